@@ -0,0 +1,76 @@
+#ifndef ENVIRONMENT_SAMPLING_HLSLI
+#define ENVIRONMENT_SAMPLING_HLSLI
+
+// GPU side of EnvironmentSampling.h.  The tables are the CPU arrays copied into buffers unchanged:
+//   StructuredBuffer<EnvAliasEntry> <- Distribution::AliasTable
+//   StructuredBuffer<float>         <- Distribution::TexelPdf
+// size is (Distribution::Width, Distribution::Height).
+
+#ifndef PI
+#define PI 3.1415926536
+#endif
+
+struct EnvAliasEntry
+{
+    float Threshold;
+    uint Alias;
+};
+
+// Row 0 is the +Y pole, same mapping as EquirectToCubeCS.
+float3 EnvUVToDirection(float2 uv)
+{
+    float phi = 2.0 * PI * uv.x;
+    float theta = PI * uv.y;
+    float sinTheta = sin(theta);
+    return float3(sinTheta * cos(phi), cos(theta), sinTheta * sin(phi));
+}
+
+float2 EnvDirectionToUV(float3 dir)
+{
+    float u = atan2(dir.z, dir.x) / (2.0 * PI);
+    float v = acos(clamp(dir.y, -1.0, 1.0)) / PI;
+    return float2(frac(u), v);
+}
+
+// Density per steradian of picking dir (normalized) with SampleEnvironment().
+float EnvironmentPdf(StructuredBuffer<float> texelPdf, uint2 size, float3 dir)
+{
+    float2 uv = EnvDirectionToUV(dir);
+    uint2 texel = min(uint2(uv * size), size - 1);
+    float sinTheta = sin(uv.y * PI);
+    return sinTheta > 0.0 ? texelPdf[texel.y * size.x + texel.x] / (2.0 * PI * PI * sinTheta) : 0.0;
+}
+
+// Picks a direction with probability proportional to the environment's luminance, u in [0, 1)^2.
+// u.x selects the texel, u.y decides between the texel and its alias and then places the sample vertically
+// inside it.  Returns the pdf per steradian in pdf.
+float3 SampleEnvironment(StructuredBuffer<EnvAliasEntry> aliasTable, StructuredBuffer<float> texelPdf, uint2 size, float2 u,
+    out float pdf)
+{
+    uint count = size.x * size.y;
+    float scaled = u.x * count;
+    uint index = min((uint)scaled, count - 1);
+    // Only a few bits of u.x are left below the texel index on a large map; this is fine for the position
+    // inside the texel but would bias the alias decision, which is why that uses u.y.
+    float du = saturate(scaled - index);
+
+    EnvAliasEntry entry = aliasTable[index];
+    float dv;
+    if (u.y < entry.Threshold)
+    {
+        dv = u.y / entry.Threshold;
+    }
+    else
+    {
+        dv = (u.y - entry.Threshold) / (1.0 - entry.Threshold);
+        index = entry.Alias;
+    }
+
+    uint2 texel = uint2(index % size.x, index / size.x);
+    float2 uv = (texel + float2(du, saturate(dv))) / size;
+    float sinTheta = sin(uv.y * PI);
+    pdf = sinTheta > 0.0 ? texelPdf[index] / (2.0 * PI * PI * sinTheta) : 0.0;
+    return EnvUVToDirection(uv);
+}
+
+#endif // ENVIRONMENT_SAMPLING_HLSLI
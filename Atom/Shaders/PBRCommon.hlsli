@@ -208,4 +208,26 @@ float SmithGGXSampleDirectionPDF(float3 V, float3 N, float3 L, float AlphaRoughn
 }
 
 
+// Order-2 SH irradiance with the basis constants folded in on the CPU (SH::PackIrradianceConstants).
+// Returns irradiance / PI, the same quantity the old irradiance cubemap stored.
+// See: Peter-Pike Sloan, "Stupid Spherical Harmonics (SH) Tricks"
+float3 EvaluateIrradianceSH(float3 N, float4 SHAr, float4 SHAg, float4 SHAb,
+                            float4 SHBr, float4 SHBg, float4 SHBb, float4 SHC)
+{
+    float4 n = float4(N, 1.0);
+    float3 x1, x2;
+    x1.r = dot(SHAr, n);
+    x1.g = dot(SHAg, n);
+    x1.b = dot(SHAb, n);
+
+    float4 vB = N.xyzz * N.yzzx;
+    x2.r = dot(SHBr, vB);
+    x2.g = dot(SHBg, vB);
+    x2.b = dot(SHBb, vB);
+
+    float3 x3 = SHC.rgb * (N.x * N.x - N.y * N.y);
+    return max(x1 + x2 + x3, 0.0);
+}
+
+
 #endif
\ No newline at end of file
@@ -2,15 +2,20 @@
 #include "PBRCommon.hlsli"
 
 
-Texture2D gAlbedeTexture : register(t0);
-Texture2D gNormalTexture : register(t1);
-Texture2D gMetalnessTexture : register(t2);
-Texture2D gRoughnessTexture : register(t3);
+// Material textures are packed into Texture2DArrays at import (see TexturePacker.h).  Every material texture is
+// viewed through one unbounded table spanning the scene texture heap; gTextureLocation says where each texture
+// lives.  The index is the same for the whole draw, so it needs no NonUniformResourceIndex.
+#define ALBEDO_TEXTURE 0
+#define NORMAL_TEXTURE 1
+#define ORM_TEXTURE 2           // R = occlusion, G = roughness, B = metallic
+#define EMISSIVE_TEXTURE 3
+#define NUM_MATERIAL_TEXTURES 4
+
+Texture2DArray gMaterialTextures[] : register(t0, space1);
 
 
 TextureCube gEnvironmentTexture : register(t10);
 TextureCube gRadianceTexture : register(t11);
-TextureCube gIrradianceMap : register(t12);
 Texture2D gSsaoMap : register(t13);
 Texture2D gShadowMap : register(t14);
 Texture2D<float2> gLUTMap : register(t15);
@@ -22,6 +27,9 @@ Texture2D gEavg : register(t19);
 cbuffer MaterialConstants : register(b0)
 {
     uint gMatIndex;
+    uint3 pad0;
+    uint4 gTextureLocation[NUM_MATERIAL_TEXTURES];
+    float4 gTextureScaleOffset[NUM_MATERIAL_TEXTURES];
 };
 
 cbuffer GlobalConstants : register(b1)
@@ -49,6 +57,17 @@ cbuffer ShaderParams : register(b2)
     float CurveFactor;
     float SpecularFactor;
 };
+
+cbuffer IrradianceSH : register(b3)
+{
+    float4 gSHAr;
+    float4 gSHAg;
+    float4 gSHAb;
+    float4 gSHBr;
+    float4 gSHBg;
+    float4 gSHBb;
+    float4 gSHC;
+};
 static const float3 g_Fdielectric = 0.04;
 
 struct VertexOut
@@ -71,6 +90,19 @@ uint querySpecularTextureLevels()
     return levels;
 }
 
+float4 SampleMaterialTexture(uint slot, float2 uv, float4 fallback)
+{
+    uint4 location = gTextureLocation[slot];
+    if (location.z == 0)
+        return fallback;
+
+    // Atlas entries only exist for textures whose UVs stay in [0, 1]; clamp so filtering never leaves the entry.
+    if (location.w != 0)
+        uv = saturate(uv);
+    uv = uv * gTextureScaleOffset[slot].xy + gTextureScaleOffset[slot].zw;
+    return gMaterialTextures[location.x].Sample(gsamAnisotropicWrap, float3(uv, location.y));
+}
+
 //https://blog.selfshadow.com/publications/s2017-shading-course/imageworks/s2017_pbs_imageworks_slides_v2.pdf
 float3 AverageFresnel(float3 r, float3 g)
 {
@@ -83,15 +115,18 @@ float4 main(VertexOut pin) : SV_Target
     float3 albedo = 0;
     float metalness = 0;
     float roughness = 0;
+    float occlusion = 1;
     float3 N = 0;
     if (UseTexture)
     {   
         // Sample input textures to get shading model params.
-        albedo = pow(gAlbedeTexture.Sample(gsamAnisotropicWrap, pin.TexC).rgb, 2.2);
-        metalness = gMetalnessTexture.Sample(gsamAnisotropicWrap, pin.TexC).r;
-        roughness = gRoughnessTexture.Sample(gsamAnisotropicWrap, pin.TexC).g;
+        albedo = pow(SampleMaterialTexture(ALBEDO_TEXTURE, pin.TexC, 1.0).rgb, 2.2);
+        float3 orm = SampleMaterialTexture(ORM_TEXTURE, pin.TexC, float4(1.0, Roughness, Metallic, 1.0)).rgb;
+        occlusion = orm.r;
+        roughness = orm.g;
+        metalness = orm.b;
         // Get current fragment's normal and transform to world space.
-        N = normalize(2.0 * gNormalTexture.Sample(gsamAnisotropicWrap, pin.TexC).rgb - 1.0);
+        N = normalize(2.0 * SampleMaterialTexture(NORMAL_TEXTURE, pin.TexC, float4(0.5, 0.5, 1.0, 1.0)).rgb - 1.0);
 	
         N = normalize(mul(N, pin.tangentBasis));
         N = normalize(pin.Normal);
@@ -181,7 +216,7 @@ float4 main(VertexOut pin) : SV_Target
             //float3 EmuV = gEmu.Sample(gsamAnisotropicClamp, float2(NoV, roughness)).rrr;
             //
             //
-            //float3 E_avg = gEavg.Sample(gsamAnisotropicClamp, float2(0, roughness)).rrr;
+            //float3 E_avg = gEavg.Sample(gsamLinearClamp, float2(roughness, 0.5)).rrr;
             
             //float3 edgetint = float3(0.827, 0.792, 0.678);
             //float3 Favg = (1.0 + F0 * 20.0) / 21.0;
@@ -199,8 +234,8 @@ float4 main(VertexOut pin) : SV_Target
 	// Ambient lighting (IBL).
     float3 ambientLighting;
 	{
-		// Sample diffuse irradiance at normal direction.
-        float3 irradiance = gIrradianceMap.Sample(gsamAnisotropicWrap, N).rgb;
+		// Evaluate diffuse irradiance at normal direction from the SH9 projection of the environment.
+        float3 irradiance = EvaluateIrradianceSH(N, gSHAr, gSHAg, gSHAb, gSHBr, gSHBg, gSHBb, gSHC);
 
 		// Calculate Fresnel term for ambient lighting.
 		// Since we use pre-filtered cubemap(s) and irradiance is coming from many directions
@@ -211,7 +246,7 @@ float4 main(VertexOut pin) : SV_Target
 		// Get diffuse contribution factor (as with direct lighting).
         float3 kd = lerp(1.0 - F, 0.0, metalness);
 
-		// Irradiance map contains exitant radiance assuming Lambertian BRDF, no need to scale by 1/PI here either.
+		// SH irradiance is pre-divided by PI (exitant radiance assuming Lambertian BRDF), no need to scale here either.
         float3 diffuseIBL = kd * albedo * irradiance;
 
 		// Sample pre-filtered specular reflection environment at correct mipmap level.
@@ -228,7 +263,7 @@ float4 main(VertexOut pin) : SV_Target
         ambientLighting = diffuseIBL + specularIBL;
     }
 
-    float ambientOcclution = 1;
+    float ambientOcclution = occlusion;
     //if(UseSSAO)
     //{
     //    pin.SsaoPosH /= pin.SsaoPosH.w;
@@ -105,8 +105,12 @@ float4 main(VertexOut pin) : SV_Target
 	//
     float3 p = (pz / pin.PosV.z) * pin.PosV;
 	
-	// Extract random vector and map from [0,1] --> [-1, +1].
-    float3 randVec = 2.0f * gRandomMap.SampleLevel(gsamLinearWrap, 4.0f * pin.TexC, 0.0f).rgb - 1.0f;
+	// Extract random vector and map from [0,1] --> [-1, +1].  The map is blue noise, so it is tiled
+	// one texel per pixel; filtering or stretching it would turn it back into low frequency noise.
+    uint randomMapSize;
+    uint randomMapHeight;
+    gRandomMap.GetDimensions(randomMapSize, randomMapHeight);
+    float3 randVec = 2.0f * gRandomMap.Load(int3(uint2(pin.PosH.xy) % randomMapSize, 0)).rgb - 1.0f;
     
     float occlusionSum = 0.0f;
 	
@@ -0,0 +1,118 @@
+#include "pch.h"
+#include "AliasingSolver.h"
+#include <algorithm>
+
+namespace
+{
+	inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+uint32_t AliasingSolver::Add(uint64_t size, uint64_t alignment, uint32_t firstPass, uint32_t lastPass)
+{
+	ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0, "Alignment must be a power of two");
+	ASSERT(firstPass <= lastPass);
+
+	m_Resources.push_back({ size, alignment, firstPass, lastPass });
+	return (uint32_t)m_Resources.size() - 1;
+}
+
+uint64_t AliasingSolver::Solve()
+{
+	std::vector<uint32_t> order(m_Resources.size());
+	for (uint32_t i = 0; i < (uint32_t)order.size(); ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+	{
+		const Resource& ra = m_Resources[a];
+		const Resource& rb = m_Resources[b];
+		if (ra.Size != rb.Size)
+			return ra.Size > rb.Size;
+		return ra.FirstPass != rb.FirstPass ? ra.FirstPass < rb.FirstPass : a < b;
+	});
+
+	struct Interval
+	{
+		uint64_t Begin;
+		uint64_t End;
+	};
+	std::vector<Interval> occupied;
+
+	m_HeapSize = 0;
+	for (size_t n = 0; n < order.size(); ++n)
+	{
+		Resource& resource = m_Resources[order[n]];
+
+		// Only the resources alive at the same time as this one constrain where it can go.
+		occupied.clear();
+		for (size_t p = 0; p < n; ++p)
+		{
+			const uint32_t placed = order[p];
+			if (LifetimesOverlap(placed, order[n]))
+				occupied.push_back({ m_Resources[placed].Offset, m_Resources[placed].Offset + m_Resources[placed].Size });
+		}
+		std::sort(occupied.begin(), occupied.end(), [](const Interval& a, const Interval& b) { return a.Begin < b.Begin; });
+
+		uint64_t bestOffset = UINT64_MAX;
+		uint64_t bestGap = UINT64_MAX;
+		uint64_t cursor = 0;
+		for (const Interval& interval : occupied)
+		{
+			const uint64_t offset = AlignUp(cursor, resource.Alignment);
+			if (interval.Begin > cursor && offset + resource.Size <= interval.Begin && interval.Begin - cursor < bestGap)
+			{
+				bestOffset = offset;
+				bestGap = interval.Begin - cursor;
+			}
+			cursor = std::max(cursor, interval.End);
+		}
+		resource.Offset = bestOffset != UINT64_MAX ? bestOffset : AlignUp(cursor, resource.Alignment);
+		m_HeapSize = std::max(m_HeapSize, resource.Offset + resource.Size);
+	}
+
+	return m_HeapSize;
+}
+
+uint64_t AliasingSolver::GetUnaliasedSize() const
+{
+	uint64_t size = 0;
+	for (const Resource& resource : m_Resources)
+		size = AlignUp(size, resource.Alignment) + resource.Size;
+	return size;
+}
+
+uint32_t AliasingSolver::GetPreviousOccupant(uint32_t index) const
+{
+	const Resource& resource = m_Resources[index];
+
+	// Within the frame, the sharer that finished last before this one starts.  Without one, this resource is
+	// the first in its memory this frame and follows the sharer that finished last in the previous frame.
+	uint32_t before = kInvalidIndex;
+	uint32_t last = kInvalidIndex;
+	for (uint32_t i = 0; i < (uint32_t)m_Resources.size(); ++i)
+	{
+		if (i == index || !MemoryOverlaps(i, index) || LifetimesOverlap(i, index))
+			continue;
+
+		const uint32_t lastPass = m_Resources[i].LastPass;
+		if (lastPass < resource.FirstPass && (before == kInvalidIndex || lastPass > m_Resources[before].LastPass))
+			before = i;
+		if (last == kInvalidIndex || lastPass > m_Resources[last].LastPass)
+			last = i;
+	}
+	return before != kInvalidIndex ? before : last;
+}
+
+bool AliasingSolver::LifetimesOverlap(uint32_t a, uint32_t b) const
+{
+	return m_Resources[a].FirstPass <= m_Resources[b].LastPass && m_Resources[b].FirstPass <= m_Resources[a].LastPass;
+}
+
+bool AliasingSolver::MemoryOverlaps(uint32_t a, uint32_t b) const
+{
+	const Resource& ra = m_Resources[a];
+	const Resource& rb = m_Resources[b];
+	return ra.Offset < rb.Offset + rb.Size && rb.Offset < ra.Offset + ra.Size;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Packs resources that are only alive during part of a frame into one heap, letting resources whose pass
+// lifetimes do not overlap share memory (see TransientHeap.h).  It only deals with sizes, alignments and pass
+// indices, so it runs without a device.
+//
+// Resources are placed largest first.  Each one goes into the smallest gap left between the resources already
+// placed whose lifetimes overlap its own, or after the last of them.
+class AliasingSolver
+{
+public:
+	static const uint32_t kInvalidIndex = ~0u;
+
+	void Reset() { m_Resources.clear(); m_HeapSize = 0; }
+
+	// Lifetime is the inclusive range of passes [firstPass, lastPass].  alignment must be a power of two.
+	uint32_t Add(uint64_t size, uint64_t alignment, uint32_t firstPass, uint32_t lastPass);
+
+	// Assigns the offsets and returns the heap size.
+	uint64_t Solve();
+
+	uint32_t GetNumResources() const { return (uint32_t)m_Resources.size(); }
+	uint64_t GetOffset(uint32_t index) const { return m_Resources[index].Offset; }
+	uint64_t GetHeapSize() const { return m_HeapSize; }
+	// What the resources take packed one after another in declaration order, without aliasing.
+	uint64_t GetUnaliasedSize() const;
+
+	// The resource that last used the memory of 'index' before its first pass, wrapping around to the previous
+	// frame, for the aliasing barrier.  kInvalidIndex when its memory is not shared.
+	uint32_t GetPreviousOccupant(uint32_t index) const;
+
+	bool LifetimesOverlap(uint32_t a, uint32_t b) const;
+	bool MemoryOverlaps(uint32_t a, uint32_t b) const;
+
+private:
+	struct Resource
+	{
+		uint64_t Size;
+		uint64_t Alignment;
+		uint32_t FirstPass;
+		uint32_t LastPass;
+		uint64_t Offset = 0;
+	};
+
+	std::vector<Resource> m_Resources;
+	uint64_t m_HeapSize = 0;
+};
@@ -3,6 +3,7 @@
 #include "GraphicsCore.h"
 #include "Display.h"
 #include "CommandListManager.h"
+#include "TransientHeap.h"
 
 DXGI_FORMAT BackBufferFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
 DXGI_FORMAT DepthStencilFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
@@ -21,7 +22,6 @@ namespace Graphics
 
 	ColorBuffer g_EnvirMap;
 	ColorBuffer g_RadianceMap;
-	ColorBuffer g_IrradianceMap;
 	ColorBuffer g_LUT;
 	ColorBuffer g_Emu;
 	ColorBuffer g_Eavg;
@@ -30,53 +30,66 @@ namespace Graphics
 	ColorBuffer g_SSSSpecularLut;
 }
 
-void Graphics::InitializeRenderingBuffers(uint32_t bufferWidth, uint32_t bufferHeight)
+namespace
 {
-	g_SceneColorBuffer.Create(L"Main Color Buffer", bufferWidth, bufferHeight, 1, BackBufferFormat);
-	g_PostProcessBuffer.Create(L"Main Color Buffer", bufferWidth, bufferHeight, 1, BackBufferFormat);
-	g_SceneDepthBuffer.Create(L"Scene Depth Buffer", bufferWidth, bufferHeight, DXGI_FORMAT_D24_UNORM_S8_UINT);
-	g_SceneNormalBuffer.Create(L"Normals Buffer", bufferWidth, bufferHeight, 1, DXGI_FORMAT_R16G16B16A16_FLOAT);
-	g_ShadowBuffer.Create(L"Shadow Map", 2048, 2048, DXGI_FORMAT_D16_UNORM);
-
-	g_SSAOFullScreen.Create(L"SSAO Full Res", bufferWidth/2, bufferHeight/2, 1, DXGI_FORMAT_R8_UNORM);
-
-	g_EnvirMap.CreateArray(L"Environment Map", 512, 512, 6, 10, DXGI_FORMAT_R16G16B16A16_FLOAT);
-	g_RadianceMap.CreateArray(L"Radiance Map", 256, 256, 6, 9, DXGI_FORMAT_R16G16B16A16_FLOAT);
-	g_IrradianceMap.CreateArray(L"Irradiance Map", 64, 64, 6, 1, DXGI_FORMAT_R8G8B8A8_UNORM);
-	g_LUT.Create(L"Specular BRDF", 512, 512, 1, DXGI_FORMAT_R16G16_FLOAT);
-	g_Emu.Create(L"emu", 512, 512, 1, DXGI_FORMAT_R32_FLOAT);
-	g_Eavg.Create(L"eavg", 512, 512, 1, DXGI_FORMAT_R32_FLOAT);
-	g_SSSDiffuseLut.Create(L"Pre-integral diffuse SSS", 512, 512, 1, DXGI_FORMAT_R16G16B16A16_FLOAT);
-	g_SSSSpecularLut.Create(L"Pre-integral specular SSS", 512, 512, 1, DXGI_FORMAT_R16G16B16A16_FLOAT);
+	TransientHeap s_TransientTargets;
+
+	void CreateDisplayDependentBuffers(uint32_t bufferWidth, uint32_t bufferHeight)
+	{
+		using namespace Graphics;
+
+		g_PostProcessBuffer.Create(L"Main Color Buffer", bufferWidth, bufferHeight, 1, BackBufferFormat);
+		g_SceneDepthBuffer.Create(L"Scene Depth Buffer", bufferWidth, bufferHeight, DXGI_FORMAT_D24_UNORM_S8_UINT);
+
+		// Every pass clears these before use, as aliased targets require.
+		g_SceneNormalBuffer.Create(L"Normals Buffer", bufferWidth, bufferHeight, 1, DXGI_FORMAT_R16G16B16A16_FLOAT,
+			s_TransientTargets, kZPrePass, kSsaoPass);
+		g_ShadowBuffer.Create(L"Shadow Map", 2048, 2048, DXGI_FORMAT_D16_UNORM, s_TransientTargets, kShadowPass, kColorPass);
+		g_SSAOFullScreen.Create(L"SSAO Full Res", bufferWidth/2, bufferHeight/2, 1, DXGI_FORMAT_R8_UNORM,
+			s_TransientTargets, kSsaoPass, kColorPass);
+		g_SceneColorBuffer.Create(L"Main Color Buffer", bufferWidth, bufferHeight, 1, BackBufferFormat,
+			s_TransientTargets, kColorPass, kPostProcessPass);
+		s_TransientTargets.Commit(L"Transient Render Targets");
+	}
 }
 
-void Graphics::ResizeDisplayDependentBuffers(uint32_t bufferWidth, uint32_t bufferHeight)
+void Graphics::BeginFramePass(CommandContext& Context, FramePass Pass)
 {
-	g_SceneColorBuffer.Create(L"Main Color Buffer", bufferWidth, bufferHeight, 1, BackBufferFormat);
-	g_PostProcessBuffer.Create(L"Main Color Buffer", bufferWidth, bufferHeight, 1, BackBufferFormat);
+	s_TransientTargets.BeginPass(Context, Pass);
+}
 
-	g_SceneDepthBuffer.Create(L"Scene Depth Buffer", bufferWidth, bufferHeight, DXGI_FORMAT_D24_UNORM_S8_UINT);
-	g_SceneNormalBuffer.Create(L"Normals Buffer", bufferWidth, bufferHeight, 1, DXGI_FORMAT_R16G16B16A16_FLOAT);
-	g_ShadowBuffer.Create(L"Shadow Map", 2048, 2048, DXGI_FORMAT_D16_UNORM);
+void Graphics::InitializeRenderingBuffers(uint32_t bufferWidth, uint32_t bufferHeight)
+{
+	CreateDisplayDependentBuffers(bufferWidth, bufferHeight);
 
-	g_SSAOFullScreen.Create(L"SSAO Full Res", bufferWidth/2, bufferHeight/2, 1, DXGI_FORMAT_R8_UNORM);
+	// Same format as IBL::BakeSettings::CubeFormat, half the size of RGBA16F and still writable by the GPU fallback passes.
+	g_EnvirMap.CreateArray(L"Environment Map", 512, 512, 6, 10, DXGI_FORMAT_R11G11B10_FLOAT);
+	g_RadianceMap.CreateArray(L"Radiance Map", 256, 256, 6, 9, DXGI_FORMAT_R11G11B10_FLOAT);
+	// Lookup tables are filled from IBL::LoadOrBakeLookupTables(), sizes and formats must match IBL::BakeSettings.
+	g_LUT.Create(L"Specular BRDF", 128, 128, 1, DXGI_FORMAT_R16G16_FLOAT);
+	g_Emu.Create(L"emu", 128, 128, 1, DXGI_FORMAT_R16_FLOAT);
+	g_Eavg.Create(L"eavg", 128, 1, 1, DXGI_FORMAT_R16_FLOAT);
+	g_SSSDiffuseLut.Create(L"Pre-integral diffuse SSS", 256, 256, 1, DXGI_FORMAT_R11G11B10_FLOAT);
+	g_SSSSpecularLut.Create(L"Pre-integral specular SSS", 256, 256, 1, DXGI_FORMAT_R16_FLOAT);
+}
 
+void Graphics::ResizeDisplayDependentBuffers(uint32_t bufferWidth, uint32_t bufferHeight)
+{
+	CreateDisplayDependentBuffers(bufferWidth, bufferHeight);
 }
 
 void Graphics::DestroyRenderingBuffers()
 {
-	g_SceneColorBuffer.Destroy();
 	g_PostProcessBuffer.Destroy();
 	g_SceneDepthBuffer.Destroy();
-	g_SceneNormalBuffer.Destroy();
-	g_ShadowBuffer.Destroy();
-	g_SSAOFullScreen.Destroy();
+	s_TransientTargets.Destroy();
 	g_RandomVectorBuffer.Destroy();
 
 	g_EnvirMap.Destroy();
 	g_RadianceMap.Destroy();
-	g_IrradianceMap.Destroy();
 	g_LUT.Destroy();
 	g_Emu.Destroy();
 	g_Eavg.Destroy();
+	g_SSSDiffuseLut.Destroy();
+	g_SSSSpecularLut.Destroy();
 }
@@ -3,6 +3,7 @@
 #include "ColorBuffer.h"
 #include "DepthBuffer.h"
 
+class CommandContext;
 
 namespace Graphics
 {
@@ -16,7 +17,6 @@ namespace Graphics
 
     extern ColorBuffer g_RadianceMap;
     extern ColorBuffer g_EnvirMap;
-    extern ColorBuffer g_IrradianceMap;
     extern ColorBuffer g_LUT;
     extern ColorBuffer g_Emu;
     extern ColorBuffer g_Eavg;
@@ -24,6 +24,22 @@ namespace Graphics
     extern ColorBuffer g_SSSDiffuseLut;
     extern ColorBuffer g_SSSSpecularLut;
 
+    // Passes of a frame in submission order.  The scene color, normal, SSAO and shadow targets only live from
+    // the pass that first writes them to the last one reading them, and share memory where these ranges do not
+    // overlap.  The post-process target is read by the overlay of the next frame, so it stays on its own.
+    enum FramePass
+    {
+        kZPrePass,
+        kShadowPass,
+        kSsaoPass,
+        kColorPass,
+        kOverlayPass,
+        kPostProcessPass
+    };
+
+    // Issues the aliasing barriers for the targets that come alive in Pass.  Call before the pass uses them.
+    void BeginFramePass(CommandContext& Context, FramePass Pass);
+
     void InitializeRenderingBuffers(uint32_t NativeWidth, uint32_t NativeHeight);
     void ResizeDisplayDependentBuffers(uint32_t NativeWidth, uint32_t NativeHeight);
     void DestroyRenderingBuffers();
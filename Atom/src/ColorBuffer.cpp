@@ -3,6 +3,7 @@
 #include "GraphicsCommon.h"
 #include "GraphicsCore.h"
 #include "CommandContext.h"
+#include "TransientHeap.h"
 
 
 void ColorBuffer::CreateDerivedViews(ID3D12Device* Device, DXGI_FORMAT Format, uint32_t ArraySize, uint32_t NumMips)
@@ -99,27 +100,49 @@ void ColorBuffer::CreateFromSwapChain(const std::wstring& Name, ID3D12Resource*
     Graphics::g_Device->CreateRenderTargetView(m_pResource.Get(), nullptr, m_RTVHandle);
 }
 
-void ColorBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t NumMips,
-    DXGI_FORMAT Format)
+D3D12_RESOURCE_DESC ColorBuffer::DescribeColorTarget(uint32_t Width, uint32_t Height, uint32_t NumMips, DXGI_FORMAT Format,
+    D3D12_CLEAR_VALUE& ClearValue)
 {
-    NumMips = (NumMips == 0 ? ComputeNumMips(Width, Height) : NumMips);
     D3D12_RESOURCE_FLAGS Flags = CombineResourceFlags();
     D3D12_RESOURCE_DESC ResourceDesc = DescribeTex2D(Width, Height, 1, NumMips, Format, Flags);
 
     ResourceDesc.SampleDesc.Count = m_FragmentCount;
     ResourceDesc.SampleDesc.Quality = 0;
 
-    D3D12_CLEAR_VALUE ClearValue = {};
+    ClearValue = {};
     ClearValue.Format = Format;
     ClearValue.Color[0] = m_ClearColor.R();
     ClearValue.Color[1] = m_ClearColor.G();
     ClearValue.Color[2] = m_ClearColor.B();
     ClearValue.Color[3] = m_ClearColor.A();
+    return ResourceDesc;
+}
+
+void ColorBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t NumMips,
+    DXGI_FORMAT Format)
+{
+    NumMips = (NumMips == 0 ? ComputeNumMips(Width, Height) : NumMips);
+    D3D12_CLEAR_VALUE ClearValue;
+    D3D12_RESOURCE_DESC ResourceDesc = DescribeColorTarget(Width, Height, NumMips, Format, ClearValue);
 
     CreateTextureResource(Graphics::g_Device, Name, ResourceDesc, ClearValue);
     CreateDerivedViews(Graphics::g_Device, Format, 1, NumMips);
 }
 
+void ColorBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t NumMips, DXGI_FORMAT Format,
+    TransientHeap& Heap, uint32_t FirstPass, uint32_t LastPass)
+{
+    NumMips = (NumMips == 0 ? ComputeNumMips(Width, Height) : NumMips);
+    D3D12_CLEAR_VALUE ClearValue;
+    D3D12_RESOURCE_DESC ResourceDesc = DescribeColorTarget(Width, Height, NumMips, Format, ClearValue);
+
+    Heap.Declare(*this, ResourceDesc, FirstPass, LastPass, [=, this](ID3D12Heap* PlacementHeap, uint64_t Offset)
+    {
+        CreatePlacedTextureResource(Graphics::g_Device, Name, ResourceDesc, ClearValue, PlacementHeap, Offset);
+        CreateDerivedViews(Graphics::g_Device, Format, 1, NumMips);
+    });
+}
+
 void ColorBuffer::CreateArray(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount, uint32_t NumMips,
     DXGI_FORMAT Format)
 {
@@ -3,6 +3,8 @@
 #include "PixelBuffer.h"
 #include "Color.h"
 
+class TransientHeap;
+
 
 class ColorBuffer : public PixelBuffer
 {
@@ -20,6 +22,9 @@ public:
     void CreateFromSwapChain(const std::wstring& name, ID3D12Resource* baseResource);
 
     void Create(const std::wstring& name, uint32_t width, uint32_t height, uint32_t numMips, DXGI_FORMAT format);
+    // Transient target used from firstPass to lastPass; heap creates it on Commit().
+    void Create(const std::wstring& name, uint32_t width, uint32_t height, uint32_t numMips, DXGI_FORMAT format,
+        TransientHeap& heap, uint32_t firstPass, uint32_t lastPass);
     void CreateArray(const std::wstring& name, uint32_t width, uint32_t height, uint32_t arrayCount,uint32_t numMips, DXGI_FORMAT format);
 
     // Get pre-created CPU-visible descriptor handles
@@ -32,6 +37,7 @@ public:
 
 protected:
     void CreateDerivedViews(ID3D12Device* device, DXGI_FORMAT format, uint32_t arraySize, uint32_t numMips = 1);
+    D3D12_RESOURCE_DESC DescribeColorTarget(uint32_t width, uint32_t height, uint32_t numMips, DXGI_FORMAT format, D3D12_CLEAR_VALUE& clearValue);
 
     
 protected:
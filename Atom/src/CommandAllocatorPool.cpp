@@ -24,27 +24,24 @@ void CommandAllocatorPool::Shutdown()
 	}
 
 	m_AllocatorPool.clear();
+	m_RetiredAllocators.Clear();
+	m_ReadyAllocators.clear();
 }
 
 ID3D12CommandAllocator* CommandAllocatorPool::RequestAllocator(uint64_t CompletedFenceValue)
 {
     std::lock_guard<std::mutex> LockGuard(m_AllocatorMutex);
 
+    m_RetiredAllocators.Process([CompletedFenceValue](uint64_t FenceValue) { return FenceValue <= CompletedFenceValue; });
+
     ID3D12CommandAllocator* pAllocator = nullptr;
-    
+
     if (!m_ReadyAllocators.empty())
     {
-        std::pair<uint64_t, ID3D12CommandAllocator*>& AllocatorPair = m_ReadyAllocators.front();
-
-        // AllocatorPair.first <= CompletedFenceValue
-        // ˵GPUʹõǰAllocator
-        if (AllocatorPair.first <= CompletedFenceValue)
-        {
-            pAllocator = AllocatorPair.second;
-            // ڴ
-            ASSERT_SUCCEEDED(pAllocator->Reset());
-            m_ReadyAllocators.pop();
-        }
+        // The GPU is done with the commands recorded in it, so its memory can be reused.
+        pAllocator = m_ReadyAllocators.back();
+        ASSERT_SUCCEEDED(pAllocator->Reset());
+        m_ReadyAllocators.pop_back();
     }
 
     if (pAllocator == nullptr)
@@ -59,10 +56,9 @@ ID3D12CommandAllocator* CommandAllocatorPool::RequestAllocator(uint64_t Complete
     return pAllocator;
 }
 
-// ʾ GPU ִ FenceValue ֵ
+// The allocator is reused once the queue has passed FenceValue.
 void CommandAllocatorPool::DiscardAllocator(uint64_t FenceValue, ID3D12CommandAllocator* Allocator)
 {
-    std::lock_guard<std::mutex> LockGuard(m_AllocatorMutex);
-
-    m_ReadyAllocators.push(std::make_pair(FenceValue, Allocator));
+    // Runs in RequestAllocator(), with m_AllocatorMutex held.
+    m_RetiredAllocators.Defer(FenceValue, [this, Allocator] { m_ReadyAllocators.push_back(Allocator); });
 }
\ No newline at end of file
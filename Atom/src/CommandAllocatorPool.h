@@ -1,5 +1,6 @@
 #pragma once
 
+#include "DeferredReleaseQueue.h"
 
 class CommandAllocatorPool
 {
@@ -20,7 +21,8 @@ private:
 
 	ID3D12Device* m_Device;
 	std::vector<ID3D12CommandAllocator*> m_AllocatorPool;
-	std::queue<std::pair<uint64_t, ID3D12CommandAllocator*>> m_ReadyAllocators;
+	DeferredReleaseQueue m_RetiredAllocators;
+	std::vector<ID3D12CommandAllocator*> m_ReadyAllocators;
 	std::mutex m_AllocatorMutex;
 };
 
@@ -4,6 +4,7 @@
 #include "DepthBuffer.h"
 #include "GraphicsCore.h"
 #include "DescriptorHeap.h"
+#include "UploadBatch.h"
 //#include "EngineProfiling.h"
 
 //#include "ReadbackBuffer.h"
@@ -62,7 +63,7 @@ void CommandContext::DestroyAllContexts(void)
     g_ContextManager.DestroyAllContexts();
 }
 
-CommandContext& CommandContext::Begin(const std::wstring ID)
+CommandContext& CommandContext::Begin(std::wstring_view ID)
 {
     CommandContext* NewContext = g_ContextManager.AllocateContext(D3D12_COMMAND_LIST_TYPE_DIRECT);
     NewContext->SetID(ID);
@@ -71,7 +72,7 @@ CommandContext& CommandContext::Begin(const std::wstring ID)
     return *NewContext;
 }
 
-ComputeContext& ComputeContext::Begin(const std::wstring& ID, bool Async)
+ComputeContext& ComputeContext::Begin(std::wstring_view ID, bool Async)
 {
     ComputeContext& NewContext = g_ContextManager.AllocateContext(
         Async ? D3D12_COMMAND_LIST_TYPE_COMPUTE : D3D12_COMMAND_LIST_TYPE_DIRECT)->GetComputeContext();
@@ -454,17 +455,29 @@ void CommandContext::InsertAliasBarrier(GpuResource& Before, GpuResource& After,
 
 void CommandContext::InitializeTexture(GpuResource& Dest, UINT NumSubresources, D3D12_SUBRESOURCE_DATA SubData[])
 {
-    UINT64 uploadBufferSize = GetRequiredIntermediateSize(Dest.GetResource(), 0, NumSubresources);
+    if (UploadBatch* Batch = UploadBatch::GetCurrent())
+    {
+        Batch->AddTexture(Dest, NumSubresources, SubData);
+        return;
+    }
 
-    CommandContext& InitContext = CommandContext::Begin();
+    // Execute the command list and wait for it to finish so we can release the upload buffer
+    UploadBatch Batch(L"Initialize Texture");
+    Batch.AddTexture(Dest, NumSubresources, SubData);
+    Batch.Submit(true);
+}
 
-    // copy data to the intermediate upload heap and then schedule a copy from the upload heap to the default texture
-    DynAlloc mem = InitContext.ReserveUploadMemory(uploadBufferSize);
-    UpdateSubresources(InitContext.m_CommandList, Dest.GetResource(), mem.Buffer.GetResource(), 0, 0, NumSubresources, SubData);
-    InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ);
+void CommandContext::InitializeBuffer(GpuResource& Dest, const void* Data, size_t NumBytes, size_t DestOffset)
+{
+    if (UploadBatch* Batch = UploadBatch::GetCurrent())
+    {
+        Batch->AddBuffer(Dest, Data, NumBytes, DestOffset);
+        return;
+    }
 
-    // Execute the command list and wait for it to finish so we can release the upload buffer
-    InitContext.Finish(true);
+    UploadBatch Batch(L"Initialize Buffer");
+    Batch.AddBuffer(Dest, Data, NumBytes, DestOffset);
+    Batch.Submit(true);
 }
 
 void CommandContext::CopySubresource(GpuResource& Dest, UINT DestSubIndex, GpuResource& Src, UINT SrcSubIndex)
@@ -550,22 +563,6 @@ void CommandContext::InitializeTextureArraySlice(GpuResource& Dest, UINT SliceIn
 //    return PlacedFootprint.Footprint.RowPitch;
 //}
 
-//void CommandContext::InitializeBuffer(GpuBuffer& Dest, const void* BufferData, size_t NumBytes, size_t DestOffset)
-//{
-//    CommandContext& InitContext = CommandContext::Begin();
-//
-//    DynAlloc mem = InitContext.ReserveUploadMemory(NumBytes);
-//    SIMDMemCopy(mem.DataPtr, BufferData, Math::DivideByMultiple(NumBytes, 16));
-//
-//    // copy data to the intermediate upload heap and then schedule a copy from the upload heap to the default texture
-//    InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_COPY_DEST, true);
-//    InitContext.m_CommandList->CopyBufferRegion(Dest.GetResource(), DestOffset, mem.Buffer.GetResource(), 0, NumBytes);
-//    InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ, true);
-//
-//    // Execute the command list and wait for it to finish so we can release the upload buffer
-//    InitContext.Finish(true);
-//}
-
 //void CommandContext::InitializeBuffer(GpuBuffer& Dest, const UploadBuffer& Src, size_t SrcOffset, size_t NumBytes, size_t DestOffset)
 //{
 //    CommandContext& InitContext = CommandContext::Begin();
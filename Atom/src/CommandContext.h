@@ -84,7 +84,7 @@ public:
 
     static void DestroyAllContexts(void);
 
-    static CommandContext& Begin(const std::wstring ID = L"");
+    static CommandContext& Begin(std::wstring_view ID = L"");
 
     // Flush existing commands to the GPU but keep the context alive
     uint64_t Flush(bool WaitForCompletion = false);
@@ -119,13 +119,14 @@ public:
     // and returns row pitch in bytes.
     uint32_t ReadbackTexture(ReadbackBuffer& DstBuffer, PixelBuffer& SrcBuffer);
 
-    DynAlloc ReserveUploadMemory(size_t SizeInBytes)
+    DynAlloc ReserveUploadMemory(size_t SizeInBytes, size_t Alignment = DEFAULT_ALIGN)
     {
-        return m_CpuLinearAllocator.Allocate(SizeInBytes);
+        return m_CpuLinearAllocator.Allocate(SizeInBytes, Alignment);
     }
 
+    // Both add to the thread's current UploadBatch if there is one, otherwise they upload and wait.
     static void InitializeTexture(GpuResource& Dest, UINT NumSubresources, D3D12_SUBRESOURCE_DATA SubData[]);
-    //static void InitializeBuffer(GpuBuffer& Dest, const void* Data, size_t NumBytes, size_t DestOffset = 0);
+    static void InitializeBuffer(GpuResource& Dest, const void* Data, size_t NumBytes, size_t DestOffset = 0);
     //static void InitializeBuffer(GpuBuffer& Dest, const UploadBuffer& Src, size_t SrcOffset, size_t NumBytes = -1, size_t DestOffset = 0);
     static void InitializeTextureArraySlice(GpuResource& Dest, UINT SliceIndex, GpuResource& Src);
 
@@ -174,7 +175,8 @@ protected:
     LinearAllocator m_GpuLinearAllocator;
 
     std::wstring m_ID;
-    void SetID(const std::wstring& ID) { m_ID = ID; }
+    // Reuses the pooled context's string, so a per frame ID only allocates the first time.
+    void SetID(std::wstring_view ID) { m_ID.assign(ID); }
 
     D3D12_COMMAND_LIST_TYPE m_Type;
 };
@@ -183,7 +185,7 @@ class GraphicsContext : public CommandContext
 {
 public:
 
-    static GraphicsContext& Begin(const std::wstring& ID = L"")
+    static GraphicsContext& Begin(std::wstring_view ID = L"")
     {
         return CommandContext::Begin(ID).GetGraphicsContext();
     }
@@ -259,7 +261,7 @@ class ComputeContext : public CommandContext
 {
 public:
 
-    static ComputeContext& Begin(const std::wstring& ID = L"", bool Async = false);
+    static ComputeContext& Begin(std::wstring_view ID = L"", bool Async = false);
 
     //void ClearUAV(GpuBuffer& Target);
     void ClearUAV(ColorBuffer& Target);
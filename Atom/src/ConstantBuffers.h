@@ -4,9 +4,23 @@
 #include "Math/Vector.h"
 
 
+enum MaterialTextureSlot
+{
+    kAlbedoTexture,
+    kNormalTexture,
+    kORMTexture,        // R = occlusion, G = roughness, B = metallic
+    kEmissiveTexture,
+    kNumMaterialTextures
+};
+
 __declspec(align(256)) struct MaterialConstants
 {
     uint32_t gMatIndex;
+    uint32_t pad0[3];
+    // Per slot: x = index in Renderer::s_TextureHeap, y = array slice, z = present, w = atlased
+    DirectX::XMUINT4 TextureLocation[kNumMaterialTextures];
+    // Per slot: page uv = uv * xy + zw
+    DirectX::XMFLOAT4 TextureScaleOffset[kNumMaterialTextures];
 };
 
 __declspec(align(256)) struct GlobalConstants
@@ -20,6 +34,18 @@ __declspec(align(256)) struct GlobalConstants
     Math::Vector3 SunPos = { 0.0f, 0.0f, 0.0f };
 };
 
+// SH9 diffuse irradiance with the basis constants pre-multiplied, see SH::PackIrradianceConstants()
+__declspec(align(256)) struct IrradianceSHConstants
+{
+    DirectX::XMFLOAT4 SHAr = {};
+    DirectX::XMFLOAT4 SHAg = {};
+    DirectX::XMFLOAT4 SHAb = {};
+    DirectX::XMFLOAT4 SHBr = {};
+    DirectX::XMFLOAT4 SHBg = {};
+    DirectX::XMFLOAT4 SHBb = {};
+    DirectX::XMFLOAT4 SHC = {};
+};
+
 __declspec(align(256)) struct SsaoConstants
 {
     Math::Matrix4 Proj{ Math::kIdentity };
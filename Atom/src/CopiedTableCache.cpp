@@ -0,0 +1,26 @@
+#include "pch.h"
+#include "CopiedTableCache.h"
+#include "Hash.h"
+#include <algorithm>
+
+uint32_t CopiedTableCache::Find(const size_t* sources, uint32_t count) const
+{
+	const size_t hash = Utility::HashState(sources, count);
+
+	auto range = m_Entries.equal_range(hash);
+	for (auto iter = range.first; iter != range.second; ++iter)
+	{
+		const Entry& entry = iter->second;
+		if (entry.KeyCount == count && std::equal(sources, sources + count, m_Keys.data() + entry.KeyStart))
+			return entry.HeapOffset;
+	}
+	return kNotFound;
+}
+
+void CopiedTableCache::Insert(const size_t* sources, uint32_t count, uint32_t heapOffset)
+{
+	const size_t hash = Utility::HashState(sources, count);
+
+	m_Entries.insert({ hash, { (uint32_t)m_Keys.size(), count, heapOffset } });
+	m_Keys.insert(m_Keys.end(), sources, sources + count);
+}
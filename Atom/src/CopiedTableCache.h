@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Remembers where descriptor tables were copied in a shader-visible heap, keyed by the CPU handles of their
+// source descriptors, so that a table staged again with the same descriptors is rebound instead of copied (see
+// DynamicDescriptorHeap).  It only deals with handle values and heap offsets, so it runs without a device.
+//
+// Entries point into one heap and stay valid until that heap is retired; the owner clears the cache when it
+// moves to another heap.  Sources are compared by handle, not by content, so a view rewritten in place is not
+// seen until the next heap.
+class CopiedTableCache
+{
+public:
+	static const uint32_t kNotFound = ~0u;
+
+	// sources holds one CPU handle per table slot, 0 for slots that were not set.  Returns the heap offset of a
+	// table copied from exactly these sources, or kNotFound.
+	uint32_t Find(const size_t* sources, uint32_t count) const;
+	void Insert(const size_t* sources, uint32_t count, uint32_t heapOffset);
+
+	void Clear() { m_Entries.clear(); m_Keys.clear(); }
+	uint32_t GetNumTables() const { return (uint32_t)m_Entries.size(); }
+
+private:
+	struct Entry
+	{
+		uint32_t KeyStart;
+		uint32_t KeyCount;
+		uint32_t HeapOffset;
+	};
+
+	std::unordered_multimap<size_t, Entry> m_Entries;
+	std::vector<size_t> m_Keys;
+};
@@ -0,0 +1,63 @@
+#include "pch.h"
+#include "DeferredRelease.h"
+#include "GraphicsCore.h"
+#include "CommandListManager.h"
+
+using namespace Graphics;
+
+DeferredReleaseQueue DeferredRelease::g_Queue;
+
+namespace
+{
+	std::atomic<bool> s_IsShutDown(false);
+
+	bool IsFenceComplete(uint64_t FenceValue)
+	{
+		return g_CommandManager.IsFenceComplete(FenceValue);
+	}
+}
+
+bool DeferredRelease::IsShutDown(void)
+{
+	return s_IsShutDown.load(std::memory_order_relaxed);
+}
+
+void DeferredRelease::Release(IUnknown* Object)
+{
+	if (Object == nullptr)
+		return;
+
+	if (!IsShutDown())
+	{
+		const D3D12_COMMAND_LIST_TYPE Types[] = { D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_LIST_TYPE_COMPUTE, D3D12_COMMAND_LIST_TYPE_COPY };
+		for (D3D12_COMMAND_LIST_TYPE Type : Types)
+		{
+			// Each busy queue holds a reference of its own, so the object goes with the last of them.
+			CommandQueue& Queue = g_CommandManager.GetQueue(Type);
+			const uint64_t LastSubmitted = Queue.GetNextFenceValue() - 1;
+			if (Queue.IsReady() && !Queue.IsFenceComplete(LastSubmitted))
+			{
+				Object->AddRef();
+				g_Queue.Defer(LastSubmitted, [Object] { Object->Release(); });
+			}
+		}
+	}
+	Object->Release();
+}
+
+void DeferredRelease::Process(void)
+{
+	g_Queue.Process(IsFenceComplete);
+}
+
+void DeferredRelease::Shutdown(void)
+{
+	// Releases deferred from now on run right away.
+	s_IsShutDown = true;
+	g_Queue.Flush();
+}
+
+DeferredReleaseQueue::Stats DeferredRelease::GetStats(void)
+{
+	return g_Queue.GetStats();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "DeferredReleaseQueue.h"
+
+// The engine-wide DeferredReleaseQueue, keyed by the fences of Graphics::g_CommandManager.  It holds releases that
+// may wait a frame; pools that recycle entries keep their own queue and poll it when they run dry.
+namespace DeferredRelease
+{
+	extern DeferredReleaseQueue g_Queue;
+
+	// Set by Shutdown(): after it the GPU is idle and releases run immediately.
+	bool IsShutDown(void);
+
+	// Runs Release once the queue that FenceValue belongs to has passed it.
+	template <typename Fn> void Defer(uint64_t FenceValue, Fn&& Release)
+	{
+		if (IsShutDown())
+			Release();
+		else
+			g_Queue.Defer(FenceValue, std::forward<Fn>(Release));
+	}
+
+	// Takes over a reference to Object and drops it once every command queue has finished the work submitted so
+	// far, for objects that may still be in flight.  Queues with nothing pending are not waited for.
+	void Release(IUnknown* Object);
+	template <typename T> void Release(Microsoft::WRL::ComPtr<T>& Object)
+	{
+		if (Object != nullptr)
+			Release(static_cast<IUnknown*>(Object.Detach()));
+	}
+
+	// Runs what the GPU is done with.  Called once a frame by Display::Present().
+	void Process(void);
+	// Runs everything.  Called by Graphics::Shutdown() once the GPU is idle.
+	void Shutdown(void);
+
+	DeferredReleaseQueue::Stats GetStats(void);
+}
@@ -0,0 +1,54 @@
+#include "pch.h"
+#include "DeferredReleaseQueue.h"
+#include <algorithm>
+
+void DeferredReleaseQueue::Push(const Entry& entry)
+{
+	const uint32_t queue = (uint32_t)(entry.FenceValue >> 56);
+	ASSERT(queue < kNumQueues, "Fence value without a queue type");
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Pending[queue].push_back(entry);
+	const uint32_t numPending = m_NumPending.load(std::memory_order_relaxed) + 1;
+	m_NumPending.store(numPending, std::memory_order_relaxed);
+	m_Stats.PeakPending = std::max(m_Stats.PeakPending, numPending);
+	++m_Stats.NumDeferred;
+}
+
+void DeferredReleaseQueue::OnTaken(uint32_t count)
+{
+	m_NumPending.store(m_NumPending.load(std::memory_order_relaxed) - count, std::memory_order_relaxed);
+	m_Stats.NumReleased += count;
+}
+
+uint32_t DeferredReleaseQueue::Run(Entry* entries, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; ++i)
+		entries[i].Invoke(entries[i].Callback);
+	return count;
+}
+
+uint32_t DeferredReleaseQueue::Flush(void)
+{
+	// Until callbacks stop deferring more work.
+	uint32_t count = 0;
+	while (const uint32_t ran = Process([](uint64_t) { return true; }))
+		count += ran;
+	return count;
+}
+
+void DeferredReleaseQueue::Clear(void)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (std::deque<Entry>& pending : m_Pending)
+		pending.clear();
+	m_NumPending.store(0, std::memory_order_relaxed);
+}
+
+DeferredReleaseQueue::Stats DeferredReleaseQueue::GetStats(void) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	Stats stats = m_Stats;
+	stats.NumPending = m_NumPending.load(std::memory_order_relaxed);
+	return stats;
+}
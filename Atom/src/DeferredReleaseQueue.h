@@ -0,0 +1,105 @@
+#pragma once
+
+#include "FrameArena.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+// Runs callbacks once the GPU has passed a fence value, for whatever the work submitted before it may still use:
+// pool entries to recycle, objects to release.  It only deals with fence values, so it runs without a device (see
+// DeferredRelease.h for the engine-wide queue keyed by the command queues).
+//
+// Fence values carry their queue type in the top byte and only increase within one queue, so entries wait in one
+// FIFO per queue and a busy queue does not hold back another one's.  An entry deferred after one with a later
+// fence value of the same queue, e.g. by two threads finishing contexts at once, waits for that one too.
+//
+// Callbacks are stored inline: any trivially copyable callable of up to kMaxCallbackSize bytes, typically a lambda
+// capturing a pointer or two.  Process() takes every completed entry in one lock, then runs the callbacks on the
+// calling thread after releasing it.  Callbacks may defer more work, and an owner may call Process() while holding
+// the lock its callbacks rely on.
+class DeferredReleaseQueue
+{
+public:
+	static const uint32_t kNumQueues = 4;
+	static const size_t kMaxCallbackSize = 4 * sizeof(void*);
+
+	struct Stats
+	{
+		uint32_t NumPending = 0;
+		uint32_t PeakPending = 0;
+		uint64_t NumDeferred = 0;       // since creation
+		uint64_t NumReleased = 0;
+	};
+
+	DeferredReleaseQueue() = default;
+	DeferredReleaseQueue(const DeferredReleaseQueue&) = delete;
+	DeferredReleaseQueue& operator=(const DeferredReleaseQueue&) = delete;
+
+	// release() runs once isFenceComplete(fenceValue) holds in a later Process().
+	template <typename Fn> void Defer(uint64_t fenceValue, Fn&& release)
+	{
+		using Callback = std::decay_t<Fn>;
+		static_assert(sizeof(Callback) <= kMaxCallbackSize && alignof(Callback) <= alignof(void*), "Callback too large to store inline");
+		static_assert(std::is_trivially_copyable_v<Callback> && std::is_trivially_destructible_v<Callback>,
+			"Callbacks are copied as bytes and never destroyed; capture raw pointers and values only");
+
+		Entry entry;
+		entry.FenceValue = fenceValue;
+		entry.Invoke = [](void* callback) { (*static_cast<Callback*>(callback))(); };
+		new (entry.Callback) Callback(std::forward<Fn>(release));
+		Push(entry);
+	}
+
+	// Runs the callbacks of the entries whose fence has completed and returns how many ran.  isFenceComplete is
+	// asked about the oldest entry of each queue until one is still pending.
+	template <typename IsComplete> uint32_t Process(IsComplete&& isFenceComplete)
+	{
+		if (m_NumPending.load(std::memory_order_relaxed) == 0)
+			return 0;
+
+		std::pmr::vector<Entry> batch(FrameAllocator::Get());
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			// One block, which the arena takes back when the batch goes out of scope.
+			batch.reserve(m_NumPending.load(std::memory_order_relaxed));
+			for (std::deque<Entry>& pending : m_Pending)
+			{
+				while (!pending.empty() && isFenceComplete(pending.front().FenceValue))
+				{
+					batch.push_back(pending.front());
+					pending.pop_front();
+				}
+			}
+			OnTaken((uint32_t)batch.size());
+		}
+		return Run(batch.data(), (uint32_t)batch.size());
+	}
+
+	// Runs every pending callback without looking at the fences, once the GPU is idle.
+	uint32_t Flush(void);
+	// Drops the pending entries without running them, for an owner that destroys what they refer to.
+	void Clear(void);
+
+	uint32_t GetNumPending(void) const { return m_NumPending.load(std::memory_order_relaxed); }
+	Stats GetStats(void) const;
+
+private:
+	struct Entry
+	{
+		uint64_t FenceValue;
+		void (*Invoke)(void* callback);
+		alignas(void*) unsigned char Callback[kMaxCallbackSize];
+	};
+
+	void Push(const Entry& entry);
+	void OnTaken(uint32_t count);       // m_Mutex held
+	static uint32_t Run(Entry* entries, uint32_t count);
+
+	mutable std::mutex m_Mutex;
+	std::deque<Entry> m_Pending[kNumQueues];
+	std::atomic<uint32_t> m_NumPending = 0;
+	Stats m_Stats;
+};
@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "DepthBuffer.h"
 #include "GraphicsCore.h"
+#include "TransientHeap.h"
 
 void DepthBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format)
 {
@@ -15,6 +16,23 @@ void DepthBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Heig
     CreateDerivedViews(Graphics::g_Device, Format);
 }
 
+void DepthBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format,
+    TransientHeap& Heap, uint32_t FirstPass, uint32_t LastPass)
+{
+	D3D12_RESOURCE_DESC ResourceDesc = DescribeTex2D(Width, Height, 1, 1, Format, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+
+    D3D12_CLEAR_VALUE ClearValue = {};
+    ClearValue.Format = Format;
+    ClearValue.DepthStencil.Depth = 1.0f;
+    ClearValue.DepthStencil.Stencil = 0;
+
+    Heap.Declare(*this, ResourceDesc, FirstPass, LastPass, [=, this](ID3D12Heap* PlacementHeap, uint64_t Offset)
+    {
+        CreatePlacedTextureResource(Graphics::g_Device, Name, ResourceDesc, ClearValue, PlacementHeap, Offset);
+        CreateDerivedViews(Graphics::g_Device, Format);
+    });
+}
+
 void DepthBuffer::CreateDerivedViews(ID3D12Device* Device, DXGI_FORMAT Format)
 {
     ID3D12Resource* Resource = m_pResource.Get();
@@ -2,6 +2,8 @@
 
 #include "PixelBuffer.h"
 
+class TransientHeap;
+
 class DepthBuffer : public PixelBuffer
 {
 public:
@@ -18,6 +20,9 @@ public:
 
     // Create a depth buffer.
     void Create(const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format);
+    // Transient target used from FirstPass to LastPass; Heap creates it on Commit().
+    void Create(const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format,
+        TransientHeap& Heap, uint32_t FirstPass, uint32_t LastPass);
 
     // Get pre-created CPU-visible descriptor handles
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetDSV() const { return m_hDSV[0]; }
@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "DescriptorHeap.h"
 #include "GraphicsCore.h"
+#include "GpuMemory.h"
 #include "CommandListManager.h"
 
 using namespace Graphics;
@@ -34,22 +35,55 @@ ID3D12DescriptorHeap* DescriptorAllocator::RequestNewHeap(D3D12_DESCRIPTOR_HEAP_
 
 D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::Allocate(uint32_t Count)
 {
-    if (m_CurrentHeap == nullptr || m_RemainingFreeHandles < Count)
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    m_Ranges.Reclaim([](uint64_t FenceValue) { return g_CommandManager.IsFenceComplete(FenceValue); });
+
+    DescriptorRangeAllocator::Range Range;
+    if (!m_Ranges.Allocate(Count, Range))
     {
-        m_CurrentHeap = RequestNewHeap(m_Type);
-        m_CurrentHandle = m_CurrentHeap->GetCPUDescriptorHandleForHeapStart();
-        m_RemainingFreeHandles = sm_NumDescriptorsPerHeap;
+        const uint32_t Heap = m_Ranges.AddHeap();
+        if (Heap >= m_HeapStarts.size())
+            m_HeapStarts.resize(Heap + 1);
+        m_HeapStarts[Heap] = RequestNewHeap(m_Type)->GetCPUDescriptorHandleForHeapStart();
 
         if (m_DescriptorSize == 0)
             m_DescriptorSize = Graphics::g_Device->GetDescriptorHandleIncrementSize(m_Type);
+
+        const bool Allocated = m_Ranges.Allocate(Count, Range);
+        ASSERT(Allocated, "A new descriptor heap cannot hold the range");
     }
 
-    D3D12_CPU_DESCRIPTOR_HANDLE ret = m_CurrentHandle;
-    m_CurrentHandle.ptr += Count * m_DescriptorSize;
-    m_RemainingFreeHandles -= Count;
+    D3D12_CPU_DESCRIPTOR_HANDLE ret = m_HeapStarts[Range.Heap];
+    ret.ptr += (size_t)Range.Offset * m_DescriptorSize;
     return ret;
 }
 
+void DescriptorAllocator::Free(D3D12_CPU_DESCRIPTOR_HANDLE Handle)
+{
+    // Views created from this descriptor may be in tables the GPU reads until the current fence.
+    const uint64_t FenceValue = g_CommandManager.GetGraphicsQueue().GetNextFenceValue();
+    const size_t HeapBytes = (size_t)sm_NumDescriptorsPerHeap * m_DescriptorSize;
+
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    for (uint32_t Heap = 0; Heap < (uint32_t)m_HeapStarts.size(); ++Heap)
+    {
+        if (Handle.ptr >= m_HeapStarts[Heap].ptr && Handle.ptr < m_HeapStarts[Heap].ptr + HeapBytes)
+        {
+            m_Ranges.Free(Heap, (uint32_t)((Handle.ptr - m_HeapStarts[Heap].ptr) / m_DescriptorSize), FenceValue);
+            return;
+        }
+    }
+    ASSERT(false, "Descriptor was not allocated by this allocator");
+}
+
+DescriptorRangeAllocator::Stats DescriptorAllocator::GetStats(void)
+{
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    return m_Ranges.GetStats();
+}
+
 //
 // DescriptorHeap implementation
 //
@@ -62,6 +96,7 @@ void DescriptorHeap::Create(const std::wstring& Name, D3D12_DESCRIPTOR_HEAP_TYPE
     m_HeapDesc.NodeMask = 1;
 
     ASSERT_SUCCEEDED(g_Device->CreateDescriptorHeap(&m_HeapDesc, IID_PPV_ARGS(m_Heap.ReleaseAndGetAddressOf())));
+    GpuMemory::Track(m_Heap.Get());
 
 #ifdef RELEASE
     (void)Name;
@@ -70,20 +105,44 @@ void DescriptorHeap::Create(const std::wstring& Name, D3D12_DESCRIPTOR_HEAP_TYPE
 #endif
 
     m_DescriptorSize = g_Device->GetDescriptorHandleIncrementSize(m_HeapDesc.Type);
-    m_NumFreeDescriptors = m_HeapDesc.NumDescriptors;
+    m_Ranges.reset(new DescriptorRangeAllocator(MaxCount));
+    m_Ranges->AddHeap();
     m_FirstHandle = DescriptorHandle(
         m_Heap->GetCPUDescriptorHandleForHeapStart(),
         m_Heap->GetGPUDescriptorHandleForHeapStart());
-    m_NextFreeHandle = m_FirstHandle;
+}
+
+bool DescriptorHeap::HasAvailableSpace(uint32_t Count)
+{
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    m_Ranges->Reclaim([](uint64_t FenceValue) { return g_CommandManager.IsFenceComplete(FenceValue); });
+    return Count <= m_Ranges->GetStats().LargestFreeRange;
 }
 
 DescriptorHandle DescriptorHeap::Alloc(uint32_t Count)
 {
-    ASSERT(HasAvailableSpace(Count), "Descriptor Heap out of space.  Increase heap size.");
-    DescriptorHandle ret = m_NextFreeHandle;
-    m_NextFreeHandle += Count * m_DescriptorSize;
-    m_NumFreeDescriptors -= Count;
-    return ret;
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    m_Ranges->Reclaim([](uint64_t FenceValue) { return g_CommandManager.IsFenceComplete(FenceValue); });
+
+    DescriptorRangeAllocator::Range Range;
+    const bool Allocated = m_Ranges->Allocate(Count, Range);
+    ASSERT(Allocated, "Descriptor Heap out of space.  Increase heap size.");
+    return m_FirstHandle + Range.Offset * m_DescriptorSize;
+}
+
+void DescriptorHeap::Free(const DescriptorHandle& Handle)
+{
+    ASSERT(ValidateHandle(Handle));
+    const uint64_t FenceValue = g_CommandManager.GetGraphicsQueue().GetNextFenceValue();
+
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    m_Ranges->Free(0, GetOffsetOfHandle(Handle), FenceValue);
+}
+
+DescriptorRangeAllocator::Stats DescriptorHeap::GetStats(void)
+{
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    return m_Ranges->GetStats();
 }
 
 bool DescriptorHeap::ValidateHandle(const DescriptorHandle& DHandle) const
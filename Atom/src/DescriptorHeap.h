@@ -1,34 +1,40 @@
 #pragma once
 
+#include "DescriptorRangeAllocator.h"
+
 
 // This is an unbounded resource descriptor allocator.  It is intended to provide space for CPU-visible
 // resource descriptors as resources are created.  For those that need to be made shader-visible, they
-// will need to be copied to a DescriptorHeap or a DynamicDescriptorHeap.
+// will need to be copied to a DescriptorHeap or a DynamicDescriptorHeap.  Freed descriptors are reused
+// once the GPU has finished the work recorded before the free; a new heap is added when none has room.
 class DescriptorAllocator
 {
 public:
     DescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE Type) :
-        m_Type(Type), m_CurrentHeap(nullptr), m_DescriptorSize(0)
+        m_Type(Type), m_Ranges(sm_NumDescriptorsPerHeap), m_DescriptorSize(0)
     {
-        m_CurrentHandle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
     }
 
     D3D12_CPU_DESCRIPTOR_HANDLE Allocate(uint32_t Count);
+    // Handle must be the start of a range returned by Allocate().
+    void Free(D3D12_CPU_DESCRIPTOR_HANDLE Handle);
+
+    DescriptorRangeAllocator::Stats GetStats(void);
 
     static void DestroyAll(void);
 
 protected:
 
-    static const uint32_t sm_NumDescriptorsPerHeap = 256;
+    static const uint32_t sm_NumDescriptorsPerHeap = 1024;
     static std::mutex sm_AllocationMutex;
     static std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> sm_DescriptorHeapPool;
     static ID3D12DescriptorHeap* RequestNewHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type);
 
+    std::mutex m_Mutex;   // Allocate() may be called from texture loading threads
     D3D12_DESCRIPTOR_HEAP_TYPE m_Type;
-    ID3D12DescriptorHeap* m_CurrentHeap;
-    D3D12_CPU_DESCRIPTOR_HANDLE m_CurrentHandle;
+    DescriptorRangeAllocator m_Ranges;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_HeapStarts;     // indexed by DescriptorRangeAllocator heap
     uint32_t m_DescriptorSize;
-    uint32_t m_RemainingFreeHandles;
 };
 
 // This handle refers to a descriptor or a descriptor table (contiguous descriptors) that is shader visible.
@@ -94,8 +100,13 @@ public:
     void Create(const std::wstring& DebugHeapName, D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t MaxCount);
     void Destroy(void) { m_Heap = nullptr; }
 
-    bool HasAvailableSpace(uint32_t Count) const { return Count <= m_NumFreeDescriptors; }
+    // A shader-visible heap cannot grow without moving every table in it, so MaxCount is a hard limit; freed
+    // ranges make room again once the GPU is done with them.
+    bool HasAvailableSpace(uint32_t Count);
     DescriptorHandle Alloc(uint32_t Count = 1);
+    // Handle must be the start of a range returned by Alloc().  Tables recorded before this may still be in use.
+    void Free(const DescriptorHandle& Handle);
+    DescriptorRangeAllocator::Stats GetStats(void);
 
     DescriptorHandle operator[] (uint32_t arrayIdx) const { return m_FirstHandle + arrayIdx * m_DescriptorSize; }
 
@@ -114,7 +125,7 @@ private:
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_Heap;
     D3D12_DESCRIPTOR_HEAP_DESC m_HeapDesc;
     uint32_t m_DescriptorSize;
-    uint32_t m_NumFreeDescriptors;
+    std::mutex m_Mutex;
+    std::unique_ptr<DescriptorRangeAllocator> m_Ranges;     // one heap of MaxCount descriptors
     DescriptorHandle m_FirstHandle;
-    DescriptorHandle m_NextFreeHandle;
 };
@@ -0,0 +1,66 @@
+#include "pch.h"
+#include "DescriptorRangeAllocator.h"
+
+bool DescriptorRangeAllocator::Allocate(uint32_t count, Range& range)
+{
+	ASSERT(count > 0 && count <= GetDescriptorsPerHeap(), "Descriptor range larger than a heap");
+
+	TlsfBlockPool::Allocation allocation;
+	if (!m_Pool.Allocate(count, 1, 0, allocation))
+		return false;
+
+	m_Handles[allocation.Block][allocation.Offset] = allocation.Handle;
+	range.Heap = allocation.Block;
+	range.Offset = (uint32_t)allocation.Offset;
+	range.Count = count;
+	return true;
+}
+
+uint32_t DescriptorRangeAllocator::AddHeap()
+{
+	const uint32_t heap = m_Pool.AddBlock(nullptr);
+	if (heap >= m_Handles.size())
+		m_Handles.resize(heap + 1);
+	const uint32_t noRange = TlsfAllocator::kInvalidHandle;
+	m_Handles[heap].assign(GetDescriptorsPerHeap(), noRange);
+	return heap;
+}
+
+void DescriptorRangeAllocator::Free(uint32_t heap, uint32_t offset, uint64_t fenceValue)
+{
+	ASSERT(heap < m_Handles.size() && offset < m_Handles[heap].size(), "Descriptor not allocated here");
+
+	uint32_t& handle = m_Handles[heap][offset];
+	ASSERT(handle != TlsfAllocator::kInvalidHandle, "Descriptor range freed twice or not the start of a range");
+
+	TlsfBlockPool::Allocation allocation;
+	allocation.Block = heap;
+	allocation.Handle = handle;
+	allocation.Offset = offset;
+	allocation.Size = m_Pool.GetBlock(heap).GetSize(handle);
+	handle = TlsfAllocator::kInvalidHandle;
+
+	m_Pending.push_back({ fenceValue, allocation });
+	m_PendingDescriptors += (uint32_t)allocation.Size;
+}
+
+void DescriptorRangeAllocator::Release(const TlsfBlockPool::Allocation& allocation)
+{
+	m_PendingDescriptors -= (uint32_t)allocation.Size;
+	// Descriptor heaps are cheap and a sampler or RTV heap can never be moved, so empty heaps are kept.
+	m_Pool.Free(allocation);
+}
+
+DescriptorRangeAllocator::Stats DescriptorRangeAllocator::GetStats() const
+{
+	const TlsfBlockPool::Stats poolStats = m_Pool.GetStats();
+
+	Stats stats;
+	stats.NumHeaps = poolStats.NumBlocks;
+	stats.UsedDescriptors = (uint32_t)poolStats.UsedBytes - m_PendingDescriptors;
+	stats.PendingDescriptors = m_PendingDescriptors;
+	stats.FreeDescriptors = (uint32_t)(poolStats.ReservedBytes - poolStats.UsedBytes);
+	stats.LargestFreeRange = (uint32_t)poolStats.LargestFreeRange;
+	stats.NumFreeRanges = poolStats.NumFreeRanges;
+	return stats;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "TlsfAllocator.h"
+#include <deque>
+
+// Hands out contiguous ranges of descriptor slots from a growable set of equally sized descriptor heaps, using
+// a TlsfBlockPool with one block per heap and a granularity of one descriptor.  It only deals with slot indices
+// and fence values, so it runs without a device (see DescriptorAllocator and DescriptorHeap).
+//
+// Freed ranges are held back until the fence value given to Free() has completed: the GPU may still read a
+// shader-visible table, or a view copied from a CPU descriptor, that was recorded before the free.
+class DescriptorRangeAllocator
+{
+public:
+	static const uint32_t kInvalidHeap = ~0u;
+
+	struct Range
+	{
+		uint32_t Heap = kInvalidHeap;
+		uint32_t Offset = 0;
+		uint32_t Count = 0;
+
+		bool IsValid() const { return Heap != kInvalidHeap; }
+	};
+
+	struct Stats
+	{
+		uint32_t NumHeaps = 0;
+		uint32_t UsedDescriptors = 0;
+		uint32_t PendingDescriptors = 0;    // freed, waiting for their fence
+		uint32_t FreeDescriptors = 0;
+		uint32_t LargestFreeRange = 0;
+		uint32_t NumFreeRanges = 0;
+
+		// 0 when all free slots are one range, close to 1 when they are scattered.
+		float GetFragmentation() const
+		{
+			return FreeDescriptors == 0 ? 0.0f : 1.0f - (float)LargestFreeRange / (float)FreeDescriptors;
+		}
+	};
+
+	explicit DescriptorRangeAllocator(uint32_t descriptorsPerHeap) : m_Pool(descriptorsPerHeap, 1) {}
+
+	uint32_t GetDescriptorsPerHeap() const { return (uint32_t)m_Pool.GetBlockSize(); }
+
+	// Fails when no heap has count free slots in a row; the caller creates a heap, adds it and retries.
+	bool Allocate(uint32_t count, Range& range);
+	uint32_t AddHeap();
+
+	// Frees the range starting at offset.  Its slots are reused once isFenceComplete(fenceValue) holds when
+	// Reclaim() is called.
+	void Free(uint32_t heap, uint32_t offset, uint64_t fenceValue);
+
+	// Returns the ranges whose fence has completed to the free lists.  Fence values are expected to be freed
+	// in increasing order, so this stops at the first pending one.
+	template <typename Fn> void Reclaim(Fn&& isFenceComplete)
+	{
+		while (!m_Pending.empty() && isFenceComplete(m_Pending.front().FenceValue))
+		{
+			Release(m_Pending.front().Allocation);
+			m_Pending.pop_front();
+		}
+	}
+
+	Stats GetStats() const;
+
+private:
+	struct PendingFree
+	{
+		uint64_t FenceValue;
+		TlsfBlockPool::Allocation Allocation;
+	};
+
+	void Release(const TlsfBlockPool::Allocation& allocation);
+
+	TlsfBlockPool m_Pool;
+	// TLSF handle of the range starting at each slot of each heap, so a range can be freed by its first slot.
+	std::vector<std::vector<uint32_t>> m_Handles;
+	std::deque<PendingFree> m_Pending;
+	uint32_t m_PendingDescriptors = 0;
+};
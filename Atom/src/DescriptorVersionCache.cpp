@@ -0,0 +1,24 @@
+#include "pch.h"
+#include "DescriptorVersionCache.h"
+
+namespace
+{
+	// Matches no source: handle 0 is never a valid view.
+	const DescriptorVersionCache::Source kUnknownSource = { 0, ~0u };
+}
+
+void DescriptorVersionCache::Resize(uint32_t numSlots)
+{
+	m_Slots.assign(numSlots, kUnknownSource);
+}
+
+void DescriptorVersionCache::Invalidate()
+{
+	m_Slots.assign(m_Slots.size(), kUnknownSource);
+}
+
+void DescriptorVersionCache::Invalidate(uint32_t slot)
+{
+	ASSERT(slot < m_Slots.size());
+	m_Slots[slot] = kUnknownSource;
+}
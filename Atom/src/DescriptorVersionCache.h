@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Remembers what each slot of a descriptor table was last copied from, so that a table refreshed every frame only
+// copies the slots whose source changed.  A source is the CPU handle of a view together with the version of the
+// resource it describes (GpuResource::GetVersionID()): views are rewritten in place when their resource is
+// recreated, e.g. on resize, and the version is what tells the new view from the old one.  It only deals with
+// handle values and versions, so it runs without a device.
+class DescriptorVersionCache
+{
+public:
+	struct Source
+	{
+		size_t Handle;
+		uint32_t Version;
+	};
+
+	struct Stats
+	{
+		uint64_t NumUpdates = 0;
+		uint64_t NumCopies = 0;         // calls to the copy callback
+		uint64_t NumSlotsCopied = 0;
+	};
+
+	explicit DescriptorVersionCache(uint32_t numSlots = 0) { Resize(numSlots); }
+
+	// Forgets every slot, as Invalidate() does.
+	void Resize(uint32_t numSlots);
+
+	// Compares sources[0..count) with what slots firstSlot.. were last copied from, and calls copy(i, n) once for
+	// each run of changed slots, which must copy sources[i..i+n) to slots firstSlot+i..firstSlot+i+n.  Returns the
+	// number of slots copied.
+	template <typename Fn> uint32_t Update(uint32_t firstSlot, const Source* sources, uint32_t count, Fn&& copy)
+	{
+		ASSERT(firstSlot + count <= m_Slots.size(), "Descriptor table too small");
+
+		++m_Stats.NumUpdates;
+		Source* slots = m_Slots.data() + firstSlot;
+		uint32_t numCopied = 0;
+		for (uint32_t i = 0; i < count;)
+		{
+			if (IsCurrent(slots[i], sources[i]))
+			{
+				++i;
+				continue;
+			}
+
+			const uint32_t first = i;
+			for (; i < count && !IsCurrent(slots[i], sources[i]); ++i)
+				slots[i] = sources[i];
+			copy(first, i - first);
+
+			++m_Stats.NumCopies;
+			numCopied += i - first;
+		}
+		m_Stats.NumSlotsCopied += numCopied;
+		return numCopied;
+	}
+
+	// The next Update() copies every slot, or the given one, e.g. after the table was written by other means.
+	void Invalidate();
+	void Invalidate(uint32_t slot);
+
+	uint32_t GetNumSlots() const { return (uint32_t)m_Slots.size(); }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	static bool IsCurrent(const Source& slot, const Source& source)
+	{
+		return slot.Handle == source.Handle && slot.Version == source.Version;
+	}
+
+	std::vector<Source> m_Slots;
+	Stats m_Stats;
+};
@@ -6,6 +6,9 @@
 #include "BufferManager.h"
 #include "ColorBuffer.h"
 #include "SystemTime.h"
+#include "GpuMemory.h"
+#include "FrameArena.h"
+#include "DeferredRelease.h"
 using namespace Graphics;
 using namespace Microsoft::WRL;
 
@@ -171,6 +174,10 @@ void Display::Present(void)
     s_FrameStartTick = CurrentTick;
 
     ++s_FrameIndex;
+    FrameAllocator::BeginFrame();
+
+    DeferredRelease::Process();
+    GpuMemory::Update();
 
 
 }
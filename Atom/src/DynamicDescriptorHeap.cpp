@@ -2,6 +2,7 @@
 #include "DynamicDescriptorHeap.h"
 #include "CommandContext.h"
 #include "GraphicsCore.h"
+#include "GpuMemory.h"
 #include "CommandListManager.h"
 #include "RootSignature.h"
 
@@ -13,7 +14,7 @@ using namespace Graphics;
 
 std::mutex DynamicDescriptorHeap::sm_Mutex;
 std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> DynamicDescriptorHeap::sm_DescriptorHeapPool[2];
-std::queue<std::pair<uint64_t, ID3D12DescriptorHeap*>> DynamicDescriptorHeap::sm_RetiredDescriptorHeaps[2];
+DeferredReleaseQueue DynamicDescriptorHeap::sm_RetiredDescriptorHeaps;
 std::queue<ID3D12DescriptorHeap*> DynamicDescriptorHeap::sm_AvailableDescriptorHeaps[2];
 
 ID3D12DescriptorHeap* DynamicDescriptorHeap::RequestDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE HeapType)
@@ -22,11 +23,7 @@ ID3D12DescriptorHeap* DynamicDescriptorHeap::RequestDescriptorHeap(D3D12_DESCRIP
 
     uint32_t idx = HeapType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? 1 : 0;
 
-    while (!sm_RetiredDescriptorHeaps[idx].empty() && g_CommandManager.IsFenceComplete(sm_RetiredDescriptorHeaps[idx].front().first))
-    {
-        sm_AvailableDescriptorHeaps[idx].push(sm_RetiredDescriptorHeaps[idx].front().second);
-        sm_RetiredDescriptorHeaps[idx].pop();
-    }
+    sm_RetiredDescriptorHeaps.Process([](uint64_t FenceValue) { return g_CommandManager.IsFenceComplete(FenceValue); });
 
     if (!sm_AvailableDescriptorHeaps[idx].empty())
     {
@@ -43,6 +40,7 @@ ID3D12DescriptorHeap* DynamicDescriptorHeap::RequestDescriptorHeap(D3D12_DESCRIP
         HeapDesc.NodeMask = 1;
         Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> HeapPtr;
         ASSERT_SUCCEEDED(g_Device->CreateDescriptorHeap(&HeapDesc, IID_PPV_ARGS(&HeapPtr)));
+        GpuMemory::Track(HeapPtr.Get());
         sm_DescriptorHeapPool[idx].emplace_back(HeapPtr);
         return HeapPtr.Get();
     }
@@ -51,9 +49,12 @@ ID3D12DescriptorHeap* DynamicDescriptorHeap::RequestDescriptorHeap(D3D12_DESCRIP
 void DynamicDescriptorHeap::DiscardDescriptorHeaps(D3D12_DESCRIPTOR_HEAP_TYPE HeapType, uint64_t FenceValue, const std::vector<ID3D12DescriptorHeap*>& UsedHeaps)
 {
     uint32_t idx = HeapType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? 1 : 0;
-    std::lock_guard<std::mutex> LockGuard(sm_Mutex);
     for (auto iter = UsedHeaps.begin(); iter != UsedHeaps.end(); ++iter)
-        sm_RetiredDescriptorHeaps[idx].push(std::make_pair(FenceValue, *iter));
+    {
+        // Runs in RequestDescriptorHeap(), with sm_Mutex held.
+        ID3D12DescriptorHeap* HeapPtr = *iter;
+        sm_RetiredDescriptorHeaps.Defer(FenceValue, [idx, HeapPtr] { sm_AvailableDescriptorHeaps[idx].push(HeapPtr); });
+    }
 }
 
 void DynamicDescriptorHeap::RetireCurrentHeap(void)
@@ -69,6 +70,7 @@ void DynamicDescriptorHeap::RetireCurrentHeap(void)
     m_RetiredHeaps.push_back(m_CurrentHeapPtr);
     m_CurrentHeapPtr = nullptr;
     m_CurrentOffset = 0;
+    m_CopiedTables.Clear();
 }
 
 void DynamicDescriptorHeap::RetireUsedHeaps(uint64_t fenceValue)
@@ -130,10 +132,46 @@ uint32_t DynamicDescriptorHeap::DescriptorHandleCache::ComputeStagedSize()
     return NeededSpace;
 }
 
+// Fills Sources with the CPU handle staged in each slot of the table, 0 for unset slots, and returns the table size.
+uint32_t DynamicDescriptorHeap::DescriptorHandleCache::GetTableSources(uint32_t RootIndex, size_t Sources[]) const
+{
+    const DescriptorTableCache& RootDescTable = m_RootDescriptorTable[RootIndex];
+
+    unsigned long MaxSetHandle;
+    _BitScanReverse(&MaxSetHandle, RootDescTable.AssignedHandlesBitMap);
+    for (uint32_t i = 0; i <= MaxSetHandle; ++i)
+        Sources[i] = (RootDescTable.AssignedHandlesBitMap >> i) & 1 ? RootDescTable.TableStart[i].ptr : 0;
+    return MaxSetHandle + 1;
+}
+
+void DynamicDescriptorHeap::DescriptorHandleCache::BindCopiedTables(
+    const CopiedTableCache& CopiedTables, uint32_t DescriptorSize,
+    DescriptorHandle HeapStart, ID3D12GraphicsCommandList* CmdList,
+    void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::* SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE))
+{
+    size_t Sources[32];     // AssignedHandlesBitMap covers 32 slots
+    uint32_t RootIndex;
+
+    uint32_t StaleParams = m_StaleRootParamsBitMap;
+    while (_BitScanForward((unsigned long*)&RootIndex, StaleParams))
+    {
+        StaleParams ^= (1 << RootIndex);
+
+        const uint32_t TableSize = GetTableSources(RootIndex, Sources);
+        const uint32_t HeapOffset = CopiedTables.Find(Sources, TableSize);
+        if (HeapOffset != CopiedTableCache::kNotFound)
+        {
+            (CmdList->*SetFunc)(RootIndex, HeapStart + HeapOffset * DescriptorSize);
+            m_StaleRootParamsBitMap ^= (1 << RootIndex);
+        }
+    }
+}
+
 void DynamicDescriptorHeap::DescriptorHandleCache::CopyAndBindStaleTables(
     D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t DescriptorSize,
     DescriptorHandle DestHandleStart, ID3D12GraphicsCommandList* CmdList,
-    void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::* SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE))
+    void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::* SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE),
+    CopiedTableCache& CopiedTables, uint32_t HeapOffset)
 {
     uint32_t StaleParamCount = 0;
     uint32_t TableSize[DescriptorHandleCache::kMaxNumDescriptorTables];
@@ -172,11 +210,17 @@ void DynamicDescriptorHeap::DescriptorHandleCache::CopyAndBindStaleTables(
     D3D12_CPU_DESCRIPTOR_HANDLE pSrcDescriptorRangeStarts[kMaxDescriptorsPerCopy];
     UINT pSrcDescriptorRangeSizes[kMaxDescriptorsPerCopy];
 
+    size_t Sources[32];     // AssignedHandlesBitMap covers 32 slots
+
     for (uint32_t i = 0; i < StaleParamCount; ++i)
     {
         RootIndex = RootIndices[i];
         (CmdList->*SetFunc)(RootIndex, DestHandleStart);
 
+        GetTableSources(RootIndex, Sources);
+        CopiedTables.Insert(Sources, TableSize[i], HeapOffset);
+        HeapOffset += TableSize[i];
+
         DescriptorTableCache& RootDescTable = m_RootDescriptorTable[RootIndex];
 
         D3D12_CPU_DESCRIPTOR_HANDLE* SrcHandles = RootDescTable.TableStart;
@@ -236,6 +280,15 @@ void DynamicDescriptorHeap::DescriptorHandleCache::CopyAndBindStaleTables(
 void DynamicDescriptorHeap::CopyAndBindStagedTables(DescriptorHandleCache& HandleCache, ID3D12GraphicsCommandList* CmdList,
     void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::* SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE))
 {
+    // Rebind tables whose descriptors were already copied to the current heap, which is still bound or about to be.
+    if (m_CurrentHeapPtr != nullptr)
+    {
+        m_OwningContext.SetDescriptorHeap(m_DescriptorType, m_CurrentHeapPtr);
+        HandleCache.BindCopiedTables(m_CopiedTables, m_DescriptorSize, m_FirstDescriptor, CmdList, SetFunc);
+        if (HandleCache.m_StaleRootParamsBitMap == 0)
+            return;
+    }
+
     uint32_t NeededSize = HandleCache.ComputeStagedSize();
     if (!HasSpace(NeededSize))
     {
@@ -246,7 +299,9 @@ void DynamicDescriptorHeap::CopyAndBindStagedTables(DescriptorHandleCache& Handl
 
     // This can trigger the creation of a new heap
     m_OwningContext.SetDescriptorHeap(m_DescriptorType, GetHeapPointer());
-    HandleCache.CopyAndBindStaleTables(m_DescriptorType, m_DescriptorSize, Allocate(NeededSize), CmdList, SetFunc);
+    const uint32_t HeapOffset = m_CurrentOffset;
+    HandleCache.CopyAndBindStaleTables(m_DescriptorType, m_DescriptorSize, Allocate(NeededSize), CmdList, SetFunc,
+        m_CopiedTables, HeapOffset);
 }
 
 void DynamicDescriptorHeap::UnbindAllValid(void)
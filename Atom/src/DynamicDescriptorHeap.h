@@ -2,6 +2,8 @@
 
 #include "DescriptorHeap.h"
 #include "RootSignature.h"
+#include "CopiedTableCache.h"
+#include "DeferredReleaseQueue.h"
 #include <vector>
 #include <queue>
 class CommandContext;
@@ -12,7 +14,8 @@ namespace Graphics
 
 // This class is a linear allocation system for dynamically generated descriptor tables.  It internally caches
 // CPU descriptor handles so that when not enough space is available in the current heap, necessary descriptors
-// can be re-copied to the new heap.
+// can be re-copied to the new heap.  Tables staged again with the same descriptors are rebound from where they
+// were already copied in the current heap.
 class DynamicDescriptorHeap
 {
 public:
@@ -21,6 +24,10 @@ public:
 
     static void DestroyAll(void)
     {
+        std::lock_guard<std::mutex> LockGuard(sm_Mutex);
+        sm_RetiredDescriptorHeaps.Clear();
+        sm_AvailableDescriptorHeaps[0] = {};
+        sm_AvailableDescriptorHeaps[1] = {};
         sm_DescriptorHeapPool[0].clear();
         sm_DescriptorHeapPool[1].clear();
     }
@@ -71,7 +78,7 @@ private:
     static const uint32_t kNumDescriptorsPerHeap = 1024;
     static std::mutex sm_Mutex;
     static std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> sm_DescriptorHeapPool[2];
-    static std::queue<std::pair<uint64_t, ID3D12DescriptorHeap*>> sm_RetiredDescriptorHeaps[2];
+    static DeferredReleaseQueue sm_RetiredDescriptorHeaps;
     static std::queue<ID3D12DescriptorHeap*> sm_AvailableDescriptorHeaps[2];
 
     // Static methods
@@ -86,6 +93,7 @@ private:
     uint32_t m_CurrentOffset;
     DescriptorHandle m_FirstDescriptor;
     std::vector<ID3D12DescriptorHeap*> m_RetiredHeaps;
+    CopiedTableCache m_CopiedTables;    // tables copied to m_CurrentHeapPtr
 
     // Describes a descriptor table entry:  a region of the handle cache and which handles have been set
     struct DescriptorTableCache
@@ -118,8 +126,12 @@ private:
         static const uint32_t kMaxNumDescriptorTables = 16;
 
         uint32_t ComputeStagedSize();
-        void CopyAndBindStaleTables(D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t DescriptorSize, DescriptorHandle DestHandleStart, ID3D12GraphicsCommandList* CmdList,
+        uint32_t GetTableSources(uint32_t RootIndex, size_t Sources[]) const;
+        void BindCopiedTables(const CopiedTableCache& CopiedTables, uint32_t DescriptorSize, DescriptorHandle HeapStart, ID3D12GraphicsCommandList* CmdList,
             void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::* SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE));
+        void CopyAndBindStaleTables(D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t DescriptorSize, DescriptorHandle DestHandleStart, ID3D12GraphicsCommandList* CmdList,
+            void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::* SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE),
+            CopiedTableCache& CopiedTables, uint32_t HeapOffset);
 
         DescriptorTableCache m_RootDescriptorTable[kMaxNumDescriptorTables];
         D3D12_CPU_DESCRIPTOR_HANDLE m_HandleCache[kMaxNumDescriptors];
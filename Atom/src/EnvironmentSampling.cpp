@@ -0,0 +1,251 @@
+#include "pch.h"
+#include "EnvironmentSampling.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const float kPi = 3.14159265358979323846f;
+	const float kOneMinusEpsilon = 0x1.fffffep-1f;
+
+	float Luminance(const float* rgb)
+	{
+		const float y = 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+		return std::isfinite(y) && y > 0.0f ? y : 0.0f;
+	}
+
+	// Fills cdf[0 .. n] from weights[0 .. n - 1] and returns the sum.  A row without weight gets a linear CDF so
+	// inversion stays well defined; the marginal never selects it anyway.
+	double BuildCDF(const double* weights, uint32_t n, float* cdf)
+	{
+		double sum = 0.0;
+		for (uint32_t i = 0; i < n; ++i)
+			sum += weights[i];
+
+		cdf[0] = 0.0f;
+		if (sum > 0.0)
+		{
+			const double invSum = 1.0 / sum;
+			double running = 0.0;
+			for (uint32_t i = 0; i < n; ++i)
+			{
+				running += weights[i];
+				cdf[i + 1] = (float)(running * invSum);
+			}
+		}
+		else
+		{
+			for (uint32_t i = 1; i <= n; ++i)
+				cdf[i] = (float)i / n;
+		}
+		cdf[n] = 1.0f;
+		return sum;
+	}
+
+	// Inverts a piecewise constant CDF: the bucket containing u and the position of u inside it.
+	uint32_t InvertCDF(const float* cdf, uint32_t n, float u, float& offset)
+	{
+		const float* it = std::upper_bound(cdf, cdf + n + 1, u);
+		const uint32_t i = std::clamp((uint32_t)(it - cdf), 1u, n) - 1;
+		const float width = cdf[i + 1] - cdf[i];
+		offset = width > 0.0f ? std::clamp((u - cdf[i]) / width, 0.0f, kOneMinusEpsilon) : 0.5f;
+		return i;
+	}
+
+	// Vose's alias method.  probabilities must sum to 1.
+	void BuildAliasTable(const std::vector<double>& probabilities, std::vector<EnvironmentSampling::AliasEntry>& table)
+	{
+		const uint32_t n = (uint32_t)probabilities.size();
+		table.resize(n);
+
+		std::vector<double> scaled(n);
+		std::vector<uint32_t> small, large;
+		small.reserve(n);
+		large.reserve(n);
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			scaled[i] = probabilities[i] * n;
+			(scaled[i] < 1.0 ? small : large).push_back(i);
+		}
+
+		while (!small.empty() && !large.empty())
+		{
+			const uint32_t s = small.back();
+			small.pop_back();
+			const uint32_t l = large.back();
+
+			table[s] = { (float)scaled[s], l };
+			scaled[l] -= 1.0 - scaled[s];
+			if (scaled[l] < 1.0)
+			{
+				large.pop_back();
+				small.push_back(l);
+			}
+		}
+
+		// Whatever is left is 1 up to rounding.
+		for (uint32_t i : large)
+			table[i] = { 1.0f, i };
+		for (uint32_t i : small)
+			table[i] = { 1.0f, i };
+	}
+
+	EnvironmentSampling::Sample MakeSample(const EnvironmentSampling::Distribution& dist, uint32_t x, uint32_t y, float du, float dv)
+	{
+		EnvironmentSampling::Sample sample;
+		sample.UV = XMFLOAT2((x + du) / dist.Width, (y + dv) / dist.Height);
+		sample.Direction = EnvironmentSampling::UVToDirection(sample.UV.x, sample.UV.y);
+
+		// Image to solid angle: dw = 2pi * pi * sin(theta) du dv.
+		const float sinTheta = std::sin(sample.UV.y * kPi);
+		const float texelPdf = dist.TexelPdf[(size_t)y * dist.Width + x];
+		sample.Pdf = sinTheta > 0.0f ? texelPdf / (2.0f * kPi * kPi * sinTheta) : 0.0f;
+		return sample;
+	}
+}
+
+size_t EnvironmentSampling::Distribution::GetMemorySize() const
+{
+	return TexelPdf.size() * sizeof(float) + MarginalCDF.size() * sizeof(float) +
+		ConditionalCDF.size() * sizeof(float) + AliasTable.size() * sizeof(AliasEntry);
+}
+
+XMFLOAT3 EnvironmentSampling::UVToDirection(float u, float v)
+{
+	const float phi = 2.0f * kPi * u;
+	const float theta = kPi * v;
+	const float sinTheta = std::sin(theta);
+	return XMFLOAT3(sinTheta * std::cos(phi), std::cos(theta), sinTheta * std::sin(phi));
+}
+
+XMFLOAT2 EnvironmentSampling::DirectionToUV(const XMFLOAT3& dir)
+{
+	const float len = std::sqrt(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+	float u = std::atan2(dir.z, dir.x) / (2.0f * kPi);
+	u -= std::floor(u);
+	const float v = std::acos(std::clamp(dir.y / len, -1.0f, 1.0f)) / kPi;
+	return XMFLOAT2(std::min(u, kOneMinusEpsilon), std::min(v, kOneMinusEpsilon));
+}
+
+void EnvironmentSampling::Build(const float* rgba, uint32_t width, uint32_t height, Distribution& out, const BuildSettings& settings)
+{
+	ASSERT(width > 0 && height > 0);
+
+	out = Distribution();
+	out.Width = width;
+	out.Height = height;
+
+	// Power per texel.  The solid angle of a row is proportional to sin(theta) at its center.
+	std::vector<double> weights((size_t)width * height);
+	std::vector<double> rowSums(height);
+	Utility::ParallelFor(height, settings.NumThreads, [&](uint32_t y)
+		{
+			const double sinTheta = std::sin(kPi * (y + 0.5) / height);
+			const float* src = rgba + (size_t)y * width * 4;
+			double* dst = weights.data() + (size_t)y * width;
+			double sum = 0.0;
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				dst[x] = Luminance(src + x * 4) * sinTheta;
+				sum += dst[x];
+			}
+			rowSums[y] = sum;
+		});
+
+	double total = 0.0;
+	for (double sum : rowSums)
+		total += sum;
+
+	if (!(total > 0.0))
+	{
+		// No light at all: sample the sphere uniformly instead.
+		total = 0.0;
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const double sinTheta = std::sin(kPi * (y + 0.5) / height);
+			std::fill(weights.begin() + (size_t)y * width, weights.begin() + (size_t)(y + 1) * width, sinTheta);
+			rowSums[y] = sinTheta * width;
+			total += rowSums[y];
+		}
+	}
+
+	// Density over the image is weight / mean weight.
+	const double texelCount = (double)width * height;
+	const double pdfScale = texelCount / total;
+	out.TexelPdf.resize(weights.size());
+	Utility::ParallelFor(height, settings.NumThreads, [&](uint32_t y)
+		{
+			const size_t row = (size_t)y * width;
+			for (uint32_t x = 0; x < width; ++x)
+				out.TexelPdf[row + x] = (float)(weights[row + x] * pdfScale);
+		});
+
+	if (settings.BuildCDF)
+	{
+		out.ConditionalCDF.resize((size_t)height * (width + 1));
+		Utility::ParallelFor(height, settings.NumThreads, [&](uint32_t y)
+			{
+				BuildCDF(weights.data() + (size_t)y * width, width, out.ConditionalCDF.data() + (size_t)y * (width + 1));
+			});
+
+		out.MarginalCDF.resize(height + 1);
+		BuildCDF(rowSums.data(), height, out.MarginalCDF.data());
+	}
+
+	if (settings.BuildAliasTable)
+	{
+		const double invTotal = 1.0 / total;
+		for (double& w : weights)
+			w *= invTotal;
+		BuildAliasTable(weights, out.AliasTable);
+	}
+}
+
+EnvironmentSampling::Sample EnvironmentSampling::SampleCDF(const Distribution& dist, const XMFLOAT2& u)
+{
+	ASSERT(!dist.MarginalCDF.empty(), "Distribution was built without CDFs");
+
+	float dv, du;
+	const uint32_t y = InvertCDF(dist.MarginalCDF.data(), dist.Height, u.y, dv);
+	const uint32_t x = InvertCDF(dist.ConditionalCDF.data() + (size_t)y * (dist.Width + 1), dist.Width, u.x, du);
+	return MakeSample(dist, x, y, du, dv);
+}
+
+EnvironmentSampling::Sample EnvironmentSampling::SampleAlias(const Distribution& dist, const XMFLOAT2& u)
+{
+	ASSERT(!dist.AliasTable.empty(), "Distribution was built without an alias table");
+
+	// u.x picks the texel and u.y decides between it and its alias.  The texel position is only refined from
+	// what is left of both: a float u.x has no bits to spare below the texel index on a large map, so it must
+	// not drive the alias decision.
+	const uint32_t count = dist.Width * dist.Height;
+	const double scaled = (double)u.x * count;
+	uint32_t index = std::min((uint32_t)scaled, count - 1);
+	const float du = std::clamp((float)(scaled - index), 0.0f, kOneMinusEpsilon);
+
+	const AliasEntry& entry = dist.AliasTable[index];
+	float dv;
+	if (u.y < entry.Threshold)
+	{
+		dv = u.y / entry.Threshold;
+	}
+	else
+	{
+		dv = (u.y - entry.Threshold) / (1.0f - entry.Threshold);
+		index = entry.Alias;
+	}
+
+	return MakeSample(dist, index % dist.Width, index / dist.Width, du, std::clamp(dv, 0.0f, kOneMinusEpsilon));
+}
+
+float EnvironmentSampling::Pdf(const Distribution& dist, const XMFLOAT3& dir)
+{
+	const XMFLOAT2 uv = DirectionToUV(dir);
+	const uint32_t x = std::min((uint32_t)(uv.x * dist.Width), dist.Width - 1);
+	const uint32_t y = std::min((uint32_t)(uv.y * dist.Height), dist.Height - 1);
+	const float sinTheta = std::sin(uv.y * kPi);
+	return sinTheta > 0.0f ? dist.TexelPdf[(size_t)y * dist.Width + x] / (2.0f * kPi * kPi * sinTheta) : 0.0f;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Importance sampling of an equirectangular HDR environment in proportion to its luminance.
+// Every texel gets the weight luminance * sin(theta), which is its share of the sphere's radiant power.
+// Two equivalent samplers are built from these weights:
+//   - marginal / conditional CDFs over rows and columns (Pharr et al., PBRT 3rd ed. 13.6.7).  Inversion is
+//     monotonic, so stratified or low discrepancy inputs stay stratified on the sphere;
+//   - an alias table (Vose 1991) that picks a texel in O(1) with no search, which is what a shader wants.
+//
+// The direction convention is the one of EquirectToCubeCS and SH::ProjectEquirect(): row 0 is the +Y pole,
+// u = atan2(z, x) / 2pi and v = acos(y) / pi.  Shaders/EnvironmentSampling.hlsli samples the same tables on
+// the GPU; every array below is laid out so it can be copied into a buffer as is.
+namespace EnvironmentSampling
+{
+	struct BuildSettings
+	{
+		bool BuildCDF = true;
+		bool BuildAliasTable = true;
+		uint32_t NumThreads = 0;  // 0 uses all hardware threads
+	};
+
+	// StructuredBuffer<EnvAliasEntry> on the GPU.  Texel i is kept with probability Threshold, otherwise
+	// Alias is taken.
+	struct AliasEntry
+	{
+		float Threshold;
+		uint32_t Alias;
+	};
+
+	struct Distribution
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		// Density over the [0, 1]^2 image domain, one float per texel.  Texels without light have 0 and are
+		// never sampled.
+		std::vector<float> TexelPdf;
+		std::vector<float> MarginalCDF;      // Height + 1 entries, 0 ... 1
+		std::vector<float> ConditionalCDF;   // Height rows of Width + 1 entries, each 0 ... 1
+		std::vector<AliasEntry> AliasTable;  // Width * Height entries
+
+		bool IsValid() const { return Width > 0 && Height > 0 && !TexelPdf.empty(); }
+		size_t GetMemorySize() const;
+	};
+
+	struct Sample
+	{
+		DirectX::XMFLOAT3 Direction;
+		float Pdf;                   // per steradian, 0 if the direction cannot be sampled
+		DirectX::XMFLOAT2 UV;        // position in the equirectangular image
+	};
+
+	// rgba is RGBA32F as stbi_loadf returns it with 4 channels.  Negative and non finite texels count as black;
+	// an entirely black image falls back to uniform sampling of the sphere.
+	void Build(const float* rgba, uint32_t width, uint32_t height, Distribution& out, const BuildSettings& settings = BuildSettings());
+
+	// u in [0, 1)^2.  SampleCDF() needs the CDFs, SampleAlias() the alias table; both produce the same density.
+	Sample SampleCDF(const Distribution& dist, const DirectX::XMFLOAT2& u);
+	Sample SampleAlias(const Distribution& dist, const DirectX::XMFLOAT2& u);
+
+	// Density per steradian of sampling dir (need not be normalized), for weighting against other strategies.
+	float Pdf(const Distribution& dist, const DirectX::XMFLOAT3& dir);
+
+	DirectX::XMFLOAT3 UVToDirection(float u, float v);
+	DirectX::XMFLOAT2 DirectionToUV(const DirectX::XMFLOAT3& dir);
+}
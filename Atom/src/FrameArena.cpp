@@ -0,0 +1,188 @@
+#include "pch.h"
+#include "FrameArena.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#define POISON_SCRATCH(p, size) ASAN_POISON_MEMORY_REGION(p, size)
+#define UNPOISON_SCRATCH(p, size) ASAN_UNPOISON_MEMORY_REGION(p, size)
+#else
+#define POISON_SCRATCH(p, size) ((void)(p), (void)(size))
+#define UNPOISON_SCRATCH(p, size) ((void)(p), (void)(size))
+#endif
+
+namespace
+{
+	uint8_t* AlignUp(uint8_t* p, size_t alignment)
+	{
+		return (uint8_t*)(((uintptr_t)p + alignment - 1) & ~(uintptr_t)(alignment - 1));
+	}
+
+	void ReleaseScratch(uint8_t* p, size_t size)
+	{
+#ifndef RELEASE
+		UNPOISON_SCRATCH(p, size);
+		memset(p, FrameArena::kPoisonByte, size);
+#endif
+		POISON_SCRATCH(p, size);
+	}
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+	ASSERT((alignment & (alignment - 1)) == 0, "Alignment must be a power of two");
+	ASSERT(std::this_thread::get_id() == m_Owner, "FrameArena allocated from on a thread that does not own it");
+
+	bytes = std::max<size_t>(bytes, 1);
+	m_Stats.UsedBytes += bytes;
+	m_Stats.PeakUsedBytes = std::max(m_Stats.PeakUsedBytes, m_Stats.UsedBytes);
+	++m_Stats.NumAllocations;
+
+	// Whatever does not fit in an empty page gets its own block.
+	if (bytes + alignment > m_PageSize)
+	{
+		const size_t pageAlignment = kPageAlignment;
+		const size_t blockAlignment = std::max(alignment, pageAlignment);
+		uint8_t* data = static_cast<uint8_t*>(::operator new(bytes, std::align_val_t(blockAlignment)));
+		m_LargeBlocks.push_back({ data, bytes, blockAlignment });
+		++m_Stats.NumLargeBlocks;
+		return data;
+	}
+
+	uint8_t* p = AlignUp(m_Cursor, alignment);
+	if (m_Cursor == nullptr || p + bytes > m_End)
+	{
+		NextPage();
+		p = AlignUp(m_Cursor, alignment);
+	}
+
+	UNPOISON_SCRATCH(p, bytes);
+	m_Cursor = p + bytes;
+	return p;
+}
+
+void FrameArena::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+	// The cursor, the large blocks and the stats are the owner's; Reset() takes the memory back instead.
+	if (std::this_thread::get_id() != m_Owner)
+		return;
+
+	bytes = std::max<size_t>(bytes, 1);
+	m_Stats.UsedBytes -= bytes;
+
+	if (bytes + alignment > m_PageSize)
+	{
+		auto block = std::find_if(m_LargeBlocks.begin(), m_LargeBlocks.end(), [&](const Block& b) { return b.Data == p; });
+		ASSERT(block != m_LargeBlocks.end(), "Block not allocated from this arena");
+		::operator delete(block->Data, std::align_val_t(block->Alignment));
+		*block = m_LargeBlocks.back();
+		m_LargeBlocks.pop_back();
+		--m_Stats.NumLargeBlocks;
+		return;
+	}
+
+	// Memory freed in reverse order of allocation is taken back, like a stack; the rest waits for the reset.
+	uint8_t* data = static_cast<uint8_t*>(p);
+	if (data + bytes == m_Cursor && data >= m_Pages[m_CurrentPage].Data)
+	{
+		ReleaseScratch(data, bytes);
+		m_Cursor = data;
+	}
+}
+
+void FrameArena::NextPage()
+{
+	if (m_Cursor != nullptr)
+		++m_CurrentPage;
+
+	if (m_CurrentPage == m_Pages.size())
+	{
+		uint8_t* data = static_cast<uint8_t*>(::operator new(m_PageSize, std::align_val_t(kPageAlignment)));
+		POISON_SCRATCH(data, m_PageSize);
+		m_Pages.push_back({ data, m_PageSize, kPageAlignment });
+		m_Stats.ReservedBytes += m_PageSize;
+	}
+
+	m_Cursor = m_Pages[m_CurrentPage].Data;
+	m_End = m_Cursor + m_PageSize;
+}
+
+void FrameArena::Reset()
+{
+	if (m_Cursor != nullptr)
+	{
+		for (size_t i = 0; i < m_CurrentPage; ++i)
+			ReleaseScratch(m_Pages[i].Data, m_Pages[i].Size);
+		ReleaseScratch(m_Pages[m_CurrentPage].Data, m_Cursor - m_Pages[m_CurrentPage].Data);
+	}
+
+	for (const Block& block : m_LargeBlocks)
+		::operator delete(block.Data, std::align_val_t(block.Alignment));
+	m_LargeBlocks.clear();
+
+	m_CurrentPage = 0;
+	m_Cursor = nullptr;
+	m_End = nullptr;
+	m_Stats.UsedBytes = 0;
+	m_Stats.NumAllocations = 0;
+	m_Stats.NumLargeBlocks = 0;
+}
+
+void FrameArena::Release()
+{
+	Reset();
+
+	for (const Block& page : m_Pages)
+	{
+		UNPOISON_SCRATCH(page.Data, page.Size);
+		::operator delete(page.Data, std::align_val_t(page.Alignment));
+	}
+	m_Pages.clear();
+	m_Stats.ReservedBytes = 0;
+}
+
+bool FrameArena::Owns(const void* p) const
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(p);
+	auto contains = [bytes](const Block& block) { return bytes >= block.Data && bytes < block.Data + block.Size; };
+	return std::any_of(m_Pages.begin(), m_Pages.end(), contains) ||
+		std::any_of(m_LargeBlocks.begin(), m_LargeBlocks.end(), contains);
+}
+
+namespace
+{
+	std::atomic<uint64_t> s_FrameIndex = 0;
+
+	struct ThreadArenas
+	{
+		FrameArena Arenas[FrameAllocator::kNumFrames];
+		uint64_t FrameIndex = ~0ull;
+	};
+}
+
+void FrameAllocator::BeginFrame(void)
+{
+	s_FrameIndex.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t FrameAllocator::GetFrameIndex(void)
+{
+	return s_FrameIndex.load(std::memory_order_relaxed);
+}
+
+FrameArena& FrameAllocator::GetArena(void)
+{
+	static thread_local ThreadArenas s_Arenas;
+
+	const uint64_t FrameIndex = GetFrameIndex();
+	FrameArena& Arena = s_Arenas.Arenas[FrameIndex % kNumFrames];
+	if (s_Arenas.FrameIndex != FrameIndex)
+	{
+		// The slot last served frame FrameIndex - kNumFrames or an older one, whose scratch memory has expired.
+		Arena.Reset();
+		s_Arenas.FrameIndex = FrameIndex;
+	}
+	return Arena;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+// Bump allocator for scratch memory that does not outlive a frame, exposed as a std::pmr::memory_resource so pmr
+// containers can draw from it.  Allocations are carved out of pages that are kept across resets.  Requests larger
+// than a page get a block of their own, which is freed as soon as it is deallocated.  Other memory is only given
+// back when it is deallocated in reverse order of allocation, as nested temporaries are.
+//
+// Reset() releases everything at once.  Builds with AddressSanitizer poison the released memory and debug builds
+// also fill it with kPoisonByte, so scratch memory used after a reset shows up.
+//
+// An arena belongs to the thread that created it, which alone may allocate from it and reset it.  Memory may be
+// deallocated on any thread, e.g. a container filled on one job thread and destroyed on another; away from the
+// owner that is a no-op and the memory waits for the next reset.
+class FrameArena : public std::pmr::memory_resource
+{
+public:
+	static const size_t kDefaultPageSize = 256 * 1024;
+	static const size_t kPageAlignment = 64;
+	static const uint8_t kPoisonByte = 0xFD;
+
+	struct Stats
+	{
+		size_t UsedBytes = 0;           // since the last reset, large blocks included
+		size_t PeakUsedBytes = 0;
+		size_t ReservedBytes = 0;       // pages kept across resets
+		uint32_t NumAllocations = 0;    // since the last reset
+		uint32_t NumLargeBlocks = 0;    // live
+	};
+
+	explicit FrameArena(size_t pageSize = kDefaultPageSize) : m_PageSize(pageSize) {}
+	~FrameArena() { Release(); }
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// Ends the lifetime of everything allocated so far.  The pages are kept.
+	void Reset();
+	// Same, and frees the pages.
+	void Release();
+
+	bool Owns(const void* p) const;
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	struct Block
+	{
+		uint8_t* Data;
+		size_t Size;
+		size_t Alignment;
+	};
+
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+	void NextPage();
+
+	std::vector<Block> m_Pages;
+	std::vector<Block> m_LargeBlocks;
+	size_t m_PageSize;
+	const std::thread::id m_Owner = std::this_thread::get_id();
+	size_t m_CurrentPage = 0;
+	uint8_t* m_Cursor = nullptr;
+	uint8_t* m_End = nullptr;
+	Stats m_Stats;
+};
+
+// One FrameArena per thread and frame in flight, for the scratch containers of per frame code paths.  Memory taken
+// during frame N stays valid until frame N + kNumFrames begins, so it may be handed to work that completes during
+// the next frame.  A thread resets the arena of the new frame the first time it asks for it, and only that thread
+// may allocate from it.
+namespace FrameAllocator
+{
+	static const uint32_t kNumFrames = 3;
+
+	// Starts the next frame.  Called once a frame by Display::Present().
+	void BeginFrame(void);
+	uint64_t GetFrameIndex(void);
+
+	// The calling thread's arena for the current frame.
+	FrameArena& GetArena(void);
+	inline std::pmr::memory_resource* Get(void) { return &GetArena(); }
+}
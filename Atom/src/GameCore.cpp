@@ -9,6 +9,7 @@
 #include "CommandListManager.h"
 #include "Display.h"
 #include "FileSystem.h"
+#include "JobSystem.h"
 
 #pragma comment(lib, "d3d12.lib")
 #pragma comment(lib, "dxguid.lib")
@@ -51,10 +52,12 @@ namespace GameCore
 	HWND g_hWnd = nullptr;
 	void InitializeApplication(IGameApp& game)
 	{
-		Graphics::Initialize();
+		// Graphics::Initialize() already loads cached assets, so paths and timers have to be set up first.
 		SystemTime::Initialize();
-		GameInput::Initialize();
 		FileSystem::Initialize();
+		JobSystem::Initialize();
+		Graphics::Initialize();
+		GameInput::Initialize();
 		game.Startup();
 	}
 
@@ -141,6 +144,7 @@ namespace GameCore
 		}
 		TerminateApplication(app);
 		Graphics::Shutdown();
+		JobSystem::Shutdown();
 		                                                            
 		return 0;
 	}
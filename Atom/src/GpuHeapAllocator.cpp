@@ -0,0 +1,347 @@
+#include "pch.h"
+#include "GpuHeapAllocator.h"
+#include "GraphicsCore.h"
+#include "GpuMemory.h"
+#include "CommandListManager.h"
+#include "CommandContext.h"
+
+using namespace Graphics;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	struct PoolConfig
+	{
+		uint64_t HeapSize;
+		uint64_t Granularity;
+		uint64_t HeapAlignment;
+		D3D12_HEAP_FLAGS Flags;
+		const char* Name;
+	};
+
+	const PoolConfig kPoolConfigs[GpuHeapAllocator::kNumHeapClasses] =
+	{
+		{ 64 << 20, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, "Buffers" },
+		{ 64 << 20, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES, "Textures" },
+		{ 64 << 20, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES, "Render Targets" },
+		{ 256 << 20, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES, "MSAA Targets" },
+	};
+
+	// Unlike committed ones, placed render targets and depth buffers start with undefined compression metadata
+	// and must be cleared, copied to or discarded before anything else.  The discard is queued ahead of any
+	// later use on the graphics queue.
+	void DiscardPlacedTarget(ID3D12Resource* Resource, const D3D12_RESOURCE_DESC& Desc, D3D12_RESOURCE_STATES InitialState)
+	{
+		const D3D12_RESOURCE_STATES TargetState = (Desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) ?
+			D3D12_RESOURCE_STATE_DEPTH_WRITE : D3D12_RESOURCE_STATE_RENDER_TARGET;
+
+		CommandContext& Context = CommandContext::Begin(L"Discard Placed Target");
+		GpuResource Target(Resource, InitialState);
+		Context.TransitionResource(Target, TargetState, true);
+		Context.GetCommandList()->DiscardResource(Resource, nullptr);
+		Context.TransitionResource(Target, InitialState, true);
+		Context.Finish();
+	}
+
+	// {6C1C7C52-2E3B-4F0B-9C5E-8D0F3A6B41D7}
+	const GUID kPlacementGuid = { 0x6c1c7c52, 0x2e3b, 0x4f0b, { 0x9c, 0x5e, 0x8d, 0x0f, 0x3a, 0x6b, 0x41, 0xd7 } };
+}
+
+// Attached to a placed resource with SetPrivateDataInterface(), which holds the only reference.  The resource
+// releases it when it is destroyed, and that returns the range.
+struct GpuHeapAllocator::Placement : public IUnknown
+{
+	Placement(HeapClass Class, const D3D12_RESOURCE_DESC& ResourceDesc, const D3D12_CLEAR_VALUE* Clear) :
+		RefCount(1), Class(Class), Generation(sm_Generation), Desc(ResourceDesc), HasClearValue(Clear != nullptr), Resource(nullptr)
+	{
+		if (Clear != nullptr)
+			ClearValue = *Clear;
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+	{
+		if (riid == __uuidof(IUnknown))
+		{
+			*ppvObject = static_cast<IUnknown*>(this);
+			AddRef();
+			return S_OK;
+		}
+		*ppvObject = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef(void) override { return ++RefCount; }
+
+	ULONG STDMETHODCALLTYPE Release(void) override
+	{
+		const ULONG Count = --RefCount;
+		if (Count == 0)
+		{
+			if (Resource != nullptr)
+				GpuHeapAllocator::Retire(*this);
+			delete this;
+		}
+		return Count;
+	}
+
+	std::atomic<ULONG> RefCount;
+	HeapClass Class;
+	uint32_t Generation;
+	TlsfBlockPool::Allocation Allocation;
+	ComPtr<ID3D12Heap> Heap;
+	// Kept to recreate the resource when defragmenting.
+	D3D12_RESOURCE_DESC Desc;
+	D3D12_CLEAR_VALUE ClearValue;
+	bool HasClearValue;
+	// Not a reference: the resource owns the placement.
+	ID3D12Resource* Resource;
+};
+
+std::mutex GpuHeapAllocator::sm_Mutex;
+TlsfBlockPool GpuHeapAllocator::sm_Pools[kNumHeapClasses] =
+{
+	{ kPoolConfigs[0].HeapSize, kPoolConfigs[0].Granularity },
+	{ kPoolConfigs[1].HeapSize, kPoolConfigs[1].Granularity },
+	{ kPoolConfigs[2].HeapSize, kPoolConfigs[2].Granularity },
+	{ kPoolConfigs[3].HeapSize, kPoolConfigs[3].Granularity },
+};
+DeferredReleaseQueue GpuHeapAllocator::sm_Retired;
+uint64_t GpuHeapAllocator::sm_PendingFreeBytes = 0;
+uint32_t GpuHeapAllocator::sm_NumCommitted = 0;
+uint64_t GpuHeapAllocator::sm_CommittedBytes = 0;
+std::atomic<uint32_t> GpuHeapAllocator::sm_Generation(0);
+
+GpuHeapAllocator::HeapClass GpuHeapAllocator::SelectHeapClass(const D3D12_RESOURCE_DESC& Desc, uint64_t Alignment)
+{
+	if (Desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+		return kBufferHeap;
+
+	if (Desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+		return Alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT ? kMsaaRenderTargetHeap : kRenderTargetHeap;
+
+	// MSAA textures that are not render targets are rare enough to stay committed.
+	return Alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT ? kNumHeapClasses : kTextureHeap;
+}
+
+ID3D12Heap* GpuHeapAllocator::CreateHeap(HeapClass Class)
+{
+	D3D12_HEAP_DESC HeapDesc = {};
+	HeapDesc.SizeInBytes = kPoolConfigs[Class].HeapSize;
+	HeapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	HeapDesc.Alignment = kPoolConfigs[Class].HeapAlignment;
+	HeapDesc.Flags = kPoolConfigs[Class].Flags;
+
+	ID3D12Heap* Heap = nullptr;
+	ASSERT_SUCCEEDED(g_Device->CreateHeap(&HeapDesc, IID_PPV_ARGS(&Heap)));
+	Heap->SetName(L"GpuHeapAllocator Heap");
+	return Heap;
+}
+
+HRESULT GpuHeapAllocator::CreatePlaced(Placement* NewPlacement, D3D12_RESOURCE_STATES InitialState, ID3D12Resource** Resource)
+{
+	ComPtr<ID3D12Resource> NewResource;
+	HRESULT hr = g_Device->CreatePlacedResource(NewPlacement->Heap.Get(), NewPlacement->Allocation.Offset, &NewPlacement->Desc,
+		InitialState, NewPlacement->HasClearValue ? &NewPlacement->ClearValue : nullptr, IID_PPV_ARGS(&NewResource));
+	if (FAILED(hr))
+		return hr;
+
+	hr = NewResource->SetPrivateDataInterface(kPlacementGuid, NewPlacement);
+	if (FAILED(hr))
+		return hr;
+
+	// From here on the resource owns the placement.
+	NewPlacement->Resource = NewResource.Get();
+	NewPlacement->Release();
+	*Resource = NewResource.Detach();
+	return S_OK;
+}
+
+HRESULT GpuHeapAllocator::CreateResource(D3D12_HEAP_TYPE HeapType, const D3D12_RESOURCE_DESC& Desc, D3D12_RESOURCE_STATES InitialState,
+	const D3D12_CLEAR_VALUE* ClearValue, ID3D12Resource** Resource)
+{
+	HeapClass Class = kNumHeapClasses;
+	D3D12_RESOURCE_DESC PlacedDesc = Desc;
+	D3D12_RESOURCE_ALLOCATION_INFO Info = {};
+
+	if (HeapType == D3D12_HEAP_TYPE_DEFAULT)
+	{
+		// Textures whose most detailed mip fits in 64 KB may use 4 KB alignment; the runtime answers with the
+		// regular alignment when the resource does not qualify.
+		const bool MayUseSmallAlignment = Desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER && Desc.SampleDesc.Count <= 1 &&
+			!(Desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL));
+		if (MayUseSmallAlignment)
+		{
+			PlacedDesc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+			Info = g_Device->GetResourceAllocationInfo(0, 1, &PlacedDesc);
+		}
+		if (!MayUseSmallAlignment || Info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+		{
+			PlacedDesc.Alignment = 0;
+			Info = g_Device->GetResourceAllocationInfo(0, 1, &PlacedDesc);
+		}
+
+		if (Info.SizeInBytes != UINT64_MAX)
+			Class = SelectHeapClass(PlacedDesc, Info.Alignment);
+		// Above a quarter of a heap, the space left around a large resource is mostly wasted.
+		if (Class != kNumHeapClasses && Info.SizeInBytes > kPoolConfigs[Class].HeapSize / 4)
+			Class = kNumHeapClasses;
+	}
+
+	if (Class == kNumHeapClasses)
+	{
+		if (HeapType == D3D12_HEAP_TYPE_DEFAULT)
+		{
+			std::lock_guard<std::mutex> LockGuard(sm_Mutex);
+			++sm_NumCommitted;
+			sm_CommittedBytes += Info.SizeInBytes != UINT64_MAX ? Info.SizeInBytes : 0;
+		}
+		return g_Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(HeapType), D3D12_HEAP_FLAG_NONE, &Desc,
+			InitialState, ClearValue, IID_PPV_ARGS(Resource));
+	}
+
+	Placement* NewPlacement = new Placement(Class, PlacedDesc, ClearValue);
+	{
+		std::lock_guard<std::mutex> LockGuard(sm_Mutex);
+		ReclaimRetired();
+
+		TlsfBlockPool& Pool = sm_Pools[Class];
+		if (!Pool.Allocate(Info.SizeInBytes, Info.Alignment, (uint64_t)NewPlacement, NewPlacement->Allocation))
+		{
+			Pool.AddBlock(CreateHeap(Class));
+			const bool Allocated = Pool.Allocate(Info.SizeInBytes, Info.Alignment, (uint64_t)NewPlacement, NewPlacement->Allocation);
+			ASSERT(Allocated, "A new heap cannot hold the resource");
+		}
+		NewPlacement->Heap = (ID3D12Heap*)Pool.GetBlockUserData(NewPlacement->Allocation.Block);
+	}
+
+	const HRESULT hr = CreatePlaced(NewPlacement, InitialState, Resource);
+	if (FAILED(hr))
+	{
+		std::lock_guard<std::mutex> LockGuard(sm_Mutex);
+		sm_Pools[Class].Free(NewPlacement->Allocation);
+		delete NewPlacement;
+	}
+	else if (Class == kRenderTargetHeap || Class == kMsaaRenderTargetHeap)
+	{
+		DiscardPlacedTarget(*Resource, PlacedDesc, InitialState);
+	}
+	return hr;
+}
+
+void GpuHeapAllocator::Retire(const Placement& Placement)
+{
+	// Resources outliving DestroyAll() (globals released at exit) belong to pools that no longer exist.
+	if (Placement.Generation != sm_Generation)
+		return;
+
+	// The range may still be read by work recorded so far, all of which completes before the next fence.
+	const uint64_t FenceValue = g_CommandManager.GetGraphicsQueue().GetNextFenceValue();
+
+	std::lock_guard<std::mutex> LockGuard(sm_Mutex);
+	sm_Retired.Defer(FenceValue, [Class = (uint32_t)Placement.Class, Allocation = Placement.Allocation]
+		{ FreeRetired(Class, Allocation); });
+	sm_PendingFreeBytes += Placement.Allocation.Size;
+	ReclaimRetired();
+}
+
+void GpuHeapAllocator::ReclaimRetired(void)
+{
+	sm_Retired.Process([](uint64_t FenceValue) { return g_CommandManager.IsFenceComplete(FenceValue); });
+}
+
+void GpuHeapAllocator::FreeRetired(uint32_t Class, const TlsfBlockPool::Allocation& Allocation)
+{
+	TlsfBlockPool& Pool = sm_Pools[Class];
+	sm_PendingFreeBytes -= Allocation.Size;
+
+	// Keep one empty heap per class so a resource that is recreated every few frames does not create and
+	// release a heap each time.
+	if (Pool.Free(Allocation) && Pool.CountEmptyBlocks() > 1)
+		((ID3D12Heap*)Pool.RemoveBlock(Allocation.Block))->Release();
+}
+
+void GpuHeapAllocator::BeginDefragmentation(std::vector<DefragmentationMove>& Moves, uint64_t MaxBytes)
+{
+	std::lock_guard<std::mutex> LockGuard(sm_Mutex);
+	ReclaimRetired();
+
+	std::vector<TlsfBlockPool::Move> Plan;
+	for (uint32_t Class = 0; Class < kNumHeapClasses; ++Class)
+	{
+		TlsfBlockPool& Pool = sm_Pools[Class];
+		Plan.clear();
+		Pool.PlanDefragmentation(MaxBytes, Plan);
+
+		for (const TlsfBlockPool::Move& Move : Plan)
+		{
+			const Placement* Source = (const Placement*)Move.UserData;
+			Placement* NewPlacement = new Placement((HeapClass)Class, Source->Desc, Source->HasClearValue ? &Source->ClearValue : nullptr);
+			NewPlacement->Allocation = Move.To;
+			NewPlacement->Heap = (ID3D12Heap*)Pool.GetBlockUserData(Move.To.Block);
+			Pool.SetUserData(Move.To, (uint64_t)NewPlacement);
+
+			DefragmentationMove NewMove;
+			if (Source->Resource == nullptr || FAILED(CreatePlaced(NewPlacement, D3D12_RESOURCE_STATE_COPY_DEST, NewMove.Destination.GetAddressOf())))
+			{
+				// Still being created on another thread, or out of memory; the rest of the heap moves anyway.
+				Pool.Free(Move.To);
+				delete NewPlacement;
+				continue;
+			}
+
+			NewMove.Source = Source->Resource;
+			GpuMemory::TrackAs(NewMove.Destination.Get(), NewMove.Source.Get());
+			Moves.push_back(std::move(NewMove));
+		}
+	}
+}
+
+GpuHeapAllocator::Stats GpuHeapAllocator::GetStats(void)
+{
+	std::lock_guard<std::mutex> LockGuard(sm_Mutex);
+
+	Stats Result;
+	for (uint32_t Class = 0; Class < kNumHeapClasses; ++Class)
+		Result.Pools[Class] = sm_Pools[Class].GetStats();
+	Result.PendingFreeBytes = sm_PendingFreeBytes;
+	Result.NumCommitted = sm_NumCommitted;
+	Result.CommittedBytes = sm_CommittedBytes;
+	return Result;
+}
+
+void GpuHeapAllocator::PrintStats(void)
+{
+	const Stats Current = GetStats();
+	for (uint32_t Class = 0; Class < kNumHeapClasses; ++Class)
+	{
+		const TlsfBlockPool::Stats& Pool = Current.Pools[Class];
+		if (Pool.NumBlocks == 0)
+			continue;
+
+		Utility::Printf("GPU heaps, %s: %u heaps, %.1f of %.1f MB used by %u resources (peak %.1f MB), %u free ranges, fragmentation %.2f\n",
+			kPoolConfigs[Class].Name, Pool.NumBlocks, Pool.UsedBytes / 1048576.0, Pool.ReservedBytes / 1048576.0, Pool.NumAllocations,
+			Pool.PeakUsedBytes / 1048576.0, Pool.NumFreeRanges, Pool.GetFragmentation());
+	}
+	Utility::Printf("GPU heaps: %.1f MB waiting for the GPU, %u committed fallbacks (%.1f MB)\n",
+		Current.PendingFreeBytes / 1048576.0, Current.NumCommitted, Current.CommittedBytes / 1048576.0);
+}
+
+void GpuHeapAllocator::DestroyAll(void)
+{
+	std::lock_guard<std::mutex> LockGuard(sm_Mutex);
+	++sm_Generation;
+
+	for (uint32_t Class = 0; Class < kNumHeapClasses; ++Class)
+	{
+		TlsfBlockPool& Pool = sm_Pools[Class];
+		for (uint32_t Block = 0; Block < Pool.GetNumBlocks(); ++Block)
+		{
+			if (Pool.IsBlockInUse(Block))
+				((ID3D12Heap*)Pool.GetBlockUserData(Block))->Release();
+		}
+		Pool = TlsfBlockPool(kPoolConfigs[Class].HeapSize, kPoolConfigs[Class].Granularity);
+	}
+
+	sm_Retired.Clear();
+	sm_PendingFreeBytes = 0;
+}
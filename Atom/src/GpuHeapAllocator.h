@@ -0,0 +1,84 @@
+#pragma once
+
+#include "TlsfAllocator.h"
+#include "DeferredReleaseQueue.h"
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+// Places DEFAULT heap resources in shared 64 MB ID3D12Heaps, managed by TlsfBlockPool, instead of giving each
+// one its own implicit heap through CreateCommittedResource.  Creating a placed resource does not allocate
+// memory, and small textures can use the 4 KB placement alignment instead of 64 KB.
+//
+// Resources are grouped by heap class, which keeps the pools usable on resource heap tier 1: buffers, plain
+// textures, render target / depth textures, and MSAA render targets whose heaps have 4 MB alignment.  Other
+// heap types and resources larger than a quarter of a heap are still committed.
+//
+// The placement is attached to the resource as private data, so its range is released when the last
+// reference to the resource goes away, whichever ComPtr or GpuResource holds it.  The range is reused once
+// the graphics queue has passed the fence that was pending at that time.
+class GpuHeapAllocator
+{
+public:
+	enum HeapClass
+	{
+		kBufferHeap,
+		kTextureHeap,
+		kRenderTargetHeap,
+		kMsaaRenderTargetHeap,
+
+		kNumHeapClasses
+	};
+
+	struct Stats
+	{
+		TlsfBlockPool::Stats Pools[kNumHeapClasses];
+		uint64_t PendingFreeBytes = 0;      // released, waiting for the GPU
+		uint32_t NumCommitted = 0;          // fallbacks to CreateCommittedResource since startup
+		uint64_t CommittedBytes = 0;
+	};
+
+	// A resource to relocate out of a heap that defragmentation wants to release.  See BeginDefragmentation().
+	struct DefragmentationMove
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Source;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Destination;     // created in D3D12_RESOURCE_STATE_COPY_DEST
+	};
+
+	// Same contract as ID3D12Device::CreateCommittedResource() with D3D12_HEAP_FLAG_NONE.
+	static HRESULT CreateResource(D3D12_HEAP_TYPE HeapType, const D3D12_RESOURCE_DESC& Desc, D3D12_RESOURCE_STATES InitialState,
+		const D3D12_CLEAR_VALUE* ClearValue, ID3D12Resource** Resource);
+
+	// For each heap class, picks the least used heap whose resources (at most MaxBytes) fit in the other heaps
+	// and creates their new placed copies.  The caller copies Source into Destination, switches every
+	// reference and view to Destination and drops Source; the old heap is released once all of its resources
+	// are gone.  Dropping a move's Destination instead cancels it.  Must not run while other threads create
+	// or release placed resources.
+	static void BeginDefragmentation(std::vector<DefragmentationMove>& Moves, uint64_t MaxBytes);
+
+	static Stats GetStats(void);
+	static void PrintStats(void);
+
+	// Releases the heaps.  Resources still alive keep their heap alive; their placements are then ignored.
+	static void DestroyAll(void);
+
+private:
+	struct Placement;       // Defined in GpuHeapAllocator.cpp
+
+	static HeapClass SelectHeapClass(const D3D12_RESOURCE_DESC& Desc, uint64_t Alignment);
+	static ID3D12Heap* CreateHeap(HeapClass Class);
+	static void Retire(const Placement& Placement);
+	static void ReclaimRetired(void);       // sm_Mutex held
+	static void FreeRetired(uint32_t Class, const TlsfBlockPool::Allocation& Allocation);       // sm_Mutex held
+	// Called with the placement's range reserved; on failure the caller returns the range and deletes it.
+	static HRESULT CreatePlaced(Placement* NewPlacement, D3D12_RESOURCE_STATES InitialState, ID3D12Resource** Resource);
+
+	static std::mutex sm_Mutex;
+	static TlsfBlockPool sm_Pools[kNumHeapClasses];
+	static DeferredReleaseQueue sm_Retired;
+	static uint64_t sm_PendingFreeBytes;
+	static uint32_t sm_NumCommitted;
+	static uint64_t sm_CommittedBytes;
+	// Bumped by DestroyAll() so placements of released pools are not returned to the new ones.
+	static std::atomic<uint32_t> sm_Generation;
+};
@@ -0,0 +1,160 @@
+#include "pch.h"
+#include "GpuMemory.h"
+#include "GraphicsCore.h"
+#include <atomic>
+
+using namespace Graphics;
+
+namespace
+{
+	GpuMemoryTracker s_Tracker;
+	Microsoft::WRL::ComPtr<IDXGIAdapter3> s_Adapter;
+	// Set by Shutdown(): objects released after it, such as globals destroyed at exit, are not counted anymore.
+	std::atomic<bool> s_IsShutDown(false);
+
+	// {3F0B6A1E-94C2-4D57-A8E1-5B7C2D9F6E43}
+	const GUID kTrackedMemoryGuid = { 0x3f0b6a1e, 0x94c2, 0x4d57, { 0xa8, 0xe1, 0x5b, 0x7c, 0x2d, 0x9f, 0x6e, 0x43 } };
+
+	// Attached to a tracked object with SetPrivateDataInterface(), which holds the only reference.  The object
+	// releases it when it is destroyed, and that removes its bytes from the tracker.
+	struct TrackedMemory : public IUnknown
+	{
+		TrackedMemory(GpuMemoryTracker::Category Category, uint64_t Bytes) : RefCount(1), Category(Category), Bytes(Bytes) {}
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+		{
+			if (riid == __uuidof(IUnknown))
+			{
+				*ppvObject = static_cast<IUnknown*>(this);
+				AddRef();
+				return S_OK;
+			}
+			*ppvObject = nullptr;
+			return E_NOINTERFACE;
+		}
+
+		ULONG STDMETHODCALLTYPE AddRef(void) override { return ++RefCount; }
+
+		ULONG STDMETHODCALLTYPE Release(void) override
+		{
+			const ULONG Count = --RefCount;
+			if (Count == 0)
+			{
+				if (!s_IsShutDown)
+					s_Tracker.OnRelease(Category, Bytes);
+				delete this;
+			}
+			return Count;
+		}
+
+		std::atomic<ULONG> RefCount;
+		GpuMemoryTracker::Category Category;
+		uint64_t Bytes;
+	};
+
+	void Attach(ID3D12Object* Object, GpuMemoryTracker::Category Category, uint64_t Bytes)
+	{
+		// Counted before attaching, since replacing a previous tag releases it.  If attaching fails, the release
+		// below balances the count.
+		s_Tracker.OnCreate(Category, Bytes);
+		TrackedMemory* Tracked = new TrackedMemory(Category, Bytes);
+		ASSERT_SUCCEEDED(Object->SetPrivateDataInterface(kTrackedMemoryGuid, Tracked));
+		Tracked->Release();
+	}
+}
+
+void GpuMemory::Initialize(IDXGIAdapter3* Adapter)
+{
+	s_Adapter = Adapter;
+	s_IsShutDown = false;
+	Update();
+}
+
+void GpuMemory::Shutdown(void)
+{
+	s_IsShutDown = true;
+	s_Adapter = nullptr;
+}
+
+void GpuMemory::Track(ID3D12Resource* Resource, GpuMemoryTracker::Category Category)
+{
+	const D3D12_RESOURCE_DESC Desc = Resource->GetDesc();
+	const D3D12_RESOURCE_ALLOCATION_INFO Info = g_Device->GetResourceAllocationInfo(0, 1, &Desc);
+	Attach(Resource, Category, Info.SizeInBytes);
+}
+
+void GpuMemory::Track(ID3D12Heap* Heap, GpuMemoryTracker::Category Category)
+{
+	Attach(Heap, Category, Heap->GetDesc().SizeInBytes);
+}
+
+void GpuMemory::Track(ID3D12DescriptorHeap* Heap)
+{
+	const D3D12_DESCRIPTOR_HEAP_DESC Desc = Heap->GetDesc();
+	if (Desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
+	{
+		Attach(Heap, GpuMemoryTracker::kDescriptorHeaps,
+			(uint64_t)Desc.NumDescriptors * g_Device->GetDescriptorHandleIncrementSize(Desc.Type));
+	}
+}
+
+void GpuMemory::TrackAs(ID3D12Resource* Resource, ID3D12Resource* Original)
+{
+	IUnknown* Tag = nullptr;
+	UINT Size = sizeof(Tag);
+	if (FAILED(Original->GetPrivateData(kTrackedMemoryGuid, &Size, &Tag)) || Tag == nullptr)
+		return;
+
+	const GpuMemoryTracker::Category Category = static_cast<TrackedMemory*>(Tag)->Category;
+	Tag->Release();
+	Track(Resource, Category);
+}
+
+void GpuMemory::Update(void)
+{
+	if (s_Adapter == nullptr)
+		return;
+
+	DXGI_QUERY_VIDEO_MEMORY_INFO Info;
+	if (FAILED(s_Adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &Info)))
+		return;
+
+	if (s_Tracker.UpdateBudget(Info.Budget, Info.CurrentUsage))
+	{
+		Utility::Printf("GPU memory over budget: %.1f MB used of %.1f MB\n",
+			Info.CurrentUsage / 1048576.0, Info.Budget / 1048576.0);
+	}
+}
+
+GpuMemoryTracker::Stats GpuMemory::GetStats(void)
+{
+	return s_Tracker.GetStats();
+}
+
+uint32_t GpuMemory::AddOverBudgetCallback(GpuMemoryTracker::BudgetCallback&& Callback)
+{
+	return s_Tracker.AddOverBudgetCallback(std::move(Callback));
+}
+
+void GpuMemory::RemoveOverBudgetCallback(uint32_t Id)
+{
+	s_Tracker.RemoveOverBudgetCallback(Id);
+}
+
+void GpuMemory::PrintStats(void)
+{
+	const GpuMemoryTracker::Stats Current = s_Tracker.GetStats();
+	for (uint32_t i = 0; i < GpuMemoryTracker::kNumCategories; ++i)
+	{
+		const GpuMemoryTracker::CategoryStats& Category = Current.Categories[i];
+		if (Category.NumCreated == 0)
+			continue;
+
+		Utility::Printf("GPU memory, %s: %.1f MB in %u objects (peak %.1f MB, %u objects)\n",
+			GpuMemoryTracker::GetCategoryName((GpuMemoryTracker::Category)i), Category.Bytes / 1048576.0, Category.Count,
+			Category.PeakBytes / 1048576.0, Category.PeakCount);
+	}
+	Utility::Printf("GPU memory: %.1f MB tracked (peak %.1f MB), %.1f MB used of a %.1f MB budget\n",
+		Current.TotalBytes / 1048576.0, Current.PeakTotalBytes / 1048576.0,
+		Current.Budget.CurrentUsage / 1048576.0, Current.Budget.Budget / 1048576.0);
+}
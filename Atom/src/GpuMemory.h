@@ -0,0 +1,29 @@
+#pragma once
+
+#include "GpuMemoryTracker.h"
+
+// Tags the GPU objects the engine creates with a GpuMemoryTracker category and polls the adapter's local memory
+// budget.  A tagged object stays counted until it is destroyed, whichever reference to it goes last.
+namespace GpuMemory
+{
+	void Initialize(IDXGIAdapter3* Adapter);
+	void Shutdown(void);
+
+	// A resource counts for what the device reserves for it.  Resources placed in a tracked heap must not be
+	// tracked themselves.  Tracking an object again moves it to the new category.
+	void Track(ID3D12Resource* Resource, GpuMemoryTracker::Category Category);
+	void Track(ID3D12Heap* Heap, GpuMemoryTracker::Category Category);
+	// Only shader visible heaps are counted; the others live in system memory.
+	void Track(ID3D12DescriptorHeap* Heap);
+	// Gives Resource the category of Original, e.g. for a copy made when defragmenting.
+	void TrackAs(ID3D12Resource* Resource, ID3D12Resource* Original);
+
+	// Queries the budget and runs the over budget callbacks when it has just been exceeded.  Called once a frame
+	// by Display::Present().
+	void Update(void);
+
+	GpuMemoryTracker::Stats GetStats(void);
+	uint32_t AddOverBudgetCallback(GpuMemoryTracker::BudgetCallback&& Callback);
+	void RemoveOverBudgetCallback(uint32_t Id);
+	void PrintStats(void);
+}
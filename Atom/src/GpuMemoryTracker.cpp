@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "GpuMemoryTracker.h"
+#include <algorithm>
+
+const char* GpuMemoryTracker::GetCategoryName(Category category)
+{
+	static const char* const kNames[kNumCategories] =
+	{
+		"Textures", "Geometry", "Render Targets", "Upload Pages", "Descriptor Heaps", "Other"
+	};
+	ASSERT(category < kNumCategories);
+	return kNames[category];
+}
+
+void GpuMemoryTracker::OnCreate(Category category, uint64_t bytes)
+{
+	ASSERT(category < kNumCategories);
+	std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+	CategoryStats& stats = m_Stats.Categories[category];
+	stats.Bytes += bytes;
+	stats.PeakBytes = std::max(stats.PeakBytes, stats.Bytes);
+	++stats.Count;
+	stats.PeakCount = std::max(stats.PeakCount, stats.Count);
+	++stats.NumCreated;
+
+	m_Stats.TotalBytes += bytes;
+	m_Stats.PeakTotalBytes = std::max(m_Stats.PeakTotalBytes, m_Stats.TotalBytes);
+}
+
+void GpuMemoryTracker::OnRelease(Category category, uint64_t bytes)
+{
+	ASSERT(category < kNumCategories);
+	std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+	CategoryStats& stats = m_Stats.Categories[category];
+	ASSERT(stats.Count > 0 && stats.Bytes >= bytes, "Released more GPU memory than was created");
+	stats.Bytes -= bytes;
+	--stats.Count;
+	m_Stats.TotalBytes -= bytes;
+}
+
+bool GpuMemoryTracker::UpdateBudget(uint64_t budget, uint64_t currentUsage)
+{
+	std::vector<BudgetCallback> callbacks;
+	BudgetInfo info;
+	{
+		std::lock_guard<std::mutex> LockGuard(m_Mutex);
+		info.Budget = budget;
+		info.CurrentUsage = currentUsage;
+		m_Stats.Budget = info;
+
+		const bool wasOverBudget = m_OverBudget;
+		m_OverBudget = info.IsOverBudget();
+		if (!m_OverBudget || wasOverBudget)
+			return false;
+
+		// Run without the lock: a callback is likely to release memory.
+		for (const auto& callback : m_Callbacks)
+			callbacks.push_back(callback.second);
+	}
+
+	for (const BudgetCallback& callback : callbacks)
+		callback(info);
+	return true;
+}
+
+uint32_t GpuMemoryTracker::AddOverBudgetCallback(BudgetCallback&& callback)
+{
+	std::lock_guard<std::mutex> LockGuard(m_Mutex);
+	m_Callbacks.emplace_back(m_NextCallbackId, std::move(callback));
+	return m_NextCallbackId++;
+}
+
+void GpuMemoryTracker::RemoveOverBudgetCallback(uint32_t id)
+{
+	std::lock_guard<std::mutex> LockGuard(m_Mutex);
+	m_Callbacks.erase(std::remove_if(m_Callbacks.begin(), m_Callbacks.end(),
+		[id](const std::pair<uint32_t, BudgetCallback>& callback) { return callback.first == id; }), m_Callbacks.end());
+}
+
+GpuMemoryTracker::Stats GpuMemoryTracker::GetStats() const
+{
+	std::lock_guard<std::mutex> LockGuard(m_Mutex);
+	return m_Stats;
+}
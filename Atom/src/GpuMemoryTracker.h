@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Counts the GPU memory created by the engine per category: live bytes and objects, and their peaks.  Creations
+// and releases are reported with their size, so it runs without a device (see GpuMemory.h, which tags the D3D
+// objects and feeds it the adapter's budget).
+//
+// UpdateBudget() takes the local memory budget and usage that the OS reports for the process.  The over budget
+// callbacks run when the usage goes above the budget, and again only after it has dropped back under it.
+class GpuMemoryTracker
+{
+public:
+	enum Category
+	{
+		kTextures,
+		kGeometry,
+		kRenderTargets,
+		kUploadPages,
+		kDescriptorHeaps,
+		kOther,
+
+		kNumCategories
+	};
+
+	struct CategoryStats
+	{
+		uint64_t Bytes = 0;
+		uint64_t PeakBytes = 0;
+		uint32_t Count = 0;
+		uint32_t PeakCount = 0;
+		uint64_t NumCreated = 0;    // since startup
+	};
+
+	struct BudgetInfo
+	{
+		uint64_t Budget = 0;        // 0 until the first UpdateBudget()
+		uint64_t CurrentUsage = 0;
+
+		bool IsOverBudget() const { return Budget != 0 && CurrentUsage > Budget; }
+	};
+
+	struct Stats
+	{
+		CategoryStats Categories[kNumCategories];
+		uint64_t TotalBytes = 0;
+		uint64_t PeakTotalBytes = 0;
+		BudgetInfo Budget;
+	};
+
+	typedef std::function<void(const BudgetInfo& Budget)> BudgetCallback;
+
+	static const char* GetCategoryName(Category category);
+
+	void OnCreate(Category category, uint64_t bytes);
+	void OnRelease(Category category, uint64_t bytes);
+
+	// Returns true when this update went over the budget; the callbacks have run by then, on this thread.
+	bool UpdateBudget(uint64_t budget, uint64_t currentUsage);
+
+	uint32_t AddOverBudgetCallback(BudgetCallback&& callback);
+	void RemoveOverBudgetCallback(uint32_t id);
+
+	Stats GetStats() const;
+
+private:
+	mutable std::mutex m_Mutex;
+	Stats m_Stats;
+	bool m_OverBudget = false;
+	std::vector<std::pair<uint32_t, BudgetCallback>> m_Callbacks;
+	uint32_t m_NextCallbackId = 0;
+};
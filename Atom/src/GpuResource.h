@@ -1,5 +1,7 @@
 #pragma once
 
+#include "DeferredRelease.h"
+
 class GpuResource
 {
     friend class CommandContext;
@@ -24,9 +26,10 @@ public:
 
     ~GpuResource() { Destroy(); }
 
+    // The GPU may still be using the resource, so it is released once the work submitted so far has completed.
     virtual void Destroy()
     {
-        m_pResource = nullptr;
+        DeferredRelease::Release(m_pResource);
         m_GpuVirtualAddress = D3D12_GPU_VIRTUAL_ADDRESS_NULL;
         ++m_VersionID;
     }
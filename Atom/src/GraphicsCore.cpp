@@ -4,6 +4,9 @@
 #include "Ssao.h"
 #include "CommandListManager.h"
 #include "CommandContext.h"
+#include "GpuHeapAllocator.h"
+#include "GpuMemory.h"
+#include "DeferredRelease.h"
 #include "GraphicsCommon.h"
 #include "Renderer.h"
 
@@ -65,6 +68,10 @@ namespace Graphics
 
 		g_Device = pDevice.Detach();
 		g_Device->SetName(L"g_Device");
+
+		Microsoft::WRL::ComPtr<IDXGIAdapter3> pAdapter;
+		if (SUCCEEDED(dxgiFactory->EnumAdapterByLuid(g_Device->GetAdapterLuid(), IID_PPV_ARGS(&pAdapter))))
+			GpuMemory::Initialize(pAdapter.Get());
 		
 		g_CommandManager.Create(g_Device);
 
@@ -84,9 +91,12 @@ namespace Graphics
     {
 		g_CommandManager.IdleGPU();
 		
+		DeferredRelease::Shutdown();
+		GpuHeapAllocator::DestroyAll();
 		g_CommandManager.Shutdown();
 		SSAO::Shutdown();
 		Display::Shutdown();
+		GpuMemory::Shutdown();
     }
 
 	
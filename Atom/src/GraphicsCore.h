@@ -26,6 +26,10 @@ namespace Graphics
     {
         return g_DescriptorAllocator[Type].Allocate(Count);
     }
+    inline void FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE Type, D3D12_CPU_DESCRIPTOR_HANDLE Handle)
+    {
+        g_DescriptorAllocator[Type].Free(Handle);
+    }
 }
 
 enum class DescriptorHeapLayout : int
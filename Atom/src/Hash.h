@@ -51,4 +51,58 @@ namespace Utility
         return HashRange((uint32_t*)StateDesc, (uint32_t*)(StateDesc + Count), Hash);
     }
 
+    // XXH64 (https://github.com/Cyan4973/xxHash) of an arbitrary byte range.  Unlike HashRange() it needs no
+    // alignment and has 64 bits, enough to key caches by content such as encoded image files.
+    inline uint64_t HashBytes(const void* Data, size_t Size, uint64_t Seed = 0)
+    {
+        const uint64_t Prime1 = 0x9E3779B185EBCA87ULL, Prime2 = 0xC2B2AE3D27D4EB4FULL, Prime3 = 0x165667B19E3779F9ULL;
+        const uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL, Prime5 = 0x27D4EB2F165667C5ULL;
+
+        auto Rotl = [](uint64_t X, int R) { return (X << R) | (X >> (64 - R)); };
+        auto Read64 = [](const uint8_t* P) { uint64_t V; memcpy(&V, P, 8); return V; };
+        auto Read32 = [](const uint8_t* P) { uint32_t V; memcpy(&V, P, 4); return (uint64_t)V; };
+        auto Round = [&](uint64_t Acc, uint64_t Input) { return Rotl(Acc + Input * Prime2, 31) * Prime1; };
+        auto Merge = [&](uint64_t Acc, uint64_t Val) { return (Acc ^ Round(0, Val)) * Prime1 + Prime4; };
+
+        const uint8_t* P = (const uint8_t*)Data;
+        const uint8_t* const End = P + Size;
+        uint64_t Hash;
+
+        if (Size >= 32)
+        {
+            uint64_t V1 = Seed + Prime1 + Prime2, V2 = Seed + Prime2, V3 = Seed, V4 = Seed - Prime1;
+            for (; P + 32 <= End; P += 32)
+            {
+                V1 = Round(V1, Read64(P));
+                V2 = Round(V2, Read64(P + 8));
+                V3 = Round(V3, Read64(P + 16));
+                V4 = Round(V4, Read64(P + 24));
+            }
+            Hash = Rotl(V1, 1) + Rotl(V2, 7) + Rotl(V3, 12) + Rotl(V4, 18);
+            Hash = Merge(Merge(Merge(Merge(Hash, V1), V2), V3), V4);
+        }
+        else
+        {
+            Hash = Seed + Prime5;
+        }
+
+        Hash += (uint64_t)Size;
+        for (; P + 8 <= End; P += 8)
+            Hash = Rotl(Hash ^ Round(0, Read64(P)), 27) * Prime1 + Prime4;
+        if (P + 4 <= End)
+        {
+            Hash = Rotl(Hash ^ Read32(P) * Prime1, 23) * Prime2 + Prime3;
+            P += 4;
+        }
+        for (; P < End; ++P)
+            Hash = Rotl(Hash ^ *P * Prime5, 11) * Prime1;
+
+        Hash ^= Hash >> 33;
+        Hash *= Prime2;
+        Hash ^= Hash >> 29;
+        Hash *= Prime3;
+        Hash ^= Hash >> 32;
+        return Hash;
+    }
+
 } // namespace Utility
\ No newline at end of file
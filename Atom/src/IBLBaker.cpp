@@ -0,0 +1,885 @@
+#include "pch.h"
+#include "IBLBaker.h"
+#include "Hash.h"
+#include "SystemTime.h"
+#include "ParallelFor.h"
+#include "Sampling.h"
+#include "PackedHDR.h"
+#include "stb_image/stb_image.h"
+#include <cmath>
+#include <filesystem>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	const float kPi = 3.14159265358979f;
+
+	// RGBA32F cube with a full mip chain, face-major like the D3D12 subresource order.
+	struct FloatCube
+	{
+		uint32_t Size = 0;
+		uint32_t MipLevels = 0;
+		std::vector<size_t> Offsets;
+		std::vector<float> Texels;
+
+		void Init(uint32_t size, uint32_t mipLevels)
+		{
+			Size = size;
+			MipLevels = mipLevels;
+			Offsets.resize(6 * mipLevels);
+			size_t offset = 0;
+			for (uint32_t face = 0; face < 6; ++face)
+			{
+				for (uint32_t mip = 0; mip < mipLevels; ++mip)
+				{
+					const uint32_t mipSize = std::max(1u, size >> mip);
+					Offsets[face * mipLevels + mip] = offset;
+					offset += (size_t)mipSize * mipSize * 4;
+				}
+			}
+			Texels.assign(offset, 0.0f);
+		}
+
+		uint32_t MipSize(uint32_t mip) const { return std::max(1u, Size >> mip); }
+		float* Face(uint32_t face, uint32_t mip) { return Texels.data() + Offsets[face * MipLevels + mip]; }
+		const float* Face(uint32_t face, uint32_t mip) const { return Texels.data() + Offsets[face * MipLevels + mip]; }
+	};
+
+	// Same face orientation as getSamplingVector() in the IBL compute shaders.
+	XMFLOAT3 TexelDirection(uint32_t face, uint32_t x, uint32_t y, uint32_t size)
+	{
+		const float u = 2.0f * (x + 0.5f) / size - 1.0f;
+		const float v = 1.0f - 2.0f * (y + 0.5f) / size;
+
+		XMFLOAT3 dir;
+		switch (face)
+		{
+		case 0: dir = XMFLOAT3(1.0f, v, -u); break;
+		case 1: dir = XMFLOAT3(-1.0f, v, u); break;
+		case 2: dir = XMFLOAT3(u, 1.0f, -v); break;
+		case 3: dir = XMFLOAT3(u, -1.0f, v); break;
+		case 4: dir = XMFLOAT3(u, v, 1.0f); break;
+		default: dir = XMFLOAT3(-u, v, -1.0f); break;
+		}
+		const float invLen = 1.0f / std::sqrt(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+		return XMFLOAT3(dir.x * invLen, dir.y * invLen, dir.z * invLen);
+	}
+
+	// Inverse of TexelDirection(): face index and [0, 1] face coordinates (st) for a direction.
+	uint32_t DirectionToFace(const XMFLOAT3& d, float& s, float& t)
+	{
+		const float ax = std::abs(d.x), ay = std::abs(d.y), az = std::abs(d.z);
+		uint32_t face;
+		float u, v;
+		if (ax >= ay && ax >= az)
+		{
+			face = d.x > 0.0f ? 0 : 1;
+			u = (d.x > 0.0f ? -d.z : d.z) / ax;
+			v = d.y / ax;
+		}
+		else if (ay >= az)
+		{
+			face = d.y > 0.0f ? 2 : 3;
+			u = d.x / ay;
+			v = (d.y > 0.0f ? -d.z : d.z) / ay;
+		}
+		else
+		{
+			face = d.z > 0.0f ? 4 : 5;
+			u = (d.z > 0.0f ? d.x : -d.x) / az;
+			v = d.y / az;
+		}
+		s = 0.5f * (u + 1.0f);
+		t = 0.5f * (1.0f - v);
+		return face;
+	}
+
+	// Bilinear fetch from an RGBA32F image with clamped rows and clamped or wrapped columns.
+	void SampleBilinear(const float* image, uint32_t width, uint32_t height, float s, float t, bool wrapU, float out[4])
+	{
+		const float fx = s * width - 0.5f;
+		const float fy = t * height - 0.5f;
+		const float x0f = std::floor(fx), y0f = std::floor(fy);
+		const float wx = fx - x0f, wy = fy - y0f;
+
+		auto column = [&](int x) -> uint32_t
+		{
+			if (wrapU)
+				return (uint32_t)((x % (int)width + (int)width) % (int)width);
+			return (uint32_t)std::clamp(x, 0, (int)width - 1);
+		};
+		const uint32_t x0 = column((int)x0f), x1 = column((int)x0f + 1);
+		const uint32_t y0 = (uint32_t)std::clamp((int)y0f, 0, (int)height - 1);
+		const uint32_t y1 = (uint32_t)std::clamp((int)y0f + 1, 0, (int)height - 1);
+
+		const float* p00 = image + ((size_t)y0 * width + x0) * 4;
+		const float* p10 = image + ((size_t)y0 * width + x1) * 4;
+		const float* p01 = image + ((size_t)y1 * width + x0) * 4;
+		const float* p11 = image + ((size_t)y1 * width + x1) * 4;
+		for (int c = 0; c < 4; ++c)
+		{
+			const float top = p00[c] + (p10[c] - p00[c]) * wx;
+			const float bottom = p01[c] + (p11[c] - p01[c]) * wx;
+			out[c] = top + (bottom - top) * wy;
+		}
+	}
+
+	// Trilinear lookup, the CPU counterpart of TextureCube.SampleLevel with a linear clamp sampler.
+	// Filtering does not cross face edges, which only matters in the lowest mips.
+	void SampleCube(const FloatCube& cube, const XMFLOAT3& dir, float mipLevel, float out[4])
+	{
+		float s, t;
+		const uint32_t face = DirectionToFace(dir, s, t);
+
+		mipLevel = std::clamp(mipLevel, 0.0f, (float)(cube.MipLevels - 1));
+		const uint32_t mip0 = (uint32_t)mipLevel;
+		const uint32_t mip1 = std::min(mip0 + 1, cube.MipLevels - 1);
+		const float w = mipLevel - (float)mip0;
+
+		SampleBilinear(cube.Face(face, mip0), cube.MipSize(mip0), cube.MipSize(mip0), s, t, false, out);
+		if (w > 0.0f && mip1 != mip0)
+		{
+			float hi[4];
+			SampleBilinear(cube.Face(face, mip1), cube.MipSize(mip1), cube.MipSize(mip1), s, t, false, hi);
+			for (int c = 0; c < 4; ++c)
+				out[c] += (hi[c] - out[c]) * w;
+		}
+	}
+
+	// Tangent space half vector around +Z, see ImportanceSampleGGX() in PBRCommon.hlsli.
+	XMFLOAT3 ImportanceSampleGGX(const XMFLOAT2& xi, float roughness)
+	{
+		const float a = std::max(0.0025f, roughness * roughness);
+		const float phi = 2.0f * kPi * xi.x;
+		const float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+		const float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+		return XMFLOAT3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+	}
+
+	float D_GGX(float NdotH, float alphaRoughness)
+	{
+		alphaRoughness = std::max(alphaRoughness, 1e-3f);
+		const float a2 = alphaRoughness * alphaRoughness;
+		const float nh2 = NdotH * NdotH;
+		const float f = nh2 * a2 + (1.0f - nh2);
+		return a2 / std::max(kPi * f * f, 1e-9f);
+	}
+
+	float V_SmithGGXCorrelated(float NdotL, float NdotV, float alphaRoughness)
+	{
+		const float a2 = alphaRoughness * alphaRoughness;
+		const float GGXV = NdotL * std::sqrt(std::max(NdotV * NdotV * (1.0f - a2) + a2, 1e-7f));
+		const float GGXL = NdotV * std::sqrt(std::max(NdotL * NdotL * (1.0f - a2) + a2, 1e-7f));
+		return 0.5f / (GGXV + GGXL);
+	}
+
+	// With N = V the light direction, its weight and the source mip only depend on the sample index and
+	// the roughness, so each radiance mip builds its sample set once and rotates it per texel.
+	struct PrefilterSample
+	{
+		XMFLOAT3 L;  // tangent space
+		float NoL;
+		float MipLevel;
+	};
+
+	void BuildPrefilterSamples(float roughness, uint32_t numSamples, uint32_t envSize, std::vector<PrefilterSample>& samples)
+	{
+		// Solid angle of a texel at the top mip of the source cube.
+		const float wt = 4.0f * kPi / (6.0f * envSize * envSize);
+		const float alpha = roughness * roughness;
+
+		samples.clear();
+		for (uint32_t i = 0; i < numSamples; ++i)
+		{
+			const XMFLOAT3 H = ImportanceSampleGGX(Sampling::Hammersley2D(i, numSamples), roughness);
+			const XMFLOAT3 L(2.0f * H.z * H.x, 2.0f * H.z * H.y, 2.0f * H.z * H.z - 1.0f);
+			const float NoL = L.z;
+			if (NoL <= 0.0f)
+				continue;
+
+			// SmithGGXSampleDirectionPDF() with N == V reduces to D / 4.
+			const float pdf = std::max(D_GGX(H.z, alpha) * 0.25f, 0.0001f);
+			const float ws = 1.0f / (numSamples * pdf);
+			const float mip = std::max(0.5f * std::log2(ws / wt) + 2.0f, 0.0f);
+			samples.push_back({ L, NoL, mip });
+		}
+	}
+
+	void EquirectToCube(const float* rgba, uint32_t width, uint32_t height, FloatCube& cube, uint32_t numThreads)
+	{
+		const uint32_t size = cube.Size;
+		Utility::ParallelFor(6 * size, numThreads, [&](uint32_t row)
+			{
+				const uint32_t face = row / size;
+				const uint32_t y = row % size;
+				float* dst = cube.Face(face, 0) + (size_t)y * size * 4;
+				for (uint32_t x = 0; x < size; ++x, dst += 4)
+				{
+					const XMFLOAT3 v = TexelDirection(face, x, y, size);
+					const float phi = std::atan2(v.z, v.x);
+					const float theta = std::acos(std::clamp(v.y, -1.0f, 1.0f));
+					float s = phi / (2.0f * kPi);
+					s -= std::floor(s);
+					SampleBilinear(rgba, width, height, s, theta / kPi, true, dst);
+				}
+			});
+	}
+
+	// 2x2 box filter per face, equivalent to GenerateMipMapCS sampling the previous level at texel centers.
+	void GenerateCubeMips(FloatCube& cube, uint32_t numThreads)
+	{
+		for (uint32_t mip = 1; mip < cube.MipLevels; ++mip)
+		{
+			const uint32_t srcSize = cube.MipSize(mip - 1);
+			const uint32_t dstSize = cube.MipSize(mip);
+			Utility::ParallelFor(6 * dstSize, numThreads, [&](uint32_t row)
+				{
+					const uint32_t face = row / dstSize;
+					const uint32_t y = row % dstSize;
+					const float* src = cube.Face(face, mip - 1);
+					float* dst = cube.Face(face, mip) + (size_t)y * dstSize * 4;
+					const uint32_t sy0 = std::min(2 * y, srcSize - 1), sy1 = std::min(2 * y + 1, srcSize - 1);
+					for (uint32_t x = 0; x < dstSize; ++x, dst += 4)
+					{
+						const uint32_t sx0 = std::min(2 * x, srcSize - 1), sx1 = std::min(2 * x + 1, srcSize - 1);
+						for (int c = 0; c < 4; ++c)
+						{
+							dst[c] = 0.25f * (
+								src[((size_t)sy0 * srcSize + sx0) * 4 + c] + src[((size_t)sy0 * srcSize + sx1) * 4 + c] +
+								src[((size_t)sy1 * srcSize + sx0) * 4 + c] + src[((size_t)sy1 * srcSize + sx1) * 4 + c]);
+						}
+					}
+				});
+		}
+	}
+
+	void PrefilterRadiance(const FloatCube& env, FloatCube& radiance, uint32_t numSamples, uint32_t numThreads)
+	{
+		const float deltaRoughness = 1.0f / std::max((float)(radiance.MipLevels - 1), 1.0f);
+
+		for (uint32_t mip = 0; mip < radiance.MipLevels; ++mip)
+		{
+			const float roughness = mip * deltaRoughness;
+			const uint32_t size = radiance.MipSize(mip);
+
+			std::vector<PrefilterSample> samples;
+			BuildPrefilterSamples(roughness, numSamples, env.Size, samples);
+
+			Utility::ParallelFor(6 * size, numThreads, [&](uint32_t row)
+				{
+					const uint32_t face = row / size;
+					const uint32_t y = row % size;
+					float* dst = radiance.Face(face, mip) + (size_t)y * size * 4;
+
+					for (uint32_t x = 0; x < size; ++x, dst += 4)
+					{
+						const XMFLOAT3 N = TexelDirection(face, x, y, size);
+
+						// The GGX lobe at roughness 0 is narrower than a source texel, every sample would
+						// land on the same footprint.
+						if (roughness == 0.0f)
+						{
+							SampleCube(env, N, 0.0f, dst);
+							dst[3] = 1.0f;
+							continue;
+						}
+
+						// Same tangent frame as ImportanceSampleGGX().
+						const XMVECTOR n = XMLoadFloat3(&N);
+						const XMVECTOR up = std::abs(N.z) < 0.999f ? g_XMIdentityR2 : g_XMIdentityR0;
+						const XMVECTOR tangentX = XMVector3Normalize(XMVector3Cross(up, n));
+						const XMVECTOR tangentY = XMVector3Cross(n, tangentX);
+
+						float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+						float totalWeight = 0.0f;
+						for (const PrefilterSample& sample : samples)
+						{
+							XMFLOAT3 L;
+							XMStoreFloat3(&L, tangentX * sample.L.x + tangentY * sample.L.y + n * sample.L.z);
+
+							float texel[4];
+							SampleCube(env, L, sample.MipLevel, texel);
+							color[0] += texel[0] * sample.NoL;
+							color[1] += texel[1] * sample.NoL;
+							color[2] += texel[2] * sample.NoL;
+							totalWeight += sample.NoL;
+						}
+
+						const float invWeight = totalWeight > 0.0f ? 1.0f / totalWeight : 0.0f;
+						dst[0] = color[0] * invWeight;
+						dst[1] = color[1] * invWeight;
+						dst[2] = color[2] * invWeight;
+						dst[3] = 1.0f;
+					}
+				});
+		}
+	}
+
+	void StoreCube(const FloatCube& cube, DXGI_FORMAT format, IBL::TextureData& out)
+	{
+		out.Format = format;
+		out.Width = cube.Size;
+		out.Height = cube.Size;
+		out.ArraySize = 6;
+		out.MipLevels = cube.MipLevels;
+		out.IsCubeMap = true;
+
+		const size_t numTexels = cube.Texels.size() / 4;
+		switch (format)
+		{
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			out.Bytes.resize(cube.Texels.size() * sizeof(HALF));
+			XMConvertFloatToHalfStream((HALF*)out.Bytes.data(), sizeof(HALF), cube.Texels.data(), sizeof(float), cube.Texels.size());
+			break;
+		case DXGI_FORMAT_R11G11B10_FLOAT:
+			out.Bytes.resize(numTexels * sizeof(uint32_t));
+			PackedHDR::EncodeR11G11B10F(cube.Texels.data(), (uint32_t*)out.Bytes.data(), numTexels);
+			break;
+		case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+			out.Bytes.resize(numTexels * sizeof(uint32_t));
+			PackedHDR::EncodeRGB9E5(cube.Texels.data(), (uint32_t*)out.Bytes.data(), numTexels);
+			break;
+		default:
+			ASSERT(false, "Unsupported IBL cube format");
+			break;
+		}
+	}
+
+	uint32_t BytesPerTexel(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R32G32B32A32_FLOAT: return 16;
+		case DXGI_FORMAT_R16G16B16A16_FLOAT: return 8;
+		case DXGI_FORMAT_R32G32_FLOAT:       return 8;
+		case DXGI_FORMAT_R16G16_FLOAT:       return 4;
+		case DXGI_FORMAT_R11G11B10_FLOAT:    return 4;
+		case DXGI_FORMAT_R9G9B9E5_SHAREDEXP: return 4;
+		case DXGI_FORMAT_R32_FLOAT:          return 4;
+		case DXGI_FORMAT_R16_FLOAT:          return 2;
+		case DXGI_FORMAT_R8G8B8A8_UNORM:     return 4;
+		case DXGI_FORMAT_R8G8_UNORM:         return 2;
+		case DXGI_FORMAT_R8_UNORM:           return 1;
+		default:                             return 0;
+		}
+	}
+
+	size_t SubresourceSize(const IBL::TextureData& texture, uint32_t mip)
+	{
+		const uint32_t width = std::max(1u, texture.Width >> mip);
+		const uint32_t height = std::max(1u, texture.Height >> mip);
+		return (size_t)width * height * BytesPerTexel(texture.Format);
+	}
+
+	size_t TotalSize(const IBL::TextureData& texture)
+	{
+		size_t size = 0;
+		for (uint32_t mip = 0; mip < texture.MipLevels; ++mip)
+			size += SubresourceSize(texture, mip);
+		return size * texture.ArraySize;
+	}
+
+	bool DecodeFloats(const IBL::TextureData& texture, std::vector<float>& values)
+	{
+		switch (texture.Format)
+		{
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R16G16_FLOAT:
+		case DXGI_FORMAT_R16_FLOAT:
+			values.resize(texture.GetDataSize() / sizeof(HALF));
+			XMConvertHalfToFloatStream(values.data(), sizeof(float), (const HALF*)texture.GetData(), sizeof(HALF), values.size());
+			return true;
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		case DXGI_FORMAT_R32G32_FLOAT:
+		case DXGI_FORMAT_R32_FLOAT:
+			values.resize(texture.GetDataSize() / sizeof(float));
+			memcpy(values.data(), texture.GetData(), texture.GetDataSize());
+			return true;
+		case DXGI_FORMAT_R11G11B10_FLOAT:
+		case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+		{
+			// The decoders write RGBA, the packed formats have no alpha to compare.
+			const size_t numTexels = texture.GetDataSize() / sizeof(uint32_t);
+			values.resize(numTexels * 4);
+			if (texture.Format == DXGI_FORMAT_R11G11B10_FLOAT)
+				PackedHDR::DecodeR11G11B10F((const uint32_t*)texture.GetData(), values.data(), numTexels);
+			else
+				PackedHDR::DecodeRGB9E5((const uint32_t*)texture.GetData(), values.data(), numTexels);
+			for (size_t i = 0; i < numTexels; ++i)
+				memmove(&values[i * 3], &values[i * 4], 3 * sizeof(float));
+			values.resize(numTexels * 3);
+			return true;
+		}
+		default:
+			return false;
+		}
+	}
+
+	size_t HashFile(const MappedFile& file)
+	{
+		// HashRange() consumes whole words; the tail is folded in separately.
+		const size_t numWords = file.GetSize() / 4;
+		size_t hash = Utility::HashRange((const uint32_t*)file.GetData(), (const uint32_t*)file.GetData() + numWords, 2166136261U);
+		uint32_t tail = 0;
+		memcpy(&tail, file.GetData() + numWords * 4, file.GetSize() - numWords * 4);
+		const uint32_t extra[] = { tail, (uint32_t)file.GetSize(), IBL::kBakeVersion };
+		return Utility::HashRange(extra, extra + _countof(extra), hash);
+	}
+
+	std::string CachePath(const std::string& cacheDir, const std::string& name, const char* suffix)
+	{
+		return cacheDir + "/" + name + suffix;
+	}
+
+	// Split sum scale and bias of F0 for one (NoV, roughness) pair (Karis, "Real Shading in Unreal Engine 4").
+	XMFLOAT2 IntegrateDFG(float NoV, float roughness, uint32_t numSamples)
+	{
+		const float alpha = roughness * roughness;
+		const XMFLOAT3 V(std::sqrt(1.0f - NoV * NoV), 0.0f, NoV);
+
+		float dfg1 = 0.0f, dfg2 = 0.0f;
+		for (uint32_t i = 0; i < numSamples; ++i)
+		{
+			const XMFLOAT3 H = ImportanceSampleGGX(Sampling::Hammersley2D(i, numSamples), roughness);
+			const float VoH = std::clamp(V.x * H.x + V.y * H.y + V.z * H.z, 0.0f, 1.0f);
+			const float NoL = std::clamp(2.0f * VoH * H.z - V.z, 0.0f, 1.0f);
+			const float NoH = std::clamp(H.z, 0.0f, 1.0f);
+
+			if (NoL > 0.0f)
+			{
+				const float G_Vis = 4.0f * V_SmithGGXCorrelated(NoL, NoV, alpha) * VoH * NoL / NoH;
+				const float Fc = std::pow(1.0f - VoH, 5.0f);
+				dfg1 += G_Vis * (1.0f - Fc);
+				dfg2 += G_Vis * Fc;
+			}
+		}
+		return XMFLOAT2(dfg1 / numSamples, dfg2 / numSamples);
+	}
+
+	const uint32_t kEavgCosineSteps = 64;
+	const uint32_t kSSSRingSteps = 2000;
+
+	float Gaussian(float variance, float x)
+	{
+		return 1.0f / (std::sqrt(2.0f * kPi) * variance) * std::exp(-x * x / (2.0f * variance * variance));
+	}
+
+	// Sum of Gaussians skin profile from GPU Gems 3, chapter 14.
+	XMFLOAT3 DiffusionProfile(float r)
+	{
+		static const float kVariance[] = { 0.0064f, 0.0484f, 0.187f, 0.567f, 1.99f, 7.41f };
+		static const XMFLOAT3 kWeight[] =
+		{
+			XMFLOAT3(0.233f, 0.455f, 0.649f),
+			XMFLOAT3(0.100f, 0.336f, 0.344f),
+			XMFLOAT3(0.118f, 0.198f, 0.0f),
+			XMFLOAT3(0.113f, 0.007f, 0.007f),
+			XMFLOAT3(0.358f, 0.004f, 0.0f),
+			XMFLOAT3(0.078f, 0.0f, 0.0f),
+		};
+
+		XMFLOAT3 ret(0.0f, 0.0f, 0.0f);
+		for (uint32_t i = 0; i < _countof(kVariance); ++i)
+		{
+			const float g = Gaussian(kVariance[i], r);
+			ret.x += g * kWeight[i].x;
+			ret.y += g * kWeight[i].y;
+			ret.z += g * kWeight[i].z;
+		}
+		return ret;
+	}
+
+	// Kelemen/Szirmay-Kalos Beckmann distribution, GPU Gems 3, chapter 14.
+	float PHBeckmann(float NdotH, float m)
+	{
+		const float alpha = std::acos(NdotH);
+		const float ta = std::tan(alpha);
+		return 1.0f / (m * m * std::pow(NdotH, 4.0f)) * std::exp(-(ta * ta) / (m * m));
+	}
+
+	void InitTexture2D(IBL::TextureData& out, DXGI_FORMAT format, uint32_t width, uint32_t height)
+	{
+		out.Format = format;
+		out.Width = width;
+		out.Height = height;
+		out.ArraySize = 1;
+		out.MipLevels = 1;
+		out.IsCubeMap = false;
+	}
+
+	void StoreHalf(IBL::TextureData& out, DXGI_FORMAT format, uint32_t width, uint32_t height, const std::vector<float>& values)
+	{
+		InitTexture2D(out, format, width, height);
+		out.Bytes.resize(values.size() * sizeof(HALF));
+		XMConvertFloatToHalfStream((HALF*)out.Bytes.data(), sizeof(HALF), values.data(), sizeof(float), values.size());
+	}
+
+	void StoreR11G11B10(IBL::TextureData& out, uint32_t width, uint32_t height, const std::vector<XMFLOAT3>& values)
+	{
+		InitTexture2D(out, DXGI_FORMAT_R11G11B10_FLOAT, width, height);
+		out.Bytes.resize(values.size() * sizeof(XMFLOAT3PK));
+		XMFLOAT3PK* dst = (XMFLOAT3PK*)out.Bytes.data();
+		for (size_t i = 0; i < values.size(); ++i)
+			XMStoreFloat3PK(dst + i, XMLoadFloat3(&values[i]));
+	}
+
+	// Subset of the DDS file format: DX10 extended header, uncompressed 2D textures and cubes.
+	struct DDSPixelFormat
+	{
+		uint32_t size, flags, fourCC, RGBBitCount, RBitMask, GBitMask, BBitMask, ABitMask;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount, reserved1[11];
+		DDSPixelFormat ddspf;
+		uint32_t caps, caps2, caps3, caps4, reserved2;
+	};
+
+	struct DDSHeaderDXT10
+	{
+		uint32_t dxgiFormat, resourceDimension, miscFlag, arraySize, miscFlags2;
+	};
+
+	const uint32_t kDDSMagic = 0x20534444;          // "DDS "
+	const uint32_t kDX10FourCC = 0x30315844;        // "DX10"
+	const uint32_t kDDSFlags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000;  // caps, height, width, pixel format, mip count
+	const uint32_t kDDPFFourCC = 0x4;
+	const uint32_t kDDSCapsTexture = 0x1000, kDDSCapsComplex = 0x8, kDDSCapsMipMap = 0x400000;
+	const uint32_t kDDSCaps2CubeMapAllFaces = 0x200 | 0x400 | 0x800 | 0x1000 | 0x2000 | 0x4000 | 0x8000;
+	const uint32_t kDDSResourceMiscTextureCube = 0x4;
+}
+
+void IBL::TextureData::GetSubresourceData(std::vector<D3D12_SUBRESOURCE_DATA>& subresources) const
+{
+	const uint32_t bytesPerTexel = BytesPerTexel(Format);
+	subresources.resize(GetNumSubresources());
+
+	const uint8_t* data = GetData();
+	for (uint32_t slice = 0; slice < ArraySize; ++slice)
+	{
+		for (uint32_t mip = 0; mip < MipLevels; ++mip)
+		{
+			D3D12_SUBRESOURCE_DATA& sub = subresources[slice * MipLevels + mip];
+			sub.pData = data;
+			sub.RowPitch = (LONG_PTR)std::max(1u, Width >> mip) * bytesPerTexel;
+			sub.SlicePitch = (LONG_PTR)SubresourceSize(*this, mip);
+			data += sub.SlicePitch;
+		}
+	}
+}
+
+void IBL::BakeEnvironment(const float* rgba, uint32_t width, uint32_t height, BakedEnvironment& out, const BakeSettings& settings)
+{
+	FloatCube env;
+	env.Init(settings.EnvMapSize, settings.EnvMapMips);
+	EquirectToCube(rgba, width, height, env, settings.NumThreads);
+	GenerateCubeMips(env, settings.NumThreads);
+
+	FloatCube radiance;
+	radiance.Init(settings.RadianceSize, settings.RadianceMips);
+	PrefilterRadiance(env, radiance, settings.RadianceSamples, settings.NumThreads);
+
+	StoreCube(env, settings.CubeFormat, out.EnvirMap);
+	StoreCube(radiance, settings.CubeFormat, out.RadianceMap);
+	out.IrradianceSH = SH::ConvolveIrradiance(SH::ProjectEquirect(rgba, width, height, settings.NumThreads));
+}
+
+void IBL::BakeLookupTables(LookupTables& out, const BakeSettings& settings)
+{
+	// Texels store the value at their center so a linear sample at (NoV, roughness) needs no half texel offset.
+	const uint32_t lutSize = settings.BRDFLutSize;
+	std::vector<float> dfg((size_t)lutSize * lutSize * 2);
+	std::vector<float> emu((size_t)lutSize * lutSize);
+	Utility::ParallelFor(lutSize, settings.NumThreads, [&](uint32_t y)
+		{
+			const float roughness = (y + 0.5f) / lutSize;
+			for (uint32_t x = 0; x < lutSize; ++x)
+			{
+				const XMFLOAT2 scaleBias = IntegrateDFG((x + 0.5f) / lutSize, roughness, settings.BRDFLutSamples);
+				const size_t index = (size_t)y * lutSize + x;
+				dfg[index * 2 + 0] = scaleBias.x;
+				dfg[index * 2 + 1] = scaleBias.y;
+				// With F = 1 the split sum terms add up to the directional albedo.
+				emu[index] = scaleBias.x + scaleBias.y;
+			}
+		});
+	StoreHalf(out.BRDFLut, DXGI_FORMAT_R16G16_FLOAT, lutSize, lutSize, dfg);
+	StoreHalf(out.Emu, DXGI_FORMAT_R16_FLOAT, lutSize, lutSize, emu);
+
+	// E_avg(roughness) = 2 * integral of E(mu) * mu over [0, 1], only a function of roughness.
+	const uint32_t eavgSize = settings.EavgSize;
+	std::vector<float> eavg(eavgSize);
+	Utility::ParallelFor(eavgSize, settings.NumThreads, [&](uint32_t i)
+		{
+			const float roughness = (i + 0.5f) / eavgSize;
+			float sum = 0.0f;
+			for (uint32_t j = 0; j < kEavgCosineSteps; ++j)
+			{
+				const float mu = (j + 0.5f) / kEavgCosineSteps;
+				const XMFLOAT2 scaleBias = IntegrateDFG(mu, roughness, settings.BRDFLutSamples);
+				sum += (scaleBias.x + scaleBias.y) * mu;
+			}
+			eavg[i] = 2.0f * sum / kEavgCosineSteps;
+		});
+	StoreHalf(out.Eavg, DXGI_FORMAT_R16_FLOAT, eavgSize, 1, eavg);
+
+	// Pre-integrated skin, as sampled by PBRShadingPS:
+	// u = NoL or NoH remapped to [0, 1], row 0 is the top of the texture (v = 1).
+	const uint32_t sssSize = settings.SSSLutSize;
+	std::vector<XMFLOAT3> sssDiffuse((size_t)sssSize * sssSize);
+	std::vector<float> sssSpecular((size_t)sssSize * sssSize);
+	Utility::ParallelFor(sssSize, settings.NumThreads, [&](uint32_t y)
+		{
+			const float v = 1.0f - (y + 0.5f) / sssSize;
+
+			// The diffusion weights along the ring only depend on the curvature (the row), not on NoL.
+			const float radius = 1.0f / std::max(0.0001f, v);
+			std::vector<XMFLOAT3> weights(kSSSRingSteps);
+			XMFLOAT3 normalization(0.0f, 0.0f, 0.0f);
+			for (uint32_t k = 0; k < kSSSRingSteps; ++k)
+			{
+				const float angle = -kPi + 2.0f * kPi * k / kSSSRingSteps;
+				weights[k] = DiffusionProfile(2.0f * radius * std::sin(angle * 0.5f));
+				normalization.x += weights[k].x;
+				normalization.y += weights[k].y;
+				normalization.z += weights[k].z;
+			}
+
+			for (uint32_t x = 0; x < sssSize; ++x)
+			{
+				const float u = (x + 0.5f) / sssSize;
+				const float theta = std::acos(std::clamp(u * 2.0f - 1.0f, -1.0f, 1.0f));
+
+				XMFLOAT3 scattering(0.0f, 0.0f, 0.0f);
+				for (uint32_t k = 0; k < kSSSRingSteps; ++k)
+				{
+					const float angle = -kPi + 2.0f * kPi * k / kSSSRingSteps;
+					const float NoL = std::max(std::cos(angle + theta), 0.0f);
+					scattering.x += NoL * weights[k].x;
+					scattering.y += NoL * weights[k].y;
+					scattering.z += NoL * weights[k].z;
+				}
+
+				const size_t index = (size_t)y * sssSize + x;
+				sssDiffuse[index] = XMFLOAT3(scattering.x / normalization.x, scattering.y / normalization.y, scattering.z / normalization.z);
+				sssSpecular[index] = 0.5f * std::pow(PHBeckmann(u, v), 0.1f);
+			}
+		});
+	StoreR11G11B10(out.SSSDiffuse, sssSize, sssSize, sssDiffuse);
+	StoreHalf(out.SSSSpecular, DXGI_FORMAT_R16_FLOAT, sssSize, sssSize, sssSpecular);
+}
+
+bool IBL::LoadOrBakeEnvironment(const std::string& hdrPath, const std::string& cacheDir, BakedEnvironment& out, const BakeSettings& settings)
+{
+	const int64_t startTick = SystemTime::GetCurrentTick();
+
+	MappedFile hdrFile;
+	if (!hdrFile.Open(hdrPath))
+	{
+		Utility::Printf("IBL: failed to read %s\n", hdrPath.c_str());
+		return false;
+	}
+
+	char key[64];
+	sprintf_s(key, "%s_%016llx", Utility::RemoveExtension(Utility::RemoveBasePath(hdrPath)).c_str(), (unsigned long long)HashFile(hdrFile));
+	const std::string envPath = CachePath(cacheDir, key, "_env.dds");
+	const std::string radiancePath = CachePath(cacheDir, key, "_radiance.dds");
+	const std::string shPath = CachePath(cacheDir, key, "_sh.bin");
+
+	{
+		std::ifstream shFile(shPath, std::ios::binary);
+		if (shFile && shFile.read((char*)&out.IrradianceSH, sizeof(out.IrradianceSH)) &&
+			LoadDDS(envPath, out.EnvirMap) && out.EnvirMap.Width == settings.EnvMapSize && out.EnvirMap.MipLevels == settings.EnvMapMips &&
+			out.EnvirMap.Format == settings.CubeFormat &&
+			LoadDDS(radiancePath, out.RadianceMap) && out.RadianceMap.Width == settings.RadianceSize && out.RadianceMap.MipLevels == settings.RadianceMips &&
+			out.RadianceMap.Format == settings.CubeFormat)
+		{
+			Utility::Printf("IBL: loaded cached environment %s in %.1f ms\n", key,
+				SystemTime::TicksToMillisecs(SystemTime::GetCurrentTick() - startTick));
+			return true;
+		}
+	}
+
+	// Drop any stale cache views so the files can be replaced below.
+	out.EnvirMap = TextureData();
+	out.RadianceMap = TextureData();
+
+	int width, height, channels;
+	float* pixels = stbi_loadf_from_memory(hdrFile.GetData(), (int)hdrFile.GetSize(), &width, &height, &channels, 4);
+	if (pixels == nullptr)
+	{
+		Utility::Printf("IBL: failed to decode %s\n", hdrPath.c_str());
+		return false;
+	}
+
+	BakeEnvironment(pixels, (uint32_t)width, (uint32_t)height, out, settings);
+	stbi_image_free(pixels);
+	hdrFile.Close();
+
+	Utility::Printf("IBL: baked environment %s in %.1f ms\n", key,
+		SystemTime::TicksToMillisecs(SystemTime::GetCurrentTick() - startTick));
+
+	// A failed write only costs the next launch another bake.
+	std::error_code ec;
+	std::filesystem::create_directories(cacheDir, ec);
+	std::ofstream shFile(shPath, std::ios::binary);
+	if (!(shFile.write((const char*)&out.IrradianceSH, sizeof(out.IrradianceSH)) &&
+		SaveDDS(envPath, out.EnvirMap) && SaveDDS(radiancePath, out.RadianceMap)))
+	{
+		Utility::Printf("IBL: failed to write cache to %s\n", cacheDir.c_str());
+	}
+	return true;
+}
+
+bool IBL::LoadOrBakeLookupTables(const std::string& cacheDir, LookupTables& out, const BakeSettings& settings)
+{
+	const int64_t startTick = SystemTime::GetCurrentTick();
+
+	char prefix[96];
+	sprintf_s(prefix, "luts_%u_%u_%u_%u_v%u", settings.BRDFLutSize, settings.BRDFLutSamples, settings.EavgSize, settings.SSSLutSize, kBakeVersion);
+
+	struct Table { TextureData* Texture; const char* Suffix; };
+	const Table tables[] =
+	{
+		{ &out.BRDFLut, "_brdf.dds" },
+		{ &out.Emu, "_emu.dds" },
+		{ &out.Eavg, "_eavg.dds" },
+		{ &out.SSSDiffuse, "_sss_diffuse.dds" },
+		{ &out.SSSSpecular, "_sss_specular.dds" },
+	};
+
+	bool cached = true;
+	for (const Table& table : tables)
+		cached = cached && LoadDDS(CachePath(cacheDir, prefix, table.Suffix), *table.Texture);
+
+	if (cached)
+	{
+		Utility::Printf("IBL: loaded cached lookup tables in %.1f ms\n", SystemTime::TicksToMillisecs(SystemTime::GetCurrentTick() - startTick));
+		return true;
+	}
+
+	for (const Table& table : tables)
+		*table.Texture = TextureData();
+	BakeLookupTables(out, settings);
+	Utility::Printf("IBL: baked lookup tables in %.1f ms\n", SystemTime::TicksToMillisecs(SystemTime::GetCurrentTick() - startTick));
+
+	std::error_code ec;
+	std::filesystem::create_directories(cacheDir, ec);
+	for (const Table& table : tables)
+	{
+		const std::string path = CachePath(cacheDir, prefix, table.Suffix);
+		if (!SaveDDS(path, *table.Texture))
+			Utility::Printf("IBL: failed to write %s\n", path.c_str());
+	}
+	return true;
+}
+
+bool IBL::SaveDDS(const std::string& path, const TextureData& texture)
+{
+	ASSERT(BytesPerTexel(texture.Format) != 0 && texture.GetDataSize() == TotalSize(texture));
+
+	DDSHeader header = {};
+	header.size = sizeof(DDSHeader);
+	header.flags = kDDSFlags;
+	header.width = texture.Width;
+	header.height = texture.Height;
+	header.mipMapCount = texture.MipLevels;
+	header.ddspf.size = sizeof(DDSPixelFormat);
+	header.ddspf.flags = kDDPFFourCC;
+	header.ddspf.fourCC = kDX10FourCC;
+	header.caps = kDDSCapsTexture | (texture.MipLevels > 1 ? kDDSCapsComplex | kDDSCapsMipMap : 0);
+	if (texture.IsCubeMap)
+	{
+		header.caps |= kDDSCapsComplex;
+		header.caps2 = kDDSCaps2CubeMapAllFaces;
+	}
+
+	DDSHeaderDXT10 dx10 = {};
+	dx10.dxgiFormat = texture.Format;
+	dx10.resourceDimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	dx10.miscFlag = texture.IsCubeMap ? kDDSResourceMiscTextureCube : 0;
+	dx10.arraySize = texture.IsCubeMap ? texture.ArraySize / 6 : texture.ArraySize;
+
+	// Write to a temporary file first so an interrupted bake never leaves a truncated cache entry behind.
+	const std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+		file.write((const char*)&kDDSMagic, sizeof(kDDSMagic));
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)&dx10, sizeof(dx10));
+		file.write((const char*)texture.GetData(), texture.GetDataSize());
+		if (!file)
+			return false;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, path, ec);
+	return !ec;
+}
+
+bool IBL::LoadDDS(const std::string& path, TextureData& texture)
+{
+	auto file = std::make_shared<MappedFile>();
+	const size_t dataOffset = sizeof(uint32_t) + sizeof(DDSHeader) + sizeof(DDSHeaderDXT10);
+	if (!file->Open(path) || file->GetSize() < dataOffset)
+		return false;
+
+	uint32_t magic = 0;
+	DDSHeader header = {};
+	DDSHeaderDXT10 dx10 = {};
+	memcpy(&magic, file->GetData(), sizeof(magic));
+	memcpy(&header, file->GetData() + sizeof(magic), sizeof(header));
+	memcpy(&dx10, file->GetData() + sizeof(magic) + sizeof(header), sizeof(dx10));
+	if (magic != kDDSMagic || header.size != sizeof(DDSHeader) || header.ddspf.fourCC != kDX10FourCC)
+		return false;
+
+	texture.Format = (DXGI_FORMAT)dx10.dxgiFormat;
+	texture.Width = header.width;
+	texture.Height = header.height;
+	texture.MipLevels = std::max(1u, header.mipMapCount);
+	texture.IsCubeMap = (dx10.miscFlag & kDDSResourceMiscTextureCube) != 0;
+	texture.ArraySize = texture.IsCubeMap ? dx10.arraySize * 6 : dx10.arraySize;
+	if (BytesPerTexel(texture.Format) == 0)
+		return false;
+
+	// The texels are used where they are in the mapping: no heap copy before the upload.
+	const size_t dataSize = TotalSize(texture);
+	if (file->GetSize() - dataOffset < dataSize)
+		return false;
+
+	texture.Bytes.clear();
+	texture.MappedBytes = file->GetData() + dataOffset;
+	texture.MappedSize = dataSize;
+	texture.File = std::move(file);
+	return true;
+}
+
+bool IBL::MeasureError(const TextureData& a, const TextureData& b, double& rmse, double& maxError)
+{
+	if (a.Format != b.Format || a.Width != b.Width || a.Height != b.Height ||
+		a.ArraySize != b.ArraySize || a.MipLevels != b.MipLevels || a.GetDataSize() != b.GetDataSize())
+	{
+		return false;
+	}
+
+	std::vector<float> va, vb;
+	if (!DecodeFloats(a, va) || !DecodeFloats(b, vb))
+		return false;
+
+	double sumSq = 0.0;
+	maxError = 0.0;
+	for (size_t i = 0; i < va.size(); ++i)
+	{
+		const double diff = std::abs((double)va[i] - (double)vb[i]);
+		sumSq += diff * diff;
+		maxError = std::max(maxError, diff);
+	}
+	const size_t count = va.size();
+	rmse = count > 0 ? std::sqrt(sumSq / count) : 0.0;
+	return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "SphericalHarmonics.h"
+#include "MappedFile.h"
+#include <memory>
+
+// CPU reference implementation of the image based lighting precompute that PbrRenderer used to run on
+// the GPU every launch (EquirectToCubeCS, GenerateMipMapCS, SpecularMapCS), plus the BRDF and skin
+// lookup tables.
+// Results are written to DDS files keyed by a hash of the source HDR so a warm start only has to read
+// the cache and upload it.
+namespace IBL
+{
+	// Bump whenever the output of the baker changes so stale cache files are ignored.
+	static const uint32_t kBakeVersion = 3;
+
+	struct BakeSettings
+	{
+		uint32_t EnvMapSize = 512;        // matches g_EnvirMap
+		uint32_t EnvMapMips = 10;
+		uint32_t RadianceSize = 256;      // matches g_RadianceMap
+		uint32_t RadianceMips = 9;
+		uint32_t RadianceSamples = 1024;  // same count as SpecularMapCS
+		uint32_t BRDFLutSize = 128;       // g_LUT and g_Emu
+		uint32_t BRDFLutSamples = 512;
+		uint32_t EavgSize = 128;          // g_Eavg, 1D over roughness
+		uint32_t SSSLutSize = 256;        // g_SSSDiffuseLut and g_SSSSpecularLut
+		uint32_t NumThreads = 0;          // 0 uses all hardware threads
+		// Format of both cubes: R16G16B16A16_FLOAT, R11G11B10_FLOAT (matches g_EnvirMap and g_RadianceMap) or
+		// R9G9B9E5_SHAREDEXP.  The packed formats are half the size and are encoded with PackedHDR.
+		DXGI_FORMAT CubeFormat = DXGI_FORMAT_R11G11B10_FLOAT;
+	};
+
+	// Texel data laid out in D3D12 subresource order (mip + slice * MipLevels), tightly packed.  Bakes fill
+	// Bytes; LoadDDS() leaves it empty and points MappedBytes into the memory mapped cache file instead.
+	struct TextureData
+	{
+		DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t ArraySize = 1;
+		uint32_t MipLevels = 1;
+		bool IsCubeMap = false;
+		std::vector<uint8_t> Bytes;
+		std::shared_ptr<const MappedFile> File;  // keeps MappedBytes valid
+		const uint8_t* MappedBytes = nullptr;
+		size_t MappedSize = 0;
+
+		const uint8_t* GetData() const { return MappedBytes ? MappedBytes : Bytes.data(); }
+		size_t GetDataSize() const { return MappedBytes ? MappedSize : Bytes.size(); }
+		uint32_t GetNumSubresources() const { return ArraySize * MipLevels; }
+		void GetSubresourceData(std::vector<D3D12_SUBRESOURCE_DATA>& subresources) const;
+	};
+
+	struct BakedEnvironment
+	{
+		TextureData EnvirMap;       // BakeSettings::CubeFormat cube
+		TextureData RadianceMap;    // same format, GGX prefiltered, roughness = mip / (mips - 1)
+		SH::SH9Color IrradianceSH;  // already convolved, see SH::ConvolveIrradiance()
+	};
+
+	// Load the baked environment for hdrPath from cacheDir, or bake it and write the cache on a miss.
+	// Returns false only if the HDR file cannot be read.
+	bool LoadOrBakeEnvironment(const std::string& hdrPath, const std::string& cacheDir, BakedEnvironment& out,
+		const BakeSettings& settings = BakeSettings());
+
+	// Environment independent tables, sampled with (NoV, roughness) unless noted.
+	struct LookupTables
+	{
+		TextureData BRDFLut;      // R16G16F split sum scale and bias of F0
+		TextureData Emu;          // R16F directional albedo E(mu) of the single scattering GGX lobe
+		TextureData Eavg;         // R16F, Width x 1, hemispherical average of E(mu) indexed by roughness
+		TextureData SSSDiffuse;   // R11G11B10F pre-integrated skin diffuse, (0.5 * NoL + 0.5, curvature)
+		TextureData SSSSpecular;  // R16F Kelemen/Szirmay-Kalos specular, (0.5 * NoH + 0.5, roughness)
+	};
+
+	bool LoadOrBakeLookupTables(const std::string& cacheDir, LookupTables& out, const BakeSettings& settings = BakeSettings());
+
+	// The individual bake steps, exposed for tools and for comparing against the GPU fallback path.
+	void BakeEnvironment(const float* rgba, uint32_t width, uint32_t height, BakedEnvironment& out,
+		const BakeSettings& settings = BakeSettings());
+	void BakeLookupTables(LookupTables& out, const BakeSettings& settings = BakeSettings());
+
+	bool SaveDDS(const std::string& path, const TextureData& texture);
+	// Maps the file and parses it in place; texture references the mapping until it is reset or destroyed.
+	bool LoadDDS(const std::string& path, TextureData& texture);
+
+	// Root mean square and maximum absolute difference over every channel of two textures with identical layout.
+	// Used to validate the CPU bake against a GPU readback.
+	bool MeasureError(const TextureData& a, const TextureData& b, double& rmse, double& maxError);
+}
@@ -0,0 +1,424 @@
+#include "pch.h"
+#include "JobSystem.h"
+#include "WorkStealingDeque.h"
+#include <bit>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+
+using namespace JobSystem;
+using JobSystem::Detail::Job;
+using JobSystem::Detail::Continuation;
+
+struct JobSystem::Detail::Continuation
+{
+	Job Work;
+	Continuation* Next;
+};
+
+namespace
+{
+	// Jobs a thread may have queued or running at once.  Past that, Submit() runs the job inline.
+	const uint32_t kMaxJobsPerThread = 4096;
+	// How many times an idle worker looks for queued jobs before it goes to sleep.
+	const uint32_t kIdleSpins = 64;
+
+	struct alignas(64) Slot
+	{
+		Job Work;
+		std::atomic<bool> Busy = false;     // from Submit() until the job has run
+	};
+
+	struct alignas(64) Worker
+	{
+		Worker() : Queue(kMaxJobsPerThread), Slots(new Slot[kMaxJobsPerThread]) {}
+
+		WorkStealingDeque<Slot> Queue;
+		std::unique_ptr<Slot[]> Slots;      // a ring, used in submission order
+		uint32_t NextSlot = 0;
+		uint32_t Index = 0;
+		// Written by the owner only, read by GetStats().
+		std::atomic<uint64_t> NumJobs = 0;
+		std::atomic<uint64_t> NumStolen = 0;
+		std::atomic<uint64_t> NumInline = 0;
+		std::thread Thread;
+	};
+
+	std::unique_ptr<Worker[]> s_Workers;    // [0] belongs to the main thread
+	uint32_t s_NumThreads = 1;
+	std::atomic<bool> s_IsRunning = false;
+	std::atomic<bool> s_Quit = false;
+	thread_local Worker* t_Worker = nullptr;
+
+	// Jobs submitted by threads without a deque.
+	std::mutex s_ExternalMutex;
+	std::deque<Job> s_ExternalJobs;
+	std::atomic<uint32_t> s_NumExternal = 0;
+	std::atomic<uint64_t> s_NumExternalRun = 0;     // by threads without a deque
+	std::atomic<uint64_t> s_NumExternalInline = 0;
+
+	// Jobs submitted and not yet taken, for idle workers to tell when to sleep and when to wake up.
+	std::atomic<int32_t> s_NumQueued = 0;
+	std::atomic<uint32_t> s_NumSleeping = 0;
+	std::mutex s_SleepMutex;
+	std::condition_variable s_WakeUp;
+
+	void Increment(std::atomic<uint64_t>& Count)
+	{
+		Count.store(Count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	uint32_t NextRandom(void)
+	{
+		// xorshift32, seeded apart per thread.
+		static thread_local uint32_t t_State = (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+		t_State ^= t_State << 13;
+		t_State ^= t_State >> 17;
+		t_State ^= t_State << 5;
+		return t_State;
+	}
+
+	void Execute(Job& Work)
+	{
+		Work.Invoke(Work.Function);
+		if (Work.Signal != nullptr)
+			Work.Signal->Done();
+	}
+
+	void Execute(Slot& Taken)
+	{
+		// The submitter may refill the slot as soon as it is free, so the counter is read before.
+		Counter* Signal = Taken.Work.Signal;
+		Taken.Work.Invoke(Taken.Work.Function);
+		Taken.Busy.store(false, std::memory_order_release);
+		if (Signal != nullptr)
+			Signal->Done();
+	}
+
+	void RunInline(Worker* Self, const Job& NewJob)
+	{
+		Increment(Self != nullptr ? Self->NumInline : s_NumExternalInline);
+		Job Work = NewJob;
+		Execute(Work);
+	}
+
+	void WakeWorker(void)
+	{
+		// s_NumQueued was raised before, and a worker raises s_NumSleeping before it checks s_NumQueued, so
+		// either it sees the job or it is counted here.
+		if (s_NumSleeping.load(std::memory_order_seq_cst) != 0)
+		{
+			std::lock_guard<std::mutex> Lock(s_SleepMutex);
+			s_WakeUp.notify_one();
+		}
+	}
+
+	Slot* Steal(Worker* Self)
+	{
+		// From a random victim on, so thieves spread over the deques.
+		const uint32_t First = NextRandom() % s_NumThreads;
+		for (uint32_t i = 0; i < s_NumThreads; ++i)
+		{
+			Worker& Victim = s_Workers[(First + i) % s_NumThreads];
+			if (&Victim == Self)
+				continue;
+			if (Slot* Taken = Victim.Queue.Steal())
+				return Taken;
+		}
+		return nullptr;
+	}
+
+	bool TakeExternal(Job& Work)
+	{
+		if (s_NumExternal.load(std::memory_order_relaxed) == 0)
+			return false;
+
+		std::lock_guard<std::mutex> Lock(s_ExternalMutex);
+		if (s_ExternalJobs.empty())
+			return false;
+		Work = s_ExternalJobs.front();
+		s_ExternalJobs.pop_front();
+		s_NumExternal.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Runs one queued job: the newest of the thread's own, else one stolen, else one from another thread.
+	bool RunOne(Worker* Self)
+	{
+		Slot* Taken = Self != nullptr ? Self->Queue.Pop() : nullptr;
+		const bool Stolen = Taken == nullptr;
+		if (Stolen)
+			Taken = Steal(Self);
+
+		Job External;
+		if (Taken == nullptr && !TakeExternal(External))
+			return false;
+
+		s_NumQueued.fetch_sub(1, std::memory_order_relaxed);
+		if (Self == nullptr)
+			s_NumExternalRun.fetch_add(1, std::memory_order_relaxed);
+		else
+		{
+			Increment(Self->NumJobs);
+			if (Stolen && Taken != nullptr)
+				Increment(Self->NumStolen);
+		}
+
+		if (Taken != nullptr)
+			Execute(*Taken);
+		else
+			Execute(External);
+		return true;
+	}
+
+	void SetWorkerAffinity(uint32_t Index, const Settings& Options)
+	{
+		if (Options.AffinityMask == 0 && !Options.PinWorkers)
+			return;
+
+		DWORD_PTR ProcessMask = 0, SystemMask = 0;
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &ProcessMask, &SystemMask))
+			return;
+
+		uint64_t Mask = (uint64_t)ProcessMask;
+		if (Options.AffinityMask != 0)
+			Mask &= Options.AffinityMask;
+		if (Mask == 0)
+		{
+			Utility::Printf("JobSystem: affinity mask %llx has no processor of the process, ignored\n", (unsigned long long)Options.AffinityMask);
+			return;
+		}
+
+		if (Options.PinWorkers)
+		{
+			// The Index-th processor of the mask, counting from 0, which is left to the main thread.
+			for (uint32_t Skip = Index % (uint32_t)std::popcount(Mask); Skip > 0; --Skip)
+				Mask &= Mask - 1;
+			Mask &= ~Mask + 1;
+		}
+		SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)Mask);
+	}
+
+	void WorkerMain(Worker* Self, Settings Options)
+	{
+		t_Worker = Self;
+		SetWorkerAffinity(Self->Index, Options);
+		SetThreadDescription(GetCurrentThread(), (L"Job worker " + std::to_wstring(Self->Index)).c_str());
+
+		for (;;)
+		{
+			if (RunOne(Self))
+				continue;
+			// Nothing left anywhere, so Shutdown() has nothing to wait for from this worker.
+			if (s_Quit.load(std::memory_order_acquire))
+				break;
+
+			bool HasWork = false;
+			for (uint32_t Spin = 0; Spin < kIdleSpins && !HasWork; ++Spin)
+			{
+				std::this_thread::yield();
+				HasWork = s_NumQueued.load(std::memory_order_relaxed) > 0;
+			}
+			if (HasWork)
+				continue;
+
+			std::unique_lock<std::mutex> Lock(s_SleepMutex);
+			s_NumSleeping.fetch_add(1, std::memory_order_seq_cst);
+			s_WakeUp.wait(Lock, [] { return s_NumQueued.load(std::memory_order_seq_cst) > 0 || s_Quit.load(std::memory_order_relaxed); });
+			s_NumSleeping.fetch_sub(1, std::memory_order_relaxed);
+		}
+		t_Worker = nullptr;
+	}
+}
+
+void JobSystem::Initialize(const Settings& Options)
+{
+	ASSERT(!s_IsRunning.load(), "JobSystem initialized twice");
+
+	uint32_t NumWorkers = Options.NumWorkers;
+	if (NumWorkers == ~0u)
+		NumWorkers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+	s_NumThreads = NumWorkers + 1;
+	s_Workers.reset(new Worker[s_NumThreads]);
+	for (uint32_t i = 0; i < s_NumThreads; ++i)
+		s_Workers[i].Index = i;
+	s_NumExternalRun = 0;
+	s_NumExternalInline = 0;
+	s_Quit = false;
+
+	t_Worker = &s_Workers[0];
+	s_IsRunning = true;
+	for (uint32_t i = 1; i < s_NumThreads; ++i)
+		s_Workers[i].Thread = std::thread(WorkerMain, &s_Workers[i], Options);
+
+	Utility::Printf("JobSystem: %u workers%s\n", NumWorkers, Options.PinWorkers ? ", pinned" : "");
+}
+
+void JobSystem::Shutdown(void)
+{
+	if (!s_IsRunning.load())
+		return;
+
+	// What the main thread still has queued, then the workers drain the rest before they stop.
+	while (RunOne(t_Worker))
+		;
+	{
+		std::lock_guard<std::mutex> Lock(s_SleepMutex);
+		s_Quit.store(true, std::memory_order_release);
+		s_WakeUp.notify_all();
+	}
+	for (uint32_t i = 1; i < s_NumThreads; ++i)
+		s_Workers[i].Thread.join();
+	ASSERT(s_NumQueued.load() == 0, "Jobs left behind by JobSystem::Shutdown()");
+
+	s_IsRunning = false;
+	t_Worker = nullptr;
+	s_Workers.reset();
+	s_NumThreads = 1;
+}
+
+bool JobSystem::IsRunning(void)
+{
+	return s_IsRunning.load(std::memory_order_relaxed);
+}
+
+uint32_t JobSystem::GetNumThreads(void)
+{
+	return s_NumThreads;
+}
+
+uint32_t JobSystem::GetThreadIndex(void)
+{
+	return t_Worker != nullptr ? t_Worker->Index : ~0u;
+}
+
+Stats JobSystem::GetStats(void)
+{
+	Stats Total;
+	Total.NumJobs = s_NumExternalRun.load(std::memory_order_relaxed);
+	Total.NumInline = s_NumExternalInline.load(std::memory_order_relaxed);
+	for (uint32_t i = 0; s_Workers != nullptr && i < s_NumThreads; ++i)
+	{
+		Total.NumJobs += s_Workers[i].NumJobs.load(std::memory_order_relaxed);
+		Total.NumStolen += s_Workers[i].NumStolen.load(std::memory_order_relaxed);
+		Total.NumInline += s_Workers[i].NumInline.load(std::memory_order_relaxed);
+	}
+	Total.NumJobs += Total.NumInline;
+	return Total;
+}
+
+void JobSystem::Detail::Submit(const Job& NewJob)
+{
+	Worker* Self = t_Worker;
+	if (!s_IsRunning.load(std::memory_order_relaxed) || s_NumThreads == 1)
+	{
+		RunInline(Self, NewJob);
+		return;
+	}
+
+	if (Self == nullptr)
+	{
+		s_NumQueued.fetch_add(1, std::memory_order_seq_cst);
+		{
+			std::lock_guard<std::mutex> Lock(s_ExternalMutex);
+			s_ExternalJobs.push_back(NewJob);
+			s_NumExternal.fetch_add(1, std::memory_order_relaxed);
+		}
+		WakeWorker();
+		return;
+	}
+
+	// A slot still busy means kMaxJobsPerThread jobs of this thread are queued or running.
+	Slot& Free = Self->Slots[Self->NextSlot & (kMaxJobsPerThread - 1)];
+	if (Free.Busy.load(std::memory_order_acquire))
+	{
+		RunInline(Self, NewJob);
+		return;
+	}
+	++Self->NextSlot;
+	Free.Work = NewJob;
+	Free.Busy.store(true, std::memory_order_relaxed);
+
+	s_NumQueued.fetch_add(1, std::memory_order_seq_cst);
+	const bool Queued = Self->Queue.Push(&Free);
+	ASSERT(Queued, "A free slot means room in the deque");
+	(void)Queued;
+	WakeWorker();
+}
+
+void JobSystem::Detail::SubmitAfter(Counter& Dependency, const Job& NewJob)
+{
+	Continuation* Parked = new Continuation{ NewJob, nullptr };
+	uint32_t State = Dependency.m_State.load(std::memory_order_acquire);
+	for (;;)
+	{
+		if (State == 0)
+		{
+			delete Parked;
+			Submit(NewJob);
+			return;
+		}
+		if ((State & Counter::kLocked) == 0 &&
+			Dependency.m_State.compare_exchange_weak(State, State | Counter::kLocked, std::memory_order_acquire, std::memory_order_acquire))
+			break;
+		if (State & Counter::kLocked)
+		{
+			std::this_thread::yield();
+			State = Dependency.m_State.load(std::memory_order_acquire);
+		}
+	}
+	Parked->Next = Dependency.m_Continuations;
+	Dependency.m_Continuations = Parked;
+	Dependency.m_State.fetch_and(~Counter::kLocked, std::memory_order_release);
+}
+
+void JobSystem::Counter::Done(void)
+{
+	uint32_t State = m_State.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		if (State & kLocked)
+		{
+			std::this_thread::yield();
+			State = m_State.load(std::memory_order_relaxed);
+			continue;
+		}
+		ASSERT(State != 0, "Counter::Done() without a matching Add()");
+
+		if (State > 1)
+		{
+			if (m_State.compare_exchange_weak(State, State - 1, std::memory_order_release, std::memory_order_relaxed))
+				return;
+			continue;
+		}
+
+		// The last one takes the parked jobs, then releases the counter to Wait() for good.  An Add() may land
+		// while the lock is held, so the count is decremented rather than cleared.
+		if (!m_State.compare_exchange_weak(State, 1 | kLocked, std::memory_order_acq_rel, std::memory_order_relaxed))
+			continue;
+		Continuation* Ready = m_Continuations;
+		m_Continuations = nullptr;
+		m_State.fetch_sub(1 | kLocked, std::memory_order_acq_rel);
+
+		while (Ready != nullptr)
+		{
+			Continuation* Next = Ready->Next;
+			Detail::Submit(Ready->Work);
+			delete Ready;
+			Ready = Next;
+		}
+		return;
+	}
+}
+
+void JobSystem::Wait(const Counter& Pending)
+{
+	Worker* Self = t_Worker;
+	while (!Pending.IsDone())
+	{
+		if (!RunOne(Self))
+			std::this_thread::yield();
+	}
+}
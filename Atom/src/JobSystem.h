@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+// Work-stealing job scheduler for the engine's threads.  The thread that calls Initialize() (the main thread) and
+// each worker own a WorkStealingDeque: they run their own jobs newest first, and idle threads steal the oldest
+// ones from the others.  Threads the job system did not start submit through a shared queue.
+//
+// Jobs report to a Counter when they finish.  Wait() runs queued jobs until its counter drops to zero, so the
+// main thread keeps working while it waits and a job may wait for the jobs it spawned; RunAfter() parks a job on
+// a counter until then.  Before Initialize() and after Shutdown(), jobs run inline on the submitting thread.
+//
+// Jobs are stored inline like DeferredReleaseQueue callbacks: any trivially copyable callable of up to
+// kMaxJobSize bytes, typically a lambda capturing pointers and indices.
+namespace JobSystem
+{
+	static const size_t kMaxJobSize = 6 * sizeof(void*);
+
+	struct Settings
+	{
+		uint32_t NumWorkers = ~0u;      // ~0u for one per hardware thread besides the main thread
+		uint64_t AffinityMask = 0;      // processors the workers may run on, 0 for those of the process
+		bool PinWorkers = false;        // worker i only runs on the i-th processor of AffinityMask, from 0, wrapping
+	};
+
+	class Counter;
+
+	namespace Detail
+	{
+		struct Job
+		{
+			void (*Invoke)(void* Function);
+			Counter* Signal;
+			alignas(void*) unsigned char Function[kMaxJobSize];
+		};
+
+		struct Continuation;
+		void SubmitAfter(Counter& Dependency, const Job& NewJob);
+	}
+
+	// The number of jobs left to finish, and the jobs to start once there are none.  Wait() for it before it goes
+	// out of scope.
+	class Counter
+	{
+	public:
+		Counter() = default;
+		Counter(const Counter&) = delete;
+		Counter& operator=(const Counter&) = delete;
+
+		// Run() adds one per job and the job takes it away, so these are only needed to count other work.
+		void Add(uint32_t Count) { m_State.fetch_add(Count, std::memory_order_relaxed); }
+		void Done(void);
+
+		bool IsDone(void) const { return (m_State.load(std::memory_order_acquire) & kCountMask) == 0; }
+		uint32_t GetPending(void) const { return m_State.load(std::memory_order_relaxed) & kCountMask; }
+
+	private:
+		friend void Detail::SubmitAfter(Counter& Dependency, const Detail::Job& NewJob);
+
+		// The count, and a bit that guards m_Continuations.  The Done() that takes the count to zero holds it
+		// while it detaches them and does not touch the counter after, as Wait() may return right then.
+		static const uint32_t kLocked = 1u << 31;
+		static const uint32_t kCountMask = kLocked - 1;
+
+		std::atomic<uint32_t> m_State = 0;
+		Detail::Continuation* m_Continuations = nullptr;
+	};
+
+	struct Stats
+	{
+		uint64_t NumJobs = 0;           // since Initialize()
+		uint64_t NumStolen = 0;
+		uint64_t NumInline = 0;         // run on submission, with the deque full or no workers
+	};
+
+	void Initialize(const Settings& Options = {});
+	// Waits for the jobs still queued, then stops the workers.
+	void Shutdown(void);
+
+	bool IsRunning(void);
+	// Workers plus the main thread.  1 when not running.
+	uint32_t GetNumThreads(void);
+	// 0 for the main thread, 1 to GetNumThreads() - 1 for the workers, ~0u for other threads.
+	uint32_t GetThreadIndex(void);
+
+	Stats GetStats(void);
+
+	namespace Detail
+	{
+		void Submit(const Job& NewJob);
+
+		template <typename Fn> Job MakeJob(Fn&& Function, Counter* Signal)
+		{
+			using Callable = std::decay_t<Fn>;
+			static_assert(sizeof(Callable) <= kMaxJobSize && alignof(Callable) <= alignof(void*), "Job too large to store inline");
+			static_assert(std::is_trivially_copyable_v<Callable> && std::is_trivially_destructible_v<Callable>,
+				"Jobs are copied as bytes and never destroyed; capture raw pointers and values only");
+
+			Job NewJob;
+			NewJob.Invoke = [](void* Function) { (*static_cast<Callable*>(Function))(); };
+			NewJob.Signal = Signal;
+			new (NewJob.Function) Callable(std::forward<Fn>(Function));
+			if (Signal != nullptr)
+				Signal->Add(1);
+			return NewJob;
+		}
+	}
+
+	// Queues Function() and, when given, holds Signal until it has run.
+	template <typename Fn> void Run(Fn&& Function, Counter* Signal = nullptr)
+	{
+		Detail::Submit(Detail::MakeJob(std::forward<Fn>(Function), Signal));
+	}
+
+	// Queues Function() once Dependency is done, right away if it is.  Signal is held from now on.
+	template <typename Fn> void RunAfter(Counter& Dependency, Fn&& Function, Counter* Signal = nullptr)
+	{
+		Detail::SubmitAfter(Dependency, Detail::MakeJob(std::forward<Fn>(Function), Signal));
+	}
+
+	// Runs queued jobs on the calling thread until Pending is done.  A job may wait for the jobs it started, but
+	// not for others: the job that would signal Pending may be suspended further down this thread's stack.  Use
+	// RunAfter() for those.
+	void Wait(const Counter& Pending);
+
+	namespace Detail
+	{
+		template <typename Fn> void RunRange(Fn& Function, uint32_t Begin, uint32_t End, uint32_t GrainSize, Counter& Signal)
+		{
+			// Hand the upper halves to thieves and keep splitting the lower one, so that a stolen half splits
+			// again on the thief and the work spreads in log(Count) steps.
+			while (End - Begin > GrainSize)
+			{
+				const uint32_t Middle = Begin + (End - Begin) / 2;
+				Fn* Func = &Function;
+				Counter* Pieces = &Signal;
+				Run([Func, Middle, End, GrainSize, Pieces] { RunRange(*Func, Middle, End, GrainSize, *Pieces); }, &Signal);
+				End = Middle;
+			}
+			for (uint32_t i = Begin; i < End; ++i)
+				Function(i);
+		}
+	}
+
+	// Calls Function(i) for i in [0, Count) on the job threads, the caller included, and returns once all calls
+	// have returned.  The range is split in halves down to pieces of at most GrainSize items; 0 picks a grain that
+	// gives each thread about four pieces.  Function may capture anything: the pieces only keep its address.
+	template <typename Fn> void ParallelFor(uint32_t Count, uint32_t GrainSize, Fn&& Function)
+	{
+		if (Count == 0)
+			return;
+		if (GrainSize == 0)
+			GrainSize = std::max(1u, Count / (GetNumThreads() * 4));
+
+		// The caller holds a count of its own while it splits, so that thieves finishing every piece queued so far
+		// cannot take Pieces to zero before the last one is queued.
+		Counter Pieces;
+		Pieces.Add(1);
+		Detail::RunRange(Function, 0, Count, GrainSize, Pieces);
+		Pieces.Done();
+		Wait(Pieces);
+	}
+}
@@ -0,0 +1,636 @@
+#include "pch.h"
+#include "KTX2Loader.h"
+#include "ParallelFor.h"
+#include "MappedFile.h"
+
+namespace
+{
+	const uint8_t kIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	struct Header
+	{
+		uint8_t Identifier[12];
+		uint32_t VkFormat;
+		uint32_t TypeSize;
+		uint32_t PixelWidth;
+		uint32_t PixelHeight;
+		uint32_t PixelDepth;
+		uint32_t LayerCount;
+		uint32_t FaceCount;
+		uint32_t LevelCount;
+		uint32_t SupercompressionScheme;
+		uint32_t DfdByteOffset;
+		uint32_t DfdByteLength;
+		uint32_t KvdByteOffset;
+		uint32_t KvdByteLength;
+		uint64_t SgdByteOffset;
+		uint64_t SgdByteLength;
+	};
+	static_assert(sizeof(Header) == 80, "KTX2 header layout");
+
+	struct LevelIndex
+	{
+		uint64_t ByteOffset;
+		uint64_t ByteLength;
+		uint64_t UncompressedByteLength;
+	};
+
+	const char* const kSupercompressionNames[] = { "none", "BasisLZ", "Zstandard", "ZLIB" };
+	const uint32_t kDfdColorModelETC1S = 163;
+	const uint32_t kDfdColorModelUASTC = 166;
+
+	// How an uncompressed payload is turned into a block compressed one.
+	enum class Transcoding
+	{
+		None,
+		R8ToBC4,
+		RG8ToBC5,
+		RGBA8ToBC,      // BC1 if every texel is opaque, BC3 otherwise
+		BGRA8ToBC,
+	};
+
+	struct FormatMapping
+	{
+		uint32_t VkFormat;
+		DXGI_FORMAT Format;
+		Transcoding Transcode;
+	};
+
+	const FormatMapping kFormats[] =
+	{
+		{ 9,   DXGI_FORMAT_R8_UNORM,               Transcoding::R8ToBC4 },      // VK_FORMAT_R8_UNORM
+		{ 16,  DXGI_FORMAT_R8G8_UNORM,             Transcoding::RG8ToBC5 },     // VK_FORMAT_R8G8_UNORM
+		{ 37,  DXGI_FORMAT_R8G8B8A8_UNORM,         Transcoding::RGBA8ToBC },    // VK_FORMAT_R8G8B8A8_UNORM
+		{ 43,  DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    Transcoding::RGBA8ToBC },    // VK_FORMAT_R8G8B8A8_SRGB
+		{ 44,  DXGI_FORMAT_B8G8R8A8_UNORM,         Transcoding::BGRA8ToBC },    // VK_FORMAT_B8G8R8A8_UNORM
+		{ 50,  DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    Transcoding::BGRA8ToBC },    // VK_FORMAT_B8G8R8A8_SRGB
+		{ 76,  DXGI_FORMAT_R16_FLOAT,              Transcoding::None },         // VK_FORMAT_R16_SFLOAT
+		{ 83,  DXGI_FORMAT_R16G16_FLOAT,           Transcoding::None },         // VK_FORMAT_R16G16_SFLOAT
+		{ 97,  DXGI_FORMAT_R16G16B16A16_FLOAT,     Transcoding::None },         // VK_FORMAT_R16G16B16A16_SFLOAT
+		{ 109, DXGI_FORMAT_R32G32B32A32_FLOAT,     Transcoding::None },         // VK_FORMAT_R32G32B32A32_SFLOAT
+		{ 122, DXGI_FORMAT_R11G11B10_FLOAT,        Transcoding::None },         // VK_FORMAT_B10G11R11_UFLOAT_PACK32
+		{ 123, DXGI_FORMAT_R9G9B9E5_SHAREDEXP,     Transcoding::None },         // VK_FORMAT_E5B9G9R9_UFLOAT_PACK32
+		{ 131, DXGI_FORMAT_BC1_UNORM,              Transcoding::None },         // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+		{ 132, DXGI_FORMAT_BC1_UNORM_SRGB,         Transcoding::None },         // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+		{ 133, DXGI_FORMAT_BC1_UNORM,              Transcoding::None },         // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+		{ 134, DXGI_FORMAT_BC1_UNORM_SRGB,         Transcoding::None },         // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+		{ 135, DXGI_FORMAT_BC2_UNORM,              Transcoding::None },         // VK_FORMAT_BC2_UNORM_BLOCK
+		{ 136, DXGI_FORMAT_BC2_UNORM_SRGB,         Transcoding::None },         // VK_FORMAT_BC2_SRGB_BLOCK
+		{ 137, DXGI_FORMAT_BC3_UNORM,              Transcoding::None },         // VK_FORMAT_BC3_UNORM_BLOCK
+		{ 138, DXGI_FORMAT_BC3_UNORM_SRGB,         Transcoding::None },         // VK_FORMAT_BC3_SRGB_BLOCK
+		{ 139, DXGI_FORMAT_BC4_UNORM,              Transcoding::None },         // VK_FORMAT_BC4_UNORM_BLOCK
+		{ 140, DXGI_FORMAT_BC4_SNORM,              Transcoding::None },         // VK_FORMAT_BC4_SNORM_BLOCK
+		{ 141, DXGI_FORMAT_BC5_UNORM,              Transcoding::None },         // VK_FORMAT_BC5_UNORM_BLOCK
+		{ 142, DXGI_FORMAT_BC5_SNORM,              Transcoding::None },         // VK_FORMAT_BC5_SNORM_BLOCK
+		{ 143, DXGI_FORMAT_BC6H_UF16,              Transcoding::None },         // VK_FORMAT_BC6H_UFLOAT_BLOCK
+		{ 144, DXGI_FORMAT_BC6H_SF16,              Transcoding::None },         // VK_FORMAT_BC6H_SFLOAT_BLOCK
+		{ 145, DXGI_FORMAT_BC7_UNORM,              Transcoding::None },         // VK_FORMAT_BC7_UNORM_BLOCK
+		{ 146, DXGI_FORMAT_BC7_UNORM_SRGB,         Transcoding::None },         // VK_FORMAT_BC7_SRGB_BLOCK
+	};
+
+	const FormatMapping* FindFormat(uint32_t vkFormat)
+	{
+		for (const FormatMapping& mapping : kFormats)
+		{
+			if (mapping.VkFormat == vkFormat)
+				return &mapping;
+		}
+		return nullptr;
+	}
+
+	// Bytes per texel, or per 4x4 block for block compressed formats.
+	uint32_t GetElementSize(DXGI_FORMAT format, bool& isBlock)
+	{
+		isBlock = false;
+		switch (format)
+		{
+		case DXGI_FORMAT_R8_UNORM:
+			return 1;
+		case DXGI_FORMAT_R8G8_UNORM:
+		case DXGI_FORMAT_R16_FLOAT:
+			return 2;
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case DXGI_FORMAT_R16G16_FLOAT:
+		case DXGI_FORMAT_R11G11B10_FLOAT:
+		case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+			return 4;
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			return 8;
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return 16;
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_UNORM:
+		case DXGI_FORMAT_BC4_SNORM:
+			isBlock = true;
+			return 8;
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC5_SNORM:
+		case DXGI_FORMAT_BC6H_UF16:
+		case DXGI_FORMAT_BC6H_SF16:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			isBlock = true;
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	// Gathers the 4x4 block at (bx, by) with clamped edges.
+	template <uint32_t Channels>
+	void FetchBlock(const uint8_t* texels, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t block[16][Channels])
+	{
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			const uint32_t sy = std::min(by * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				const uint32_t sx = std::min(bx * 4 + x, width - 1);
+				memcpy(block[y * 4 + x], texels + ((size_t)sy * width + sx) * Channels, Channels);
+			}
+		}
+	}
+
+	// Picks the closest palette entry for each of the 16 values, returns the squared error.
+	int FitBC4Palette(const uint8_t* values, uint32_t stride, const int palette[8], uint64_t& indices)
+	{
+		int totalError = 0;
+		indices = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const int value = values[i * stride];
+			uint32_t best = 0;
+			int bestError = INT_MAX;
+			for (uint32_t p = 0; p < 8; ++p)
+			{
+				const int error = (palette[p] - value) * (palette[p] - value);
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= (uint64_t)best << (3 * i);
+			totalError += bestError;
+		}
+		return totalError;
+	}
+
+	// One 8 byte BC4 block from 16 values read with a stride.  Tries the 8 value mode over the full range and
+	// the 6 value mode, which spends its endpoints on the values between the explicit 0 and 255.
+	void EncodeBC4Block(const uint8_t* values, uint32_t stride, uint8_t* out)
+	{
+		int minValue = 255, maxValue = 0, innerMin = 255, innerMax = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const int value = values[i * stride];
+			minValue = std::min(minValue, value);
+			maxValue = std::max(maxValue, value);
+			if (value != 0 && value != 255)
+			{
+				innerMin = std::min(innerMin, value);
+				innerMax = std::max(innerMax, value);
+			}
+		}
+		if (innerMin > innerMax)
+			innerMin = innerMax = minValue;
+
+		int palette8[8] = { maxValue, minValue };
+		for (int i = 1; i < 7; ++i)
+			palette8[i + 1] = ((7 - i) * maxValue + i * minValue + 3) / 7;
+
+		int palette6[8] = { innerMin, innerMax, 0, 0, 0, 0, 0, 255 };
+		for (int i = 1; i < 5; ++i)
+			palette6[i + 1] = ((5 - i) * innerMin + i * innerMax + 2) / 5;
+
+		uint64_t indices8 = 0, indices6 = 0;
+		const int error8 = maxValue > minValue ? FitBC4Palette(values, stride, palette8, indices8) : INT_MAX;
+		const int error6 = FitBC4Palette(values, stride, palette6, indices6);
+
+		const bool use8 = error8 < error6;
+		out[0] = (uint8_t)(use8 ? maxValue : innerMin);
+		out[1] = (uint8_t)(use8 ? minValue : innerMax);
+		const uint64_t indices = use8 ? indices8 : indices6;
+		for (uint32_t i = 0; i < 6; ++i)
+			out[2 + i] = (uint8_t)(indices >> (8 * i));
+	}
+
+	uint16_t PackRGB565(const float color[3])
+	{
+		const uint32_t r = (uint32_t)(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+		const uint32_t g = (uint32_t)(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+		const uint32_t b = (uint32_t)(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRGB565(uint16_t color, int out[3])
+	{
+		const int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		out[0] = (r << 3) | (r >> 2);
+		out[1] = (g << 2) | (g >> 4);
+		out[2] = (b << 3) | (b >> 2);
+	}
+
+	// One 8 byte BC1 color block in four color mode.  Endpoints are the extremes of the texels projected
+	// on their principal axis, a few power iterations of the covariance matrix.
+	void EncodeBC1Block(const uint8_t block[16][4], uint8_t* out)
+	{
+		float mean[3] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+			for (uint32_t c = 0; c < 3; ++c)
+				mean[c] += block[i][c] / 16.0f;
+
+		float cov[6] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const float d[3] = { block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2] };
+			cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+			cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+		}
+
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (uint32_t iteration = 0; iteration < 4; ++iteration)
+		{
+			const float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+			const float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+			const float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+			const float length = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+			if (length < 1e-6f)
+				break;
+			axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+		}
+
+		float minT = FLT_MAX, maxT = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const float t = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		const float axisLengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		if (axisLengthSq > 0.0f)
+		{
+			minT /= axisLengthSq;
+			maxT /= axisLengthSq;
+		}
+		const float end0[3] = { mean[0] + axis[0] * maxT, mean[1] + axis[1] * maxT, mean[2] + axis[2] * maxT };
+		const float end1[3] = { mean[0] + axis[0] * minT, mean[1] + axis[1] * minT, mean[2] + axis[2] * minT };
+
+		uint16_t color0 = PackRGB565(end0);
+		uint16_t color1 = PackRGB565(end1);
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		uint32_t indices = 0;
+		if (color0 != color1)
+		{
+			int palette[4][3];
+			UnpackRGB565(color0, palette[0]);
+			UnpackRGB565(color1, palette[1]);
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				uint32_t best = 0;
+				int bestError = INT_MAX;
+				for (uint32_t p = 0; p < 4; ++p)
+				{
+					const int dr = palette[p][0] - block[i][0], dg = palette[p][1] - block[i][1], db = palette[p][2] - block[i][2];
+					const int error = dr * dr + dg * dg + db * db;
+					if (error < bestError)
+					{
+						bestError = error;
+						best = p;
+					}
+				}
+				indices |= best << (2 * i);
+			}
+		}
+
+		out[0] = (uint8_t)color0; out[1] = (uint8_t)(color0 >> 8);
+		out[2] = (uint8_t)color1; out[3] = (uint8_t)(color1 >> 8);
+		for (uint32_t i = 0; i < 4; ++i)
+			out[4 + i] = (uint8_t)(indices >> (8 * i));
+	}
+
+	bool HasTransparentTexels(const uint8_t* texels, size_t count, uint32_t alphaOffset)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (texels[i * 4 + alphaOffset] != 255)
+				return true;
+		}
+		return false;
+	}
+
+	DXGI_FORMAT GetTranscodedFormat(Transcoding transcode, DXGI_FORMAT format, bool hasAlpha)
+	{
+		const bool sRGB = format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+		switch (transcode)
+		{
+		case Transcoding::R8ToBC4:
+			return DXGI_FORMAT_BC4_UNORM;
+		case Transcoding::RG8ToBC5:
+			return DXGI_FORMAT_BC5_UNORM;
+		case Transcoding::RGBA8ToBC:
+		case Transcoding::BGRA8ToBC:
+			if (hasAlpha)
+				return sRGB ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+			return sRGB ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+		default:
+			return format;
+		}
+	}
+}
+
+void KTX2::CompressBC1(const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* blocks)
+{
+	const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	for (uint32_t by = 0; by < blocksY; ++by)
+	{
+		for (uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			uint8_t block[16][4];
+			FetchBlock<4>(rgba, width, height, bx, by, block);
+			EncodeBC1Block(block, blocks + ((size_t)by * blocksX + bx) * 8);
+		}
+	}
+}
+
+void KTX2::CompressBC3(const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* blocks)
+{
+	const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	for (uint32_t by = 0; by < blocksY; ++by)
+	{
+		for (uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			uint8_t block[16][4];
+			FetchBlock<4>(rgba, width, height, bx, by, block);
+			uint8_t* out = blocks + ((size_t)by * blocksX + bx) * 16;
+			EncodeBC4Block(&block[0][3], 4, out);
+			EncodeBC1Block(block, out + 8);
+		}
+	}
+}
+
+void KTX2::CompressBC4(const uint8_t* r, uint32_t width, uint32_t height, uint8_t* blocks)
+{
+	const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	for (uint32_t by = 0; by < blocksY; ++by)
+	{
+		for (uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			uint8_t block[16][1];
+			FetchBlock<1>(r, width, height, bx, by, block);
+			EncodeBC4Block(&block[0][0], 1, blocks + ((size_t)by * blocksX + bx) * 8);
+		}
+	}
+}
+
+void KTX2::CompressBC5(const uint8_t* rg, uint32_t width, uint32_t height, uint8_t* blocks)
+{
+	const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	for (uint32_t by = 0; by < blocksY; ++by)
+	{
+		for (uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			uint8_t block[16][2];
+			FetchBlock<2>(rg, width, height, bx, by, block);
+			uint8_t* out = blocks + ((size_t)by * blocksX + bx) * 16;
+			EncodeBC4Block(&block[0][0], 2, out);
+			EncodeBC4Block(&block[0][1], 2, out + 8);
+		}
+	}
+}
+
+bool KTX2::GetSurfaceInfo(DXGI_FORMAT format, uint32_t width, uint32_t height, size_t& rowPitch, size_t& slicePitch)
+{
+	bool isBlock = false;
+	const uint32_t elementSize = GetElementSize(format, isBlock);
+	if (elementSize == 0)
+		return false;
+
+	if (isBlock)
+	{
+		rowPitch = (size_t)std::max(1u, (width + 3) / 4) * elementSize;
+		slicePitch = rowPitch * std::max(1u, (height + 3) / 4);
+	}
+	else
+	{
+		rowPitch = (size_t)width * elementSize;
+		slicePitch = rowPitch * height;
+	}
+	return true;
+}
+
+void KTX2::TextureData::GetSubresourceData(std::vector<D3D12_SUBRESOURCE_DATA>& subresources) const
+{
+	subresources.resize(GetNumSubresources());
+
+	const uint8_t* data = Bytes.data();
+	for (uint32_t slice = 0; slice < ArraySize; ++slice)
+	{
+		for (uint32_t mip = 0; mip < MipLevels; ++mip)
+		{
+			size_t rowPitch = 0, slicePitch = 0;
+			GetSurfaceInfo(Format, std::max(1u, Width >> mip), std::max(1u, Height >> mip), rowPitch, slicePitch);
+
+			D3D12_SUBRESOURCE_DATA& sub = subresources[slice * MipLevels + mip];
+			sub.pData = data;
+			sub.RowPitch = (LONG_PTR)rowPitch;
+			sub.SlicePitch = (LONG_PTR)slicePitch;
+			data += slicePitch;
+		}
+	}
+}
+
+bool KTX2::IsKTX2(const void* data, size_t size)
+{
+	return size >= sizeof(kIdentifier) && memcmp(data, kIdentifier, sizeof(kIdentifier)) == 0;
+}
+
+bool KTX2::Load(const void* data, size_t size, TextureData& out, const LoadSettings& settings)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+
+	Header header;
+	if (!IsKTX2(data, size) || size < sizeof(Header))
+	{
+		Utility::Printf("KTX2: not a KTX2 file\n");
+		return false;
+	}
+	memcpy(&header, bytes, sizeof(Header));
+
+	if (header.SupercompressionScheme != 0)
+	{
+		Utility::Printf("KTX2: %s supercompression is not supported\n", header.SupercompressionScheme < _countof(kSupercompressionNames) ?
+			kSupercompressionNames[header.SupercompressionScheme] : "vendor");
+		return false;
+	}
+
+	if (header.VkFormat == 0)
+	{
+		// VK_FORMAT_UNDEFINED: the data format descriptor names the payload, e.g. UASTC.
+		uint32_t colorModel = 0;
+		if (header.DfdByteLength >= 16 && (uint64_t)header.DfdByteOffset + 16 <= size)
+			colorModel = bytes[header.DfdByteOffset + 12];
+		Utility::Printf("KTX2: %s payloads are not supported\n", colorModel == kDfdColorModelUASTC ? "UASTC" :
+			colorModel == kDfdColorModelETC1S ? "ETC1S" : "undefined format");
+		return false;
+	}
+
+	const FormatMapping* mapping = FindFormat(header.VkFormat);
+	if (mapping == nullptr)
+	{
+		Utility::Printf("KTX2: VkFormat %u is not supported\n", header.VkFormat);
+		return false;
+	}
+
+	const uint32_t faceCount = header.FaceCount;
+	const uint32_t layerCount = std::max(1u, header.LayerCount);
+	// A level count of 0 asks the loader to generate mips; only the base level is used then.
+	const uint32_t levelCount = std::max(1u, header.LevelCount);
+	if (header.PixelWidth == 0 || header.PixelHeight == 0 || header.PixelDepth > 1 || (faceCount != 1 && faceCount != 6) ||
+		levelCount > 32 || sizeof(Header) + (uint64_t)levelCount * sizeof(LevelIndex) > size)
+	{
+		Utility::Printf("KTX2: only 2D textures, arrays and cube maps are supported\n");
+		return false;
+	}
+
+	std::vector<LevelIndex> levels(levelCount);
+	memcpy(levels.data(), bytes + sizeof(Header), levelCount * sizeof(LevelIndex));
+
+	const uint32_t numSlices = layerCount * faceCount;
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		size_t rowPitch = 0, slicePitch = 0;
+		GetSurfaceInfo(mapping->Format, std::max(1u, header.PixelWidth >> level), std::max(1u, header.PixelHeight >> level), rowPitch, slicePitch);
+		if (levels[level].ByteOffset + levels[level].ByteLength > size || levels[level].ByteLength < slicePitch * numSlices)
+		{
+			Utility::Printf("KTX2: level %u is truncated\n", level);
+			return false;
+		}
+	}
+
+	// Top levels that are not a multiple of the block size cannot be created as BC textures.
+	Transcoding transcode = mapping->Transcode;
+	if (!settings.TranscodeToBC || header.PixelWidth % 4 != 0 || header.PixelHeight % 4 != 0)
+		transcode = Transcoding::None;
+
+	bool hasAlpha = false;
+	if (transcode == Transcoding::RGBA8ToBC || transcode == Transcoding::BGRA8ToBC)
+	{
+		for (uint32_t level = 0; level < levelCount && !hasAlpha; ++level)
+			hasAlpha = HasTransparentTexels(bytes + levels[level].ByteOffset, levels[level].ByteLength / 4, 3);
+	}
+
+	out.Format = GetTranscodedFormat(transcode, mapping->Format, hasAlpha);
+	out.Width = header.PixelWidth;
+	out.Height = header.PixelHeight;
+	out.ArraySize = numSlices;
+	out.MipLevels = levelCount;
+	out.IsCubeMap = faceCount == 6;
+
+	// Destination offsets in subresource order; KTX2 stores level-major, D3D12 wants slice-major.
+	std::vector<size_t> offsets(out.GetNumSubresources());
+	size_t totalSize = 0;
+	for (uint32_t slice = 0; slice < numSlices; ++slice)
+	{
+		for (uint32_t mip = 0; mip < levelCount; ++mip)
+		{
+			size_t rowPitch = 0, slicePitch = 0;
+			GetSurfaceInfo(out.Format, std::max(1u, out.Width >> mip), std::max(1u, out.Height >> mip), rowPitch, slicePitch);
+			offsets[slice * levelCount + mip] = totalSize;
+			totalSize += slicePitch;
+		}
+	}
+	out.Bytes.resize(totalSize);
+
+	// One job per mip and face; large mips are further split into bands of block rows so a single big
+	// texture still spreads over all threads.
+	struct Job
+	{
+		uint32_t Subresource;
+		uint32_t FirstRow;      // texel rows, a multiple of 4
+		uint32_t NumRows;
+	};
+	const uint32_t kBandRows = transcode == Transcoding::None ? UINT32_MAX : 256;
+
+	std::vector<Job> jobs;
+	for (uint32_t subresource = 0; subresource < out.GetNumSubresources(); ++subresource)
+	{
+		const uint32_t height = std::max(1u, out.Height >> (subresource % levelCount));
+		for (uint32_t row = 0; row < height; row += std::min(kBandRows, height - row))
+			jobs.push_back({ subresource, row, std::min(kBandRows, height - row) });
+	}
+
+	Utility::ParallelFor((uint32_t)jobs.size(), settings.NumThreads, [&](uint32_t jobIndex)
+		{
+			const Job& job = jobs[jobIndex];
+			const uint32_t slice = job.Subresource / levelCount;
+			const uint32_t mip = job.Subresource % levelCount;
+			const uint32_t width = std::max(1u, out.Width >> mip);
+			const uint32_t height = std::max(1u, out.Height >> mip);
+
+			size_t srcRowPitch = 0, srcSize = 0, dstRowPitch = 0, dstSize = 0;
+			GetSurfaceInfo(mapping->Format, width, height, srcRowPitch, srcSize);
+			GetSurfaceInfo(out.Format, width, height, dstRowPitch, dstSize);
+			const uint8_t* src = bytes + levels[mip].ByteOffset + srcSize * slice + srcRowPitch * job.FirstRow;
+			uint8_t* dst = out.Bytes.data() + offsets[job.Subresource] + dstRowPitch * (job.FirstRow / 4);
+
+			switch (transcode)
+			{
+			case Transcoding::None:
+				memcpy(dst, src, srcSize);
+				break;
+			case Transcoding::R8ToBC4:
+				CompressBC4(src, width, job.NumRows, dst);
+				break;
+			case Transcoding::RG8ToBC5:
+				CompressBC5(src, width, job.NumRows, dst);
+				break;
+			case Transcoding::RGBA8ToBC:
+			case Transcoding::BGRA8ToBC:
+			{
+				const uint8_t* rgba = src;
+				std::vector<uint8_t> swizzled;
+				if (transcode == Transcoding::BGRA8ToBC)
+				{
+					swizzled.assign(src, src + srcRowPitch * job.NumRows);
+					for (size_t i = 0; i < swizzled.size(); i += 4)
+						std::swap(swizzled[i], swizzled[i + 2]);
+					rgba = swizzled.data();
+				}
+				if (hasAlpha)
+					CompressBC3(rgba, width, job.NumRows, dst);
+				else
+					CompressBC1(rgba, width, job.NumRows, dst);
+				break;
+			}
+			}
+		});
+
+	return true;
+}
+
+bool KTX2::LoadFile(const std::wstring& path, TextureData& out, const LoadSettings& settings)
+{
+	MappedFile file;
+	if (!file.Open(path))
+		return false;
+
+	return Load(file.GetData(), file.GetSize(), out, settings);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Reader for KTX 2.0 containers (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html).
+// Payloads the GPU can sample directly (BC1-7, 8 bit and float formats) are passed through.  Uncompressed
+// R8, RG8 and RGBA8 payloads are transcoded on the CPU to BC4, BC5 and BC1 (opaque) or BC3, one job per
+// mip and face.
+//
+// Supercompressed payloads (BasisLZ/ETC1S, Zstandard, ZLIB) and UASTC need the Basis Universal transcoder
+// and zstd, which are not part of this tree; such files are rejected with a message so the caller falls
+// back to its default texture.
+namespace KTX2
+{
+	struct LoadSettings
+	{
+		bool TranscodeToBC = true;  // false keeps uncompressed payloads as they are
+		uint32_t NumThreads = 0;    // 0 uses all hardware threads
+	};
+
+	// Texel data laid out in D3D12 subresource order (mip + slice * MipLevels), rows tightly packed.
+	// Slices are layer-major: slice = layer * 6 + face for cube maps.
+	struct TextureData
+	{
+		DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t ArraySize = 1;
+		uint32_t MipLevels = 1;
+		bool IsCubeMap = false;
+		std::vector<uint8_t> Bytes;
+
+		uint32_t GetNumSubresources() const { return ArraySize * MipLevels; }
+		void GetSubresourceData(std::vector<D3D12_SUBRESOURCE_DATA>& subresources) const;
+	};
+
+	bool IsKTX2(const void* data, size_t size);
+	bool Load(const void* data, size_t size, TextureData& out, const LoadSettings& settings = LoadSettings());
+	bool LoadFile(const std::wstring& path, TextureData& out, const LoadSettings& settings = LoadSettings());
+
+	// Row pitch and size of one mip of a texture in format.  Block compressed formats round up to whole blocks.
+	bool GetSurfaceInfo(DXGI_FORMAT format, uint32_t width, uint32_t height, size_t& rowPitch, size_t& slicePitch);
+
+	// Block compression of tightly packed 8 bit texels, exposed for tools and tests.  Partial edge blocks
+	// repeat the last row and column.  blocks receives ceil(width / 4) * ceil(height / 4) blocks.
+	void CompressBC1(const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* blocks);
+	void CompressBC3(const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* blocks);
+	void CompressBC4(const uint8_t* r, uint32_t width, uint32_t height, uint8_t* blocks);
+	void CompressBC5(const uint8_t* rg, uint32_t width, uint32_t height, uint8_t* blocks);
+}
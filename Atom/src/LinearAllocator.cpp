@@ -2,15 +2,41 @@
 #include "Math/Common.h"
 #include "LinearAllocator.h"
 #include "GraphicsCore.h"
+#include "GpuMemory.h"
 #include "CommandListManager.h"
 #include <thread>
 
 using namespace Graphics;
 using namespace std;
 
+namespace
+{
+    // Pages a thread takes from the shared pool at once when its cache runs dry.
+    const size_t kThreadCachePages = 4;
+
+    // Retired pages a thread holds before it hands the oldest half back to the shared pool.
+    const size_t kThreadCacheMaxRetired = 16;
+}
+
+// Per-thread magazine for one page manager.  Only touched by its own thread, except in Destroy() which
+// invalidates it through the generation.
+struct LinearAllocatorPageManager::ThreadCache
+{
+    LinearAllocatorPageManager* Owner = nullptr;
+    uint32_t Generation = 0;
+    vector<LinearAllocationPage*> Available;
+    vector<pair<uint64_t, LinearAllocationPage*> > Retired;    // Oldest first
+
+    ~ThreadCache()
+    {
+        if (Owner != nullptr)
+            Owner->ReleaseThreadCache(*this);
+    }
+};
+
 LinearAllocatorType LinearAllocatorPageManager::sm_AutoType = kGpuExclusive;
 
-LinearAllocatorPageManager::LinearAllocatorPageManager()
+LinearAllocatorPageManager::LinearAllocatorPageManager() : m_Generation(0)
 {
     m_AllocationType = sm_AutoType;
     sm_AutoType = (LinearAllocatorType)(sm_AutoType + 1);
@@ -19,54 +45,122 @@ LinearAllocatorPageManager::LinearAllocatorPageManager()
 
 LinearAllocatorPageManager LinearAllocator::sm_PageManager[2];
 
+LinearAllocatorPageManager::ThreadCache& LinearAllocatorPageManager::GetThreadCache(void)
+{
+    static thread_local ThreadCache s_Caches[kNumAllocatorTypes];
+
+    ThreadCache& Cache = s_Caches[m_AllocationType];
+    const uint32_t Generation = m_Generation.load(memory_order_acquire);
+    if (Cache.Owner == nullptr || Cache.Generation != Generation)
+    {
+        // The pages were destroyed with the pool, forget them.
+        Cache.Owner = this;
+        Cache.Generation = Generation;
+        Cache.Available.clear();
+        Cache.Retired.clear();
+    }
+    return Cache;
+}
+
 LinearAllocationPage* LinearAllocatorPageManager::RequestPage()
 {
-    lock_guard<mutex> LockGuard(m_Mutex);
+    ThreadCache& Cache = GetThreadCache();
 
-    while (!m_RetiredPages.empty() && g_CommandManager.IsFenceComplete(m_RetiredPages.front().first))
+    // Reuse this thread's own retired pages first, in any order: they may come from different queues.
+    if (Cache.Available.empty())
     {
-        m_AvailablePages.push(m_RetiredPages.front().second);
-        m_RetiredPages.pop();
+        auto Kept = Cache.Retired.begin();
+        for (auto iter = Cache.Retired.begin(); iter != Cache.Retired.end(); ++iter)
+        {
+            if (g_CommandManager.IsFenceComplete(iter->first))
+                Cache.Available.push_back(iter->second);
+            else
+                *Kept++ = *iter;
+        }
+        Cache.Retired.erase(Kept, Cache.Retired.end());
     }
 
-    LinearAllocationPage* PagePtr = nullptr;
+    if (Cache.Available.empty())
+        RefillThreadCache(Cache);
+
+    LinearAllocationPage* PagePtr = Cache.Available.back();
+    Cache.Available.pop_back();
+    return PagePtr;
+}
+
+void LinearAllocatorPageManager::RefillThreadCache(ThreadCache& Cache)
+{
+    lock_guard<mutex> LockGuard(m_Mutex);
+
+    m_RetiredPages.Process([](uint64_t FenceValue) { return g_CommandManager.IsFenceComplete(FenceValue); });
 
-    if (!m_AvailablePages.empty())
+    while (Cache.Available.size() < kThreadCachePages && !m_AvailablePages.empty())
     {
-        PagePtr = m_AvailablePages.front();
+        Cache.Available.push_back(m_AvailablePages.front());
         m_AvailablePages.pop();
     }
-    else
+
+    // Only create what is needed right now, other threads may free pages soon.
+    if (Cache.Available.empty())
     {
-        PagePtr = CreateNewPage();
+        LinearAllocationPage* PagePtr = CreateNewPage();
         m_PagePool.emplace_back(PagePtr);
+        Cache.Available.push_back(PagePtr);
     }
+}
 
-    return PagePtr;
+void LinearAllocatorPageManager::ReturnRetiredPages(ThreadCache& Cache, size_t Count)
+{
+    // Callbacks run from RefillThreadCache(), which holds m_Mutex.
+    for (size_t i = 0; i < Count; ++i)
+    {
+        LinearAllocationPage* PagePtr = Cache.Retired[i].second;
+        m_RetiredPages.Defer(Cache.Retired[i].first, [this, PagePtr] { m_AvailablePages.push(PagePtr); });
+    }
+    Cache.Retired.erase(Cache.Retired.begin(), Cache.Retired.begin() + Count);
 }
 
-void LinearAllocatorPageManager::DiscardPages(uint64_t FenceValue, const vector<LinearAllocationPage*>& UsedPages)
+void LinearAllocatorPageManager::ReleaseThreadCache(ThreadCache& Cache)
 {
+    if (Cache.Generation != m_Generation.load(memory_order_acquire))
+        return;
+
+    ReturnRetiredPages(Cache, Cache.Retired.size());
+
     lock_guard<mutex> LockGuard(m_Mutex);
-    for (auto iter = UsedPages.begin(); iter != UsedPages.end(); ++iter)
-        m_RetiredPages.push(make_pair(FenceValue, *iter));
+    for (LinearAllocationPage* PagePtr : Cache.Available)
+        m_AvailablePages.push(PagePtr);
+    Cache.Available.clear();
 }
 
-void LinearAllocatorPageManager::FreeLargePages(uint64_t FenceValue, const vector<LinearAllocationPage*>& LargePages)
+void LinearAllocatorPageManager::DiscardPages(uint64_t FenceValue, const vector<LinearAllocationPage*>& UsedPages)
 {
-    lock_guard<mutex> LockGuard(m_Mutex);
+    ThreadCache& Cache = GetThreadCache();
+    for (auto iter = UsedPages.begin(); iter != UsedPages.end(); ++iter)
+        Cache.Retired.push_back(make_pair(FenceValue, *iter));
 
-    while (!m_DeletionQueue.empty() && g_CommandManager.IsFenceComplete(m_DeletionQueue.front().first))
-    {
-        delete m_DeletionQueue.front().second;
-        m_DeletionQueue.pop();
-    }
+    // Pages retired on this thread are reused here first; past the limit the oldest half goes back to the
+    // shared pool in one lock so that other threads can have them.
+    if (Cache.Retired.size() > kThreadCacheMaxRetired)
+        ReturnRetiredPages(Cache, Cache.Retired.size() / 2);
+}
 
+void LinearAllocatorPageManager::FreeLargePages(uint64_t FenceValue, const vector<LinearAllocationPage*>& LargePages)
+{
+    // The page's resource goes to the engine-wide deferred release queue, which holds it past FenceValue:
+    // that fence was the last one signaled when the context was finished.
+    (void)FenceValue;
     for (auto iter = LargePages.begin(); iter != LargePages.end(); ++iter)
-    {
-        (*iter)->Unmap();
-        m_DeletionQueue.push(make_pair(FenceValue, *iter));
-    }
+        delete *iter;
+}
+
+void LinearAllocatorPageManager::Destroy(void)
+{
+    lock_guard<mutex> LockGuard(m_Mutex);
+    m_Generation.fetch_add(1, memory_order_release);
+    m_RetiredPages.Clear();
+    m_AvailablePages = {};
+    m_PagePool.clear();
 }
 
 LinearAllocationPage* LinearAllocatorPageManager::CreateNewPage(size_t PageSize)
@@ -110,6 +204,7 @@ LinearAllocationPage* LinearAllocatorPageManager::CreateNewPage(size_t PageSize)
         &ResourceDesc, DefaultUsage, nullptr, IID_PPV_ARGS(&pBuffer)));
 
     pBuffer->SetName(L"LinearAllocator Page");
+    GpuMemory::Track(pBuffer, m_AllocationType == kGpuExclusive ? GpuMemoryTracker::kOther : GpuMemoryTracker::kUploadPages);
 
     return new LinearAllocationPage(pBuffer, DefaultUsage);
 }
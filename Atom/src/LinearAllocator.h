@@ -1,8 +1,9 @@
 // Description:  This is a dynamic graphics memory allocator for DX12.  It's designed to work in concert
 // with the CommandContext class and to do so in a thread-safe manner.  There may be many command contexts,
 // each with its own linear allocators.  They act as windows into a global memory pool by reserving a
-// context-local memory page.  Requesting a new page is done in a thread-safe manner by guarding accesses
-// with a mutex lock.
+// context-local memory page.  Each thread keeps a small cache of pages per allocator type, so most page
+// requests and returns never touch the global pool; the pool's mutex is only taken to refill a thread's
+// cache or to hand it a batch of retired pages.
 //
 // When a command context is finished, it will receive a fence ID that indicates when it's safe to reclaim
 // used resources.  The CleanupUsedPages() method must be invoked at this time so that the used pages can be
@@ -11,9 +12,11 @@
 #pragma once
 
 #include "GpuResource.h"
+#include "DeferredReleaseQueue.h"
 #include <vector>
 #include <queue>
 #include <mutex>
+#include <atomic>
 
 // Constant blocks must be multiples of 16 constants @ 16 bytes each
 #define DEFAULT_ALIGN 256
@@ -95,22 +98,30 @@ public:
     // Discarded pages will get recycled.  This is for fixed size pages.
     void DiscardPages(uint64_t FenceID, const std::vector<LinearAllocationPage*>& Pages);
 
-    // Freed pages will be destroyed once their fence has passed.  This is for single-use,
-    // "large" pages.
+    // Freed pages are destroyed right away; their resources are released once the GPU is done with
+    // them.  This is for single-use, "large" pages.
     void FreeLargePages(uint64_t FenceID, const std::vector<LinearAllocationPage*>& Pages);
 
-    void Destroy(void) { m_PagePool.clear(); }
+    void Destroy(void);
 
 private:
 
+    struct ThreadCache;     // Defined in LinearAllocator.cpp
+    ThreadCache& GetThreadCache(void);
+    void RefillThreadCache(ThreadCache& Cache);
+    void ReturnRetiredPages(ThreadCache& Cache, size_t Count);
+    void ReleaseThreadCache(ThreadCache& Cache);
+
     static LinearAllocatorType sm_AutoType;
 
     LinearAllocatorType m_AllocationType;
     std::vector<std::unique_ptr<LinearAllocationPage> > m_PagePool;
-    std::queue<std::pair<uint64_t, LinearAllocationPage*> > m_RetiredPages;
-    std::queue<std::pair<uint64_t, LinearAllocationPage*> > m_DeletionQueue;
+    // Pages handed back by the thread caches, moved to m_AvailablePages once their fence has passed.
+    DeferredReleaseQueue m_RetiredPages;
     std::queue<LinearAllocationPage*> m_AvailablePages;
     std::mutex m_Mutex;
+    // Bumped by Destroy() so thread caches drop the pages they still point to.
+    std::atomic<uint32_t> m_Generation;
 };
 
 class LinearAllocator
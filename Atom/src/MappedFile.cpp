@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::Open(const std::filesystem::path& path, bool sequential)
+{
+	Close();
+
+	// The view keeps the mapping alive, so the file and mapping handles are released right away.
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size = {};
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr)
+		return false;
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == nullptr)
+		return false;
+
+	m_Data = (const uint8_t*)view;
+	m_Size = (size_t)size.QuadPart;
+#else
+	const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	struct stat info = {};
+	void* view = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && info.st_size > 0)
+		view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED)
+		return false;
+
+	m_Data = (const uint8_t*)view;
+	m_Size = (size_t)info.st_size;
+
+	// MADV_WILLNEED was measured slower than plain read-ahead: it blocks until the whole range is queued.
+	if (sequential)
+		madvise(view, m_Size, MADV_SEQUENTIAL);
+#endif
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_Data == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_Data);
+#else
+	munmap((void*)m_Data, m_Size);
+#endif
+	m_Data = nullptr;
+	m_Size = 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+// Read-only view of a whole file mapped into the address space.  Pages are read on first touch and are
+// backed by the file rather than the page file, so large assets (DDS caches, KTX2 textures, HDR sources) can
+// be parsed in place and copied straight into upload memory without staging them in a heap buffer.
+//
+// The view stays valid until Close() or destruction.  On Windows a mapped file cannot be replaced, so close
+// the view before overwriting the file it came from.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// sequential hints the OS to read ahead and drop pages behind, for files that are consumed front to back once.
+	bool Open(const std::filesystem::path& path, bool sequential = true);
+	void Close();
+
+	bool IsOpen() const { return m_Data != nullptr; }
+	const uint8_t* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	const uint8_t* m_Data = nullptr;
+	size_t m_Size = 0;
+};
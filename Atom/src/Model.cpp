@@ -5,14 +5,29 @@
 #include "Renderer.h"
 #include "FileSystem.h"
 #include "TextureManager.h"
+#include "CommandContext.h"
+#include "UploadBatch.h"
+#include "GpuHeapAllocator.h"
+#include "GpuMemory.h"
+#include "DeferredRelease.h"
+#include "FrameArena.h"
+#include "Camera.h"
 #include "tiny_gltf.h"
 
 // stb_image for decoding PNG/JPEG from base64 or compressed image buffers
 #include "stb_image.h"
+#include <algorithm>
+#include <tuple>
+#include <unordered_map>
 
 
 // -------------------- Helpers --------------------
 
+static TextureRef Material::* const s_MaterialTextures[kNumMaterialTextures] =
+{
+    &Material::Albedo, &Material::Normal, &Material::ORM, &Material::Emissive
+};
+
 static bool EndsWith(const std::string& s, const std::string& suffix)
 {
     if (s.size() < suffix.size()) return false;
@@ -129,10 +144,80 @@ static std::vector<unsigned char> Base64Decode(const std::string& input)
 // Expected: TextureRef LoadTexFromFile(const std::wstring& path);
 //           TextureRef LoadTexFromMemory(const unsigned char* pixels, int w, int h);
 
-// Load tinygltf::Image into TextureRef (handles external URI, data:base64, bufferView/raw)
-TextureRef LoadGltfImageToTextureRef(const tinygltf::Image& image, const std::string& baseDir)
+static bool IsKTX2Image(const tinygltf::Image& image)
+{
+    return image.mimeType == "image/ktx2" || EndsWith(image.uri, ".ktx2") || EndsWith(image.uri, ".KTX2");
+}
+
+// Texture -> image, -1 if none.  KHR_texture_basisu keeps its KTX2 image in the extension and an optional
+// PNG/JPG in source; the fallback wins since ETC1S/UASTC cannot be transcoded here (KTX2Loader.h).
+static int32_t GetImageIndex(const tinygltf::Model& gltf, int texIdx)
+{
+    if (texIdx < 0 || texIdx >= (int)gltf.textures.size()) return -1;
+    const tinygltf::Texture& t = gltf.textures[texIdx];
+    int source = t.source;
+    auto basisu = t.extensions.find("KHR_texture_basisu");
+    if (source < 0 && basisu != t.extensions.end() && basisu->second.Has("source"))
+        source = basisu->second.Get("source").Get<int>();
+    if (source < 0 || source >= (int)gltf.images.size()) return -1;
+    return source;
+}
+
+// Decode an embedded tinygltf::Image (data:base64, bufferView/raw) or an external file to tightly packed RGBA8.
+static bool DecodeGltfImage(const tinygltf::Image& image, const std::string& baseDir, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height)
+{
+    int w = 0, h = 0, comp = 0;
+    unsigned char* pixels = nullptr;
+
+    // tinygltf stores raw pixel bytes in image.image when it decoded them (component = number of channels)
+    if (!image.image.empty() && image.component > 0) {
+        if (image.bits != 8)
+            return false;
+
+        width = (uint32_t)image.width;
+        height = (uint32_t)image.height;
+        rgba.resize((size_t)width * height * 4);
+        for (size_t i = 0; i < (size_t)width * height; ++i) {
+            const unsigned char* src = &image.image[i * image.component];
+            rgba[i * 4 + 0] = src[0];
+            rgba[i * 4 + 1] = image.component > 1 ? src[1] : src[0];
+            rgba[i * 4 + 2] = image.component > 2 ? src[2] : src[0];
+            rgba[i * 4 + 3] = image.component > 3 ? src[3] : 255;
+        }
+        return true;
+    }
+
+    if (!image.image.empty()) {
+        // component == 0 -> image.image probably contains compressed file bytes (PNG/JPG)
+        pixels = stbi_load_from_memory(image.image.data(), static_cast<int>(image.image.size()), &w, &h, &comp, 4);
+    }
+    else if (!image.uri.empty() && image.uri.rfind("data:", 0) == 0) {
+        size_t pos = image.uri.find("base64,");
+        if (pos == std::string::npos)
+            return false;
+        std::vector<unsigned char> decoded = Base64Decode(image.uri.substr(pos + 7));
+        pixels = stbi_load_from_memory(decoded.data(), static_cast<int>(decoded.size()), &w, &h, &comp, 4);
+    }
+    else if (!image.uri.empty()) {
+        std::string fullPath = baseDir.empty() ? image.uri : (baseDir + "/" + image.uri);
+        pixels = stbi_load(fullPath.c_str(), &w, &h, &comp, 4);
+    }
+
+    if (!pixels)
+        return false;
+
+    width = (uint32_t)w;
+    height = (uint32_t)h;
+    rgba.assign(pixels, pixels + (size_t)w * h * 4);
+    stbi_image_free(pixels);
+    return true;
+}
+
+// Load tinygltf::Image into TextureRef.  External files go through the TextureManager cache by path and
+// embedded PNG/JPG bytes by content, so images shared by several materials or duplicated in a GLB are decoded
+// and uploaded once.  Only images that exist as pixels alone (e.g. the ORM images) are uploaded directly.
+TextureRef LoadGltfImageToTextureRef(const tinygltf::Model& gltf, const tinygltf::Image& image, const std::string& baseDir)
 {
-    // Case 1: external file (uri not empty and not data:)
     if (!image.uri.empty() && image.uri.rfind("data:", 0) != 0)
     {
         std::string fullPath = baseDir.empty() ? image.uri : (baseDir + "/" + image.uri);
@@ -140,58 +225,211 @@ TextureRef LoadGltfImageToTextureRef(const tinygltf::Image& image, const std::st
         return TextureManager::LoadTexFromFile(wpath);
     }
 
-    // Case 2: data: URI (base64 compressed image)
-    if (!image.uri.empty() && image.uri.rfind("data:", 0) == 0)
+    // tinygltf usually decoded the pixels already; reuse them on a cache miss instead of decoding again
+    TextureManager::DecodeFunc decode = nullptr;
+    if (!image.image.empty())
+        decode = [&](std::vector<uint8_t>& rgba, uint32_t& w, uint32_t& h) { return DecodeGltfImage(image, baseDir, rgba, w, h); };
+
+    if (image.bufferView >= 0 && image.bufferView < (int)gltf.bufferViews.size())
+    {
+        const tinygltf::BufferView& bv = gltf.bufferViews[image.bufferView];
+        const tinygltf::Buffer& buf = gltf.buffers[bv.buffer];
+        if (bv.byteOffset + bv.byteLength <= buf.data.size())
+            return TextureManager::LoadTexFromEncodedMemory(buf.data.data() + bv.byteOffset, bv.byteLength, Graphics::kMagenta2D, false, decode);
+    }
+
+    if (!image.uri.empty())
     {
-        // find base64 part
         size_t pos = image.uri.find("base64,");
-        if (pos == std::string::npos) {
+        if (pos == std::string::npos)
             return TextureRef(nullptr);
-        }
-        std::string base64Data = image.uri.substr(pos + 7);
-        std::vector<unsigned char> decoded = Base64Decode(base64Data);
-
-        // decode compressed image (PNG/JPEG) to RGBA using stb_image
-        int w = 0, h = 0, comp = 0;
-        unsigned char* rgba = stbi_load_from_memory(decoded.data(), static_cast<int>(decoded.size()), &w, &h, &comp, 4);
-        if (!rgba) {
-            // failed to decode
-            return TextureRef(nullptr);
-        }
+        std::vector<unsigned char> decoded = Base64Decode(image.uri.substr(pos + 7));
+        return TextureManager::LoadTexFromEncodedMemory(decoded.data(), decoded.size(), Graphics::kMagenta2D, false, decode);
+    }
+
+    std::vector<uint8_t> rgba;
+    uint32_t w = 0, h = 0;
+    if (!DecodeGltfImage(image, baseDir, rgba, w, h))
+        return TextureRef(nullptr);
+
+    return TextureManager::LoadTexFromMemory(rgba.data(), w, h);
+}
 
-        TextureRef ref = TextureManager::LoadTexFromMemory(rgba, w, h);
+// -------------------- Occlusion/roughness/metallic packing --------------------
 
-        stbi_image_free(rgba);
-        return ref;
+// Bilinear resample of an RGBA8 image with texel centres aligned; a 2:1 reduction is a box filter.
+static void ResampleRGBA8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t width, uint32_t height, std::vector<uint8_t>& dst)
+{
+    dst.resize((size_t)width * height * 4);
+    for (uint32_t y = 0; y < height; ++y) {
+        const float sy = std::clamp((y + 0.5f) * srcHeight / height - 0.5f, 0.0f, (float)(srcHeight - 1));
+        const uint32_t y0 = (uint32_t)sy, y1 = std::min(y0 + 1, srcHeight - 1);
+        const float fy = sy - y0;
+        for (uint32_t x = 0; x < width; ++x) {
+            const float sx = std::clamp((x + 0.5f) * srcWidth / width - 0.5f, 0.0f, (float)(srcWidth - 1));
+            const uint32_t x0 = (uint32_t)sx, x1 = std::min(x0 + 1, srcWidth - 1);
+            const float fx = sx - x0;
+            for (uint32_t c = 0; c < 4; ++c) {
+                const float top = src[((size_t)y0 * srcWidth + x0) * 4 + c] * (1.0f - fx) + src[((size_t)y0 * srcWidth + x1) * 4 + c] * fx;
+                const float bottom = src[((size_t)y1 * srcWidth + x0) * 4 + c] * (1.0f - fx) + src[((size_t)y1 * srcWidth + x1) * 4 + c] * fx;
+                dst[((size_t)y * width + x) * 4 + c] = (uint8_t)(top + (bottom - top) * fy + 0.5f);
+            }
+        }
     }
+}
 
-    // Case 3: image.image may contain decoded pixels OR compressed bytes depending on tinygltf settings
-    if (!image.image.empty()) {
-        // tinygltf often decodes PNG/JPG into image.image only if Load... did decode them
-        // but to be robust: attempt to detect if image.image is already raw RGBA or compressed (PNG/JPG).
-        // Heuristic: if image.component is set and equals channels (1/3/4) -> raw pixels
-        if (image.component > 0) {
-            // component = number of channels (e.g. 4 for RGBA) => treat as raw pixels
-            // tinygltf stores raw pixel bytes in image.image when it decoded them.
-            return TextureManager::LoadTexFromMemory(const_cast<unsigned char*>(image.image.data()), image.width, image.height);
+// glTF keeps occlusion in R of one texture and roughness/metallic in G/B of another, often two full size
+// images that are both decoded to RGBA8.  Each material gets a single ORM image instead (R = occlusion,
+// G = roughness, B = metallic) at the larger of the two sizes, with the occlusion strength and the
+// roughness/metallic factors baked in; a material with neither texture gets a 1x1 image of its factors.  Only
+// materials whose two slots already share one image that needs none of that are left alone.  The new images and
+// textures are appended to gltf and the materials repointed, so everything downstream only sees the ORM texture
+// in the metallic/roughness slot.
+static void PackOcclusionRoughnessMetallic(tinygltf::Model& gltf, const std::string& baseDir, const std::string& name)
+{
+    struct DecodedImage
+    {
+        std::vector<uint8_t> Pixels;
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        bool Valid = false;
+    };
+    std::map<int32_t, DecodedImage> decoded;
+    auto Decode = [&](int32_t image) -> const DecodedImage* {
+        if (image < 0)
+            return nullptr;
+        auto it = decoded.find(image);
+        if (it == decoded.end()) {
+            DecodedImage& d = decoded[image];
+            d.Valid = !IsKTX2Image(gltf.images[image]) && DecodeGltfImage(gltf.images[image], baseDir, d.Pixels, d.Width, d.Height);
+            if (!d.Valid)
+                Utility::Printf("%s: cannot decode image %d for ORM packing\n", name.c_str(), image);
+            it = decoded.find(image);
         }
-        else {
-            // component == 0 -> image.image probably contains compressed file bytes (PNG/JPG)
-            int w = 0, h = 0, comp = 0;
-            unsigned char* rgba = stbi_load_from_memory(image.image.data(), static_cast<int>(image.image.size()), &w, &h, &comp, 4);
-            if (!rgba) return TextureRef(nullptr);
-            TextureRef ref = TextureManager::LoadTexFromMemory(rgba, w, h);
-            stbi_image_free(rgba);
-            return ref;
+        return it->second.Valid ? &it->second : nullptr;
+    };
+
+    // Images referenced by the two slots, for the memory report
+    auto GetUsedImages = [&]() {
+        std::vector<bool> used(gltf.images.size(), false);
+        for (const tinygltf::Material& gm : gltf.materials) {
+            for (int tex : { gm.occlusionTexture.index, gm.pbrMetallicRoughness.metallicRoughnessTexture.index }) {
+                const int32_t image = GetImageIndex(gltf, tex);
+                if (image >= 0) used[image] = true;
+            }
         }
+        return used;
+    };
+    const std::vector<bool> usedBefore = GetUsedImages();
+    std::map<int32_t, uint64_t> texels;
+    uint32_t numPacked = 0;
+
+    // (occlusion image, metallic/roughness image, strength, roughness, metallic) -> ORM texture
+    std::map<std::tuple<int32_t, int32_t, double, double, double>, int> packed;
+    std::vector<uint8_t> occResampled, mrResampled;
+
+    for (tinygltf::Material& gm : gltf.materials) {
+        tinygltf::TextureInfo& mrInfo = gm.pbrMetallicRoughness.metallicRoughnessTexture;
+        tinygltf::OcclusionTextureInfo& occInfo = gm.occlusionTexture;
+        const int32_t mrImage = GetImageIndex(gltf, mrInfo.index);
+        const int32_t occImage = GetImageIndex(gltf, occInfo.index);
+        const double strength = occImage >= 0 ? occInfo.strength : 0.0;
+        const double roughness = gm.pbrMetallicRoughness.roughnessFactor;
+        const double metallic = gm.pbrMetallicRoughness.metallicFactor;
+        if (mrImage >= 0 && mrImage == occImage && strength == 1.0 && roughness == 1.0 && metallic == 1.0)
+            continue;
+        const auto key = std::make_tuple(occImage, mrImage, strength, roughness, metallic);
+
+        auto it = packed.find(key);
+        if (it == packed.end()) {
+            // An image that fails to decode is treated as absent
+            const DecodedImage* occ = Decode(occImage);
+            const DecodedImage* mr = Decode(mrImage);
+            int texture = -1;
+            if (occ != nullptr || mr != nullptr || (occImage < 0 && mrImage < 0)) {
+                const uint32_t width = std::max({ occ ? occ->Width : 0u, mr ? mr->Width : 0u, 1u });
+                const uint32_t height = std::max({ occ ? occ->Height : 0u, mr ? mr->Height : 0u, 1u });
+
+                const uint8_t* occPixels = nullptr;
+                const uint8_t* mrPixels = nullptr;
+                if (occ != nullptr) {
+                    occPixels = occ->Pixels.data();
+                    if (occ->Width != width || occ->Height != height) {
+                        ResampleRGBA8(occPixels, occ->Width, occ->Height, width, height, occResampled);
+                        occPixels = occResampled.data();
+                    }
+                }
+                if (mr != nullptr) {
+                    mrPixels = mr->Pixels.data();
+                    if (mr->Width != width || mr->Height != height) {
+                        ResampleRGBA8(mrPixels, mr->Width, mr->Height, width, height, mrResampled);
+                        mrPixels = mrResampled.data();
+                    }
+                }
+
+                tinygltf::Image image;
+                image.name = gm.name + "_ORM";
+                image.width = (int)width;
+                image.height = (int)height;
+                image.component = 4;
+                image.bits = 8;
+                image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+                image.image.resize((size_t)width * height * 4);
+
+                const float roughnessFactor = (float)std::clamp(roughness, 0.0, 1.0);
+                const float metallicFactor = (float)std::clamp(metallic, 0.0, 1.0);
+                const float occlusionStrength = (float)std::clamp(strength, 0.0, 1.0);
+                for (size_t i = 0; i < (size_t)width * height; ++i) {
+                    uint8_t* dst = &image.image[i * 4];
+                    dst[0] = occPixels ? (uint8_t)(255.0f + occlusionStrength * (occPixels[i * 4] - 255.0f) + 0.5f) : 255;
+                    dst[1] = (uint8_t)((mrPixels ? mrPixels[i * 4 + 1] : 255.0f) * roughnessFactor + 0.5f);
+                    dst[2] = (uint8_t)((mrPixels ? mrPixels[i * 4 + 2] : 255.0f) * metallicFactor + 0.5f);
+                    dst[3] = 255;
+                }
+
+                tinygltf::Texture orm;
+                orm.name = image.name;
+                if (mr != nullptr || occ != nullptr)
+                    orm.sampler = gltf.textures[mr ? mrInfo.index : occInfo.index].sampler;
+                orm.source = (int)gltf.images.size();
+                texels[orm.source] = (uint64_t)width * height;
+                gltf.images.push_back(std::move(image));
+                texture = (int)gltf.textures.size();
+                gltf.textures.push_back(orm);
+                ++numPacked;
+            }
+            it = packed.emplace(key, texture).first;
+        }
+
+        if (it->second < 0)
+            continue;
+        mrInfo.index = it->second;
+        mrInfo.texCoord = 0;
+        occInfo.index = it->second;
+        occInfo.texCoord = 0;
+        occInfo.strength = 1.0;
+    }
+
+    if (numPacked == 0)
+        return;
+
+    for (const auto& entry : decoded)
+        if (entry.second.Valid) texels[entry.first] = (uint64_t)entry.second.Width * entry.second.Height;
+
+    const std::vector<bool> usedAfter = GetUsedImages();
+    uint64_t before = 0, after = 0;
+    for (const auto& entry : texels) {
+        if (entry.first < (int32_t)usedBefore.size() && usedBefore[entry.first]) before += entry.second;
+        if (usedAfter[entry.first]) after += entry.second;
     }
 
-    return TextureRef(nullptr);
+    Utility::Printf("%s: packed occlusion/roughness/metallic into %zu ORM textures, %.1f MB -> %.1f MB of RGBA8 texels\n",
+        name.c_str(), numPacked, before * 4 / 1048576.0, after * 4 / 1048576.0);
 }
 
 // -------------------- Material conversion --------------------
 
-Material ConvertMaterial(const tinygltf::Model& gltf, const tinygltf::Material& gm, const std::string& baseDir)
+Material ConvertMaterial(const tinygltf::Model& gltf, const tinygltf::Material& gm, const std::string& baseDir, bool loadTextures)
 {
     Material mat;
 
@@ -214,45 +452,29 @@ Material ConvertMaterial(const tinygltf::Model& gltf, const tinygltf::Material&
     mat.DoubleSided = gm.doubleSided;
     mat.Name = gm.name;
 
-    // helper to safely get texture -> image
-    auto GetImageFromTextureIndex = [&](int texIdx) -> const tinygltf::Image* {
-        if (texIdx < 0 || texIdx >= (int)gltf.textures.size()) return nullptr;
-        const tinygltf::Texture& t = gltf.textures[texIdx];
-        if (t.source < 0 || t.source >= (int)gltf.images.size()) return nullptr;
-        return &gltf.images[t.source];
-        };
-
-    // Albedo
-    if (gm.pbrMetallicRoughness.baseColorTexture.index >= 0) {
-        if (const tinygltf::Image* img = GetImageFromTextureIndex(gm.pbrMetallicRoughness.baseColorTexture.index))
-            mat.Albedo = LoadGltfImageToTextureRef(*img, baseDir);
-    }
-
-    // MetallicRoughness (single texture: B=metallic, G=roughness)
-    if (gm.pbrMetallicRoughness.metallicRoughnessTexture.index >= 0) {
-        if (const tinygltf::Image* img = GetImageFromTextureIndex(gm.pbrMetallicRoughness.metallicRoughnessTexture.index)) {
-            TextureRef mr = LoadGltfImageToTextureRef(*img, baseDir);
-            mat.Metallic = mr;
-            mat.Roughness = mr;
-        }
-    }
+    mat.SourceImages[kAlbedoTexture] = GetImageIndex(gltf, gm.pbrMetallicRoughness.baseColorTexture.index);
+    mat.SourceImages[kNormalTexture] = GetImageIndex(gltf, gm.normalTexture.index);
+    // After PackOcclusionRoughnessMetallic() the metallic/roughness texture is the ORM texture
+    mat.SourceImages[kORMTexture] = GetImageIndex(gltf, gm.pbrMetallicRoughness.metallicRoughnessTexture.index);
+    mat.SourceImages[kEmissiveTexture] = GetImageIndex(gltf, gm.emissiveTexture.index);
 
-    // Normal
-    if (gm.normalTexture.index >= 0) {
-        if (const tinygltf::Image* img = GetImageFromTextureIndex(gm.normalTexture.index))
-            mat.Normal = LoadGltfImageToTextureRef(*img, baseDir);
-    }
+    if (!loadTextures)
+        return mat;
 
-    // Occlusion
-    if (gm.occlusionTexture.index >= 0) {
-        if (const tinygltf::Image* img = GetImageFromTextureIndex(gm.occlusionTexture.index))
-            mat.Occlusion = LoadGltfImageToTextureRef(*img, baseDir);
-    }
+    for (uint32_t slot = 0; slot < kNumMaterialTextures; ++slot) {
+        const int32_t image = mat.SourceImages[slot];
+        if (image < 0)
+            continue;
+
+        // Slots sharing an image share the texture
+        uint32_t first = 0;
+        while (mat.SourceImages[first] != image)
+            ++first;
 
-    // Emissive
-    if (gm.emissiveTexture.index >= 0) {
-        if (const tinygltf::Image* img = GetImageFromTextureIndex(gm.emissiveTexture.index))
-            mat.Emissive = LoadGltfImageToTextureRef(*img, baseDir);
+        if (first < slot)
+            mat.*s_MaterialTextures[slot] = mat.*s_MaterialTextures[first];
+        else
+            mat.*s_MaterialTextures[slot] = LoadGltfImageToTextureRef(gltf, gltf.images[image], baseDir);
     }
 
     return mat;
@@ -341,12 +563,9 @@ Mesh ConvertMesh(const tinygltf::Model& gltf, const tinygltf::Mesh& gmesh, const
         sub.BaseVertex = baseVertex;
         sub.Bounds = DirectX::BoundingBox(); // optional: compute properly later
 
-        if (prim.material >= 0 && prim.material < (int)gltf.materials.size()) {
-            sub.Material = ConvertMaterial(gltf, gltf.materials[prim.material], baseDir);
-        }
-        else {
-            sub.Material = Material(); // default
-        }
+        // sub.Material is filled from Model::Materials by the caller, so textures are only loaded once
+        if (prim.material >= 0 && prim.material < (int)gltf.materials.size())
+            sub.MaterialIndex = prim.material;
 
         mesh.Submeshes.push_back(std::move(sub));
     }
@@ -355,15 +574,18 @@ Mesh ConvertMesh(const tinygltf::Model& gltf, const tinygltf::Mesh& gmesh, const
     mesh.CPUVertices = std::move(vertices);
     mesh.CPUIndices = std::move(indices);
 
+    if (!mesh.CPUVertices.empty()) {
+        DirectX::BoundingBox::CreateFromPoints(mesh.Bounds, mesh.CPUVertices.size(),
+            reinterpret_cast<const XMFLOAT3*>(&mesh.CPUVertices[0].Position), sizeof(Vertex));
+    }
+
     return mesh;
 }
 
-// -------------------- GPU upload (UPLOAD heap, Map/Unmap) --------------------
+// -------------------- GPU upload (placed in DEFAULT heaps by GpuHeapAllocator, copied through CommandContext::InitializeBuffer) --------------------
 
 void UploadMeshToGPU(Mesh& mesh)
 {
-    ID3D12Device* device = Graphics::g_Device;
-
     mesh.VertexCount = static_cast<uint32_t>(mesh.CPUVertices.size());
     mesh.IndexCount = static_cast<uint32_t>(mesh.CPUIndices.size());
 
@@ -371,21 +593,16 @@ void UploadMeshToGPU(Mesh& mesh)
     const size_t ibSize = mesh.IndexCount * sizeof(uint32_t);
 
     if (vbSize > 0) {
-        ASSERT_SUCCEEDED(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(vbSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
+        ASSERT_SUCCEEDED(GpuHeapAllocator::CreateResource(
+            D3D12_HEAP_TYPE_DEFAULT,
+            CD3DX12_RESOURCE_DESC::Buffer(vbSize),
+            D3D12_RESOURCE_STATE_COMMON,
             nullptr,
-            IID_PPV_ARGS(&mesh.VertexBuffer)));
+            mesh.VertexBuffer.ReleaseAndGetAddressOf()));
+        GpuMemory::Track(mesh.VertexBuffer.Get(), GpuMemoryTracker::kGeometry);
 
-        // map & copy
-        {
-            UINT8* mapped = nullptr;
-            ASSERT_SUCCEEDED(mesh.VertexBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mapped)));
-            memcpy(mapped, mesh.CPUVertices.data(), vbSize);
-            mesh.VertexBuffer->Unmap(0, nullptr);
-        }
+        GpuResource dest(mesh.VertexBuffer.Get(), D3D12_RESOURCE_STATE_COMMON);
+        CommandContext::InitializeBuffer(dest, mesh.CPUVertices.data(), vbSize);
 
         mesh.VBV.BufferLocation = mesh.VertexBuffer->GetGPUVirtualAddress();
         mesh.VBV.SizeInBytes = static_cast<UINT>(vbSize);
@@ -393,20 +610,16 @@ void UploadMeshToGPU(Mesh& mesh)
     }
 
     if (ibSize > 0) {
-        ASSERT_SUCCEEDED(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(ibSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
+        ASSERT_SUCCEEDED(GpuHeapAllocator::CreateResource(
+            D3D12_HEAP_TYPE_DEFAULT,
+            CD3DX12_RESOURCE_DESC::Buffer(ibSize),
+            D3D12_RESOURCE_STATE_COMMON,
             nullptr,
-            IID_PPV_ARGS(&mesh.IndexBuffer)));
+            mesh.IndexBuffer.ReleaseAndGetAddressOf()));
+        GpuMemory::Track(mesh.IndexBuffer.Get(), GpuMemoryTracker::kGeometry);
 
-        {
-            UINT8* mapped = nullptr;
-            ASSERT_SUCCEEDED(mesh.IndexBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mapped)));
-            memcpy(mapped, mesh.CPUIndices.data(), ibSize);
-            mesh.IndexBuffer->Unmap(0, nullptr);
-        }
+        GpuResource dest(mesh.IndexBuffer.Get(), D3D12_RESOURCE_STATE_COMMON);
+        CommandContext::InitializeBuffer(dest, mesh.CPUIndices.data(), ibSize);
 
         mesh.IBV.BufferLocation = mesh.IndexBuffer->GetGPUVirtualAddress();
         mesh.IBV.SizeInBytes = static_cast<UINT>(ibSize);
@@ -414,55 +627,320 @@ void UploadMeshToGPU(Mesh& mesh)
     }
 }
 
+// -------------------- Texture packing --------------------
+
+// Replace the material textures by a few Texture2DArray pages, see TexturePacker.h.  Images that fail to
+// decode are dropped from the materials.
+static void PackMaterialTextures(Model& model, const tinygltf::Model& gltf, const std::string& baseDir)
+{
+    using namespace Graphics;
+
+    const size_t numImages = gltf.images.size();
+
+    std::vector<bool> referenced(numImages, false);
+    for (const Material& mat : model.Materials)
+        for (int32_t image : mat.SourceImages)
+            if (image >= 0) referenced[image] = true;
+
+    // Atlas entries are sampled with clamped UVs, so only images whose every use stays inside [0, 1] qualify.
+    std::vector<bool> wraps(numImages, false);
+    for (const Mesh& mesh : model.Meshes) {
+        for (const Submesh& sub : mesh.Submeshes) {
+            bool inside = true;
+            for (uint32_t i = 0; i < sub.IndexCount && inside; ++i) {
+                const XMFLOAT2& uv = mesh.CPUVertices[mesh.CPUIndices[sub.StartIndex + i]].UV;
+                inside = uv.x >= 0.0f && uv.x <= 1.0f && uv.y >= 0.0f && uv.y <= 1.0f;
+            }
+            if (!inside)
+                for (int32_t image : model.Materials[sub.MaterialIndex].SourceImages)
+                    if (image >= 0) wraps[image] = true;
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> pixels(numImages);
+    std::vector<TexturePacker::Input> inputs;
+    std::vector<int32_t> inputImages;
+    for (size_t image = 0; image < numImages; ++image) {
+        if (!referenced[image])
+            continue;
+
+        TexturePacker::Input input;
+        if (!DecodeGltfImage(gltf.images[image], baseDir, pixels[image], input.Width, input.Height)) {
+            Utility::Printf("%s: failed to decode image %zu, materials using it fall back to constants\n", model.Name.c_str(), image);
+            continue;
+        }
+        input.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        input.AllowAtlas = !wraps[image];
+        inputs.push_back(input);
+        inputImages.push_back((int32_t)image);
+    }
+
+    for (Material& mat : model.Materials)
+        for (int32_t& image : mat.SourceImages)
+            if (image >= 0 && pixels[image].empty()) image = -1;
+
+    const TexturePacker::Settings settings;
+    const TexturePacker::Result layout = TexturePacker::Pack(inputs, settings);
+
+    model.TexturePageLayouts = layout.Pages;
+    model.ImagePlacements.assign(numImages, TexturePacker::Placement());
+    for (size_t i = 0; i < inputs.size(); ++i)
+        model.ImagePlacements[inputImages[i]] = layout.Placements[i];
+
+    model.TexturePages.resize(layout.Pages.size());
+    for (uint32_t pageIndex = 0; pageIndex < (uint32_t)layout.Pages.size(); ++pageIndex) {
+        const TexturePacker::Page& page = layout.Pages[pageIndex];
+
+        // Mip chains of every slice; atlas slices are composed first and then filtered as a whole.
+        std::vector<std::vector<std::vector<uint8_t>>> slices(page.ArraySize);
+        std::vector<std::vector<uint8_t>> canvases(page.IsAtlas ? page.ArraySize : 0);
+        for (std::vector<uint8_t>& canvas : canvases)
+            canvas.resize((size_t)page.Width * page.Height * 4, 0);
+
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            const TexturePacker::Placement& placement = layout.Placements[i];
+            if (placement.Page != pageIndex)
+                continue;
+
+            const std::vector<uint8_t>& src = pixels[inputImages[i]];
+            if (page.IsAtlas)
+                TexturePacker::BlitPadded(src.data(), inputs[i].Width, inputs[i].Height, canvases[placement.Slice].data(),
+                    page.Width, page.Height, placement.X, placement.Y, settings.Padding, 4);
+            else
+                BuildMipChain(src.data(), page.Width, page.Height, slices[placement.Slice]);
+        }
+
+        for (uint32_t slice = 0; slice < (uint32_t)canvases.size(); ++slice) {
+            BuildMipChain(canvases[slice].data(), page.Width, page.Height, slices[slice]);
+            slices[slice].resize(page.MipLevels);
+        }
+
+        std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+        for (uint32_t slice = 0; slice < page.ArraySize; ++slice) {
+            for (uint32_t mip = 0; mip < page.MipLevels; ++mip) {
+                D3D12_SUBRESOURCE_DATA data = {};
+                data.pData = slices[slice][mip].data();
+                data.RowPitch = std::max(1u, page.Width >> mip) * 4;
+                data.SlicePitch = data.RowPitch * std::max(1u, page.Height >> mip);
+                subresources.push_back(data);
+            }
+        }
+
+        ASSERT_SUCCEEDED(GpuHeapAllocator::CreateResource(
+            D3D12_HEAP_TYPE_DEFAULT,
+            CD3DX12_RESOURCE_DESC::Tex2D(page.Format, page.Width, page.Height, (UINT16)page.ArraySize, (UINT16)page.MipLevels),
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            model.TexturePages[pageIndex].ReleaseAndGetAddressOf()));
+        GpuMemory::Track(model.TexturePages[pageIndex].Get(), GpuMemoryTracker::kTextures);
+
+        GpuResource destTexture(model.TexturePages[pageIndex].Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+        CommandContext::InitializeTexture(destTexture, (UINT)subresources.size(), subresources.data());
+    }
+
+    Utility::Printf("%s: packed %zu textures into %zu pages, %.0f%% of the allocated texels used\n",
+        model.Name.c_str(), inputs.size(), layout.Pages.size(), layout.GetEfficiency() * 100.0f);
+}
+
 // -------------------- Material SRV creation --------------------
 
-void Model::CreateMaterialSRVs()
+// The distinct resources a material samples, and optionally where each slot lives: x indexes resources.
+static void GatherMaterialTextures(const Model& model, const Material& mat, std::pmr::vector<ID3D12Resource*>& resources, MaterialConstants* constants)
+{
+    resources.clear();
+
+    for (uint32_t slot = 0; slot < kNumMaterialTextures; ++slot)
+    {
+        ID3D12Resource* resource = nullptr;
+        XMUINT4 location(0, 0, 0, 0);
+        XMFLOAT4 scaleOffset(1.0f, 1.0f, 0.0f, 0.0f);
+
+        if (!model.TexturePages.empty())
+        {
+            const int32_t image = mat.SourceImages[slot];
+            if (image >= 0)
+            {
+                const TexturePacker::Placement& placement = model.ImagePlacements[image];
+                resource = model.TexturePages[placement.Page].Get();
+                location.y = placement.Slice;
+                location.w = model.TexturePageLayouts[placement.Page].IsAtlas ? 1 : 0;
+                scaleOffset = placement.ScaleOffset;
+            }
+        }
+        else if ((mat.*s_MaterialTextures[slot]).IsValid())
+        {
+            resource = const_cast<ID3D12Resource*>((mat.*s_MaterialTextures[slot])->GetResource());
+        }
+
+        if (resource != nullptr)
+        {
+            location.x = (uint32_t)(std::find(resources.begin(), resources.end(), resource) - resources.begin());
+            if (location.x == resources.size())
+                resources.push_back(resource);
+            location.z = 1;
+        }
+
+        if (constants != nullptr)
+        {
+            constants->TextureLocation[slot] = location;
+            constants->TextureScaleOffset[slot] = scaleOffset;
+        }
+    }
+}
+
+// The distinct resources of all the model's materials, in MaterialTextures order.  With constants, also fills one
+// MaterialConstants per material, whose texture locations then index that list.
+static void GatherModelTextures(const Model& model, std::pmr::vector<ID3D12Resource*>& modelResources, MaterialConstants* constants)
+{
+    std::pmr::vector<ID3D12Resource*> resources(FrameAllocator::Get());
+    resources.reserve(kNumMaterialTextures);
+    std::pmr::unordered_map<ID3D12Resource*, uint32_t> entries(FrameAllocator::Get());
+    modelResources.clear();
+
+    for (const Material& mat : model.Materials)
+    {
+        GatherMaterialTextures(model, mat, resources, constants);
+
+        uint32_t modelEntries[kNumMaterialTextures];
+        for (size_t i = 0; i < resources.size(); ++i)
+        {
+            auto inserted = entries.try_emplace(resources[i], (uint32_t)modelResources.size());
+            if (inserted.second)
+                modelResources.push_back(resources[i]);
+            modelEntries[i] = inserted.first->second;
+        }
+
+        if (constants != nullptr)
+        {
+            for (XMUINT4& location : constants->TextureLocation)
+            {
+                if (location.z != 0)
+                    location.x = modelEntries[location.x];
+            }
+            ++constants;
+        }
+    }
+}
+
+// Views the model's textures in a new range of Renderer::s_TextureHeap and points new material constants at it.
+// Frames in flight keep indexing the old range and constants through gMaterialTextures, so those are only handed
+// back, to be reused once the GPU is done with them, never overwritten.
+static void WriteMaterialSRVs(Model& model)
 {
     using namespace Graphics;
-    using namespace Renderer;
 
-    MaterialSRVs.resize(Materials.size());
+    std::vector<MaterialConstants> constants(model.Materials.size());
+    std::pmr::vector<ID3D12Resource*> resources(FrameAllocator::Get());
+    GatherModelTextures(model, resources, constants.data());
 
-    for (size_t i = 0; i < Materials.size(); ++i)
+    DescriptorHandle textures;
+    uint32_t firstSlot = 0;
+    if (!resources.empty())
     {
-        Material& mat = Materials[i];
-
-        std::vector<TextureRef*> texRefs;
-        if (mat.Albedo.IsValid())    texRefs.push_back(&mat.Albedo);
-        if (mat.Normal.IsValid())    texRefs.push_back(&mat.Normal);
-        if (mat.Metallic.IsValid())  texRefs.push_back(&mat.Metallic);
-        if (mat.Roughness.IsValid()) texRefs.push_back(&mat.Roughness);
-        if (mat.Occlusion.IsValid()) texRefs.push_back(&mat.Occlusion);
-        if (mat.Emissive.IsValid())  texRefs.push_back(&mat.Emissive);
-
-        uint32_t texCount = static_cast<uint32_t>(texRefs.size());
-        if (texCount == 0) {
-            MaterialSRVs[i] = DescriptorHandle(); // empty
-            continue;
+        textures = Renderer::s_TextureHeap.Alloc((uint32_t)resources.size());
+        firstSlot = Renderer::s_TextureHeap.GetOffsetOfHandle(textures);
+    }
+
+    for (size_t i = 0; i < model.Materials.size(); ++i)
+    {
+        constants[i].gMatIndex = static_cast<uint32_t>(i);
+        for (XMUINT4& location : constants[i].TextureLocation)
+        {
+            if (location.z != 0)
+                location.x += firstSlot;
         }
+    }
+
+    // Every texture is viewed as an array so packed and unpacked materials share one shader.
+    const uint32_t descriptorSize = Renderer::s_TextureHeap.GetDescriptorSize();
+    D3D12_CPU_DESCRIPTOR_HANDLE dst = textures;
+    for (ID3D12Resource* resource : resources)
+    {
+        const D3D12_RESOURCE_DESC desc = resource->GetDesc();
 
-        MaterialSRVs[i] = Renderer::s_TextureHeap.Alloc(texCount);
-        DescriptorHandle dst = MaterialSRVs[i];
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Format = desc.Format;
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+        srvDesc.Texture2DArray.MipLevels = -1;
+        srvDesc.Texture2DArray.ArraySize = desc.DepthOrArraySize;
 
-        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> src;
-        src.reserve(texCount);
-        for (TextureRef* t : texRefs) src.push_back(t->GetSRV());
+        g_Device->CreateShaderResourceView(resource, &srvDesc, dst);
+        dst.ptr += descriptorSize;
+    }
 
-        Graphics::g_Device->CopyDescriptors(
-            1,
-            &dst,
-            &texCount,
-            texCount,
-            src.data(),
+    Microsoft::WRL::ComPtr<ID3D12Resource> constantsBuffer;
+    if (!constants.empty()) {
+        const size_t cbSize = constants.size() * sizeof(MaterialConstants);
+        ASSERT_SUCCEEDED(g_Device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(cbSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ,
             nullptr,
-            D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
-        );
+            IID_PPV_ARGS(&constantsBuffer)));
+        GpuMemory::Track(constantsBuffer.Get(), GpuMemoryTracker::kOther);
+
+        UINT8* mapped = nullptr;
+        ASSERT_SUCCEEDED(constantsBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mapped)));
+        memcpy(mapped, constants.data(), cbSize);
+        constantsBuffer->Unmap(0, nullptr);
+    }
+
+    model.ReleaseMaterialSRVs();
+    DeferredRelease::Release(model.MaterialConstantsBuffer);
+    model.MaterialTextures = textures;
+    model.MaterialConstantsBuffer = std::move(constantsBuffer);
+}
+
+void Model::CreateMaterialSRVs()
+{
+    WriteMaterialSRVs(*this);
+}
+
+void Model::ReleaseMaterialSRVs()
+{
+    // The heap holds the slots back until the GPU is done with the frames that may still index them.
+    if (!MaterialTextures.IsNull())
+        Renderer::s_TextureHeap.Free(MaterialTextures);
+    MaterialTextures = DescriptorHandle();
+}
+
+void Model::RefreshMaterialSRVs()
+{
+    if (MaterialTextures.IsNull())
+        return;
+
+    WriteMaterialSRVs(*this);
+}
+
+void Model::RequestTextureResolution(const Math::Camera& camera, float viewportHeight)
+{
+    DirectX::BoundingSphere sphere;
+    DirectX::BoundingSphere::CreateFromBoundingBox(sphere, Bounds);
+    sphere.Transform(sphere, m_MeshConstants.ModelMatrix);
+
+    // Assume the UVs map each texture across the model once, so the texture spans roughly the projected
+    // diameter.  Inside the bounds, ask for full detail.
+    const float distance = Length(Vector3(XMLoadFloat3(&sphere.Center)) - camera.GetPosition());
+    float screenPixels = FLT_MAX;
+    if (distance > sphere.Radius)
+        screenPixels = sphere.Radius / (distance * tanf(camera.GetFOV() * 0.5f)) * viewportHeight;
+
+    const float priority = std::min(screenPixels, viewportHeight) / viewportHeight;
+
+    for (const Material& mat : Materials)
+    {
+        mat.Albedo.RequestResolution(screenPixels, priority);
+        mat.Normal.RequestResolution(screenPixels, priority);
+        mat.ORM.RequestResolution(screenPixels, priority);
+        mat.Emissive.RequestResolution(screenPixels, priority);
     }
 }
 
 // -------------------- Top-level loader --------------------
 
-Model LoadGltfModel(const std::string& path)
+Model LoadGltfModel(const std::string& path, bool packTextures)
 {
     tinygltf::Model gltf;
     tinygltf::TinyGLTF loader;
@@ -486,11 +964,26 @@ Model LoadGltfModel(const std::string& path)
     Model model;
     model.Name = path;
 
-    // Convert materials first (so textures are created and ready)
+    // All textures and buffers of the model go into one command list instead of one GPU round trip each.
+    // A caller that is batching already keeps its batch.
+    UploadBatch uploads(L"glTF Upload");
+    UploadBatch::Scope uploadScope(UploadBatch::GetCurrent() != nullptr ? *UploadBatch::GetCurrent() : uploads);
+
+    // KTX2 images are usually block compressed already and cannot go into the RGBA8 pages
+    for (const tinygltf::Image& image : gltf.images) {
+        if (packTextures && IsKTX2Image(image)) {
+            Utility::Printf("%s: uses KTX2 images, textures are not packed\n", path.c_str());
+            packTextures = false;
+        }
+    }
+
+    PackOcclusionRoughnessMetallic(gltf, baseDir, path);
+
+    // Convert materials first (so textures are created and ready).  Packed textures are created below instead.
     model.Materials.clear();
-    model.Materials.reserve(gltf.materials.size());
+    model.Materials.reserve(gltf.materials.size() + 1);
     for (const auto& gm : gltf.materials) {
-        model.Materials.push_back(ConvertMaterial(gltf, gm, baseDir));
+        model.Materials.push_back(ConvertMaterial(gltf, gm, baseDir, !packTextures));
     }
 
     // Meshes
@@ -498,9 +991,29 @@ Model LoadGltfModel(const std::string& path)
     for (const auto& gmesh : gltf.meshes) {
         Mesh m = ConvertMesh(gltf, gmesh, baseDir);
         UploadMeshToGPU(m);
+        if (model.Meshes.empty())
+            model.Bounds = m.Bounds;
+        else
+            DirectX::BoundingBox::CreateMerged(model.Bounds, model.Bounds, m.Bounds);
         model.Meshes.push_back(std::move(m));
     }
 
+    // Submeshes without a material draw with a default one, so every draw has material constants to bind.
+    // Submesh::Material is a copy sharing the textures loaded above.
+    for (Mesh& mesh : model.Meshes) {
+        for (Submesh& sub : mesh.Submeshes) {
+            if (sub.MaterialIndex < 0) {
+                if (model.Materials.size() == gltf.materials.size())
+                    model.Materials.push_back(Material());
+                sub.MaterialIndex = static_cast<int32_t>(gltf.materials.size());
+            }
+            sub.Material = model.Materials[sub.MaterialIndex];
+        }
+    }
+
+    if (packTextures)
+        PackMaterialTextures(model, gltf, baseDir);
+
     // Optional: create descriptor blocks for all materials
     model.CreateMaterialSRVs();
 
@@ -510,14 +1023,20 @@ void Model::Draw(ID3D12GraphicsCommandList* cmdList, bool isSkyBox)
 {
     for (uint32_t meshIndex = 0; meshIndex < Meshes.size(); meshIndex++)
     {
-        if(!isSkyBox)
-        cmdList->SetGraphicsRootDescriptorTable(Renderer::kMaterialSRVs, MaterialSRVs[meshIndex]);
-
-
         cmdList->IASetVertexBuffers(0, 1, &Meshes[meshIndex].VBV);
         cmdList->IASetIndexBuffer(&Meshes[meshIndex].IBV);
         cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        cmdList->DrawIndexedInstanced(Meshes[meshIndex].CPUIndices.size(), 1, 0, 0, 0);
+
+        for (const Submesh& sub : Meshes[meshIndex].Submeshes)
+        {
+            if (!isSkyBox)
+            {
+                cmdList->SetGraphicsRootConstantBufferView(Renderer::kMaterialConstants,
+                    MaterialConstantsBuffer->GetGPUVirtualAddress() + sub.MaterialIndex * sizeof(MaterialConstants));
+            }
+
+            cmdList->DrawIndexedInstanced(sub.IndexCount, 1, sub.StartIndex, 0, 0);
+        }
     }
 }
 
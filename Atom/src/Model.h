@@ -5,6 +5,10 @@
 #include "Math/Vector.h"
 #include "DescriptorHeap.h"
 #include "TextureManager.h"
+#include "TexturePacker.h"
+#include "ConstantBuffers.h"
+
+namespace Math { class Camera; }
 
 using namespace DirectX;
 using namespace Math;
@@ -35,9 +39,7 @@ struct Material
 {
 	TextureRef Albedo;
 	TextureRef Normal;
-	TextureRef Metallic;
-	TextureRef Roughness;
-	TextureRef Occlusion;
+	TextureRef ORM;         // occlusion, roughness, metallic packed at import, see LoadGltfModel()
 	TextureRef Emissive;
 
 
@@ -53,6 +55,9 @@ struct Material
 
 	uint32_t PipelineStateID = 0;
 	std::string Name;
+
+	// glTF image behind each MaterialTextureSlot, -1 if none
+	int32_t SourceImages[kNumMaterialTextures] = { -1, -1, -1, -1 };
 };
 
 struct Submesh
@@ -63,6 +68,7 @@ struct Submesh
 
 	BoundingBox Bounds;
 
+	int32_t MaterialIndex = -1;
 	Material Material;
 };
 
@@ -143,7 +149,15 @@ struct Model
 {
 	std::vector<Mesh> Meshes;
 	std::vector<struct Material> Materials;
-	std::vector<DescriptorHandle> MaterialSRVs;
+	// Views of the distinct textures of all materials, in Renderer::s_TextureHeap.  Shaders see the whole heap
+	// as one table, and MaterialConstants::TextureLocation holds heap indices, so no table is bound per draw.
+	DescriptorHandle MaterialTextures;
+	Microsoft::WRL::ComPtr<ID3D12Resource> MaterialConstantsBuffer;
+	// Packed material textures, empty unless the model was loaded with packTextures.  ImagePlacements is
+	// indexed by glTF image.
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> TexturePages;
+	std::vector<TexturePacker::Page> TexturePageLayouts;
+	std::vector<TexturePacker::Placement> ImagePlacements;
 	std::vector<Node> Nodes;
 	std::vector<Skin> Skins;
 	std::vector<Animation> Animations;
@@ -151,6 +165,12 @@ struct Model
 	std::string Name;
 
 	void CreateMaterialSRVs();
+	// Returns MaterialTextures to Renderer::s_TextureHeap.  Not done on destruction, as models are copied.
+	void ReleaseMaterialSRVs();
+	// Recreate the material SRVs in a new range, e.g. after TextureManager::UpdateStreaming().
+	void RefreshMaterialSRVs();
+	// Report the on-screen size of the model's textures to the streamer.
+	void RequestTextureResolution(const Math::Camera& camera, float viewportHeight);
 	void Draw(ID3D12GraphicsCommandList* cmdList, bool isSkyBox = false);
 
 	void UpdateConstants()
@@ -174,9 +194,13 @@ struct Model
 };
 void UploadMeshToGPU(Mesh& mesh);
 
-Model LoadGltfModel(const std::string& path);
+// Occlusion and metallic/roughness images are always merged into one ORM image per material first.
+// packTextures packs the material textures into Texture2DArray pages (see TexturePacker.h).  Packed textures
+// are not streamed; pass false to keep one streamed texture per image.
+Model LoadGltfModel(const std::string& path, bool packTextures = true);
 
 Material ConvertMaterial(
 	const tinygltf::Model& gltf,
 	const tinygltf::Material& gm,
-	const std::string& baseDir);
+	const std::string& baseDir,
+	bool loadTextures = true);
@@ -0,0 +1,462 @@
+#include "pch.h"
+#include "PackedHDR.h"
+#include <cstring>
+#include <immintrin.h>
+#include <intrin.h>
+
+namespace
+{
+	// Same constants as Color::R11G11B10F() and Color::R9G9B9E5().
+	const uint32_t kR11MaxBits = 0x47800000;    // 2^16, rounds to the infinity encoding
+	const uint32_t kR11ScaleBits = 0x07800000;  // 2^-112 rebiases the exponent from 127 to 15
+	const uint32_t kR11UnscaleBits = 0x77800000;  // 2^112
+	const uint32_t kSEMaxBits = 0x477F8000;     // 1.FF * 2^15, largest RGB9E5 value
+	const uint32_t kSEMinBits = 0x37800000;     // 2^-16, floor for the shared exponent
+
+	float AsFloat(uint32_t u)
+	{
+		float f;
+		memcpy(&f, &u, sizeof(f));
+		return f;
+	}
+
+	uint32_t AsUint(float f)
+	{
+		uint32_t u;
+		memcpy(&u, &f, sizeof(u));
+		return u;
+	}
+
+	// NaN fails both comparisons and ends up as 0, like Math::Clamp().
+	float ClampChannel(float v, uint32_t maxBits)
+	{
+		v = v > 0.0f ? v : 0.0f;
+		const float maxVal = AsFloat(maxBits);
+		return v < maxVal ? v : maxVal;
+	}
+
+	uint32_t EncodeR11G11B10FScalar(const float* rgba)
+	{
+		const float scale = AsFloat(kR11ScaleBits);
+		uint32_t r = AsUint(ClampChannel(rgba[0], kR11MaxBits) * scale);
+		uint32_t g = AsUint(ClampChannel(rgba[1], kR11MaxBits) * scale);
+		uint32_t b = AsUint(ClampChannel(rgba[2], kR11MaxBits) * scale);
+
+		r += 0x0FFFF + ((r >> 16) & 1);
+		g += 0x0FFFF + ((g >> 16) & 1);
+		b += 0x1FFFF + ((b >> 17) & 1);
+
+		r &= 0x0FFE0000;
+		g &= 0x0FFE0000;
+		b &= 0x0FFC0000;
+		return r >> 17 | g >> 6 | b << 4;
+	}
+
+	uint32_t EncodeRGB9E5Scalar(const float* rgba)
+	{
+		const float r = ClampChannel(rgba[0], kSEMaxBits);
+		const float g = ClampChannel(rgba[1], kSEMaxBits);
+		const float b = ClampChannel(rgba[2], kSEMaxBits);
+		const float minVal = AsFloat(kSEMinBits);
+		const float maxRG = r > g ? r : g;
+		const float maxB = b > minVal ? b : minVal;
+		const float maxChannel = maxRG > maxB ? maxRG : maxB;
+
+		// Exponent of the largest channel after rounding it to 9 bits, plus 15.  Adding 2^(e + 15) to every
+		// channel leaves its rounded 9 bit mantissa in the low bits.
+		const uint32_t bias = (AsUint(maxChannel) + 0x07804000) & 0x7F800000;
+		const uint32_t rBits = AsUint(r + AsFloat(bias));
+		const uint32_t gBits = AsUint(g + AsFloat(bias));
+		const uint32_t bBits = AsUint(b + AsFloat(bias));
+		const uint32_t exponent = (bias << 4) + 0x10000000;
+		return exponent | bBits << 18 | gBits << 9 | (rBits & 511);
+	}
+
+	float DecodeFloat11(uint32_t bits, uint32_t shift)
+	{
+		// Exponent and mantissa go to the top of a float's, scaling by 2^112 fixes the bias and denormals.
+		const uint32_t expMask = 0x1Fu << 23;
+		const uint32_t f = bits << shift;
+		if ((f & expMask) == expMask)
+			return AsFloat(0x7F800000 | f);
+		return AsFloat(f) * AsFloat(kR11UnscaleBits);
+	}
+
+	void DecodeR11G11B10FScalar(uint32_t packed, float* rgba)
+	{
+		rgba[0] = DecodeFloat11(packed & 0x7FF, 17);
+		rgba[1] = DecodeFloat11((packed >> 11) & 0x7FF, 17);
+		rgba[2] = DecodeFloat11(packed >> 22, 18);
+		rgba[3] = 1.0f;
+	}
+
+	void DecodeRGB9E5Scalar(uint32_t packed, float* rgba)
+	{
+		// 2^(e - 15 - 9)
+		const float scale = AsFloat(((packed >> 27) + 127 - 24) << 23);
+		rgba[0] = (float)(packed & 511) * scale;
+		rgba[1] = (float)((packed >> 9) & 511) * scale;
+		rgba[2] = (float)((packed >> 18) & 511) * scale;
+		rgba[3] = 1.0f;
+	}
+
+	// SSE4.1, 4 texels at a time.
+
+	void EncodeR11G11B10FSSE41(const float* rgba, uint32_t* packed, size_t count)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 maxVal = _mm_castsi128_ps(_mm_set1_epi32(kR11MaxBits));
+		const __m128 scale = _mm_castsi128_ps(_mm_set1_epi32(kR11ScaleBits));
+		const __m128i one = _mm_set1_epi32(1);
+		const __m128i round6 = _mm_set1_epi32(0x0FFFF);
+		const __m128i round5 = _mm_set1_epi32(0x1FFFF);
+		const __m128i mask6 = _mm_set1_epi32(0x0FFE0000);
+		const __m128i mask5 = _mm_set1_epi32(0x0FFC0000);
+
+		for (size_t i = 0; i + 4 <= count; i += 4, rgba += 16, packed += 4)
+		{
+			__m128 r = _mm_loadu_ps(rgba);
+			__m128 g = _mm_loadu_ps(rgba + 4);
+			__m128 b = _mm_loadu_ps(rgba + 8);
+			__m128 a = _mm_loadu_ps(rgba + 12);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+
+			// max(v, 0) returns 0 for NaN, the same as the scalar compare.
+			__m128i ri = _mm_castps_si128(_mm_mul_ps(_mm_min_ps(_mm_max_ps(r, zero), maxVal), scale));
+			__m128i gi = _mm_castps_si128(_mm_mul_ps(_mm_min_ps(_mm_max_ps(g, zero), maxVal), scale));
+			__m128i bi = _mm_castps_si128(_mm_mul_ps(_mm_min_ps(_mm_max_ps(b, zero), maxVal), scale));
+
+			ri = _mm_add_epi32(ri, _mm_add_epi32(round6, _mm_and_si128(_mm_srli_epi32(ri, 16), one)));
+			gi = _mm_add_epi32(gi, _mm_add_epi32(round6, _mm_and_si128(_mm_srli_epi32(gi, 16), one)));
+			bi = _mm_add_epi32(bi, _mm_add_epi32(round5, _mm_and_si128(_mm_srli_epi32(bi, 17), one)));
+
+			ri = _mm_srli_epi32(_mm_and_si128(ri, mask6), 17);
+			gi = _mm_srli_epi32(_mm_and_si128(gi, mask6), 6);
+			bi = _mm_slli_epi32(_mm_and_si128(bi, mask5), 4);
+			_mm_storeu_si128((__m128i*)packed, _mm_or_si128(_mm_or_si128(ri, gi), bi));
+		}
+	}
+
+	void EncodeRGB9E5SSE41(const float* rgba, uint32_t* packed, size_t count)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 maxVal = _mm_castsi128_ps(_mm_set1_epi32(kSEMaxBits));
+		const __m128 minVal = _mm_castsi128_ps(_mm_set1_epi32(kSEMinBits));
+		const __m128i biasRound = _mm_set1_epi32(0x07804000);
+		const __m128i expMask = _mm_set1_epi32(0x7F800000);
+		const __m128i expBias = _mm_set1_epi32(0x10000000);
+		const __m128i mantissaMask = _mm_set1_epi32(511);
+
+		for (size_t i = 0; i + 4 <= count; i += 4, rgba += 16, packed += 4)
+		{
+			__m128 r = _mm_loadu_ps(rgba);
+			__m128 g = _mm_loadu_ps(rgba + 4);
+			__m128 b = _mm_loadu_ps(rgba + 8);
+			__m128 a = _mm_loadu_ps(rgba + 12);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+
+			r = _mm_min_ps(_mm_max_ps(r, zero), maxVal);
+			g = _mm_min_ps(_mm_max_ps(g, zero), maxVal);
+			b = _mm_min_ps(_mm_max_ps(b, zero), maxVal);
+			const __m128 maxChannel = _mm_max_ps(_mm_max_ps(r, g), _mm_max_ps(b, minVal));
+
+			const __m128i bias = _mm_and_si128(_mm_add_epi32(_mm_castps_si128(maxChannel), biasRound), expMask);
+			const __m128i ri = _mm_castps_si128(_mm_add_ps(r, _mm_castsi128_ps(bias)));
+			const __m128i gi = _mm_castps_si128(_mm_add_ps(g, _mm_castsi128_ps(bias)));
+			const __m128i bi = _mm_castps_si128(_mm_add_ps(b, _mm_castsi128_ps(bias)));
+			const __m128i exponent = _mm_add_epi32(_mm_slli_epi32(bias, 4), expBias);
+
+			__m128i result = _mm_or_si128(exponent, _mm_slli_epi32(bi, 18));
+			result = _mm_or_si128(result, _mm_slli_epi32(gi, 9));
+			result = _mm_or_si128(result, _mm_and_si128(ri, mantissaMask));
+			_mm_storeu_si128((__m128i*)packed, result);
+		}
+	}
+
+	__m128 DecodeFloat11SSE41(__m128i bits, int shift)
+	{
+		const __m128i expMask = _mm_set1_epi32(0x1F << 23);
+		const __m128i f = _mm_sll_epi32(bits, _mm_cvtsi32_si128(shift));
+		const __m128 finite = _mm_mul_ps(_mm_castsi128_ps(f), _mm_castsi128_ps(_mm_set1_epi32(kR11UnscaleBits)));
+		const __m128 special = _mm_castsi128_ps(_mm_or_si128(f, _mm_set1_epi32(0x7F800000)));
+		const __m128 isSpecial = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(f, expMask), expMask));
+		return _mm_blendv_ps(finite, special, isSpecial);
+	}
+
+	void StoreTexelsSSE41(__m128 r, __m128 g, __m128 b, float* rgba)
+	{
+		__m128 a = _mm_set1_ps(1.0f);
+		_MM_TRANSPOSE4_PS(r, g, b, a);
+		_mm_storeu_ps(rgba, r);
+		_mm_storeu_ps(rgba + 4, g);
+		_mm_storeu_ps(rgba + 8, b);
+		_mm_storeu_ps(rgba + 12, a);
+	}
+
+	void DecodeR11G11B10FSSE41(const uint32_t* packed, float* rgba, size_t count)
+	{
+		const __m128i mask11 = _mm_set1_epi32(0x7FF);
+		for (size_t i = 0; i + 4 <= count; i += 4, packed += 4, rgba += 16)
+		{
+			const __m128i p = _mm_loadu_si128((const __m128i*)packed);
+			StoreTexelsSSE41(
+				DecodeFloat11SSE41(_mm_and_si128(p, mask11), 17),
+				DecodeFloat11SSE41(_mm_and_si128(_mm_srli_epi32(p, 11), mask11), 17),
+				DecodeFloat11SSE41(_mm_srli_epi32(p, 22), 18),
+				rgba);
+		}
+	}
+
+	void DecodeRGB9E5SSE41(const uint32_t* packed, float* rgba, size_t count)
+	{
+		const __m128i mask9 = _mm_set1_epi32(511);
+		const __m128i expBias = _mm_set1_epi32(127 - 24);
+		for (size_t i = 0; i + 4 <= count; i += 4, packed += 4, rgba += 16)
+		{
+			const __m128i p = _mm_loadu_si128((const __m128i*)packed);
+			const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_srli_epi32(p, 27), expBias), 23));
+			StoreTexelsSSE41(
+				_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(p, mask9)), scale),
+				_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 9), mask9)), scale),
+				_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 18), mask9)), scale),
+				rgba);
+		}
+	}
+
+	// AVX2, 8 texels at a time.  Texels i and i + 4 share a register so the 4x4 transposes stay within lanes
+	// and the packed results come out in order.
+
+	void LoadTexelsAVX2(const float* rgba, __m256& r, __m256& g, __m256& b)
+	{
+		const __m256 t0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(rgba)), _mm_loadu_ps(rgba + 16), 1);
+		const __m256 t1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(rgba + 4)), _mm_loadu_ps(rgba + 20), 1);
+		const __m256 t2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(rgba + 8)), _mm_loadu_ps(rgba + 24), 1);
+		const __m256 t3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(rgba + 12)), _mm_loadu_ps(rgba + 28), 1);
+		const __m256 rg01 = _mm256_unpacklo_ps(t0, t1);
+		const __m256 rg23 = _mm256_unpacklo_ps(t2, t3);
+		const __m256 ba01 = _mm256_unpackhi_ps(t0, t1);
+		const __m256 ba23 = _mm256_unpackhi_ps(t2, t3);
+		r = _mm256_shuffle_ps(rg01, rg23, _MM_SHUFFLE(1, 0, 1, 0));
+		g = _mm256_shuffle_ps(rg01, rg23, _MM_SHUFFLE(3, 2, 3, 2));
+		b = _mm256_shuffle_ps(ba01, ba23, _MM_SHUFFLE(1, 0, 1, 0));
+	}
+
+	void StoreTexelsAVX2(__m256 r, __m256 g, __m256 b, float* rgba)
+	{
+		const __m256 a = _mm256_set1_ps(1.0f);
+		const __m256 rg01 = _mm256_unpacklo_ps(r, g);
+		const __m256 ba01 = _mm256_unpacklo_ps(b, a);
+		const __m256 rg23 = _mm256_unpackhi_ps(r, g);
+		const __m256 ba23 = _mm256_unpackhi_ps(b, a);
+		const __m256 t0 = _mm256_shuffle_ps(rg01, ba01, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 t1 = _mm256_shuffle_ps(rg01, ba01, _MM_SHUFFLE(3, 2, 3, 2));
+		const __m256 t2 = _mm256_shuffle_ps(rg23, ba23, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 t3 = _mm256_shuffle_ps(rg23, ba23, _MM_SHUFFLE(3, 2, 3, 2));
+		_mm_storeu_ps(rgba, _mm256_castps256_ps128(t0));
+		_mm_storeu_ps(rgba + 4, _mm256_castps256_ps128(t1));
+		_mm_storeu_ps(rgba + 8, _mm256_castps256_ps128(t2));
+		_mm_storeu_ps(rgba + 12, _mm256_castps256_ps128(t3));
+		_mm_storeu_ps(rgba + 16, _mm256_extractf128_ps(t0, 1));
+		_mm_storeu_ps(rgba + 20, _mm256_extractf128_ps(t1, 1));
+		_mm_storeu_ps(rgba + 24, _mm256_extractf128_ps(t2, 1));
+		_mm_storeu_ps(rgba + 28, _mm256_extractf128_ps(t3, 1));
+	}
+
+	void EncodeR11G11B10FAVX2(const float* rgba, uint32_t* packed, size_t count)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 maxVal = _mm256_castsi256_ps(_mm256_set1_epi32(kR11MaxBits));
+		const __m256 scale = _mm256_castsi256_ps(_mm256_set1_epi32(kR11ScaleBits));
+		const __m256i one = _mm256_set1_epi32(1);
+		const __m256i round6 = _mm256_set1_epi32(0x0FFFF);
+		const __m256i round5 = _mm256_set1_epi32(0x1FFFF);
+		const __m256i mask6 = _mm256_set1_epi32(0x0FFE0000);
+		const __m256i mask5 = _mm256_set1_epi32(0x0FFC0000);
+
+		for (size_t i = 0; i + 8 <= count; i += 8, rgba += 32, packed += 8)
+		{
+			__m256 r, g, b;
+			LoadTexelsAVX2(rgba, r, g, b);
+
+			__m256i ri = _mm256_castps_si256(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(r, zero), maxVal), scale));
+			__m256i gi = _mm256_castps_si256(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(g, zero), maxVal), scale));
+			__m256i bi = _mm256_castps_si256(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(b, zero), maxVal), scale));
+
+			ri = _mm256_add_epi32(ri, _mm256_add_epi32(round6, _mm256_and_si256(_mm256_srli_epi32(ri, 16), one)));
+			gi = _mm256_add_epi32(gi, _mm256_add_epi32(round6, _mm256_and_si256(_mm256_srli_epi32(gi, 16), one)));
+			bi = _mm256_add_epi32(bi, _mm256_add_epi32(round5, _mm256_and_si256(_mm256_srli_epi32(bi, 17), one)));
+
+			ri = _mm256_srli_epi32(_mm256_and_si256(ri, mask6), 17);
+			gi = _mm256_srli_epi32(_mm256_and_si256(gi, mask6), 6);
+			bi = _mm256_slli_epi32(_mm256_and_si256(bi, mask5), 4);
+			_mm256_storeu_si256((__m256i*)packed, _mm256_or_si256(_mm256_or_si256(ri, gi), bi));
+		}
+	}
+
+	void EncodeRGB9E5AVX2(const float* rgba, uint32_t* packed, size_t count)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 maxVal = _mm256_castsi256_ps(_mm256_set1_epi32(kSEMaxBits));
+		const __m256 minVal = _mm256_castsi256_ps(_mm256_set1_epi32(kSEMinBits));
+		const __m256i biasRound = _mm256_set1_epi32(0x07804000);
+		const __m256i expMask = _mm256_set1_epi32(0x7F800000);
+		const __m256i expBias = _mm256_set1_epi32(0x10000000);
+		const __m256i mantissaMask = _mm256_set1_epi32(511);
+
+		for (size_t i = 0; i + 8 <= count; i += 8, rgba += 32, packed += 8)
+		{
+			__m256 r, g, b;
+			LoadTexelsAVX2(rgba, r, g, b);
+
+			r = _mm256_min_ps(_mm256_max_ps(r, zero), maxVal);
+			g = _mm256_min_ps(_mm256_max_ps(g, zero), maxVal);
+			b = _mm256_min_ps(_mm256_max_ps(b, zero), maxVal);
+			const __m256 maxChannel = _mm256_max_ps(_mm256_max_ps(r, g), _mm256_max_ps(b, minVal));
+
+			const __m256i bias = _mm256_and_si256(_mm256_add_epi32(_mm256_castps_si256(maxChannel), biasRound), expMask);
+			const __m256i ri = _mm256_castps_si256(_mm256_add_ps(r, _mm256_castsi256_ps(bias)));
+			const __m256i gi = _mm256_castps_si256(_mm256_add_ps(g, _mm256_castsi256_ps(bias)));
+			const __m256i bi = _mm256_castps_si256(_mm256_add_ps(b, _mm256_castsi256_ps(bias)));
+			const __m256i exponent = _mm256_add_epi32(_mm256_slli_epi32(bias, 4), expBias);
+
+			__m256i result = _mm256_or_si256(exponent, _mm256_slli_epi32(bi, 18));
+			result = _mm256_or_si256(result, _mm256_slli_epi32(gi, 9));
+			result = _mm256_or_si256(result, _mm256_and_si256(ri, mantissaMask));
+			_mm256_storeu_si256((__m256i*)packed, result);
+		}
+	}
+
+	__m256 DecodeFloat11AVX2(__m256i bits, int shift)
+	{
+		const __m256i expMask = _mm256_set1_epi32(0x1F << 23);
+		const __m256i f = _mm256_sll_epi32(bits, _mm_cvtsi32_si128(shift));
+		const __m256 finite = _mm256_mul_ps(_mm256_castsi256_ps(f), _mm256_castsi256_ps(_mm256_set1_epi32(kR11UnscaleBits)));
+		const __m256 special = _mm256_castsi256_ps(_mm256_or_si256(f, _mm256_set1_epi32(0x7F800000)));
+		const __m256 isSpecial = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(f, expMask), expMask));
+		return _mm256_blendv_ps(finite, special, isSpecial);
+	}
+
+	void DecodeR11G11B10FAVX2(const uint32_t* packed, float* rgba, size_t count)
+	{
+		const __m256i mask11 = _mm256_set1_epi32(0x7FF);
+		for (size_t i = 0; i + 8 <= count; i += 8, packed += 8, rgba += 32)
+		{
+			// Texels i..i+3 in the low lane and i+4..i+7 in the high lane, as StoreTexelsAVX2() expects.
+			const __m256i p = _mm256_loadu_si256((const __m256i*)packed);
+			StoreTexelsAVX2(
+				DecodeFloat11AVX2(_mm256_and_si256(p, mask11), 17),
+				DecodeFloat11AVX2(_mm256_and_si256(_mm256_srli_epi32(p, 11), mask11), 17),
+				DecodeFloat11AVX2(_mm256_srli_epi32(p, 22), 18),
+				rgba);
+		}
+	}
+
+	void DecodeRGB9E5AVX2(const uint32_t* packed, float* rgba, size_t count)
+	{
+		const __m256i mask9 = _mm256_set1_epi32(511);
+		const __m256i expBias = _mm256_set1_epi32(127 - 24);
+		for (size_t i = 0; i + 8 <= count; i += 8, packed += 8, rgba += 32)
+		{
+			const __m256i p = _mm256_loadu_si256((const __m256i*)packed);
+			const __m256 scale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_srli_epi32(p, 27), expBias), 23));
+			StoreTexelsAVX2(
+				_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(p, mask9)), scale),
+				_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(p, 9), mask9)), scale),
+				_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(p, 18), mask9)), scale),
+				rgba);
+		}
+	}
+
+	struct CpuFeatures
+	{
+		bool SSE41 = false;
+		bool AVX2 = false;
+
+		CpuFeatures()
+		{
+			int info[4];
+			__cpuid(info, 0);
+			const int maxLeaf = info[0];
+
+			__cpuid(info, 1);
+			SSE41 = (info[2] & (1 << 19)) != 0;
+
+			// AVX also needs the OS to save the upper halves of the registers (OSXSAVE and XCR0 bits 1 and 2).
+			const bool osAVX = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+			if (osAVX && maxLeaf >= 7)
+			{
+				__cpuidex(info, 7, 0);
+				AVX2 = (info[1] & (1 << 5)) != 0;
+			}
+		}
+	};
+
+	PackedHDR::Path Resolve(PackedHDR::Path path)
+	{
+		static const CpuFeatures s_Features;
+		if (path == PackedHDR::Path::Auto)
+			return s_Features.AVX2 ? PackedHDR::Path::AVX2 : s_Features.SSE41 ? PackedHDR::Path::SSE41 : PackedHDR::Path::Scalar;
+
+		ASSERT(PackedHDR::IsSupported(path), "Requested SIMD path is not supported by this CPU");
+		return path;
+	}
+
+	// Runs the SIMD kernel on whole groups and the scalar one on the remainder.
+	template <typename Src, typename Dst, typename Scalar, typename Kernel>
+	void Dispatch(const Src* src, Dst* dst, size_t count, uint32_t srcStride, uint32_t dstStride, size_t groupSize,
+		Kernel&& kernel, Scalar&& scalar)
+	{
+		const size_t simdCount = groupSize > 1 ? count / groupSize * groupSize : 0;
+		if (simdCount > 0)
+			kernel(src, dst, simdCount);
+		for (size_t i = simdCount; i < count; ++i)
+			scalar(src + i * srcStride, dst + i * dstStride);
+	}
+
+	size_t GroupSize(PackedHDR::Path path)
+	{
+		return path == PackedHDR::Path::AVX2 ? 8 : path == PackedHDR::Path::SSE41 ? 4 : 1;
+	}
+}
+
+bool PackedHDR::IsSupported(Path path)
+{
+	switch (path)
+	{
+	case Path::SSE41: return Resolve(Path::Auto) != Path::Scalar;
+	case Path::AVX2:  return Resolve(Path::Auto) == Path::AVX2;
+	default:          return true;
+	}
+}
+
+void PackedHDR::EncodeR11G11B10F(const float* rgba, uint32_t* packed, size_t count, Path path)
+{
+	path = Resolve(path);
+	Dispatch(rgba, packed, count, 4, 1, GroupSize(path),
+		path == Path::AVX2 ? EncodeR11G11B10FAVX2 : EncodeR11G11B10FSSE41,
+		[](const float* src, uint32_t* dst) { *dst = EncodeR11G11B10FScalar(src); });
+}
+
+void PackedHDR::EncodeRGB9E5(const float* rgba, uint32_t* packed, size_t count, Path path)
+{
+	path = Resolve(path);
+	Dispatch(rgba, packed, count, 4, 1, GroupSize(path),
+		path == Path::AVX2 ? EncodeRGB9E5AVX2 : EncodeRGB9E5SSE41,
+		[](const float* src, uint32_t* dst) { *dst = EncodeRGB9E5Scalar(src); });
+}
+
+void PackedHDR::DecodeR11G11B10F(const uint32_t* packed, float* rgba, size_t count, Path path)
+{
+	path = Resolve(path);
+	Dispatch(packed, rgba, count, 1, 4, GroupSize(path),
+		path == Path::AVX2 ? DecodeR11G11B10FAVX2 : DecodeR11G11B10FSSE41,
+		[](const uint32_t* src, float* dst) { DecodeR11G11B10FScalar(*src, dst); });
+}
+
+void PackedHDR::DecodeRGB9E5(const uint32_t* packed, float* rgba, size_t count, Path path)
+{
+	path = Resolve(path);
+	Dispatch(packed, rgba, count, 1, 4, GroupSize(path),
+		path == Path::AVX2 ? DecodeRGB9E5AVX2 : DecodeRGB9E5SSE41,
+		[](const uint32_t* src, float* dst) { DecodeRGB9E5Scalar(*src, dst); });
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Batch conversion between RGBA32F texels and the 32 bit HDR formats DXGI_FORMAT_R11G11B10_FLOAT and
+// DXGI_FORMAT_R9G9B9E5_SHAREDEXP.  Encoding matches Color::R11G11B10F(true) and Color::R9G9B9E5() bit for
+// bit: round to nearest even, negative values and NaN become 0, values past the largest finite R11G11B10F
+// round to infinity and RGB9E5 clamps to its maximum.  Alpha is ignored when encoding and decodes to 1.
+//
+// The SIMD paths handle 4 (SSE4.1) or 8 (AVX2) texels per iteration and are picked at run time.
+namespace PackedHDR
+{
+	enum class Path
+	{
+		Auto,    // best supported by the CPU
+		Scalar,
+		SSE41,
+		AVX2,
+	};
+
+	bool IsSupported(Path path);
+
+	void EncodeR11G11B10F(const float* rgba, uint32_t* packed, size_t count, Path path = Path::Auto);
+	void EncodeRGB9E5(const float* rgba, uint32_t* packed, size_t count, Path path = Path::Auto);
+	void DecodeR11G11B10F(const uint32_t* packed, float* rgba, size_t count, Path path = Path::Auto);
+	void DecodeRGB9E5(const uint32_t* packed, float* rgba, size_t count, Path path = Path::Auto);
+}
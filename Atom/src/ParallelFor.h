@@ -0,0 +1,42 @@
+#pragma once
+
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace Utility
+{
+	// Hands out work items [0, count) to numThreads threads (0 uses all hardware threads), the caller
+	// included.  Items are claimed one at a time so uneven items balance across workers.  With 0 threads and
+	// the JobSystem running, its workers take the items instead of threads started for the call.
+	template <typename Func>
+	void ParallelFor(uint32_t count, uint32_t numThreads, Func&& func)
+	{
+		if (numThreads == 0 && JobSystem::IsRunning())
+		{
+			JobSystem::ParallelFor(count, 1, func);
+			return;
+		}
+
+		if (numThreads == 0)
+			numThreads = std::max(1u, std::thread::hardware_concurrency());
+		numThreads = std::min(numThreads, std::max(1u, count));
+
+		std::atomic<uint32_t> next = 0;
+		auto worker = [&]()
+		{
+			for (uint32_t i = next++; i < count; i = next++)
+				func(i);
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(numThreads - 1);
+		for (uint32_t t = 1; t < numThreads; ++t)
+			threads.emplace_back(worker);
+		worker();
+		for (std::thread& t : threads)
+			t.join();
+	}
+}
@@ -1,5 +1,7 @@
 #include "pch.h"
 #include "PixelBuffer.h"
+#include "GpuHeapAllocator.h"
+#include "GpuMemory.h"
 
 DXGI_FORMAT PixelBuffer::GetBaseFormat(DXGI_FORMAT defaultFormat)
 {
@@ -334,15 +336,14 @@ void PixelBuffer::CreateTextureResource(ID3D12Device* device, const std::wstring
 {
 	Destroy();
 
-	CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
-	ASSERT_SUCCEEDED(device->CreateCommittedResource(
-		&heapProps,
-		D3D12_HEAP_FLAG_NONE,
-		&resourceDesc,
+	ASSERT_SUCCEEDED(GpuHeapAllocator::CreateResource(
+		D3D12_HEAP_TYPE_DEFAULT,
+		resourceDesc,
 		D3D12_RESOURCE_STATE_COMMON,
 		&clearValue,
-		IID_PPV_ARGS(&m_pResource)
+		m_pResource.ReleaseAndGetAddressOf()
 	));
+	GpuMemory::Track(m_pResource.Get(), GpuMemoryTracker::kRenderTargets);
 
 	m_UsageState = D3D12_RESOURCE_STATE_COMMON;
 	m_GpuVirtualAddress = D3D12_GPU_VIRTUAL_ADDRESS_NULL;
@@ -352,3 +353,25 @@ void PixelBuffer::CreateTextureResource(ID3D12Device* device, const std::wstring
 #endif
 
 }
+
+void PixelBuffer::CreatePlacedTextureResource(ID3D12Device* device, const std::wstring& name, const D3D12_RESOURCE_DESC& resourceDesc,
+	D3D12_CLEAR_VALUE clearValue, ID3D12Heap* heap, uint64_t heapOffset)
+{
+	Destroy();
+
+	ASSERT_SUCCEEDED(device->CreatePlacedResource(
+		heap,
+		heapOffset,
+		&resourceDesc,
+		D3D12_RESOURCE_STATE_COMMON,
+		&clearValue,
+		IID_PPV_ARGS(m_pResource.ReleaseAndGetAddressOf())
+	));
+
+	m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+	m_GpuVirtualAddress = D3D12_GPU_VIRTUAL_ADDRESS_NULL;
+
+#ifndef RELEASE
+    m_pResource->SetName(name.c_str());
+#endif
+}
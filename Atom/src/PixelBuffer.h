@@ -19,6 +19,9 @@ protected:
     void AssociateWithResource(ID3D12Device* device, const std::wstring&name, ID3D12Resource* resource, D3D12_RESOURCE_STATES currentState);
 
     void CreateTextureResource(ID3D12Device* device, const std::wstring& name, const D3D12_RESOURCE_DESC& resourceDesc, D3D12_CLEAR_VALUE clearValue);;
+    // Places the resource at heapOffset in heap instead, for targets that share memory (see TransientHeap.h).
+    void CreatePlacedTextureResource(ID3D12Device* device, const std::wstring& name, const D3D12_RESOURCE_DESC& resourceDesc,
+        D3D12_CLEAR_VALUE clearValue, ID3D12Heap* heap, uint64_t heapOffset);
 
     static DXGI_FORMAT GetBaseFormat(DXGI_FORMAT Format);
     static DXGI_FORMAT GetUAVFormat(DXGI_FORMAT Format);
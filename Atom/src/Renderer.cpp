@@ -8,6 +8,7 @@
 #include "GraphicsCommon.h"
 #include "Display.h"
 #include "PipelineState.h"
+#include "DescriptorVersionCache.h"
 
 #include "../CompiledShaders/PBRShadingVS.h"
 #include "../CompiledShaders/SkyBoxVS.h"
@@ -37,8 +38,12 @@ namespace Renderer
 	DescriptorHandle g_SSAOUavHeap;
 	DescriptorHandle g_NullDescriptor;
 
+	// What the slots of m_CommonTextures were copied from, so UpdateGlobalDescriptors() only rewrites the views
+	// that changed.
+	DescriptorVersionCache s_CommonTextureCache(10);
+
 	RootSignature s_RootSig;
-	std::unordered_map<std::string, GraphicsPSO> s_PSOs;
+	std::unordered_map<std::string, GraphicsPSO, PSONameHash, std::equal_to<>> s_PSOs;
 	GraphicsPSO s_SkyboxPSO;
 
 	RootSignature s_ComputeRootSig;
@@ -55,11 +60,13 @@ namespace Renderer
 		s_RootSig.InitStaticSampler(4, SamplerShadowDesc, D3D12_SHADER_VISIBILITY_PIXEL);
 		s_RootSig[kMeshConstants].InitAsConstantBuffer(0, D3D12_SHADER_VISIBILITY_VERTEX);
 		s_RootSig[kMaterialConstants].InitAsConstantBuffer(0, D3D12_SHADER_VISIBILITY_PIXEL);
-		s_RootSig[kMaterialSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 10, D3D12_SHADER_VISIBILITY_PIXEL);
+		// Unbounded, bound once to the start of s_TextureHeap: materials index their textures in the heap.
+		s_RootSig[kMaterialSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, UINT_MAX, D3D12_SHADER_VISIBILITY_PIXEL, 1);
 		s_RootSig[kCommonSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 10, 10, D3D12_SHADER_VISIBILITY_PIXEL);
 		s_RootSig[kCommonCBV].InitAsConstantBuffer(1);
 		s_RootSig[kPostprocessSRVs].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 20, 10);
 		s_RootSig[kShaderParams].InitAsConstantBuffer(2);
+		s_RootSig[kIrradianceSH].InitAsConstantBuffer(3, D3D12_SHADER_VISIBILITY_PIXEL);
 		s_RootSig.Finalize(L"GraphicsRootSig", D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
 		s_ComputeRootSig.Reset(3, 5);
@@ -139,7 +146,7 @@ namespace Renderer
 
 		TextureManager::Initialize(L"");
 
-		s_TextureHeap.Create(L"Scene Texture Descriptors", D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 128);
+		s_TextureHeap.Create(L"Scene Texture Descriptors", D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 16384);
 
 		m_CommonTextures = s_TextureHeap.Alloc(10);
 		g_PostProcessTexture = s_TextureHeap.Alloc(2);
@@ -154,26 +161,19 @@ namespace Renderer
 		desc.Texture2D.ResourceMinLODClamp = 0;
 		g_Device->CreateShaderResourceView(nullptr, &desc, g_NullDescriptor);
 
-		uint32_t DestCount = 10;
-		uint32_t SourceCounts[] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+		// t12 used to be the irradiance cubemap. Diffuse IBL now comes from SH9 constants (kIrradianceSH),
+		// the slot stays in the table as a null cube SRV so the remaining register assignments are unchanged.
+		DescriptorHandle IrradianceSlot = m_CommonTextures + 2 * s_TextureHeap.GetDescriptorSize();
 
+		D3D12_SHADER_RESOURCE_VIEW_DESC nullCubeDesc = {};
+		nullCubeDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+		nullCubeDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		nullCubeDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		nullCubeDesc.TextureCube.MipLevels = 1;
+		g_Device->CreateShaderResourceView(nullptr, &nullCubeDesc, IrradianceSlot);
 
-		D3D12_CPU_DESCRIPTOR_HANDLE SourceTextures[] =
-		{
-			g_EnvirMap.GetSRV(),
-			g_RadianceMap.GetSRV(),
-			g_IrradianceMap.GetSRV(),
-			g_SSAOFullScreen.GetSRV(),
-			g_ShadowBuffer.GetDepthSRV(),
-			g_LUT.GetSRV(),
-			g_SSSDiffuseLut.GetSRV(),
-			g_SSSSpecularLut.GetSRV(),
-			g_Emu.GetSRV(),
-			g_Eavg.GetSRV(),
-		};
+		UpdateGlobalDescriptors();
 
-		g_Device->CopyDescriptors(1, &m_CommonTextures, &DestCount, DestCount, SourceTextures, SourceCounts, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-		
 		{
 			g_SSAOSrvHeap = Renderer::s_TextureHeap.Alloc(4);
 			g_SSAOUavHeap = Renderer::s_TextureHeap.Alloc();
@@ -197,19 +197,47 @@ namespace Renderer
 	}
 	void UpdateGlobalDescriptors(void)
 	{
-		uint32_t DestCount = 2;
-		uint32_t SourceCounts[] = { 1, 1 };
+		// Copies sources[0..Count) to the slots of m_CommonTextures starting at Slot.
+		auto CopyRun = [](uint32_t Slot, const DescriptorVersionCache::Source* Sources, uint32_t Count)
+		{
+			static const uint32_t SourceCounts[] = { 1, 1, 1, 1, 1, 1, 1 };
+			ASSERT(Count <= _countof(SourceCounts));
 
+			D3D12_CPU_DESCRIPTOR_HANDLE SourceTextures[_countof(SourceCounts)];
+			for (uint32_t i = 0; i < Count; ++i)
+				SourceTextures[i].ptr = Sources[i].Handle;
 
-		D3D12_CPU_DESCRIPTOR_HANDLE SourceTextures[] =
-		{
-			g_SSAOFullScreen.GetSRV(),
-			g_ShadowBuffer.GetDepthSRV(),
+			DescriptorHandle Dest = m_CommonTextures + Slot * s_TextureHeap.GetDescriptorSize();
+			g_Device->CopyDescriptors(1, &Dest, &Count, Count, SourceTextures, SourceCounts, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 		};
 
-		DescriptorHandle dest = m_CommonTextures + 3 * s_TextureHeap.GetDescriptorSize();
+		// Slot 2 is the null irradiance cube written by Initialize().
+		const DescriptorVersionCache::Source HeadTextures[] =
+		{
+			{ g_EnvirMap.GetSRV().ptr, g_EnvirMap.GetVersionID() },
+			{ g_RadianceMap.GetSRV().ptr, g_RadianceMap.GetVersionID() },
+		};
+		const DescriptorVersionCache::Source TailTextures[] =
+		{
+			{ g_SSAOFullScreen.GetSRV().ptr, g_SSAOFullScreen.GetVersionID() },
+			{ g_ShadowBuffer.GetDepthSRV().ptr, g_ShadowBuffer.GetVersionID() },
+			{ g_LUT.GetSRV().ptr, g_LUT.GetVersionID() },
+			{ g_SSSDiffuseLut.GetSRV().ptr, g_SSSDiffuseLut.GetVersionID() },
+			{ g_SSSSpecularLut.GetSRV().ptr, g_SSSSpecularLut.GetVersionID() },
+			{ g_Emu.GetSRV().ptr, g_Emu.GetVersionID() },
+			{ g_Eavg.GetSRV().ptr, g_Eavg.GetVersionID() },
+		};
 
-		g_Device->CopyDescriptors(1, &dest, &DestCount, DestCount, SourceTextures, SourceCounts, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		s_CommonTextureCache.Update(0, HeadTextures, _countof(HeadTextures),
+			[&](uint32_t First, uint32_t Count) { CopyRun(First, HeadTextures + First, Count); });
+		s_CommonTextureCache.Update(3, TailTextures, _countof(TailTextures),
+			[&](uint32_t First, uint32_t Count) { CopyRun(3 + First, TailTextures + First, Count); });
+	}
 
+	GraphicsPSO& GetPSO(std::string_view Name)
+	{
+		auto iter = s_PSOs.find(Name);
+		ASSERT(iter != s_PSOs.end(), "Unknown PSO");
+		return iter->second;
 	}
 }
\ No newline at end of file
@@ -18,7 +18,14 @@ namespace Renderer
     extern RootSignature s_RootSig;
     extern RootSignature s_ComputeRootSig;
 
-    extern std::unordered_map<std::string, GraphicsPSO> s_PSOs;
+    // Transparent, so PSOs can be looked up by a string literal without building a std::string every frame.
+    struct PSONameHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view Name) const { return std::hash<std::string_view>()(Name); }
+    };
+    extern std::unordered_map<std::string, GraphicsPSO, PSONameHash, std::equal_to<>> s_PSOs;
+    GraphicsPSO& GetPSO(std::string_view Name);
     extern GraphicsPSO s_SkyboxPSO;
     extern ComputePSO s_PostProcessPSO;
 
@@ -28,11 +35,12 @@ namespace Renderer
     {
         kMeshConstants,       // for VS
         kMaterialConstants,   // for PS
-        kMaterialSRVs,        // material texture 
+        kMaterialSRVs,        // all of s_TextureHeap, unbounded (space1)
         kCommonSRVs,          //
         kCommonCBV,           // global cbv
         kPostprocessSRVs,
         kShaderParams,
+        kIrradianceSH,        // SH9 diffuse irradiance
         kNumRootBindings
     };
 
@@ -126,14 +126,23 @@ void RootSignature::Finalize(const std::wstring& name, D3D12_ROOT_SIGNATURE_FLAG
             HashCode = Utility::HashState(RootParam.DescriptorTable.pDescriptorRanges,
                 RootParam.DescriptorTable.NumDescriptorRanges, HashCode);
 
+            bool IsUnbounded = false;
+            for (UINT TableRange = 0; TableRange < RootParam.DescriptorTable.NumDescriptorRanges; ++TableRange)
+            {
+                const UINT NumDescriptors = RootParam.DescriptorTable.pDescriptorRanges[TableRange].NumDescriptors;
+                IsUnbounded |= NumDescriptors == UINT_MAX;
+                m_DescriptorTableSize[Param] += NumDescriptors;
+            }
+
+            // Unbounded (bindless) tables point into a shader-visible heap bound by the caller; dynamic
+            // descriptor heaps cannot stage them.
+            if (IsUnbounded)
+                m_DescriptorTableSize[Param] = 0;
             // We keep track of sampler descriptor tables separately from CBV_SRV_UAV descriptor tables
-            if (RootParam.DescriptorTable.pDescriptorRanges->RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER)
+            else if (RootParam.DescriptorTable.pDescriptorRanges->RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER)
                 m_SamplerTableBitMap |= (1 << Param);
             else
                 m_DescriptorTableBitMap |= (1 << Param);
-
-            for (UINT TableRange = 0; TableRange < RootParam.DescriptorTable.NumDescriptorRanges; ++TableRange)
-                m_DescriptorTableSize[Param] += RootParam.DescriptorTable.pDescriptorRanges[TableRange].NumDescriptors;
         }
         else
             HashCode = Utility::HashState(&RootParam, 1, HashCode);
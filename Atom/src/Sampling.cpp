@@ -0,0 +1,426 @@
+#include "pch.h"
+#include "Sampling.h"
+#include "ParallelFor.h"
+#include "SystemTime.h"
+#include <bit>
+#include <cmath>
+#include <filesystem>
+#include <numeric>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	const float kPi = 3.14159265358979323846f;
+	const float kOneMinusEpsilon = 0x1.fffffep-1f;
+
+	uint32_t ReverseBits(uint32_t bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return bits;
+	}
+
+	// Truncates to the 24 bits a float holds.  Rounding could carry a point into the next stratum.
+	float ToUnitFloat(uint32_t x)
+	{
+		return (float)(x >> 8) * 0x1p-24f;
+	}
+
+	uint32_t HashCombine(uint32_t seed, uint32_t v)
+	{
+		return seed ^ (v + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+	}
+
+	struct SobolMatrices
+	{
+		uint32_t Directions[Sampling::kMaxSobolDimensions][32];
+
+		SobolMatrices()
+		{
+			// Degree s, coefficients a and initial m_k of the primitive polynomials for dimensions 1 ... 7.
+			struct Polynomial { uint32_t S; uint32_t A; uint32_t M[5]; };
+			static const Polynomial polynomials[Sampling::kMaxSobolDimensions - 1] =
+			{
+				{ 1, 0, { 1 } },
+				{ 2, 1, { 1, 3 } },
+				{ 3, 1, { 1, 3, 1 } },
+				{ 3, 2, { 1, 1, 1 } },
+				{ 4, 1, { 1, 1, 3, 3 } },
+				{ 4, 4, { 1, 3, 5, 13 } },
+				{ 5, 2, { 1, 1, 5, 5, 17 } },
+			};
+
+			for (uint32_t k = 0; k < 32; ++k)
+				Directions[0][k] = 1u << (31 - k);
+
+			for (uint32_t d = 1; d < Sampling::kMaxSobolDimensions; ++d)
+			{
+				const Polynomial& p = polynomials[d - 1];
+				uint32_t* v = Directions[d];
+				for (uint32_t k = 0; k < p.S; ++k)
+					v[k] = p.M[k] << (31 - k);
+				for (uint32_t k = p.S; k < 32; ++k)
+				{
+					v[k] = v[k - p.S] ^ (v[k - p.S] >> p.S);
+					for (uint32_t j = 1; j < p.S; ++j)
+					{
+						if ((p.A >> (p.S - 1 - j)) & 1)
+							v[k] ^= v[k - j];
+					}
+				}
+			}
+		}
+	};
+
+	const SobolMatrices& GetSobolMatrices()
+	{
+		static const SobolMatrices s_Matrices;
+		return s_Matrices;
+	}
+
+	// Void-and-cluster on a torus.  Energy is the Gaussian weighted count of minority pixels around a texel;
+	// the tightest cluster is the minority pixel with the most energy, the largest void the majority pixel with
+	// the least.
+	class VoidAndCluster
+	{
+	public:
+		VoidAndCluster(uint32_t size, float sigma) : m_Size(size), m_Kernel((size_t)size * size)
+		{
+			const float invTwoSigma2 = 1.0f / (2.0f * sigma * sigma);
+			for (uint32_t y = 0; y < size; ++y)
+			{
+				const float dy = (float)std::min(y, size - y);
+				for (uint32_t x = 0; x < size; ++x)
+				{
+					const float dx = (float)std::min(x, size - x);
+					m_Kernel[(size_t)y * size + x] = std::exp(-(dx * dx + dy * dy) * invTwoSigma2);
+				}
+			}
+		}
+
+		void Reset(const std::vector<uint8_t>& pattern)
+		{
+			m_Pattern.assign(pattern.size(), 0);
+			m_Energy.assign(pattern.size(), 0.0f);
+			for (uint32_t i = 0; i < (uint32_t)pattern.size(); ++i)
+			{
+				if (pattern[i])
+					Set(i, true);
+			}
+		}
+
+		void Set(uint32_t index, bool value)
+		{
+			m_Pattern[index] = value ? 1 : 0;
+			const float sign = value ? 1.0f : -1.0f;
+			const uint32_t px = index % m_Size, py = index / m_Size;
+			for (uint32_t y = 0; y < m_Size; ++y)
+			{
+				const float* kernel = m_Kernel.data() + (size_t)((y + m_Size - py) % m_Size) * m_Size;
+				float* energy = m_Energy.data() + (size_t)y * m_Size;
+				uint32_t dx = (m_Size - px) % m_Size;
+				for (uint32_t x = 0; x < m_Size; ++x)
+				{
+					energy[x] += sign * kernel[dx];
+					dx = dx + 1 == m_Size ? 0 : dx + 1;
+				}
+			}
+		}
+
+		uint32_t TightestCluster() const
+		{
+			uint32_t best = 0;
+			float bestEnergy = -FLT_MAX;
+			for (uint32_t i = 0; i < (uint32_t)m_Pattern.size(); ++i)
+			{
+				if (m_Pattern[i] && m_Energy[i] > bestEnergy)
+				{
+					bestEnergy = m_Energy[i];
+					best = i;
+				}
+			}
+			return best;
+		}
+
+		uint32_t LargestVoid() const
+		{
+			uint32_t best = 0;
+			float bestEnergy = FLT_MAX;
+			for (uint32_t i = 0; i < (uint32_t)m_Pattern.size(); ++i)
+			{
+				if (!m_Pattern[i] && m_Energy[i] < bestEnergy)
+				{
+					bestEnergy = m_Energy[i];
+					best = i;
+				}
+			}
+			return best;
+		}
+
+		const std::vector<uint8_t>& GetPattern() const { return m_Pattern; }
+
+	private:
+		uint32_t m_Size;
+		std::vector<float> m_Kernel;
+		std::vector<uint8_t> m_Pattern;
+		std::vector<float> m_Energy;
+	};
+
+	DXGI_FORMAT BlueNoiseFormat(uint32_t channels)
+	{
+		switch (channels)
+		{
+		case 1:  return DXGI_FORMAT_R8_UNORM;
+		case 2:  return DXGI_FORMAT_R8G8_UNORM;
+		default: return DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+}
+
+float Sampling::RadicalInverse(uint32_t i)
+{
+	return ToUnitFloat(ReverseBits(i));
+}
+
+XMFLOAT2 Sampling::Hammersley2D(uint32_t i, uint32_t n)
+{
+	return XMFLOAT2((float)i / (float)n, RadicalInverse(i));
+}
+
+uint32_t Sampling::Sobol(uint32_t index, uint32_t dimension)
+{
+	ASSERT(dimension < kMaxSobolDimensions);
+
+	const uint32_t* v = GetSobolMatrices().Directions[dimension];
+	uint32_t x = 0;
+	for (; index != 0; index &= index - 1)
+		x ^= v[std::countr_zero(index)];
+	return x;
+}
+
+uint32_t Sampling::OwenScramble(uint32_t x, uint32_t seed)
+{
+	// Laine-Karras style hash on the reversed bits: every bit is only affected by the bits above it.
+	x = ReverseBits(x);
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return ReverseBits(x);
+}
+
+float Sampling::SobolOwen(uint32_t index, uint32_t dimension, uint32_t seed)
+{
+	// Shuffling the index with the same scramble keeps the first 2^k points a (0, k, d)-net but decorrelates
+	// different seeds further.
+	const uint32_t shuffled = OwenScramble(index, seed);
+	return ToUnitFloat(OwenScramble(Sobol(shuffled, dimension), HashCombine(seed, dimension + 1)));
+}
+
+void Sampling::GenerateSobol(uint32_t count, uint32_t dimensions, uint32_t seed, std::vector<float>& out)
+{
+	ASSERT(dimensions > 0 && dimensions <= kMaxSobolDimensions);
+
+	out.resize((size_t)count * dimensions);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		for (uint32_t d = 0; d < dimensions; ++d)
+			out[(size_t)i * dimensions + d] = SobolOwen(i, d, seed);
+	}
+}
+
+void Sampling::GenerateRank1Lattice(uint32_t count, const uint32_t* generator, uint32_t dimensions, const float* shift,
+	std::vector<float>& out)
+{
+	ASSERT(count > 0);
+
+	out.resize((size_t)count * dimensions);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		for (uint32_t d = 0; d < dimensions; ++d)
+		{
+			// Integer modulo first so large indices do not lose precision.
+			float x = (float)(((uint64_t)i * generator[d]) % count) / (float)count;
+			if (shift)
+			{
+				x += shift[d];
+				x -= std::floor(x);
+			}
+			out[(size_t)i * dimensions + d] = std::min(x, kOneMinusEpsilon);
+		}
+	}
+}
+
+uint32_t Sampling::FindKorobovGenerator2D(uint32_t count)
+{
+	// The lattice is a group, so the closest pair is as close as the point closest to the origin.
+	uint64_t bestDistance = 0;
+	uint32_t best = 1;
+	for (uint32_t a = 1; a <= count / 2; ++a)
+	{
+		uint64_t minDistance = UINT64_MAX;
+		for (uint32_t i = 1; i < count && minDistance > bestDistance; ++i)
+		{
+			const uint64_t x = std::min<uint64_t>(i, count - i);
+			const uint64_t ai = ((uint64_t)a * i) % count;
+			const uint64_t y = std::min<uint64_t>(ai, count - ai);
+			minDistance = std::min(minDistance, x * x + y * y);
+		}
+		if (minDistance > bestDistance)
+		{
+			bestDistance = minDistance;
+			best = a;
+		}
+	}
+	return best;
+}
+
+void Sampling::GenerateBlueNoiseRanks(uint32_t size, float sigma, uint32_t seed, std::vector<uint32_t>& ranks)
+{
+	ASSERT(size > 0);
+
+	const uint32_t count = size * size;
+	ranks.assign(count, 0);
+
+	// Initial binary pattern: 10% of the texels at random, relaxed until the tightest cluster and the largest
+	// void are the same texel.
+	std::vector<uint32_t> order(count);
+	std::iota(order.begin(), order.end(), 0u);
+	std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+	const uint32_t initialCount = std::max(1u, count / 10);
+
+	std::vector<uint8_t> initial(count, 0);
+	for (uint32_t i = 0; i < initialCount; ++i)
+		initial[order[i]] = 1;
+
+	VoidAndCluster vc(size, sigma);
+	vc.Reset(initial);
+	for (uint32_t iteration = 0; iteration < count; ++iteration)
+	{
+		const uint32_t cluster = vc.TightestCluster();
+		vc.Set(cluster, false);
+		const uint32_t largestVoid = vc.LargestVoid();
+		vc.Set(largestVoid, true);
+		if (largestVoid == cluster)
+			break;
+	}
+	initial = vc.GetPattern();
+
+	// Phase 1: remove the tightest clusters of the initial pattern, highest rank first.
+	for (uint32_t rank = initialCount; rank-- > 0;)
+	{
+		const uint32_t cluster = vc.TightestCluster();
+		vc.Set(cluster, false);
+		ranks[cluster] = rank;
+	}
+
+	// Phases 2 and 3: fill the largest voids.  Past half, Ulichney swaps the roles of ones and zeros and removes
+	// the tightest clusters of zeros instead; with a fixed kernel the zero energy is the total kernel weight
+	// minus the one energy, so that is the same texel.
+	vc.Reset(initial);
+	for (uint32_t rank = initialCount; rank < count; ++rank)
+	{
+		const uint32_t largestVoid = vc.LargestVoid();
+		vc.Set(largestVoid, true);
+		ranks[largestVoid] = rank;
+	}
+}
+
+void Sampling::GenerateBlueNoise(IBL::TextureData& out, const BlueNoiseSettings& settings)
+{
+	ASSERT(settings.Channels == 1 || settings.Channels == 2 || settings.Channels == 4);
+
+	const uint32_t size = settings.Size;
+	const uint32_t count = size * size;
+	std::vector<std::vector<uint32_t>> ranks(settings.Channels);
+	Utility::ParallelFor(settings.Channels, settings.NumThreads, [&](uint32_t channel)
+		{
+			GenerateBlueNoiseRanks(size, settings.Sigma, HashCombine(settings.Seed, channel), ranks[channel]);
+		});
+
+	out = IBL::TextureData();
+	out.Format = BlueNoiseFormat(settings.Channels);
+	out.Width = size;
+	out.Height = size;
+	out.Bytes.resize((size_t)count * settings.Channels);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		for (uint32_t c = 0; c < settings.Channels; ++c)
+			out.Bytes[(size_t)i * settings.Channels + c] = (uint8_t)((uint64_t)ranks[c][i] * 256 / count);
+	}
+}
+
+void Sampling::LoadOrGenerateBlueNoise(const std::string& cacheDir, IBL::TextureData& out, const BlueNoiseSettings& settings)
+{
+	const int64_t startTick = SystemTime::GetCurrentTick();
+
+	char name[96];
+	sprintf_s(name, "bluenoise_%u_%u_%u_%u.dds", settings.Size, settings.Channels, (uint32_t)(settings.Sigma * 100.0f + 0.5f), settings.Seed);
+	const std::string path = cacheDir + "/" + name;
+
+	if (IBL::LoadDDS(path, out) && out.Format == BlueNoiseFormat(settings.Channels) && out.Width == settings.Size && out.Height == settings.Size)
+	{
+		Utility::Printf("Sampling: loaded cached %s in %.1f ms\n", name, SystemTime::TicksToMillisecs(SystemTime::GetCurrentTick() - startTick));
+		return;
+	}
+
+	GenerateBlueNoise(out, settings);
+	Utility::Printf("Sampling: generated %s in %.1f ms\n", name, SystemTime::TicksToMillisecs(SystemTime::GetCurrentTick() - startTick));
+
+	std::error_code ec;
+	std::filesystem::create_directories(cacheDir, ec);
+	if (!IBL::SaveDDS(path, out))
+		Utility::Printf("Sampling: failed to write %s\n", path.c_str());
+}
+
+XMFLOAT2 Sampling::ConcentricDisk(const XMFLOAT2& u)
+{
+	// Shirley and Chiu, "A Low Distortion Map Between Disk and Square".
+	const float a = 2.0f * u.x - 1.0f;
+	const float b = 2.0f * u.y - 1.0f;
+	if (a == 0.0f && b == 0.0f)
+		return XMFLOAT2(0.0f, 0.0f);
+
+	float r, phi;
+	if (std::abs(a) > std::abs(b))
+	{
+		r = a;
+		phi = (kPi / 4.0f) * (b / a);
+	}
+	else
+	{
+		r = b;
+		phi = (kPi / 2.0f) - (kPi / 4.0f) * (a / b);
+	}
+	return XMFLOAT2(r * std::cos(phi), r * std::sin(phi));
+}
+
+XMFLOAT3 Sampling::UniformSphere(const XMFLOAT2& u)
+{
+	const float z = 1.0f - 2.0f * u.x;
+	const float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+	const float phi = 2.0f * kPi * u.y;
+	return XMFLOAT3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+XMFLOAT3 Sampling::UniformHemisphere(const XMFLOAT2& u)
+{
+	const float z = u.x;
+	const float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+	const float phi = 2.0f * kPi * u.y;
+	return XMFLOAT3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+XMFLOAT3 Sampling::CosineHemisphere(const XMFLOAT2& u)
+{
+	// Malley's method: project the disk up onto the hemisphere.
+	const XMFLOAT2 d = ConcentricDisk(u);
+	const float z = std::sqrt(std::max(0.0f, 1.0f - d.x * d.x - d.y * d.y));
+	return XMFLOAT3(d.x, d.y, z);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "IBLBaker.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Sample sets for Monte Carlo integration in the bakers and for per pixel noise in screen space passes.
+//   - Hammersley and Sobol points; Sobol with Owen scrambling (Burley, "Practical Hash-based Owen
+//     Scrambling", JCGT 2020) gives independent, still stratified sequences per seed.
+//   - Rank-1 lattices, x_i = frac(i * g / n + shift), with a Korobov generator search for 2D.
+//   - Blue noise textures built with void-and-cluster (Ulichney, "The void-and-cluster method for dither
+//     array generation", 1993), cached on disk like the IBL tables.
+//   - Mappings from [0, 1)^2 to the disk, sphere and hemisphere.
+// Everything is deterministic: the same arguments always produce the same points.
+namespace Sampling
+{
+	// Direction numbers from Joe and Kuo (new-joe-kuo-6.21201), dimension 0 is the van der Corput sequence.
+	static const uint32_t kMaxSobolDimensions = 8;
+
+	float RadicalInverse(uint32_t i);
+	DirectX::XMFLOAT2 Hammersley2D(uint32_t i, uint32_t n);
+
+	// Sobol point as 32 bit fixed point.
+	uint32_t Sobol(uint32_t index, uint32_t dimension);
+	// Nested uniform scramble of a 32 bit fixed point value; a different seed gives an independent scramble.
+	uint32_t OwenScramble(uint32_t x, uint32_t seed);
+	// Scrambled and shuffled Sobol point in [0, 1).  Every dimension is scrambled with its own seed.
+	float SobolOwen(uint32_t index, uint32_t dimension, uint32_t seed);
+	// count points of dimensions coordinates each, point major.
+	void GenerateSobol(uint32_t count, uint32_t dimensions, uint32_t seed, std::vector<float>& out);
+
+	// generator holds one entry per dimension and shift one value in [0, 1) per dimension (nullptr for none).
+	void GenerateRank1Lattice(uint32_t count, const uint32_t* generator, uint32_t dimensions, const float* shift,
+		std::vector<float>& out);
+	// a such that (1, a) maximizes the minimum toroidal distance between points of the 2D lattice.  O(count^2).
+	uint32_t FindKorobovGenerator2D(uint32_t count);
+
+	struct BlueNoiseSettings
+	{
+		uint32_t Size = 64;      // width and height, the texture tiles seamlessly
+		uint32_t Channels = 4;   // 1, 2 or 4 independent channels, R8, R8G8 or R8G8B8A8_UNORM
+		float Sigma = 1.5f;      // energy filter width in texels, as in the original paper
+		uint32_t Seed = 0;
+		uint32_t NumThreads = 0; // channels are generated in parallel, 0 uses all hardware threads
+	};
+
+	// Rank of every texel in [0, size * size); thresholding at any rank gives a blue noise point set.
+	void GenerateBlueNoiseRanks(uint32_t size, float sigma, uint32_t seed, std::vector<uint32_t>& ranks);
+	// 8 bit texture where every value occurs equally often.
+	void GenerateBlueNoise(IBL::TextureData& out, const BlueNoiseSettings& settings = BlueNoiseSettings());
+	// Same as GenerateBlueNoise() but reads the texture from cacheDir if it was generated before.
+	void LoadOrGenerateBlueNoise(const std::string& cacheDir, IBL::TextureData& out, const BlueNoiseSettings& settings = BlueNoiseSettings());
+
+	// Mappings of u in [0, 1)^2.  They preserve stratification, pdfs are per steradian.
+	DirectX::XMFLOAT2 ConcentricDisk(const DirectX::XMFLOAT2& u);
+	DirectX::XMFLOAT3 UniformSphere(const DirectX::XMFLOAT2& u);           // pdf 1 / 4pi
+	DirectX::XMFLOAT3 UniformHemisphere(const DirectX::XMFLOAT2& u);       // around +Z, pdf 1 / 2pi
+	DirectX::XMFLOAT3 CosineHemisphere(const DirectX::XMFLOAT2& u);        // around +Z, pdf cos(theta) / pi
+}
@@ -0,0 +1,256 @@
+#include "pch.h"
+#include "SphericalHarmonics.h"
+#include "ParallelFor.h"
+#include <thread>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const double kPi = 3.14159265358979323846;
+
+	// Real SH basis normalization constants for bands 0..2
+	const double kY00 = 0.282094791773878;  // 1/2 sqrt(1/pi)
+	const double kY1m = 0.488602511902920;  // sqrt(3/(4pi))
+	const double kY2a = 1.092548430592079;  // 1/2 sqrt(15/pi)
+	const double kY20 = 0.315391565252520;  // 1/4 sqrt(5/pi)
+	const double kY22 = 0.546274215296040;  // 1/4 sqrt(15/pi)
+
+	struct Accumulator
+	{
+		double Coefficients[SH::kNumCoefficients][3] = {};
+		double WeightSum = 0.0;
+
+		void Add(double x, double y, double z, const float* rgb, double weight)
+		{
+			const double basis[SH::kNumCoefficients] =
+			{
+				kY00,
+				kY1m * y,
+				kY1m * z,
+				kY1m * x,
+				kY2a * x * y,
+				kY2a * y * z,
+				kY20 * (3.0 * z * z - 1.0),
+				kY2a * x * z,
+				kY22 * (x * x - y * y),
+			};
+
+			for (uint32_t i = 0; i < SH::kNumCoefficients; ++i)
+			{
+				const double w = basis[i] * weight;
+				Coefficients[i][0] += rgb[0] * w;
+				Coefficients[i][1] += rgb[1] * w;
+				Coefficients[i][2] += rgb[2] * w;
+			}
+			WeightSum += weight;
+		}
+
+		void Merge(const Accumulator& rhs)
+		{
+			for (uint32_t i = 0; i < SH::kNumCoefficients; ++i)
+				for (uint32_t c = 0; c < 3; ++c)
+					Coefficients[i][c] += rhs.Coefficients[i][c];
+			WeightSum += rhs.WeightSum;
+		}
+
+		// The discrete weights only approximate 4pi, so renormalize to keep the DC term exact.
+		SH::SH9Color Resolve() const
+		{
+			SH::SH9Color ret;
+			const double scale = WeightSum > 0.0 ? 4.0 * kPi / WeightSum : 0.0;
+			for (uint32_t i = 0; i < SH::kNumCoefficients; ++i)
+			{
+				ret.Coefficients[i] = XMFLOAT3(
+					(float)(Coefficients[i][0] * scale),
+					(float)(Coefficients[i][1] * scale),
+					(float)(Coefficients[i][2] * scale));
+			}
+			return ret;
+		}
+	};
+
+	// Splits [0, rowCount) into contiguous chunks, one accumulator per chunk, and merges the partial sums in a
+	// fixed order so the result does not depend on which thread ran which chunk.
+	template <typename RowFunc>
+	SH::SH9Color ParallelProject(uint32_t rowCount, uint32_t numThreads, RowFunc&& projectRow)
+	{
+		if (numThreads == 0)
+			numThreads = std::max(1u, std::thread::hardware_concurrency());
+		numThreads = std::min(numThreads, std::max(1u, rowCount));
+
+		std::vector<Accumulator> partials(numThreads);
+		const uint32_t rowsPerChunk = (rowCount + numThreads - 1) / numThreads;
+		Utility::ParallelFor(numThreads, 0, [&](uint32_t chunk)
+			{
+				const uint32_t begin = chunk * rowsPerChunk;
+				const uint32_t end = std::min(rowCount, begin + rowsPerChunk);
+				for (uint32_t row = begin; row < end; ++row)
+					projectRow(row, partials[chunk]);
+			});
+
+		Accumulator total;
+		for (const Accumulator& partial : partials)
+			total.Merge(partial);
+		return total.Resolve();
+	}
+
+	double CubeAreaElement(double x, double y)
+	{
+		return std::atan2(x * y, std::sqrt(x * x + y * y + 1.0));
+	}
+
+	// Solid angle subtended by the texel centered at (u, v) on a face spanning [-1, 1]^2.
+	double CubeTexelSolidAngle(double u, double v, double invSize)
+	{
+		const double x0 = u - invSize, x1 = u + invSize;
+		const double y0 = v - invSize, y1 = v + invSize;
+		return CubeAreaElement(x0, y0) - CubeAreaElement(x0, y1) - CubeAreaElement(x1, y0) + CubeAreaElement(x1, y1);
+	}
+
+	// Same face orientation as getSamplingVector() in the IBL compute shaders.
+	void CubeTexelDirection(uint32_t face, double u, double v, double& x, double& y, double& z)
+	{
+		switch (face)
+		{
+		case 0: x = 1.0;  y = v;    z = -u;   break;
+		case 1: x = -1.0; y = v;    z = u;    break;
+		case 2: x = u;    y = 1.0;  z = -v;   break;
+		case 3: x = u;    y = -1.0; z = v;    break;
+		case 4: x = u;    y = v;    z = 1.0;  break;
+		default: x = -u;  y = v;    z = -1.0; break;
+		}
+		const double invLen = 1.0 / std::sqrt(x * x + y * y + z * z);
+		x *= invLen;
+		y *= invLen;
+		z *= invLen;
+	}
+}
+
+SH::SH9Color SH::ProjectEquirect(const float* rgba, uint32_t width, uint32_t height, uint32_t numThreads)
+{
+	ASSERT(rgba != nullptr && width > 0 && height > 0);
+
+	const double dPhi = 2.0 * kPi / width;
+	const double dTheta = kPi / height;
+
+	return ParallelProject(height, numThreads, [&](uint32_t row, Accumulator& acc)
+		{
+			const double theta = (row + 0.5) * dTheta;
+			const double sinTheta = std::sin(theta);
+			const double cosTheta = std::cos(theta);
+			const double weight = dPhi * dTheta * sinTheta;
+			const float* texel = rgba + (size_t)row * width * 4;
+
+			for (uint32_t col = 0; col < width; ++col, texel += 4)
+			{
+				const double phi = (col + 0.5) * dPhi;
+				acc.Add(sinTheta * std::cos(phi), cosTheta, sinTheta * std::sin(phi), texel, weight);
+			}
+		});
+}
+
+SH::SH9Color SH::ProjectCubemap(const float* const faces[6], uint32_t faceSize, uint32_t numThreads)
+{
+	ASSERT(faces != nullptr && faceSize > 0);
+
+	const double invSize = 1.0 / faceSize;
+
+	return ParallelProject(6 * faceSize, numThreads, [&](uint32_t row, Accumulator& acc)
+		{
+			const uint32_t face = row / faceSize;
+			const uint32_t y = row % faceSize;
+			const double v = 1.0 - 2.0 * (y + 0.5) * invSize;
+			const float* texel = faces[face] + (size_t)y * faceSize * 4;
+
+			for (uint32_t x = 0; x < faceSize; ++x, texel += 4)
+			{
+				const double u = 2.0 * (x + 0.5) * invSize - 1.0;
+				double dx, dy, dz;
+				CubeTexelDirection(face, u, v, dx, dy, dz);
+				acc.Add(dx, dy, dz, texel, CubeTexelSolidAngle(u, v, invSize));
+			}
+		});
+}
+
+SH::SH9Color SH::ConvolveIrradiance(const SH9Color& radiance)
+{
+	// Ramamoorthi & Hanrahan, "An Efficient Representation for Irradiance Environment Maps".
+	// Band factors A_l are pi, 2pi/3 and pi/4; dividing by pi leaves 1, 2/3 and 1/4.
+	static const float kBandScale[kNumCoefficients] =
+	{
+		1.0f,
+		2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+		0.25f, 0.25f, 0.25f, 0.25f, 0.25f,
+	};
+
+	SH9Color ret;
+	for (uint32_t i = 0; i < kNumCoefficients; ++i)
+	{
+		const XMFLOAT3& c = radiance.Coefficients[i];
+		ret.Coefficients[i] = XMFLOAT3(c.x * kBandScale[i], c.y * kBandScale[i], c.z * kBandScale[i]);
+	}
+	return ret;
+}
+
+XMFLOAT3 SH::Evaluate(const SH9Color& sh, const XMFLOAT3& dir)
+{
+	double x = dir.x, y = dir.y, z = dir.z;
+	const double len = std::sqrt(x * x + y * y + z * z);
+	if (len > 0.0)
+	{
+		x /= len;
+		y /= len;
+		z /= len;
+	}
+
+	const double basis[kNumCoefficients] =
+	{
+		kY00,
+		kY1m * y,
+		kY1m * z,
+		kY1m * x,
+		kY2a * x * y,
+		kY2a * y * z,
+		kY20 * (3.0 * z * z - 1.0),
+		kY2a * x * z,
+		kY22 * (x * x - y * y),
+	};
+
+	double r = 0.0, g = 0.0, b = 0.0;
+	for (uint32_t i = 0; i < kNumCoefficients; ++i)
+	{
+		r += sh.Coefficients[i].x * basis[i];
+		g += sh.Coefficients[i].y * basis[i];
+		b += sh.Coefficients[i].z * basis[i];
+	}
+	return XMFLOAT3((float)r, (float)g, (float)b);
+}
+
+IrradianceSHConstants SH::PackIrradianceConstants(const SH9Color& irradiance)
+{
+	// Layout from Sloan, "Stupid Spherical Harmonics (SH) Tricks": the shader evaluates
+	//   dot(SHA, float4(N, 1)) + dot(SHB, N.xyzz * N.yzzx) + SHC * (N.x^2 - N.y^2)
+	const XMFLOAT3* c = irradiance.Coefficients;
+	const float k0 = (float)kY00, k1 = (float)kY1m, k2 = (float)kY2a, k20 = (float)kY20, k22 = (float)kY22;
+
+	auto PackA = [&](float c0, float c1, float c2, float c3, float c6)
+	{
+		return XMFLOAT4(c3 * k1, c1 * k1, c2 * k1, c0 * k0 - c6 * k20);
+	};
+	auto PackB = [&](float c4, float c5, float c6, float c7)
+	{
+		return XMFLOAT4(c4 * k2, c5 * k2, c6 * 3.0f * k20, c7 * k2);
+	};
+
+	IrradianceSHConstants ret;
+	ret.SHAr = PackA(c[0].x, c[1].x, c[2].x, c[3].x, c[6].x);
+	ret.SHAg = PackA(c[0].y, c[1].y, c[2].y, c[3].y, c[6].y);
+	ret.SHAb = PackA(c[0].z, c[1].z, c[2].z, c[3].z, c[6].z);
+	ret.SHBr = PackB(c[4].x, c[5].x, c[6].x, c[7].x);
+	ret.SHBg = PackB(c[4].y, c[5].y, c[6].y, c[7].y);
+	ret.SHBb = PackB(c[4].z, c[5].z, c[6].z, c[7].z);
+	ret.SHC = XMFLOAT4(c[8].x * k22, c[8].y * k22, c[8].z * k22, 0.0f);
+	return ret;
+}
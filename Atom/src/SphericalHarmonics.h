@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ConstantBuffers.h"
+
+// Order-2 real spherical harmonics (9 coefficients per channel) for diffuse image based lighting.
+// An HDR environment is projected on the CPU once at startup; the PBR pixel shader then evaluates
+// irradiance from 27 floats in a constant buffer instead of sampling an irradiance cubemap.
+namespace SH
+{
+	static const uint32_t kNumCoefficients = 9;
+
+	struct SH9Color
+	{
+		DirectX::XMFLOAT3 Coefficients[kNumCoefficients];
+	};
+
+	// Project an equirectangular RGBA32F image (the layout stbi_loadf returns with 4 channels) into SH9.
+	// Row 0 is the +Y pole, matching EquirectToCubeCS.  Every texel is weighted by its solid angle.
+	// The rows are split into numThreads chunks, 0 for one per hardware thread, run on the JobSystem when it is
+	// running; the result only depends on the chunk count.
+	SH9Color ProjectEquirect(const float* rgba, uint32_t width, uint32_t height, uint32_t numThreads = 0);
+
+	// Project a cubemap given as six RGBA32F faces (+X, -X, +Y, -Y, +Z, -Z) of faceSize x faceSize texels,
+	// oriented the same way as g_EnvirMap.
+	SH9Color ProjectCubemap(const float* const faces[6], uint32_t faceSize, uint32_t numThreads = 0);
+
+	// Convolve projected radiance with the clamped cosine lobe.  The result is irradiance / PI, which is
+	// what the irradiance cubemap used to store, so the shading code needs no extra scale.
+	SH9Color ConvolveIrradiance(const SH9Color& radiance);
+
+	// Reconstruct the function in direction dir (need not be normalized).
+	DirectX::XMFLOAT3 Evaluate(const SH9Color& sh, const DirectX::XMFLOAT3& dir);
+
+	// Fold the basis constants into the coefficients for EvaluateIrradianceSH() in PBRCommon.hlsli.
+	IrradianceSHConstants PackIrradianceConstants(const SH9Color& irradiance);
+}
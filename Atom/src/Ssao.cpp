@@ -1,9 +1,9 @@
 #include "pch.h"
 #include "Ssao.h"
 #include "GraphicsCore.h"
+#include "GpuMemory.h"
 #include "Display.h"
 #include "BufferManager.h"
-#include "MathHelper.h"
 #include "Camera.h"
 #include "CommandContext.h"
 #include "Renderer.h"
@@ -11,6 +11,8 @@
 #include "RootSignature.h"
 #include "GraphicsCommon.h"
 #include "PipelineState.h"
+#include "Sampling.h"
+#include "FileSystem.h"
 
 namespace shader
 {
@@ -33,6 +35,7 @@ namespace
     GraphicsPSO s_SsaoPso(L"SSAO PSO");
 
     ComPtr<ID3D12Resource> s_RandomVectorMapUploadBuffer;
+    const uint32_t kRandomVectorMapSize = 64;
 
     const UINT64 s_SsaoCbuferSize = sizeof(SsaoConstants);
 
@@ -116,6 +119,7 @@ void SSAO::Initialize()
         nullptr,
         IID_PPV_ARGS(s_SsaoCbuffer.GetAddressOf())
     ));
+    GpuMemory::Track(s_SsaoCbuffer.Get(), GpuMemoryTracker::kOther);
     BuildRandomVectorTexture(gfxContext.GetCommandList());
     BuildOffsetVectors();
 
@@ -214,7 +218,14 @@ void SSAO::Render(GraphicsContext& GfxContext, const Math::Camera& camera)
 
 void BuildRandomVectorTexture(ID3D12GraphicsCommandList* CmdList)
 {
-    g_RandomVectorBuffer.Create(L"Random Vector Buffer", 256, 256, 1, DXGI_FORMAT_R8G8B8A8_UNORM);
+    // Blue noise instead of white noise: neighbouring pixels get dissimilar vectors, so the blur pass removes
+    // the pattern with less smearing.  Each channel is an independent blue noise, read 1:1 per pixel by SsaoPS.
+    IBL::TextureData noise;
+    Sampling::BlueNoiseSettings settings;
+    settings.Size = kRandomVectorMapSize;
+    Sampling::LoadOrGenerateBlueNoise(FileSystem::GetFullPath("Assets/Cache/Sampling"), noise, settings);
+
+    g_RandomVectorBuffer.Create(L"Random Vector Buffer", kRandomVectorMapSize, kRandomVectorMapSize, 1, DXGI_FORMAT_R8G8B8A8_UNORM);
 
     auto texDesc = g_RandomVectorBuffer.GetResource()->GetDesc();
 
@@ -228,23 +239,12 @@ void BuildRandomVectorTexture(ID3D12GraphicsCommandList* CmdList)
         D3D12_RESOURCE_STATE_GENERIC_READ,
         nullptr,
         IID_PPV_ARGS(s_RandomVectorMapUploadBuffer.GetAddressOf())));
-
-    XMCOLOR initData[256 * 256];
-    for (int i = 0; i < 256; ++i)
-    {
-        for (int j = 0; j < 256; ++j)
-        {
-            // Random vector in [0,1].  We will decompress in shader to [-1,1].
-            XMFLOAT3 v(MathHelper::RandF(), MathHelper::RandF(), MathHelper::RandF());
-
-            initData[i * 256 + j] = XMCOLOR(v.x, v.y, v.z, 0.0f);
-        }
-    }
+    GpuMemory::Track(s_RandomVectorMapUploadBuffer.Get(), GpuMemoryTracker::kUploadPages);
 
     D3D12_SUBRESOURCE_DATA subResourceData = {};
-    subResourceData.pData = initData;
-    subResourceData.RowPitch = 256 * sizeof(XMCOLOR);
-    subResourceData.SlicePitch = subResourceData.RowPitch * 256;
+    subResourceData.pData = noise.GetData();
+    subResourceData.RowPitch = kRandomVectorMapSize * 4;
+    subResourceData.SlicePitch = subResourceData.RowPitch * kRandomVectorMapSize;
 
     //
     // Schedule to copy the data to the default resource, and change states.
@@ -298,8 +298,8 @@ void BuildOffsetVectors()
 
     for (int i = 0; i < 14; ++i)
     {
-        // Create random lengths in [0.25, 1.0].
-        float s = MathHelper::RandF(0.25f, 1.0f);
+        // Stratified lengths in [0.25, 1.0] so near and far occluders are both covered.
+        float s = 0.25f + 0.75f * Sampling::SobolOwen(i, 0, 0);
 
         Vector4 v = s * Math::Normalize(mOffsets[i]);
 
@@ -2,12 +2,23 @@
 #include "CommandContext.h"
 #include "GraphicsCore.h"
 #include "TextureManager.h"
+#include "TextureResidency.h"
+#include "KTX2Loader.h"
+#include "UploadBatch.h"
+#include "GpuHeapAllocator.h"
+#include "GpuMemory.h"
+#include "FrameArena.h"
+#include "DeferredRelease.h"
+#include "Hash.h"
 #include "stb_image/stb_image.h"
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
 using namespace Graphics;
 using namespace DirectX;
 using namespace DirectX::PackedVector;
-std::vector<XMHALF4> ConvertToHalf(const float* floatData, int pixelCount) {
-	std::vector<XMHALF4> halfData(pixelCount);
+std::pmr::vector<XMHALF4> ConvertToHalf(const float* floatData, int pixelCount, std::pmr::memory_resource* memory) {
+	std::pmr::vector<XMHALF4> halfData(pixelCount, memory);
 	for (int i = 0; i < pixelCount; i++) {
 		halfData[i] = XMHALF4(
 			floatData[i * 4 + 0],
@@ -18,33 +29,132 @@ std::vector<XMHALF4> ConvertToHalf(const float* floatData, int pixelCount) {
 	}
 	return halfData;
 }
+void BuildMipChain(const unsigned char* data, uint32_t width, uint32_t height, std::vector<std::vector<uint8_t>>& mips)
+{
+	mips.clear();
+	mips.emplace_back(data, data + (size_t)width * height * 4);
+
+	while (width > 1 || height > 1)
+	{
+		const uint32_t mipWidth = std::max(1u, width / 2);
+		const uint32_t mipHeight = std::max(1u, height / 2);
+		const std::vector<uint8_t>& src = mips.back();
+		std::vector<uint8_t> dst((size_t)mipWidth * mipHeight * 4);
+
+		for (uint32_t y = 0; y < mipHeight; ++y)
+		{
+			const uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+			for (uint32_t x = 0; x < mipWidth; ++x)
+			{
+				const uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					const uint32_t sum = src[((size_t)y0 * width + x0) * 4 + c] + src[((size_t)y0 * width + x1) * 4 + c] +
+						src[((size_t)y1 * width + x0) * 4 + c] + src[((size_t)y1 * width + x1) * 4 + c];
+					dst[((size_t)y * mipWidth + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+				}
+			}
+		}
+
+		mips.push_back(std::move(dst));
+		width = mipWidth;
+		height = mipHeight;
+	}
+}
+
+class ManagedTexture;
+
+namespace TextureManager
+{
+	void DestroyTexture(ManagedTexture* tex);
+}
+
 class ManagedTexture : public Texture
 {
 	friend class TextureRef;
+	friend bool TextureManager::UpdateStreaming();
+	friend void TextureManager::DestroyTexture(ManagedTexture* tex);
 public:
 	ManagedTexture(const std::wstring& fileName);
+	~ManagedTexture();
 
 	void WaitForLoad() const;
 	void CreateFromMemory(unsigned char* data, uint64_t width, uint64_t height, eDefaultTexture fallbak, bool forceSRGB);
 	void CreateFromMemory(float* data, uint64_t width, uint64_t height);
+	// Any format and layout, e.g. a block compressed KTX2 file.  Not streamed.
+	void CreateFromTextureData(const KTX2::TextureData* data, eDefaultTexture fallback);
 private:
 	void Unload();
 	bool IsValid() const { return m_IsValid; }
+
+	// (Re)creates the GPU texture holding levels residentMip..N-1 of m_MipData and points the SRV at it.
+	void CreateResidentMips(uint32_t residentMip);
+	void StopStreaming();
 private:
 	std::wstring m_MapKey; // for deleting from map later
+	// Content keyed textures: size and a second hash of the source, seeded apart from the key's, to tell
+	// collisions of the key apart without keeping the file around.
+	size_t m_EncodedSize = 0;
+	uint64_t m_EncodedCheck = 0;
 	bool m_IsValid = false;
-	bool m_IsLoading = true;
-	size_t m_ReferenceCount = 0;
+	std::atomic<bool> m_IsLoading = true;
+	std::atomic<size_t> m_ReferenceCount = 0;
 
+	// Streamed textures keep their full mip chain in system memory and only the resident levels on the GPU.
+	std::vector<std::vector<uint8_t>> m_MipData;
+	uint32_t m_StreamingId = TextureResidencyManager::kInvalidId;
+	uint32_t m_ResidentMip = 0;
 };
 
 namespace TextureManager
 {
 	std::wstring s_RootPath = L"";
-	std::map<std::wstring, std::unique_ptr<ManagedTexture>> s_TextureCache;
 
-	std::mutex s_Mutex;
-	ManagedTexture* FindOrLoadTexture(const std::wstring& fileName, eDefaultTexture fallback, bool forceSRGB);
+	// Declared before the cache so it outlives the textures that unregister from it.
+	TextureResidencyManager s_Residency;
+	std::mutex s_ResidencyMutex;
+	bool s_StreamingEnabled = true;
+	std::vector<TextureResidencyManager::MipChange> s_MipChanges;
+	std::vector<ManagedTexture*> s_StreamedTextures;
+
+	// The cache is split into shards with their own lock so loads of unrelated files do not serialize.
+	// A reference is only ever taken from the cache while holding the shard lock, which is what lets
+	// DestroyTexture() tell a dead texture from one that was just looked up again.
+	static const uint32_t kNumCacheShards = 16;
+
+	struct CacheShard
+	{
+		std::mutex Mutex;
+		std::unordered_map<std::wstring, std::unique_ptr<ManagedTexture>> Textures;
+	};
+	CacheShard s_CacheShards[kNumCacheShards];
+
+	// Textures whose last reference was dropped.  UpdateStreaming() hands them to the deferred release queue,
+	// which frees them after the GPU has finished any frame recorded before the release.
+	std::mutex s_ReleaseMutex;
+	std::vector<std::unique_ptr<ManagedTexture>> s_ReleasedTextures;
+
+	CacheShard& GetShard(const std::wstring& key)
+	{
+		return s_CacheShards[std::hash<std::wstring>()(key) % kNumCacheShards];
+	}
+
+	// Returns the cached texture for key, creating an empty one if needed; isNew tells the caller to load it.
+	ManagedTexture* FindOrCreateTexture(const std::wstring& key, TextureRef& ref, bool& isNew)
+	{
+		CacheShard& shard = GetShard(key);
+		std::lock_guard<std::mutex> Guard(shard.Mutex);
+
+		std::unique_ptr<ManagedTexture>& entry = shard.Textures[key];
+		isNew = entry == nullptr;
+		if (isNew)
+			entry.reset(new ManagedTexture(key));
+
+		ref = TextureRef(entry.get());
+		return entry.get();
+	}
+
+	TextureRef FindOrLoadTexture(const std::wstring& fileName, eDefaultTexture fallback, bool forceSRGB);
 	void Initialize(const std::wstring& rootPath)
 	{
 		s_RootPath = rootPath;
@@ -52,38 +162,77 @@ namespace TextureManager
 
 	void Shutdown(void)
 	{
-		s_TextureCache.clear();
+		for (CacheShard& shard : s_CacheShards)
+		{
+			std::lock_guard<std::mutex> Guard(shard.Mutex);
+			shard.Textures.clear();
+		}
+
+		std::lock_guard<std::mutex> Guard(s_ReleaseMutex);
+		s_ReleasedTextures.clear();
 	}
 
-	TextureRef LoadTexFromFile(const std::wstring& filePath, eDefaultTexture fallback, bool sRGB)
+	void SetStreamingEnabled(bool enable)
 	{
-		return FindOrLoadTexture(filePath, fallback, sRGB);
+		s_StreamingEnabled = enable;
 	}
 
-	TextureRef LoadHdrFromFile(const std::wstring& filePath)
+	void SetStreamingBudget(uint64_t budgetBytes)
+	{
+		std::lock_guard<std::mutex> Guard(s_ResidencyMutex);
+		s_Residency.SetBudget(budgetBytes);
+	}
+
+	TextureResidencyManager::Stats GetStreamingStats()
 	{
-		ManagedTexture* tex = nullptr;
+		std::lock_guard<std::mutex> Guard(s_ResidencyMutex);
+		return s_Residency.GetStats();
+	}
+
+	bool UpdateStreaming()
+	{
+		CommandQueue& queue = g_CommandManager.GetGraphicsQueue();
 
 		{
-			std::lock_guard<std::mutex> Guard(s_Mutex);
+			std::lock_guard<std::mutex> Guard(s_ReleaseMutex);
+			for (std::unique_ptr<ManagedTexture>& tex : s_ReleasedTextures)
+				DeferredRelease::Defer(queue.GetNextFenceValue() - 1, [Texture = tex.release()] { delete Texture; });
+			s_ReleasedTextures.clear();
+		}
 
-			std::wstring key = filePath;
+		std::lock_guard<std::mutex> Guard(s_ResidencyMutex);
+		s_Residency.Update(s_MipChanges);
 
-			// If a texture was already created make sure it has finished loading before
-			// returning a point to it.
-			if (auto iter = s_TextureCache.find(key); iter != s_TextureCache.end())
-			{
-				tex = iter->second.get();
-				tex->WaitForLoad();
-				return tex;
-			}
-			else
-			{
-				// If it's not found, create a new managed texture and start loading it
+		// One command list for all of this frame's mip changes, submitted when the batch goes out of scope.
+		UploadBatch uploads(L"Texture Streaming");
+		UploadBatch::Scope uploadScope(uploads);
+		for (const TextureResidencyManager::MipChange& change : s_MipChanges)
+		{
+			ManagedTexture* tex = s_StreamedTextures[change.TextureId];
+			// The old resource may still be read by frames in flight.
+			DeferredRelease::Release(tex->m_pResource);
+			tex->CreateResidentMips(change.ResidentMip);
+		}
+		return !s_MipChanges.empty();
+	}
 
-				tex = new ManagedTexture(key);
-				s_TextureCache[key].reset(tex);
-			}
+	TextureRef LoadTexFromFile(const std::wstring& filePath, eDefaultTexture fallback, bool sRGB)
+	{
+		return FindOrLoadTexture(filePath, fallback, sRGB);
+	}
+
+	TextureRef LoadHdrFromFile(const std::wstring& filePath)
+	{
+		TextureRef ref;
+		bool isNew = false;
+		ManagedTexture* tex = FindOrCreateTexture(filePath, ref, isNew);
+
+		// If a texture was already created make sure it has finished loading before
+		// returning a point to it.
+		if (!isNew)
+		{
+			tex->WaitForLoad();
+			return ref;
 		}
 
 		// Create Texture
@@ -94,8 +243,9 @@ namespace TextureManager
 			abort();
 		}
 		tex->CreateFromMemory(data, width, height);
+		stbi_image_free(data);
 		// This was the first time it was requested, so indicate that the caller must read the file
-		return tex;
+		return ref;
 	}
 
 	TextureRef LoadTexFromMemory(unsigned char* data, uint64_t width, uint64_t height, eDefaultTexture fallback, bool sRGB )
@@ -105,34 +255,77 @@ namespace TextureManager
 		return tex;
 	}
 
-
-
-	ManagedTexture* FindOrLoadTexture(const std::wstring& fileName, eDefaultTexture fallback, bool forceSRGB)
+	TextureRef LoadTexFromEncodedMemory(const void* encoded, size_t size, eDefaultTexture fallback, bool sRGB, const DecodeFunc& decode)
 	{
-		ManagedTexture* tex = nullptr;
-
+		// '<' cannot appear in a file name, so content keys never clash with LoadTexFromFile().  On a collision
+		// the next probe index is tried.
+		const uint64_t kCheckSeed = 0x9E3779B97F4A7C15ull;
+		const uint64_t hash = Utility::HashBytes(encoded, size);
+		const uint64_t check = Utility::HashBytes(encoded, size, kCheckSeed);
+		for (uint32_t probe = 0;; ++probe)
 		{
-			std::lock_guard<std::mutex> Guard(s_Mutex);
+			wchar_t key[48];
+			swprintf(key, 48, L"<encoded:%016llx:%u:%d>", (unsigned long long)hash, probe, sRGB ? 1 : 0);
 
-			std::wstring key = fileName;
-			//if (forceSRGB)
-				//key += L"_sRGB";
+			TextureRef ref;
+			bool isNew = false;
+			ManagedTexture* tex = FindOrCreateTexture(key, ref, isNew);
 
-			// If a texture was already created make sure it has finished loading before
-			// returning a point to it.
-			if (auto iter = s_TextureCache.find(key); iter != s_TextureCache.end())
+			if (!isNew)
 			{
-				tex = iter->second.get();
 				tex->WaitForLoad();
-				return tex;
+				if (tex->m_EncodedSize == size && tex->m_EncodedCheck == check)
+					return ref;
+				continue;
 			}
-			else
-			{
-				// If it's not found, create a new managed texture and start loading it
 
-				tex = new ManagedTexture(key);
-				s_TextureCache[key].reset(tex);
+			tex->m_EncodedSize = size;
+			tex->m_EncodedCheck = check;
+
+			std::vector<uint8_t> rgba;
+			uint32_t width = 0, height = 0;
+			if (decode)
+			{
+				const bool decoded = decode(rgba, width, height);
+				tex->CreateFromMemory(decoded ? rgba.data() : nullptr, width, height, fallback, sRGB);
+				return ref;
 			}
+
+			int w = 0, h = 0, channels = 0;
+			auto data = stbi_load_from_memory((const stbi_uc*)encoded, (int)size, &w, &h, &channels, STBI_rgb_alpha);
+			tex->CreateFromMemory(data, w, h, fallback, sRGB);
+			if (data != nullptr)
+				stbi_image_free(data);
+			return ref;
+		}
+	}
+
+
+
+	TextureRef FindOrLoadTexture(const std::wstring& fileName, eDefaultTexture fallback, bool forceSRGB)
+	{
+		std::wstring key = fileName;
+		//if (forceSRGB)
+			//key += L"_sRGB";
+
+		TextureRef ref;
+		bool isNew = false;
+		ManagedTexture* tex = FindOrCreateTexture(key, ref, isNew);
+
+		// If a texture was already created make sure it has finished loading before
+		// returning a point to it.
+		if (!isNew)
+		{
+			tex->WaitForLoad();
+			return ref;
+		}
+
+		if (_wcsicmp(std::filesystem::path(fileName).extension().c_str(), L".ktx2") == 0)
+		{
+			KTX2::TextureData data;
+			const bool loaded = KTX2::LoadFile(fileName, data);
+			tex->CreateFromTextureData(loaded ? &data : nullptr, fallback);
+			return ref;
 		}
 
 		int width = 0, height = 0, channels = 0;
@@ -140,19 +333,45 @@ namespace TextureManager
 		auto data = stbi_load(Utility::WStringToString(fileName).c_str(), &width, &height, &channels, STBI_rgb_alpha);
 
 		tex->CreateFromMemory(data, width, height, fallback, forceSRGB);
+		if (data != nullptr)
+			stbi_image_free(data);
 		// This was the first time it was requested, so indicate that the caller must read the file
-		return tex;
+		return ref;
 	}
 
 
-	void DestroyTexture(const std::wstring& key)
+	// Called when the reference count reached zero.  A concurrent lookup may have revived the texture
+	// before we got the shard lock, in which case it stays.
+	void DestroyTexture(ManagedTexture* tex)
 	{
-		std::lock_guard<std::mutex> Guard(s_Mutex);
+		std::unique_ptr<ManagedTexture> released;
 
-		if (auto iter = s_TextureCache.find(key); iter != s_TextureCache.end())
+		if (tex->m_MapKey.empty())
+		{
+			// Not in the cache (LoadTexFromMemory), so nothing can look it up again.
+			released.reset(tex);
+		}
+		else
 		{
-			s_TextureCache.erase(iter);
+			CacheShard& shard = GetShard(tex->m_MapKey);
+			std::lock_guard<std::mutex> Guard(shard.Mutex);
+
+			auto iter = shard.Textures.find(tex->m_MapKey);
+			if (iter == shard.Textures.end() || iter->second.get() != tex || tex->m_ReferenceCount != 0)
+				return;
+
+			released = std::move(iter->second);
+			shard.Textures.erase(iter);
 		}
+
+		released->StopStreaming();
+
+		// The slot is reused once the GPU is past the frames that may still sample the texture.
+		if (released->m_IsValid)
+			FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, released->m_hCpuDescriptorHandle);
+
+		std::lock_guard<std::mutex> Guard(s_ReleaseMutex);
+		s_ReleasedTextures.push_back(std::move(released));
 	}
 }
 
@@ -162,9 +381,26 @@ ManagedTexture::ManagedTexture(const std::wstring& fileName)
 {
 }
 
+ManagedTexture::~ManagedTexture()
+{
+	StopStreaming();
+}
+
+void ManagedTexture::StopStreaming()
+{
+	if (m_StreamingId != TextureResidencyManager::kInvalidId)
+	{
+		std::lock_guard<std::mutex> Guard(TextureManager::s_ResidencyMutex);
+		TextureManager::s_Residency.Unregister(m_StreamingId);
+		TextureManager::s_StreamedTextures[m_StreamingId] = nullptr;
+		m_StreamingId = TextureResidencyManager::kInvalidId;
+	}
+	m_MipData.clear();
+}
+
 void ManagedTexture::WaitForLoad() const
 {
-	while ((volatile bool&)m_IsLoading)
+	while (m_IsLoading)
 		std::this_thread::yield();
 }
 
@@ -178,45 +414,31 @@ void ManagedTexture::CreateFromMemory(unsigned char* data, uint64_t width, uint6
 	{
 		// We probably have a texture to load, so let's allocate a new descriptor
 		m_hCpuDescriptorHandle = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		m_Width = (uint32_t)width;
+		m_Height = (uint32_t)height;
+		m_Depth = 1;
 
-		D3D12_RESOURCE_DESC textureDesc = {};
-		textureDesc.MipLevels = 1;
-		textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-		textureDesc.Width = width;
-		textureDesc.Height = height;
-		textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-		textureDesc.DepthOrArraySize = 1;
-		textureDesc.SampleDesc.Count = 1;
-		textureDesc.SampleDesc.Quality = 0;
-		textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		BuildMipChain(data, m_Width, m_Height, m_MipData);
 
-		//if (forceSRGB)
-		//	textureDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
-
-		ASSERT_SUCCEEDED(g_Device->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-			D3D12_HEAP_FLAG_NONE,
-			&textureDesc,
-			D3D12_RESOURCE_STATE_COPY_DEST,
-			nullptr,
-			IID_PPV_ARGS(m_pResource.GetAddressOf())
-		));
-		D3D12_SUBRESOURCE_DATA textureData = {};
-		textureData.pData = data;
-		textureData.RowPitch = width * 4;
-		textureData.SlicePitch = textureData.RowPitch * height;
-
-		GpuResource destTexture(m_pResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
-		CommandContext::InitializeTexture(destTexture, 1, &textureData);
-
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Format = textureDesc.Format;
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-		srvDesc.Texture2D.MipLevels = -1;
-		srvDesc.Texture2D.MostDetailedMip = 0;
+		uint32_t residentMip = 0;
+		if (TextureManager::s_StreamingEnabled)
+		{
+			// Start with the mip tail only; UpdateStreaming() brings in finer levels once the renderer asks for them.
+			std::lock_guard<std::mutex> Guard(TextureManager::s_ResidencyMutex);
+			m_StreamingId = TextureManager::s_Residency.Register(m_Width, m_Height, (uint32_t)m_MipData.size(), 4);
+			if (m_StreamingId != TextureResidencyManager::kInvalidId)
+			{
+				if (TextureManager::s_StreamedTextures.size() <= m_StreamingId)
+					TextureManager::s_StreamedTextures.resize(m_StreamingId + 1);
+				TextureManager::s_StreamedTextures[m_StreamingId] = this;
+				residentMip = TextureManager::s_Residency.GetResidentMip(m_StreamingId);
+			}
+		}
+
+		CreateResidentMips(residentMip);
 
-		g_Device->CreateShaderResourceView(m_pResource.Get(), &srvDesc, m_hCpuDescriptorHandle);
+		if (m_StreamingId == TextureResidencyManager::kInvalidId)
+			m_MipData.clear();
 
 		m_IsValid = true;
 	}
@@ -226,7 +448,7 @@ void ManagedTexture::CreateFromMemory(unsigned char* data, uint64_t width, uint6
 
 void ManagedTexture::CreateFromMemory(float* data, uint64_t width, uint64_t height)
 {
-	std::vector<XMHALF4> halfData = ConvertToHalf(data, width * height);
+	std::pmr::vector<XMHALF4> halfData = ConvertToHalf(data, width * height, FrameAllocator::Get());
 	// We probably have a texture to load, so let's allocate a new descriptor
 	m_hCpuDescriptorHandle = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
@@ -242,14 +464,14 @@ void ManagedTexture::CreateFromMemory(float* data, uint64_t width, uint64_t heig
 	textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 
 
-	ASSERT_SUCCEEDED(g_Device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&textureDesc,
+	ASSERT_SUCCEEDED(GpuHeapAllocator::CreateResource(
+		D3D12_HEAP_TYPE_DEFAULT,
+		textureDesc,
 		D3D12_RESOURCE_STATE_COPY_DEST,
 		nullptr,
-		IID_PPV_ARGS(m_pResource.GetAddressOf())
+		m_pResource.ReleaseAndGetAddressOf()
 	));
+	GpuMemory::Track(m_pResource.Get(), GpuMemoryTracker::kTextures);
 	D3D12_SUBRESOURCE_DATA textureData = {};
 	textureData.pData = halfData.data();
 	textureData.RowPitch = width * 4 * 2;
@@ -272,9 +494,125 @@ void ManagedTexture::CreateFromMemory(float* data, uint64_t width, uint64_t heig
 	m_IsLoading = false;
 }
 
+void ManagedTexture::CreateFromTextureData(const KTX2::TextureData* data, eDefaultTexture fallback)
+{
+	if (data == nullptr)
+	{
+		m_hCpuDescriptorHandle = GetDefaultTexture(fallback);
+		m_IsLoading = false;
+		return;
+	}
+
+	m_hCpuDescriptorHandle = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	m_Width = data->Width;
+	m_Height = data->Height;
+	m_Depth = 1;
+
+	ASSERT_SUCCEEDED(GpuHeapAllocator::CreateResource(
+		D3D12_HEAP_TYPE_DEFAULT,
+		CD3DX12_RESOURCE_DESC::Tex2D(data->Format, data->Width, data->Height, (UINT16)data->ArraySize, (UINT16)data->MipLevels),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		m_pResource.ReleaseAndGetAddressOf()
+	));
+	GpuMemory::Track(m_pResource.Get(), GpuMemoryTracker::kTextures);
+
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+	data->GetSubresourceData(subresources);
+	GpuResource destTexture(m_pResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+	CommandContext::InitializeTexture(destTexture, (UINT)subresources.size(), subresources.data());
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = data->Format;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	if (data->IsCubeMap && data->ArraySize == 6)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MipLevels = -1;
+	}
+	else if (data->IsCubeMap)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
+		srvDesc.TextureCubeArray.MipLevels = -1;
+		srvDesc.TextureCubeArray.NumCubes = data->ArraySize / 6;
+	}
+	else if (data->ArraySize > 1)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MipLevels = -1;
+		srvDesc.Texture2DArray.ArraySize = data->ArraySize;
+	}
+	else
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = -1;
+	}
+	g_Device->CreateShaderResourceView(m_pResource.Get(), &srvDesc, m_hCpuDescriptorHandle);
+
+	m_IsValid = true;
+	m_IsLoading = false;
+}
+
+void ManagedTexture::CreateResidentMips(uint32_t residentMip)
+{
+	ASSERT(residentMip < m_MipData.size());
+
+	const uint32_t mipLevels = (uint32_t)m_MipData.size() - residentMip;
+
+	D3D12_RESOURCE_DESC textureDesc = {};
+	textureDesc.MipLevels = (UINT16)mipLevels;
+	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	textureDesc.Width = std::max(1u, m_Width >> residentMip);
+	textureDesc.Height = std::max(1u, m_Height >> residentMip);
+	textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+	textureDesc.DepthOrArraySize = 1;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+
+	//if (forceSRGB)
+	//	textureDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	ASSERT_SUCCEEDED(GpuHeapAllocator::CreateResource(
+		D3D12_HEAP_TYPE_DEFAULT,
+		textureDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		resource.GetAddressOf()
+	));
+	GpuMemory::Track(resource.Get(), GpuMemoryTracker::kTextures);
+
+	std::vector<D3D12_SUBRESOURCE_DATA> textureData(mipLevels);
+	for (uint32_t i = 0; i < mipLevels; ++i)
+	{
+		const uint32_t mip = residentMip + i;
+		textureData[i].pData = m_MipData[mip].data();
+		textureData[i].RowPitch = std::max(1u, m_Width >> mip) * 4;
+		textureData[i].SlicePitch = textureData[i].RowPitch * std::max(1u, m_Height >> mip);
+	}
+
+	GpuResource destTexture(resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+	CommandContext::InitializeTexture(destTexture, mipLevels, textureData.data());
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = textureDesc.Format;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = -1;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+
+	g_Device->CreateShaderResourceView(resource.Get(), &srvDesc, m_hCpuDescriptorHandle);
+
+	// The SRV was rewritten in place; tables holding a copy of it must copy it again.
+	m_pResource = resource;
+	m_ResidentMip = residentMip;
+	++m_VersionID;
+}
+
 void ManagedTexture::Unload()
 {
-	TextureManager::DestroyTexture(m_MapKey);
+	TextureManager::DestroyTexture(this);
 }
 
 
@@ -293,27 +631,31 @@ TextureRef::TextureRef(ManagedTexture* tex)
 }
 
 TextureRef::~TextureRef()
+{
+	Release();
+}
+
+void TextureRef::Release()
 {
 	if (m_Ref != nullptr && --m_Ref->m_ReferenceCount == 0)
 		m_Ref->Unload();
+	m_Ref = nullptr;
 }
+
 void TextureRef::operator= (std::nullptr_t)
 {
-	if (m_Ref != nullptr)
-		--m_Ref->m_ReferenceCount;
-
-	m_Ref = nullptr;
+	Release();
 }
 
-void TextureRef::operator= (TextureRef& rhs)
+void TextureRef::operator= (const TextureRef& rhs)
 {
-	if (m_Ref != nullptr)
-		--m_Ref->m_ReferenceCount;
-
-	m_Ref = rhs.m_Ref;
+	// Take the new reference first so self assignment cannot drop the last one.
+	ManagedTexture* tex = rhs.m_Ref;
+	if (tex != nullptr)
+		++tex->m_ReferenceCount;
 
-	if (m_Ref != nullptr)
-		++m_Ref->m_ReferenceCount;
+	Release();
+	m_Ref = tex;
 }
 
 bool TextureRef::IsValid() const
@@ -332,6 +674,19 @@ const Texture* TextureRef::operator->(void) const
 	return m_Ref;
 }
 
+void TextureRef::RequestResolution(float screenPixels, float priority) const
+{
+	if (m_Ref == nullptr)
+		return;
+
+	// StopStreaming() clears the id under the same lock.
+	std::lock_guard<std::mutex> Guard(TextureManager::s_ResidencyMutex);
+	if (m_Ref->m_StreamingId == TextureResidencyManager::kInvalidId)
+		return;
+	TextureManager::s_Residency.RequestMip(m_Ref->m_StreamingId,
+		TextureResidencyManager::ComputeMip(m_Ref->m_Width, m_Ref->m_Height, screenPixels), priority);
+}
+
 D3D12_CPU_DESCRIPTOR_HANDLE TextureRef::GetSRV() const
 {
 	if (m_Ref != nullptr)
@@ -2,9 +2,14 @@
 
 #include "Texture.h"
 #include "GraphicsCommon.h"
+#include "TextureResidency.h"
+#include <functional>
 
 class TextureRef;
 
+// Box filtered RGBA8 mip chain down to 1x1, level 0 is a copy of the source.
+void BuildMipChain(const unsigned char* data, uint32_t width, uint32_t height, std::vector<std::vector<uint8_t>>& mips);
+
 namespace TextureManager
 {
 	using namespace Graphics;
@@ -12,9 +17,28 @@ namespace TextureManager
 	void Initialize(const std::wstring& rootPath);
 	void Shutdown();
 
+	// .ktx2 files go through KTX2Loader.h, everything else through stb_image.
 	TextureRef LoadTexFromFile(const std::wstring& filePath, eDefaultTexture = kMagenta2D, bool sRGB = false);
 	TextureRef LoadHdrFromFile(const std::wstring& filePath);
 	TextureRef LoadTexFromMemory(unsigned char* data, uint64_t width, uint64_t height, eDefaultTexture = kMagenta2D, bool sRGB = false);
+	// Encoded image file (PNG, JPG, ...) already in memory, e.g. embedded in a GLB.  Identical bytes share one
+	// texture: they are keyed by a 64 bit content hash, and a hit is confirmed by the size and a second, differently
+	// seeded 64 bit hash rather than the bytes, which are not kept.  Two files alias only if both hashes collide.
+	// decode, if given, supplies the RGBA8 pixels on a miss instead of stb_image, e.g. when they were decoded already.
+	using DecodeFunc = std::function<bool(std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height)>;
+	TextureRef LoadTexFromEncodedMemory(const void* encoded, size_t size, eDefaultTexture = kMagenta2D, bool sRGB = false,
+		const DecodeFunc& decode = nullptr);
+
+	// Mip streaming for LDR textures.  Only affects textures created after the call.
+	void SetStreamingEnabled(bool enable);
+	void SetStreamingBudget(uint64_t budgetBytes);
+	TextureResidencyManager::Stats GetStreamingStats();
+
+	// Call once per frame before recording.  Frees textures released since the last call once the GPU is done
+	// with them, then applies the residency decisions for the mips requested through
+	// TextureRef::RequestResolution().  Returns true if any texture was recreated; SRVs keep their CPU
+	// handles, but copies of them in shader visible descriptor tables have to be refreshed.
+	bool UpdateStreaming();
 }
 
 class ManagedTexture;
@@ -27,7 +51,7 @@ public:
 	~TextureRef();
 
     void operator= (std::nullptr_t);
-    void operator= (TextureRef& rhs);
+    void operator= (const TextureRef& rhs);
 
     // Check that this points to a valid texture (which loaded successfully)
     bool IsValid() const;
@@ -41,7 +65,12 @@ public:
     const Texture* Get(void) const;
 
     const Texture* operator->(void) const;
+
+    // Streaming feedback: the texture covers about screenPixels along its larger axis this frame.
+    void RequestResolution(float screenPixels, float priority = 1.0f) const;
 private:
+	void Release();
+
 	ManagedTexture* m_Ref = nullptr;
 };
 
@@ -0,0 +1,301 @@
+#include "pch.h"
+#include "TexturePacker.h"
+#include <algorithm>
+
+namespace
+{
+	uint32_t AlignUp(uint32_t value, uint32_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	uint32_t NextPow2(uint32_t value)
+	{
+		uint32_t ret = 1;
+		while (ret < value)
+			ret <<= 1;
+		return ret;
+	}
+
+	uint32_t FullMipCount(uint32_t width, uint32_t height)
+	{
+		uint32_t mips = 1;
+		while ((width >> mips) > 0 || (height >> mips) > 0)
+			++mips;
+		return mips;
+	}
+
+	// Bottom-left skyline allocator (Jylanki, "A Thousand Ways to Pack the Bin").
+	class SkylineAllocator
+	{
+	public:
+		SkylineAllocator(uint32_t width, uint32_t height) : m_Width(width), m_Height(height)
+		{
+			m_Skyline.push_back({ 0, 0, width });
+		}
+
+		bool Allocate(uint32_t width, uint32_t height, uint32_t& outX, uint32_t& outY)
+		{
+			size_t bestIndex = SIZE_MAX;
+			uint32_t bestTop = UINT32_MAX, bestX = 0, bestY = 0;
+
+			for (size_t i = 0; i < m_Skyline.size(); ++i)
+			{
+				uint32_t y;
+				if (Fits(i, width, height, y) && (y + height < bestTop || (y + height == bestTop && m_Skyline[i].X < bestX)))
+				{
+					bestIndex = i;
+					bestTop = y + height;
+					bestX = m_Skyline[i].X;
+					bestY = y;
+				}
+			}
+
+			if (bestIndex == SIZE_MAX)
+				return false;
+
+			Insert(bestIndex, bestX, bestY + height, width);
+			m_MaxX = std::max(m_MaxX, bestX + width);
+			m_MaxY = std::max(m_MaxY, bestY + height);
+			outX = bestX;
+			outY = bestY;
+			return true;
+		}
+
+		uint32_t GetUsedWidth() const { return m_MaxX; }
+		uint32_t GetUsedHeight() const { return m_MaxY; }
+
+	private:
+		struct Segment
+		{
+			uint32_t X;
+			uint32_t Y;
+			uint32_t Width;
+		};
+
+		bool Fits(size_t index, uint32_t width, uint32_t height, uint32_t& outY) const
+		{
+			const uint32_t x = m_Skyline[index].X;
+			if (x + width > m_Width)
+				return false;
+
+			uint32_t y = 0;
+			uint32_t remaining = width;
+			for (size_t i = index; remaining > 0; ++i)
+			{
+				ASSERT(i < m_Skyline.size());
+				y = std::max(y, m_Skyline[i].Y);
+				if (y + height > m_Height)
+					return false;
+				remaining -= std::min(remaining, m_Skyline[i].Width);
+			}
+			outY = y;
+			return true;
+		}
+
+		void Insert(size_t index, uint32_t x, uint32_t y, uint32_t width)
+		{
+			m_Skyline.insert(m_Skyline.begin() + index, { x, y, width });
+
+			// Shrink or remove the segments now covered by the new one.
+			for (size_t i = index + 1; i < m_Skyline.size();)
+			{
+				Segment& seg = m_Skyline[i];
+				const uint32_t end = x + width;
+				if (seg.X >= end)
+					break;
+
+				const uint32_t overlap = end - seg.X;
+				if (overlap >= seg.Width)
+				{
+					m_Skyline.erase(m_Skyline.begin() + i);
+					continue;
+				}
+				seg.X += overlap;
+				seg.Width -= overlap;
+				break;
+			}
+
+			// Merge neighbours at the same height.
+			for (size_t i = 0; i + 1 < m_Skyline.size();)
+			{
+				if (m_Skyline[i].Y == m_Skyline[i + 1].Y)
+				{
+					m_Skyline[i].Width += m_Skyline[i + 1].Width;
+					m_Skyline.erase(m_Skyline.begin() + i + 1);
+				}
+				else
+				{
+					++i;
+				}
+			}
+		}
+
+		uint32_t m_Width;
+		uint32_t m_Height;
+		uint32_t m_MaxX = 0;
+		uint32_t m_MaxY = 0;
+		std::vector<Segment> m_Skyline;
+	};
+}
+
+TexturePacker::Result TexturePacker::Pack(const std::vector<Input>& inputs, const Settings& settings)
+{
+	ASSERT(settings.Padding > 0 && settings.MaxAtlasedSize + 2 * settings.Padding <= settings.AtlasSize);
+
+	Result result;
+	result.Placements.resize(inputs.size());
+
+	auto IsAtlased = [&](const Input& in)
+	{
+		return in.AllowAtlas && in.Width <= settings.MaxAtlasedSize && in.Height <= settings.MaxAtlasedSize;
+	};
+
+	// Largest first packs tighter; ties fall back to the input order so the result is deterministic.
+	std::vector<uint32_t> order(inputs.size());
+	for (uint32_t i = 0; i < (uint32_t)order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+		{
+			const Input& ia = inputs[a];
+			const Input& ib = inputs[b];
+			if (ia.Format != ib.Format)
+				return ia.Format < ib.Format;
+			if (IsAtlased(ia) != IsAtlased(ib))
+				return !IsAtlased(ia);
+			if (ia.Height != ib.Height)
+				return ia.Height > ib.Height;
+			return ia.Width > ib.Width;
+		});
+
+	// Arrays: one page per (format, width, height).
+	for (size_t i = 0; i < order.size();)
+	{
+		const Input& first = inputs[order[i]];
+		if (IsAtlased(first))
+		{
+			++i;
+			continue;
+		}
+
+		const uint32_t pageIndex = (uint32_t)result.Pages.size();
+		Page page;
+		page.Format = first.Format;
+		page.Width = first.Width;
+		page.Height = first.Height;
+		page.MipLevels = FullMipCount(first.Width, first.Height);
+
+		while (i < order.size() && page.ArraySize < settings.MaxArraySize)
+		{
+			const Input& in = inputs[order[i]];
+			if (IsAtlased(in) || in.Format != page.Format || in.Width != page.Width || in.Height != page.Height)
+				break;
+
+			Placement& placement = result.Placements[order[i]];
+			placement.Page = pageIndex;
+			placement.Slice = page.ArraySize++;
+			++i;
+		}
+
+		result.Pages.push_back(page);
+	}
+
+	// Atlases: one page per format, as many slices as needed.
+	for (size_t i = 0; i < order.size();)
+	{
+		const Input& first = inputs[order[i]];
+		if (!IsAtlased(first))
+		{
+			++i;
+			continue;
+		}
+
+		const uint32_t pageIndex = (uint32_t)result.Pages.size();
+		std::vector<SkylineAllocator> slices;
+		std::vector<uint32_t> members;
+
+		for (; i < order.size() && inputs[order[i]].Format == first.Format && IsAtlased(inputs[order[i]]); ++i)
+		{
+			const Input& in = inputs[order[i]];
+
+			// Keep entries aligned so the first few mips of neighbours never share a texel.
+			const uint32_t width = AlignUp(in.Width + 2 * settings.Padding, settings.Padding);
+			const uint32_t height = AlignUp(in.Height + 2 * settings.Padding, settings.Padding);
+
+			uint32_t x = 0, y = 0, slice = 0;
+			for (; slice < slices.size(); ++slice)
+			{
+				if (slices[slice].Allocate(width, height, x, y))
+					break;
+			}
+			if (slice == slices.size())
+			{
+				slices.emplace_back(settings.AtlasSize, settings.AtlasSize);
+				const bool allocated = slices.back().Allocate(width, height, x, y);
+				ASSERT(allocated);
+			}
+
+			Placement& placement = result.Placements[order[i]];
+			placement.Page = pageIndex;
+			placement.Slice = slice;
+			placement.X = x + settings.Padding;
+			placement.Y = y + settings.Padding;
+			members.push_back(order[i]);
+		}
+
+		Page page;
+		page.Format = first.Format;
+		page.ArraySize = (uint32_t)slices.size();
+		page.IsAtlas = true;
+		page.Width = settings.AtlasSize;
+		page.Height = settings.AtlasSize;
+
+		// A single slice only needs to be as large as what was placed in it.
+		if (slices.size() == 1)
+		{
+			page.Width = std::min(settings.AtlasSize, NextPow2(slices[0].GetUsedWidth()));
+			page.Height = std::min(settings.AtlasSize, NextPow2(slices[0].GetUsedHeight()));
+		}
+
+		// Mip n halves the padding; stop while there is still at least one border texel.
+		page.MipLevels = 1;
+		while ((settings.Padding >> page.MipLevels) >= 1 && page.MipLevels < FullMipCount(page.Width, page.Height))
+			++page.MipLevels;
+
+		for (uint32_t index : members)
+		{
+			Placement& placement = result.Placements[index];
+			placement.ScaleOffset = DirectX::XMFLOAT4(
+				(float)inputs[index].Width / page.Width, (float)inputs[index].Height / page.Height,
+				(float)placement.X / page.Width, (float)placement.Y / page.Height);
+		}
+
+		result.Pages.push_back(page);
+	}
+
+	for (const Input& in : inputs)
+		result.UsedTexels += (uint64_t)in.Width * in.Height;
+	for (const Page& page : result.Pages)
+		result.AllocatedTexels += (uint64_t)page.Width * page.Height * page.ArraySize;
+
+	return result;
+}
+
+void TexturePacker::BlitPadded(const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight,
+	uint32_t x, uint32_t y, uint32_t padding, uint32_t bytesPerTexel)
+{
+	ASSERT(x >= padding && y >= padding && x + width + padding <= dstWidth && y + height + padding <= dstHeight);
+
+	for (uint32_t row = 0; row < height + 2 * padding; ++row)
+	{
+		const uint32_t srcRow = (uint32_t)std::clamp((int)row - (int)padding, 0, (int)height - 1);
+		uint8_t* dstRow = dst + ((size_t)(y - padding + row) * dstWidth + (x - padding)) * bytesPerTexel;
+		const uint8_t* srcLine = src + (size_t)srcRow * width * bytesPerTexel;
+
+		for (uint32_t col = 0; col < padding; ++col)
+			memcpy(dstRow + col * bytesPerTexel, srcLine, bytesPerTexel);
+		memcpy(dstRow + padding * bytesPerTexel, srcLine, (size_t)width * bytesPerTexel);
+		for (uint32_t col = 0; col < padding; ++col)
+			memcpy(dstRow + (padding + width + col) * bytesPerTexel, srcLine + (size_t)(width - 1) * bytesPerTexel, bytesPerTexel);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Import time packing of material textures into as few shader resources as possible.
+// Textures of the same format and size are stacked into Texture2DArrays; small textures whose UVs stay in
+// [0, 1] are placed into atlas pages (slices of one more array) with a skyline allocator.  Every texture
+// ends up as (page, slice, uv scale/offset), which is what MaterialConstants carries to the pixel shader.
+//
+// Packing only depends on the inputs and their order, so the same model always produces the same layout.
+namespace TexturePacker
+{
+	struct Settings
+	{
+		uint32_t AtlasSize = 2048;      // width and height of an atlas slice
+		uint32_t MaxAtlasedSize = 512;  // larger textures always go to arrays
+		uint32_t Padding = 4;           // texels of clamped border around each atlas entry
+		uint32_t MaxArraySize = 2048;   // D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION
+	};
+
+	struct Input
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+		bool AllowAtlas = true;         // false if the texture is sampled with wrapping UVs
+	};
+
+	struct Page
+	{
+		DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t ArraySize = 0;
+		uint32_t MipLevels = 0;         // full chain for arrays, limited by the padding for atlases
+		bool IsAtlas = false;
+	};
+
+	struct Placement
+	{
+		uint32_t Page = 0;
+		uint32_t Slice = 0;
+		uint32_t X = 0;                 // texel offset of the texture inside the slice
+		uint32_t Y = 0;
+		DirectX::XMFLOAT4 ScaleOffset = { 1.0f, 1.0f, 0.0f, 0.0f };  // page uv = uv * xy + zw
+	};
+
+	struct Result
+	{
+		std::vector<Page> Pages;
+		std::vector<Placement> Placements;  // one per input, same order
+		uint64_t UsedTexels = 0;            // texels of the inputs, top level only
+		uint64_t AllocatedTexels = 0;       // texels of all page slices, top level only
+
+		float GetEfficiency() const { return AllocatedTexels ? (float)UsedTexels / AllocatedTexels : 1.0f; }
+	};
+
+	Result Pack(const std::vector<Input>& inputs, const Settings& settings = Settings());
+
+	// Copy a tightly packed texture into an atlas slice at (x, y) and replicate its edges into the padding.
+	void BlitPadded(const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight,
+		uint32_t x, uint32_t y, uint32_t padding, uint32_t bytesPerTexel);
+}
@@ -0,0 +1,256 @@
+#include "pch.h"
+#include "TextureResidency.h"
+#include "FrameArena.h"
+#include <algorithm>
+#include <cmath>
+
+TextureResidencyManager::TextureResidencyManager(uint64_t budgetBytes)
+{
+	m_Stats.BudgetBytes = budgetBytes;
+}
+
+uint32_t TextureResidencyManager::Register(uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t bytesPerTexel)
+{
+	ASSERT(width > 0 && height > 0 && mipLevels > 0 && bytesPerTexel > 0);
+
+	uint32_t tailMip = 0;
+	while (tailMip + 1 < mipLevels && std::max(width >> tailMip, height >> tailMip) > kTailSize)
+		++tailMip;
+
+	if (tailMip == 0)
+		return kInvalidId;
+
+	uint32_t id;
+	if (!m_FreeIds.empty())
+	{
+		id = m_FreeIds.back();
+		m_FreeIds.pop_back();
+	}
+	else
+	{
+		id = (uint32_t)m_Textures.size();
+		m_Textures.emplace_back();
+	}
+
+	TextureState& tex = m_Textures[id];
+	tex = TextureState();
+	tex.Width = width;
+	tex.Height = height;
+	tex.MipLevels = mipLevels;
+	tex.BytesPerTexel = bytesPerTexel;
+	tex.TailMip = tailMip;
+	tex.ResidentMip = tailMip;
+	tex.DesiredMip = tailMip;
+	tex.LastUsedFrame = m_FrameIndex;
+	tex.InUse = true;
+
+	// The tail counts against the budget but is never evicted, so a scene with too many textures can exceed it.
+	m_Stats.ResidentBytes += GetResidentBytes(id, tailMip);
+	m_Stats.PeakBytes = std::max(m_Stats.PeakBytes, m_Stats.ResidentBytes);
+	++m_Stats.NumTextures;
+	return id;
+}
+
+void TextureResidencyManager::Unregister(uint32_t id)
+{
+	ASSERT(id < m_Textures.size() && m_Textures[id].InUse);
+
+	TextureState& tex = m_Textures[id];
+	m_Stats.ResidentBytes -= GetResidentBytes(id, tex.ResidentMip);
+	--m_Stats.NumTextures;
+	tex.InUse = false;
+	m_FreeIds.push_back(id);
+}
+
+uint64_t TextureResidencyManager::GetResidentBytes(uint32_t id, uint32_t residentMip) const
+{
+	const TextureState& tex = m_Textures[id];
+	uint64_t bytes = 0;
+	for (uint32_t mip = residentMip; mip < tex.MipLevels; ++mip)
+		bytes += (uint64_t)std::max(1u, tex.Width >> mip) * std::max(1u, tex.Height >> mip) * tex.BytesPerTexel;
+	return bytes;
+}
+
+float TextureResidencyManager::ComputeMip(uint32_t width, uint32_t height, float screenPixels)
+{
+	if (screenPixels <= 0.0f)
+		return 32.0f;
+	return std::log2((float)std::max(width, height) / screenPixels);
+}
+
+void TextureResidencyManager::RequestMip(uint32_t id, float mip, float priority)
+{
+	ASSERT(id < m_Textures.size() && m_Textures[id].InUse);
+
+	TextureState& tex = m_Textures[id];
+
+	// Round toward more detail so magnified textures are never blurrier than requested.
+	uint32_t desired = mip <= 0.0f ? 0 : std::min((uint32_t)std::floor(mip), tex.MipLevels - 1);
+	desired = std::min(desired, tex.TailMip);
+
+	// Reports made before the next Update() belong to the next frame.
+	const uint64_t frame = m_FrameIndex + 1;
+	if (tex.LastUsedFrame != frame)
+	{
+		tex.DesiredMip = desired;
+		tex.Priority = priority;
+		tex.LastUsedFrame = frame;
+	}
+	else
+	{
+		tex.DesiredMip = std::min(tex.DesiredMip, desired);
+		tex.Priority = std::max(tex.Priority, priority);
+	}
+}
+
+void TextureResidencyManager::SetResidentMip(uint32_t id, uint32_t mip, std::vector<MipChange>& changes)
+{
+	TextureState& tex = m_Textures[id];
+	if (mip == tex.ResidentMip)
+		return;
+
+	m_Stats.ResidentBytes -= GetResidentBytes(id, tex.ResidentMip);
+	m_Stats.ResidentBytes += GetResidentBytes(id, mip);
+	m_Stats.PeakBytes = std::max(m_Stats.PeakBytes, m_Stats.ResidentBytes);
+	if (mip < tex.ResidentMip)
+		++m_Stats.NumLoads;
+	else
+		++m_Stats.NumEvictions;
+	tex.ResidentMip = mip;
+
+	for (MipChange& change : changes)
+	{
+		if (change.TextureId == id)
+		{
+			change.ResidentMip = mip;
+			return;
+		}
+	}
+	changes.push_back({ id, mip });
+}
+
+// Frees at least bytesNeeded, or nothing if that is not possible.  Detail nobody asked for goes first, least
+// recently used first.  After that, textures with a lower priority than the requester give up levels, lowest
+// priority first.  Without a requester (the budget shrank) every texture is a candidate.
+bool TextureResidencyManager::MakeRoom(uint64_t bytesNeeded, const TextureState* requester, std::vector<MipChange>& changes)
+{
+	auto FloorMip = [&](const TextureState& tex)
+	{
+		return IsStale(tex) ? tex.TailMip : std::max(tex.ResidentMip, tex.DesiredMip);
+	};
+
+	auto CanDowngrade = [&](const TextureState& tex)
+	{
+		return requester == nullptr || tex.Priority < requester->Priority;
+	};
+
+	m_Scratch.clear();
+	for (uint32_t id = 0; id < (uint32_t)m_Textures.size(); ++id)
+	{
+		const TextureState& tex = m_Textures[id];
+		if (tex.InUse && &tex != requester && tex.ResidentMip < tex.TailMip)
+			m_Scratch.push_back(id);
+	}
+
+	uint64_t available = 0;
+	for (uint32_t id : m_Scratch)
+	{
+		const TextureState& tex = m_Textures[id];
+		const uint32_t floorMip = CanDowngrade(tex) ? tex.TailMip : FloorMip(tex);
+		available += GetResidentBytes(id, tex.ResidentMip) - GetResidentBytes(id, floorMip);
+	}
+	if (available < bytesNeeded)
+		return false;
+
+	uint64_t freed = 0;
+	auto Evict = [&](uint32_t id, uint32_t floorMip)
+	{
+		const TextureState& tex = m_Textures[id];
+		uint32_t mip = tex.ResidentMip;
+		while (mip < floorMip && freed < bytesNeeded)
+		{
+			freed += GetResidentBytes(id, mip) - GetResidentBytes(id, mip + 1);
+			++mip;
+		}
+		SetResidentMip(id, mip, changes);
+	};
+
+	std::sort(m_Scratch.begin(), m_Scratch.end(), [&](uint32_t a, uint32_t b)
+		{
+			const TextureState& ta = m_Textures[a];
+			const TextureState& tb = m_Textures[b];
+			if (ta.LastUsedFrame != tb.LastUsedFrame)
+				return ta.LastUsedFrame < tb.LastUsedFrame;
+			return ta.Priority < tb.Priority;
+		});
+	for (uint32_t id : m_Scratch)
+	{
+		if (freed >= bytesNeeded)
+			return true;
+		Evict(id, FloorMip(m_Textures[id]));
+	}
+
+	std::stable_sort(m_Scratch.begin(), m_Scratch.end(), [&](uint32_t a, uint32_t b)
+		{
+			return m_Textures[a].Priority < m_Textures[b].Priority;
+		});
+	for (uint32_t id : m_Scratch)
+	{
+		if (freed >= bytesNeeded)
+			break;
+		if (CanDowngrade(m_Textures[id]))
+			Evict(id, m_Textures[id].TailMip);
+	}
+
+	ASSERT(freed >= bytesNeeded);
+	return true;
+}
+
+void TextureResidencyManager::Update(std::vector<MipChange>& changes, uint32_t maxLoads)
+{
+	++m_FrameIndex;
+	changes.clear();
+
+	if (m_Stats.ResidentBytes > m_Stats.BudgetBytes)
+		MakeRoom(m_Stats.ResidentBytes - m_Stats.BudgetBytes, nullptr, changes);
+
+	std::pmr::vector<uint32_t> requests(FrameAllocator::Get());
+	requests.reserve(m_Textures.size());
+	for (uint32_t id = 0; id < (uint32_t)m_Textures.size(); ++id)
+	{
+		const TextureState& tex = m_Textures[id];
+		if (tex.InUse && tex.LastUsedFrame == m_FrameIndex && tex.DesiredMip < tex.ResidentMip)
+			requests.push_back(id);
+	}
+
+	std::sort(requests.begin(), requests.end(), [&](uint32_t a, uint32_t b)
+		{
+			const TextureState& ta = m_Textures[a];
+			const TextureState& tb = m_Textures[b];
+			if (ta.Priority != tb.Priority)
+				return ta.Priority > tb.Priority;
+			return ta.ResidentMip - ta.DesiredMip > tb.ResidentMip - tb.DesiredMip;
+		});
+
+	uint32_t numLoads = 0;
+	for (uint32_t id : requests)
+	{
+		if (numLoads == maxLoads)
+			break;
+
+		const TextureState& tex = m_Textures[id];
+		const uint64_t residentBytes = GetResidentBytes(id, tex.ResidentMip);
+
+		// Settle for less detail than requested if the full chain does not fit.
+		for (uint32_t mip = tex.DesiredMip; mip < tex.ResidentMip; ++mip)
+		{
+			const uint64_t newBytes = m_Stats.ResidentBytes - residentBytes + GetResidentBytes(id, mip);
+			if (newBytes <= m_Stats.BudgetBytes || MakeRoom(newBytes - m_Stats.BudgetBytes, &tex, changes))
+			{
+				SetResidentMip(id, mip, changes);
+				++numLoads;
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// CPU side bookkeeping for streamed textures.  It owns no GPU objects: the renderer reports which mip each
+// texture should be sampled at, Update() turns that into a list of residency changes under a memory budget,
+// and TextureManager applies them.  Keeping it free of D3D makes it easy to drive with simulated requests.
+//
+// Mip indices follow D3D12: 0 is the most detailed level.  A texture's "resident mip" is the most detailed
+// level in memory; every coarser level is resident too.  The tail (levels no larger than kTailSize) is
+// loaded at registration and never evicted.
+class TextureResidencyManager
+{
+public:
+	static const uint32_t kInvalidId = ~0u;
+	static const uint32_t kTailSize = 64;
+
+	struct MipChange
+	{
+		uint32_t TextureId;
+		uint32_t ResidentMip;   // new most detailed resident level
+	};
+
+	struct Stats
+	{
+		uint64_t ResidentBytes = 0;
+		uint64_t PeakBytes = 0;
+		uint64_t BudgetBytes = 0;
+		uint32_t NumTextures = 0;
+		uint32_t NumLoads = 0;      // mip changes that increased detail, since creation
+		uint32_t NumEvictions = 0;  // mip changes that decreased detail, since creation
+	};
+
+	explicit TextureResidencyManager(uint64_t budgetBytes = 256ull << 20);
+
+	void SetBudget(uint64_t budgetBytes) { m_Stats.BudgetBytes = budgetBytes; }
+
+	// Frames a texture may go without a report before its extra detail becomes the first thing to evict.
+	void SetEvictionDelay(uint32_t frames) { m_EvictionDelay = frames; }
+
+	// Returns an id, or kInvalidId if the texture is too small to be worth streaming.
+	uint32_t Register(uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t bytesPerTexel);
+	void Unregister(uint32_t id);
+
+	// Renderer feedback for the current frame.  mip may be fractional and negative; several reports in one
+	// frame keep the most detailed mip and the highest priority.
+	void RequestMip(uint32_t id, float mip, float priority = 1.0f);
+
+	// Texel density helper: the mip where one texel maps to about one pixel when the larger axis of the
+	// texture spans screenPixels on screen.
+	static float ComputeMip(uint32_t width, uint32_t height, float screenPixels);
+
+	// Call once per frame after the reports: decides what to load or evict.  At most maxLoads textures gain
+	// detail per call so a camera cut does not stall a single frame.  The returned changes are already
+	// reflected in GetResidentMip() and GetStats().
+	void Update(std::vector<MipChange>& changes, uint32_t maxLoads = 4);
+
+	uint32_t GetResidentMip(uint32_t id) const { return m_Textures[id].ResidentMip; }
+	uint32_t GetTailMip(uint32_t id) const { return m_Textures[id].TailMip; }
+	uint64_t GetResidentBytes(uint32_t id, uint32_t residentMip) const;
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	struct TextureState
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t MipLevels = 0;
+		uint32_t BytesPerTexel = 0;
+		uint32_t TailMip = 0;
+		uint32_t ResidentMip = 0;
+		uint32_t DesiredMip = 0;
+		float Priority = 0.0f;
+		uint64_t LastUsedFrame = 0;
+		bool InUse = false;
+	};
+
+	bool IsStale(const TextureState& tex) const { return m_FrameIndex - tex.LastUsedFrame > m_EvictionDelay; }
+	void SetResidentMip(uint32_t id, uint32_t mip, std::vector<MipChange>& changes);
+	bool MakeRoom(uint64_t bytesNeeded, const TextureState* requester, std::vector<MipChange>& changes);
+
+	std::vector<TextureState> m_Textures;
+	std::vector<uint32_t> m_FreeIds;
+	std::vector<uint32_t> m_Scratch;
+	uint64_t m_FrameIndex = 0;
+	uint32_t m_EvictionDelay = 60;
+	Stats m_Stats;
+};
@@ -0,0 +1,438 @@
+#include "pch.h"
+#include "TlsfAllocator.h"
+#include <algorithm>
+
+namespace
+{
+	inline uint32_t HighestBit(uint64_t value)
+	{
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return (uint32_t)index;
+	}
+
+	inline uint32_t LowestBit(uint64_t value)
+	{
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return (uint32_t)index;
+	}
+}
+
+// -------------------- TlsfAllocator --------------------
+
+void TlsfAllocator::Reset(uint64_t size, uint64_t granularity)
+{
+	ASSERT(granularity > 0 && (granularity & (granularity - 1)) == 0, "TLSF granularity must be a power of two");
+	ASSERT(size > 0 && size % granularity == 0);
+
+	m_Ranges.clear();
+	m_UnusedRanges = kInvalidHandle;
+	m_FirstLevelBitmap = 0;
+	for (uint32_t fl = 0; fl < kFirstLevelCount; ++fl)
+	{
+		m_SecondLevelBitmaps[fl] = 0;
+		for (uint32_t sl = 0; sl < kSecondLevelCount; ++sl)
+			m_FreeHeads[fl][sl] = kInvalidHandle;
+	}
+
+	m_Size = size;
+	m_Granularity = granularity;
+	m_GranularityLog2 = HighestBit(granularity);
+	m_UsedBytes = 0;
+	m_NumAllocations = 0;
+
+	m_FirstRange = NewRange();
+	m_Ranges[m_FirstRange].Size = size;
+	InsertFree(m_FirstRange);
+}
+
+// Sizes below kSecondLevelCount units share first level 0 with one list per size.  Above that, the first
+// level is the position of the highest bit and the second level the next kSecondLevelLog2 bits.
+void TlsfAllocator::MapSize(uint64_t units, uint32_t& fl, uint32_t& sl) const
+{
+	if (units < kSecondLevelCount)
+	{
+		fl = 0;
+		sl = (uint32_t)units;
+	}
+	else
+	{
+		const uint32_t msb = HighestBit(units);
+		fl = msb - kSecondLevelLog2 + 1;
+		sl = (uint32_t)(units >> (msb - kSecondLevelLog2)) - kSecondLevelCount;
+	}
+}
+
+// Returns the head of the first list whose ranges are all at least 'units' long.
+uint32_t TlsfAllocator::FindFreeRange(uint64_t units) const
+{
+	if (units >= kSecondLevelCount)
+		units += (1ull << (HighestBit(units) - kSecondLevelLog2)) - 1;
+
+	uint32_t fl, sl;
+	MapSize(units, fl, sl);
+	if (fl >= kFirstLevelCount)
+		return kInvalidHandle;
+
+	uint32_t slMap = m_SecondLevelBitmaps[fl] & (~0u << sl);
+	if (slMap == 0)
+	{
+		const uint64_t flMap = fl + 1 < 64 ? m_FirstLevelBitmap & (~0ull << (fl + 1)) : 0;
+		if (flMap == 0)
+			return kInvalidHandle;
+
+		fl = LowestBit(flMap);
+		slMap = m_SecondLevelBitmaps[fl];
+	}
+	return m_FreeHeads[fl][LowestBit(slMap)];
+}
+
+void TlsfAllocator::InsertFree(uint32_t r)
+{
+	uint32_t fl, sl;
+	MapSize(m_Ranges[r].Size >> m_GranularityLog2, fl, sl);
+
+	Range& range = m_Ranges[r];
+	range.IsFree = true;
+	range.PrevFree = kInvalidHandle;
+	range.NextFree = m_FreeHeads[fl][sl];
+	if (range.NextFree != kInvalidHandle)
+		m_Ranges[range.NextFree].PrevFree = r;
+	m_FreeHeads[fl][sl] = r;
+
+	m_FirstLevelBitmap |= 1ull << fl;
+	m_SecondLevelBitmaps[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t r)
+{
+	uint32_t fl, sl;
+	MapSize(m_Ranges[r].Size >> m_GranularityLog2, fl, sl);
+
+	Range& range = m_Ranges[r];
+	if (range.PrevFree != kInvalidHandle)
+		m_Ranges[range.PrevFree].NextFree = range.NextFree;
+	else
+		m_FreeHeads[fl][sl] = range.NextFree;
+	if (range.NextFree != kInvalidHandle)
+		m_Ranges[range.NextFree].PrevFree = range.PrevFree;
+
+	if (m_FreeHeads[fl][sl] == kInvalidHandle)
+	{
+		m_SecondLevelBitmaps[fl] &= ~(1u << sl);
+		if (m_SecondLevelBitmaps[fl] == 0)
+			m_FirstLevelBitmap &= ~(1ull << fl);
+	}
+
+	range.IsFree = false;
+	range.PrevFree = range.NextFree = kInvalidHandle;
+}
+
+uint32_t TlsfAllocator::NewRange()
+{
+	uint32_t r = m_UnusedRanges;
+	if (r != kInvalidHandle)
+	{
+		m_UnusedRanges = m_Ranges[r].NextFree;
+		m_Ranges[r] = Range();
+	}
+	else
+	{
+		r = (uint32_t)m_Ranges.size();
+		m_Ranges.emplace_back();
+	}
+	return r;
+}
+
+void TlsfAllocator::DeleteRange(uint32_t r)
+{
+	m_Ranges[r] = Range();
+	m_Ranges[r].NextFree = m_UnusedRanges;
+	m_UnusedRanges = r;
+}
+
+uint32_t TlsfAllocator::SplitAfter(uint32_t r, uint64_t size)
+{
+	const uint32_t rest = NewRange();
+	Range& range = m_Ranges[r];
+	Range& restRange = m_Ranges[rest];
+
+	restRange.Offset = range.Offset + size;
+	restRange.Size = range.Size - size;
+	restRange.PrevPhysical = r;
+	restRange.NextPhysical = range.NextPhysical;
+	if (range.NextPhysical != kInvalidHandle)
+		m_Ranges[range.NextPhysical].PrevPhysical = rest;
+	range.NextPhysical = rest;
+	range.Size = size;
+	return rest;
+}
+
+uint32_t TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, uint64_t userData)
+{
+	ASSERT(size > 0 && alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+	alignment = std::max(alignment, m_Granularity);
+	const uint64_t units = (size + m_Granularity - 1) >> m_GranularityLog2;
+	const uint64_t bytes = units << m_GranularityLog2;
+	if (bytes > m_Size)
+		return kInvalidHandle;
+
+	auto Padding = [&](uint32_t r) { return ((m_Ranges[r].Offset + alignment - 1) & ~(alignment - 1)) - m_Ranges[r].Offset; };
+
+	// Most ranges in a pool are already aligned, so look for the plain size first and only reserve room for
+	// the worst case padding when the range found cannot take it.
+	uint32_t r = FindFreeRange(units);
+	if (r == kInvalidHandle || Padding(r) + bytes > m_Ranges[r].Size)
+	{
+		if (alignment == m_Granularity)
+			return kInvalidHandle;
+		r = FindFreeRange(units + ((alignment - m_Granularity) >> m_GranularityLog2));
+		if (r == kInvalidHandle)
+			return kInvalidHandle;
+	}
+
+	RemoveFree(r);
+
+	// The ranges around a free range are in use, so the padding and the tail cannot be merged with anything.
+	if (const uint64_t padding = Padding(r))
+	{
+		const uint32_t aligned = SplitAfter(r, padding);
+		InsertFree(r);
+		r = aligned;
+	}
+	if (m_Ranges[r].Size > bytes)
+		InsertFree(SplitAfter(r, bytes));
+
+	m_Ranges[r].UserData = userData;
+	m_Ranges[r].Alignment = alignment;
+	m_UsedBytes += bytes;
+	++m_NumAllocations;
+	return r;
+}
+
+void TlsfAllocator::Free(uint32_t handle)
+{
+	ASSERT(handle < m_Ranges.size() && !m_Ranges[handle].IsFree && m_Ranges[handle].Size > 0, "Freeing an invalid TLSF handle");
+
+	m_UsedBytes -= m_Ranges[handle].Size;
+	--m_NumAllocations;
+
+	uint32_t r = handle;
+	const uint32_t prev = m_Ranges[r].PrevPhysical;
+	if (prev != kInvalidHandle && m_Ranges[prev].IsFree)
+	{
+		RemoveFree(prev);
+		m_Ranges[prev].Size += m_Ranges[r].Size;
+		m_Ranges[prev].NextPhysical = m_Ranges[r].NextPhysical;
+		if (m_Ranges[r].NextPhysical != kInvalidHandle)
+			m_Ranges[m_Ranges[r].NextPhysical].PrevPhysical = prev;
+		DeleteRange(r);
+		r = prev;
+	}
+
+	const uint32_t next = m_Ranges[r].NextPhysical;
+	if (next != kInvalidHandle && m_Ranges[next].IsFree)
+	{
+		RemoveFree(next);
+		m_Ranges[r].Size += m_Ranges[next].Size;
+		m_Ranges[r].NextPhysical = m_Ranges[next].NextPhysical;
+		if (m_Ranges[next].NextPhysical != kInvalidHandle)
+			m_Ranges[m_Ranges[next].NextPhysical].PrevPhysical = r;
+		DeleteRange(next);
+	}
+
+	m_Ranges[r].UserData = 0;
+	m_Ranges[r].Alignment = 0;
+	InsertFree(r);
+}
+
+TlsfAllocator::Stats TlsfAllocator::GetStats() const
+{
+	Stats stats;
+	stats.Size = m_Size;
+	stats.UsedBytes = m_UsedBytes;
+	stats.NumAllocations = m_NumAllocations;
+	for (uint32_t r = m_FirstRange; r != kInvalidHandle; r = m_Ranges[r].NextPhysical)
+	{
+		if (m_Ranges[r].IsFree)
+		{
+			++stats.NumFreeRanges;
+			stats.LargestFreeRange = std::max(stats.LargestFreeRange, m_Ranges[r].Size);
+		}
+	}
+	return stats;
+}
+
+bool TlsfAllocator::Validate() const
+{
+	uint64_t offset = 0, usedBytes = 0;
+	uint32_t numAllocations = 0, numFree = 0, prev = kInvalidHandle;
+	for (uint32_t r = m_FirstRange; r != kInvalidHandle; prev = r, r = m_Ranges[r].NextPhysical)
+	{
+		const Range& range = m_Ranges[r];
+		if (range.PrevPhysical != prev || range.Offset != offset || range.Size == 0 || range.Size % m_Granularity != 0)
+			return false;
+		if (range.IsFree && prev != kInvalidHandle && m_Ranges[prev].IsFree)
+			return false;
+		offset += range.Size;
+		if (range.IsFree)
+			++numFree;
+		else
+		{
+			usedBytes += range.Size;
+			++numAllocations;
+		}
+	}
+	if (offset != m_Size || usedBytes != m_UsedBytes || numAllocations != m_NumAllocations)
+		return false;
+
+	uint32_t numListed = 0;
+	for (uint32_t fl = 0; fl < kFirstLevelCount; ++fl)
+	{
+		if (((m_FirstLevelBitmap >> fl) & 1) != (m_SecondLevelBitmaps[fl] != 0 ? 1u : 0u))
+			return false;
+		for (uint32_t sl = 0; sl < kSecondLevelCount; ++sl)
+		{
+			if (((m_SecondLevelBitmaps[fl] >> sl) & 1) != (m_FreeHeads[fl][sl] != kInvalidHandle ? 1u : 0u))
+				return false;
+			uint32_t prevFree = kInvalidHandle;
+			for (uint32_t r = m_FreeHeads[fl][sl]; r != kInvalidHandle; prevFree = r, r = m_Ranges[r].NextFree)
+			{
+				uint32_t rangeFl, rangeSl;
+				MapSize(m_Ranges[r].Size >> m_GranularityLog2, rangeFl, rangeSl);
+				if (!m_Ranges[r].IsFree || m_Ranges[r].PrevFree != prevFree || rangeFl != fl || rangeSl != sl)
+					return false;
+				++numListed;
+			}
+		}
+	}
+	return numListed == numFree;
+}
+
+// -------------------- TlsfBlockPool --------------------
+
+bool TlsfBlockPool::Allocate(uint64_t size, uint64_t alignment, uint64_t userData, Allocation& allocation)
+{
+	for (uint32_t b = 0; b < (uint32_t)m_Blocks.size(); ++b)
+	{
+		if (!m_Blocks[b].InUse)
+			continue;
+
+		TlsfAllocator& allocator = m_Blocks[b].Allocator;
+		const uint32_t handle = allocator.Allocate(size, alignment, userData);
+		if (handle == TlsfAllocator::kInvalidHandle)
+			continue;
+
+		allocation.Block = b;
+		allocation.Handle = handle;
+		allocation.Offset = allocator.GetOffset(handle);
+		allocation.Size = allocator.GetSize(handle);
+		m_UsedBytes += allocation.Size;
+		m_PeakUsedBytes = std::max(m_PeakUsedBytes, m_UsedBytes);
+		return true;
+	}
+	return false;
+}
+
+bool TlsfBlockPool::Free(const Allocation& allocation)
+{
+	ASSERT(allocation.IsValid() && m_Blocks[allocation.Block].InUse);
+
+	TlsfAllocator& allocator = m_Blocks[allocation.Block].Allocator;
+	m_UsedBytes -= allocation.Size;
+	allocator.Free(allocation.Handle);
+	return allocator.IsEmpty();
+}
+
+uint32_t TlsfBlockPool::AddBlock(void* userData)
+{
+	uint32_t b = 0;
+	while (b < (uint32_t)m_Blocks.size() && m_Blocks[b].InUse)
+		++b;
+	if (b == (uint32_t)m_Blocks.size())
+		m_Blocks.emplace_back();
+
+	m_Blocks[b].Allocator.Reset(m_BlockSize, m_Granularity);
+	m_Blocks[b].UserData = userData;
+	m_Blocks[b].InUse = true;
+	return b;
+}
+
+void* TlsfBlockPool::RemoveBlock(uint32_t block)
+{
+	ASSERT(m_Blocks[block].InUse && m_Blocks[block].Allocator.IsEmpty(), "Removing a heap that still holds resources");
+
+	void* userData = m_Blocks[block].UserData;
+	m_Blocks[block].UserData = nullptr;
+	m_Blocks[block].InUse = false;
+	return userData;
+}
+
+uint32_t TlsfBlockPool::CountEmptyBlocks() const
+{
+	uint32_t count = 0;
+	for (const Block& block : m_Blocks)
+		count += block.InUse && block.Allocator.IsEmpty() ? 1 : 0;
+	return count;
+}
+
+void TlsfBlockPool::PlanDefragmentation(uint64_t maxBytes, std::vector<Move>& moves)
+{
+	std::vector<uint32_t> candidates;
+	for (uint32_t b = 0; b < (uint32_t)m_Blocks.size(); ++b)
+	{
+		const TlsfAllocator& allocator = m_Blocks[b].Allocator;
+		if (m_Blocks[b].InUse && !allocator.IsEmpty() && allocator.GetUsedBytes() <= maxBytes)
+			candidates.push_back(b);
+	}
+	std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b)
+		{ return m_Blocks[a].Allocator.GetUsedBytes() < m_Blocks[b].Allocator.GetUsedBytes(); });
+
+	const size_t firstMove = moves.size();
+	for (uint32_t source : candidates)
+	{
+		// Largest first, as the big allocations are the hardest to place.
+		m_Blocks[source].Allocator.ForEachAllocation([&](uint32_t handle, uint64_t offset, uint64_t size, uint64_t userData)
+			{ moves.push_back({ { source, handle, offset, size }, Allocation(), userData }); });
+		std::sort(moves.begin() + firstMove, moves.end(), [](const Move& a, const Move& b) { return a.From.Size > b.From.Size; });
+
+		// Hide the source so Allocate() only finds room in the other blocks.
+		m_Blocks[source].InUse = false;
+		size_t placed = firstMove;
+		const TlsfAllocator& sourceAllocator = m_Blocks[source].Allocator;
+		while (placed < moves.size() && Allocate(moves[placed].From.Size, sourceAllocator.GetAlignment(moves[placed].From.Handle),
+			moves[placed].UserData, moves[placed].To))
+			++placed;
+		m_Blocks[source].InUse = true;
+
+		if (placed == moves.size())
+			return;
+
+		// Not everything fits elsewhere; moving part of a heap would not let it be released.
+		for (size_t i = firstMove; i < placed; ++i)
+			Free(moves[i].To);
+		moves.resize(firstMove);
+	}
+}
+
+TlsfBlockPool::Stats TlsfBlockPool::GetStats() const
+{
+	Stats stats;
+	stats.PeakUsedBytes = m_PeakUsedBytes;
+	for (const Block& block : m_Blocks)
+	{
+		if (!block.InUse)
+			continue;
+
+		const TlsfAllocator::Stats blockStats = block.Allocator.GetStats();
+		++stats.NumBlocks;
+		stats.ReservedBytes += blockStats.Size;
+		stats.UsedBytes += blockStats.UsedBytes;
+		stats.NumAllocations += blockStats.NumAllocations;
+		stats.NumFreeRanges += blockStats.NumFreeRanges;
+		stats.LargestFreeRange = std::max(stats.LargestFreeRange, blockStats.LargestFreeRange);
+	}
+	return stats;
+}
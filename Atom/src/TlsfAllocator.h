@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit allocator over an abstract address range, used to place GPU resources in large
+// ID3D12Heaps (see GpuHeapAllocator.h).  It never touches the memory it manages: block headers live in a side
+// array, so the range can be a heap, a buffer or nothing at all, which keeps it testable without a device.
+//
+// Free ranges are kept in lists indexed by (log2 of the size, next kSecondLevelLog2 bits of the size).  An
+// allocation rounds its size up to the next list boundary and takes the head of the first non-empty list at
+// or above it, found with two bit scans, so both Allocate() and Free() are O(1).  Neighbouring free ranges
+// are merged on Free().
+//
+// Offsets and sizes are multiples of the granularity given at construction; larger alignments are honoured
+// by splitting off the padding as a free range.
+class TlsfAllocator
+{
+public:
+	static const uint32_t kInvalidHandle = ~0u;
+	static const uint32_t kSecondLevelLog2 = 4;
+
+	struct Stats
+	{
+		uint64_t Size = 0;
+		uint64_t UsedBytes = 0;
+		uint64_t LargestFreeRange = 0;
+		uint32_t NumAllocations = 0;
+		uint32_t NumFreeRanges = 0;
+	};
+
+	TlsfAllocator() = default;
+	TlsfAllocator(uint64_t size, uint64_t granularity) { Reset(size, granularity); }
+
+	// Forgets every allocation.  granularity must be a power of two, size a multiple of it.
+	void Reset(uint64_t size, uint64_t granularity);
+
+	// Returns kInvalidHandle when no free range can hold the allocation.  alignment must be a power of two.
+	uint32_t Allocate(uint64_t size, uint64_t alignment, uint64_t userData = 0);
+	void Free(uint32_t handle);
+
+	uint64_t GetOffset(uint32_t handle) const { return m_Ranges[handle].Offset; }
+	uint64_t GetSize(uint32_t handle) const { return m_Ranges[handle].Size; }
+	uint64_t GetUserData(uint32_t handle) const { return m_Ranges[handle].UserData; }
+	uint64_t GetAlignment(uint32_t handle) const { return m_Ranges[handle].Alignment; }
+	void SetUserData(uint32_t handle, uint64_t userData) { m_Ranges[handle].UserData = userData; }
+
+	uint64_t GetCapacity() const { return m_Size; }
+	uint64_t GetGranularity() const { return m_Granularity; }
+	uint64_t GetUsedBytes() const { return m_UsedBytes; }
+	uint32_t GetNumAllocations() const { return m_NumAllocations; }
+	bool IsEmpty() const { return m_NumAllocations == 0; }
+
+	// Walks the ranges in address order.  O(number of ranges); meant for statistics and defragmentation.
+	Stats GetStats() const;
+	template <typename Fn> void ForEachAllocation(Fn&& fn) const
+	{
+		for (uint32_t r = m_FirstRange; r != kInvalidHandle; r = m_Ranges[r].NextPhysical)
+			if (!m_Ranges[r].IsFree)
+				fn(r, m_Ranges[r].Offset, m_Ranges[r].Size, m_Ranges[r].UserData);
+	}
+
+	// Checks the physical chain, the free lists and the bitmaps against each other.
+	bool Validate() const;
+
+private:
+	static const uint32_t kSecondLevelCount = 1u << kSecondLevelLog2;
+	static const uint32_t kFirstLevelCount = 65 - kSecondLevelLog2;
+
+	struct Range
+	{
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+		uint64_t UserData = 0;
+		uint64_t Alignment = 0;                 // as requested, so defragmentation can honour it
+		uint32_t PrevPhysical = kInvalidHandle;
+		uint32_t NextPhysical = kInvalidHandle;
+		uint32_t PrevFree = kInvalidHandle;     // also links unused records
+		uint32_t NextFree = kInvalidHandle;
+		bool IsFree = false;
+	};
+
+	// Sizes are mapped in units of the granularity.
+	void MapSize(uint64_t units, uint32_t& fl, uint32_t& sl) const;
+	uint32_t FindFreeRange(uint64_t units) const;
+	void InsertFree(uint32_t r);
+	void RemoveFree(uint32_t r);
+	uint32_t NewRange();
+	void DeleteRange(uint32_t r);
+	// Splits the front of r off as a separate range of the given size and returns the remainder.
+	uint32_t SplitAfter(uint32_t r, uint64_t size);
+
+	std::vector<Range> m_Ranges;
+	uint32_t m_UnusedRanges = kInvalidHandle;
+	uint32_t m_FirstRange = kInvalidHandle;
+	uint32_t m_FreeHeads[kFirstLevelCount][kSecondLevelCount];
+	uint64_t m_FirstLevelBitmap = 0;
+	uint32_t m_SecondLevelBitmaps[kFirstLevelCount];
+	uint64_t m_Size = 0;
+	uint64_t m_Granularity = 1;
+	uint32_t m_GranularityLog2 = 0;
+	uint64_t m_UsedBytes = 0;
+	uint32_t m_NumAllocations = 0;
+};
+
+// A growable set of equally sized TlsfAllocator blocks, each standing for one heap.  The pool does not create
+// the heaps: Allocate() fails when no block has room and the caller adds one with AddBlock() and retries.
+class TlsfBlockPool
+{
+public:
+	static const uint32_t kInvalidBlock = ~0u;
+
+	struct Allocation
+	{
+		uint32_t Block = kInvalidBlock;
+		uint32_t Handle = TlsfAllocator::kInvalidHandle;
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+
+		bool IsValid() const { return Block != kInvalidBlock; }
+	};
+
+	struct Stats
+	{
+		uint64_t ReservedBytes = 0;     // sum of the block sizes
+		uint64_t UsedBytes = 0;
+		uint64_t PeakUsedBytes = 0;
+		uint64_t LargestFreeRange = 0;
+		uint32_t NumBlocks = 0;
+		uint32_t NumAllocations = 0;
+		uint32_t NumFreeRanges = 0;
+
+		// 0 when all free memory is one range, close to 1 when it is scattered in small pieces.
+		float GetFragmentation() const
+		{
+			const uint64_t freeBytes = ReservedBytes - UsedBytes;
+			return freeBytes == 0 ? 0.0f : 1.0f - (float)((double)LargestFreeRange / (double)freeBytes);
+		}
+	};
+
+	// A resource moved out of the emptiest block by PlanDefragmentation().  To is already reserved; the owner
+	// copies the contents, switches to the new location and frees From.
+	struct Move
+	{
+		Allocation From;
+		Allocation To;
+		uint64_t UserData;
+	};
+
+	TlsfBlockPool(uint64_t blockSize, uint64_t granularity) : m_BlockSize(blockSize), m_Granularity(granularity) {}
+
+	uint64_t GetBlockSize() const { return m_BlockSize; }
+
+	// Tries the blocks in creation order so memory stays packed into the oldest heaps.
+	bool Allocate(uint64_t size, uint64_t alignment, uint64_t userData, Allocation& allocation);
+	// Returns true when the block became empty; the caller decides whether to keep it.
+	bool Free(const Allocation& allocation);
+
+	void SetUserData(const Allocation& allocation, uint64_t userData) { m_Blocks[allocation.Block].Allocator.SetUserData(allocation.Handle, userData); }
+
+	uint32_t AddBlock(void* userData);
+	// The block must be empty.  Returns the user data passed to AddBlock().
+	void* RemoveBlock(uint32_t block);
+
+	// Number of block slots; removed blocks leave unused slots that AddBlock() fills first.
+	uint32_t GetNumBlocks() const { return (uint32_t)m_Blocks.size(); }
+	bool IsBlockInUse(uint32_t block) const { return m_Blocks[block].InUse; }
+	void* GetBlockUserData(uint32_t block) const { return m_Blocks[block].UserData; }
+	uint32_t CountEmptyBlocks() const;
+	const TlsfAllocator& GetBlock(uint32_t block) const { return m_Blocks[block].Allocator; }
+
+	// Picks the least used block whose allocations fit in the other blocks and total at most maxBytes, and
+	// reserves their new locations.  Appends nothing when no block can be emptied that way.
+	void PlanDefragmentation(uint64_t maxBytes, std::vector<Move>& moves);
+
+	Stats GetStats() const;
+
+private:
+	struct Block
+	{
+		TlsfAllocator Allocator;
+		void* UserData = nullptr;
+		bool InUse = false;
+	};
+
+	std::vector<Block> m_Blocks;
+	uint64_t m_BlockSize;
+	uint64_t m_Granularity;
+	uint64_t m_UsedBytes = 0;
+	uint64_t m_PeakUsedBytes = 0;
+};
@@ -0,0 +1,76 @@
+#include "pch.h"
+#include "TransientHeap.h"
+#include "GraphicsCore.h"
+#include "GpuMemory.h"
+#include "CommandContext.h"
+
+using namespace Graphics;
+
+void TransientHeap::Declare(GpuResource& Target, const D3D12_RESOURCE_DESC& Desc, uint32_t FirstPass, uint32_t LastPass, CreateFunction&& Create)
+{
+	// Keeps the heap usable on resource heap tier 1.
+	ASSERT(Desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
+		"Only render and depth targets can be transient");
+
+	if (m_Declared.empty())
+		m_Solver.Reset();
+
+	const D3D12_RESOURCE_ALLOCATION_INFO Info = g_Device->GetResourceAllocationInfo(0, 1, &Desc);
+	ASSERT(Info.SizeInBytes != UINT64_MAX, "Invalid transient target description");
+
+	m_Solver.Add(Info.SizeInBytes, Info.Alignment, FirstPass, LastPass);
+	m_Declared.push_back({ &Target, std::move(Create), FirstPass, AliasingSolver::kInvalidIndex });
+}
+
+void TransientHeap::Commit(const std::wstring& Name)
+{
+	ASSERT(!m_Declared.empty(), "No transient target declared");
+
+	const uint64_t Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	m_HeapSize = (m_Solver.Solve() + Alignment - 1) & ~(Alignment - 1);
+	m_UnaliasedSize = m_Solver.GetUnaliasedSize();
+
+	D3D12_HEAP_DESC HeapDesc = {};
+	HeapDesc.SizeInBytes = m_HeapSize;
+	HeapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	HeapDesc.Alignment = Alignment;
+	HeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+
+	Microsoft::WRL::ComPtr<ID3D12Heap> NewHeap;
+	ASSERT_SUCCEEDED(g_Device->CreateHeap(&HeapDesc, IID_PPV_ARGS(&NewHeap)));
+	NewHeap->SetName(Name.c_str());
+	GpuMemory::Track(NewHeap.Get(), GpuMemoryTracker::kRenderTargets);
+
+	m_Targets = std::move(m_Declared);
+	m_Declared.clear();
+	for (uint32_t i = 0; i < (uint32_t)m_Targets.size(); ++i)
+	{
+		m_Targets[i].Create(NewHeap.Get(), m_Solver.GetOffset(i));
+		m_Targets[i].Create = nullptr;
+		m_Targets[i].PreviousOccupant = m_Solver.GetPreviousOccupant(i);
+	}
+	m_Heap = NewHeap;
+
+	Utility::Printf("%ls: %u targets in %.1f MB instead of %.1f MB\n", Name.c_str(), (uint32_t)m_Targets.size(),
+		m_HeapSize / 1048576.0, m_UnaliasedSize / 1048576.0);
+}
+
+void TransientHeap::BeginPass(CommandContext& Context, uint32_t Pass)
+{
+	for (const Target& Current : m_Targets)
+	{
+		if (Current.FirstPass == Pass && Current.PreviousOccupant != AliasingSolver::kInvalidIndex)
+			Context.InsertAliasBarrier(*m_Targets[Current.PreviousOccupant].Resource, *Current.Resource);
+	}
+}
+
+void TransientHeap::Destroy()
+{
+	for (Target& Current : m_Targets)
+		Current.Resource->Destroy();
+	m_Targets.clear();
+	m_Declared.clear();
+	m_Heap = nullptr;
+	m_HeapSize = 0;
+	m_UnaliasedSize = 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "AliasingSolver.h"
+#include <functional>
+
+class GpuResource;
+class CommandContext;
+
+// One ID3D12Heap shared by render targets that are only alive during part of the frame.  Each target declares
+// the inclusive range of passes it is used in; targets that are never alive at the same time get overlapping
+// memory, placed by AliasingSolver.
+//
+// Targets are declared through the transient Create() overloads of ColorBuffer and DepthBuffer, which leave the
+// creation to Commit().  Before a pass, BeginPass() issues the aliasing barriers for the targets it brings to
+// life; the pass must then clear, discard or fully overwrite them before reading.
+class TransientHeap
+{
+public:
+	typedef std::function<void(ID3D12Heap* Heap, uint64_t Offset)> CreateFunction;
+
+	void Declare(GpuResource& Target, const D3D12_RESOURCE_DESC& Desc, uint32_t FirstPass, uint32_t LastPass, CreateFunction&& Create);
+
+	// Places the targets declared since the last Commit() and creates them in a new heap.  The previous heap is
+	// released with the resources that were in it, so the GPU must be done with them.
+	void Commit(const std::wstring& Name);
+
+	void BeginPass(CommandContext& Context, uint32_t Pass);
+
+	void Destroy();
+
+	uint64_t GetHeapSize() const { return m_HeapSize; }
+	uint64_t GetUnaliasedSize() const { return m_UnaliasedSize; }
+
+private:
+	struct Target
+	{
+		GpuResource* Resource;
+		CreateFunction Create;
+		uint32_t FirstPass;
+		uint32_t PreviousOccupant;
+	};
+
+	AliasingSolver m_Solver;
+	std::vector<Target> m_Declared;
+	std::vector<Target> m_Targets;
+	Microsoft::WRL::ComPtr<ID3D12Heap> m_Heap;
+	uint64_t m_HeapSize = 0;
+	uint64_t m_UnaliasedSize = 0;
+};
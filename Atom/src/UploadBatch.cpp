@@ -0,0 +1,113 @@
+#include "pch.h"
+#include "UploadBatch.h"
+#include "CommandContext.h"
+#include "CommandListManager.h"
+
+using namespace Graphics;
+
+namespace
+{
+	thread_local UploadBatch* s_CurrentBatch = nullptr;
+}
+
+bool UploadTicket::IsComplete(void) const
+{
+	return FenceValue == 0 || g_CommandManager.IsFenceComplete(FenceValue);
+}
+
+void UploadTicket::Wait(void) const
+{
+	if (FenceValue != 0)
+		g_CommandManager.WaitForFence(FenceValue);
+}
+
+UploadBatch::UploadBatch(const std::wstring& ID, size_t FlushThreshold) :
+	m_ID(ID),
+	m_FlushThreshold(FlushThreshold),
+	m_Context(nullptr),
+	m_PendingBytes(0),
+	m_NumPendingUploads(0),
+	m_NumSubmits(0)
+{
+}
+
+UploadBatch::~UploadBatch()
+{
+	ASSERT(s_CurrentBatch != this, "UploadBatch destroyed inside its own Scope");
+	Submit();
+}
+
+CommandContext& UploadBatch::GetContext(void)
+{
+	if (m_Context == nullptr)
+		m_Context = &CommandContext::Begin(m_ID);
+	return *m_Context;
+}
+
+void UploadBatch::OnUploadAdded(size_t NumBytes)
+{
+	m_PendingBytes += NumBytes;
+	++m_NumPendingUploads;
+	if (m_PendingBytes >= m_FlushThreshold)
+		Submit();
+}
+
+void UploadBatch::AddTexture(GpuResource& Dest, UINT NumSubresources, const D3D12_SUBRESOURCE_DATA SubData[])
+{
+	const UINT64 UploadBufferSize = GetRequiredIntermediateSize(Dest.GetResource(), 0, NumSubresources);
+
+	// Several textures share an upload page, so the copy has to start at this allocation's offset, which
+	// CopyTextureRegion wants aligned to D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT.
+	CommandContext& Context = GetContext();
+	DynAlloc mem = Context.ReserveUploadMemory((size_t)UploadBufferSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	Context.TransitionResource(Dest, D3D12_RESOURCE_STATE_COPY_DEST, true);
+	UpdateSubresources(Context.GetCommandList(), Dest.GetResource(), mem.Buffer.GetResource(), mem.Offset, 0, NumSubresources, SubData);
+	Context.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	OnUploadAdded((size_t)UploadBufferSize);
+}
+
+void UploadBatch::AddBuffer(GpuResource& Dest, const void* Data, size_t NumBytes, size_t DestOffset)
+{
+	ASSERT(Data != nullptr && NumBytes > 0);
+
+	CommandContext& Context = GetContext();
+	DynAlloc mem = Context.ReserveUploadMemory(NumBytes);
+	memcpy(mem.DataPtr, Data, NumBytes);
+	Context.CopyBufferRegion(Dest, DestOffset, mem.Buffer, mem.Offset, NumBytes);
+	Context.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	OnUploadAdded(NumBytes);
+}
+
+UploadTicket UploadBatch::Submit(bool WaitForCompletion)
+{
+	if (m_Context != nullptr)
+	{
+		m_LastTicket.FenceValue = m_Context->Finish(WaitForCompletion);
+		m_Context = nullptr;
+		m_PendingBytes = 0;
+		m_NumPendingUploads = 0;
+		++m_NumSubmits;
+	}
+	else if (WaitForCompletion)
+	{
+		m_LastTicket.Wait();
+	}
+	return m_LastTicket;
+}
+
+UploadBatch::Scope::Scope(UploadBatch& Batch) : m_Previous(s_CurrentBatch)
+{
+	s_CurrentBatch = &Batch;
+}
+
+UploadBatch::Scope::~Scope()
+{
+	s_CurrentBatch = m_Previous;
+}
+
+UploadBatch* UploadBatch::GetCurrent(void)
+{
+	return s_CurrentBatch;
+}
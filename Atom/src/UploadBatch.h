@@ -0,0 +1,76 @@
+#pragma once
+
+#include "GpuResource.h"
+#include <string>
+
+class CommandContext;
+
+// Fence of a submitted upload batch.  Work submitted to the graphics queue later is ordered after the
+// copies anyway; waiting is only needed before reading the destination on the CPU or on another queue.
+struct UploadTicket
+{
+	uint64_t FenceValue = 0;     // 0 when nothing was submitted
+
+	bool IsComplete(void) const;
+	void Wait(void) const;
+};
+
+// Records texture and buffer initializations into one command list instead of one blocking Finish(true)
+// per resource.  The source data is copied into the context's upload pages (LinearAllocator) as soon as a
+// copy is added, so callers can free it right away; the pages are recycled once the batch's fence passes.
+//
+// While an UploadBatch::Scope is alive, CommandContext::InitializeTexture() and InitializeBuffer() on that
+// thread add to its batch, which lets existing loaders batch without changes.
+class UploadBatch
+{
+public:
+	// A batch submits itself once this much upload memory is pending, so a large scene does not keep all of
+	// its texels in upload pages at the same time.
+	static const size_t kDefaultFlushThreshold = 64 << 20;
+
+	explicit UploadBatch(const std::wstring& ID = L"Upload Batch", size_t FlushThreshold = kDefaultFlushThreshold);
+	// Submits whatever is still pending without waiting.
+	~UploadBatch();
+
+	UploadBatch(const UploadBatch&) = delete;
+	UploadBatch& operator=(const UploadBatch&) = delete;
+
+	void AddTexture(GpuResource& Dest, UINT NumSubresources, const D3D12_SUBRESOURCE_DATA SubData[]);
+	void AddBuffer(GpuResource& Dest, const void* Data, size_t NumBytes, size_t DestOffset = 0);
+
+	// Executes the copies recorded so far.  Returns the ticket of the last submission if nothing is pending.
+	UploadTicket Submit(bool WaitForCompletion = false);
+
+	size_t GetPendingBytes(void) const { return m_PendingBytes; }
+	uint32_t GetNumPendingUploads(void) const { return m_NumPendingUploads; }
+	uint32_t GetNumSubmits(void) const { return m_NumSubmits; }
+	UploadTicket GetLastTicket(void) const { return m_LastTicket; }
+
+	class Scope
+	{
+	public:
+		explicit Scope(UploadBatch& Batch);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		UploadBatch* m_Previous;
+	};
+
+	// The batch of the innermost Scope on this thread, or nullptr.
+	static UploadBatch* GetCurrent(void);
+
+private:
+	CommandContext& GetContext(void);
+	void OnUploadAdded(size_t NumBytes);
+
+	std::wstring m_ID;
+	size_t m_FlushThreshold;
+	CommandContext* m_Context;
+	size_t m_PendingBytes;
+	uint32_t m_NumPendingUploads;
+	uint32_t m_NumSubmits;
+	UploadTicket m_LastTicket;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Chase-Lev work-stealing deque of pointers, with the memory orders of Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models" (2013).  One owner thread pushes and pops at the bottom; any thread may
+// steal from the top.  The capacity is fixed, so Push() fails instead of growing and the caller runs the item
+// itself; a buffer that never moves needs no reclamation of old ones while thieves may still read them.
+template <typename T>
+class WorkStealingDeque
+{
+public:
+	// capacity must be a power of two.
+	explicit WorkStealingDeque(uint32_t capacity) :
+		m_Buffer(new std::atomic<T*>[capacity]), m_Mask((int64_t)capacity - 1)
+	{
+		ASSERT(capacity != 0 && (capacity & (capacity - 1)) == 0, "Capacity must be a power of two");
+	}
+
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+	// Owner only.
+	bool Push(T* item)
+	{
+		const int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+		const int64_t top = m_Top.load(std::memory_order_acquire);
+		if (bottom - top > m_Mask)
+			return false;
+
+		m_Buffer[bottom & m_Mask].store(item, std::memory_order_relaxed);
+		// Release rather than the paper's fence + relaxed store, so that a thief's acquire of m_Bottom also
+		// orders what the item points to.
+		m_Bottom.store(bottom + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Owner only.  Takes the newest item, or nullptr when empty.
+	T* Pop(void)
+	{
+		const int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_Top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		T* item = m_Buffer[bottom & m_Mask].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			// The last item: race the thieves for it.
+			if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				item = nullptr;
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	// Any thread.  Takes the oldest item, or nullptr when empty or when another thread took it first.
+	T* Steal(void)
+	{
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+		if (top >= bottom)
+			return nullptr;
+
+		T* item = m_Buffer[top & m_Mask].load(std::memory_order_relaxed);
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return item;
+	}
+
+	// A snapshot, exact only on the owner thread while nobody steals.
+	uint32_t GetSize(void) const
+	{
+		const int64_t size = m_Bottom.load(std::memory_order_relaxed) - m_Top.load(std::memory_order_relaxed);
+		return size > 0 ? (uint32_t)size : 0;
+	}
+
+private:
+	std::unique_ptr<std::atomic<T*>[]> m_Buffer;
+	int64_t m_Mask;
+	// Apart, so that thieves bumping m_Top do not keep taking the owner's cache line.
+	alignas(64) std::atomic<int64_t> m_Top = 0;
+	alignas(64) std::atomic<int64_t> m_Bottom = 0;
+};
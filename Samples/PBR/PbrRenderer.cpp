@@ -18,18 +18,18 @@
 #include <d3d12shader.h>
 #include "FileSystem.h"
 #include "Model.h"
+#include "SphericalHarmonics.h"
+#include "IBLBaker.h"
+#include "MappedFile.h"
+#include "UploadBatch.h"
+#include "GpuHeapAllocator.h"
+#include "GpuMemory.h"
 
 namespace CS
 {
-#include "../CompiledShaders/SpecularBRDFCS.h"
-#include "../CompiledShaders/IrradianceMapCS.h"
 #include "../CompiledShaders/SpecularMapCS.h"
 #include "../CompiledShaders/EquirectToCubeCS.h"
 #include "../CompiledShaders/GenerateMipMapCS.h"
-#include "../CompiledShaders/Emu.h"
-#include "../CompiledShaders/Eavg.h"
-#include "../CompiledShaders/PreIntegralDiffuseSSSCS.h"
-#include "../CompiledShaders/PreIntegralSpecularSSSCS.h"
 
 }
 
@@ -37,6 +37,16 @@ namespace
 {
 	std::unordered_map<std::string, ComputePSO> s_IBL_PSOCache;
 
+	void UploadBakedTexture(GpuResource& dest, const IBL::TextureData& texture)
+	{
+		const D3D12_RESOURCE_DESC desc = dest.GetResource()->GetDesc();
+		ASSERT(desc.Format == texture.Format && desc.Width == texture.Width && desc.Height == texture.Height &&
+			desc.MipLevels == texture.MipLevels, "Baked texture does not match the GPU resource");
+
+		std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+		texture.GetSubresourceData(subresources);
+		CommandContext::InitializeTexture(dest, (UINT)subresources.size(), subresources.data());
+	}
 
 }
 
@@ -61,6 +71,7 @@ PbrRenderer::PbrRenderer(HINSTANCE hInstance)
 
 PbrRenderer::~PbrRenderer()
 {
+	GpuMemory::RemoveOverBudgetCallback(m_OverBudgetCallback);
 	ImGui_ImplDX12_Shutdown();
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
@@ -72,14 +83,62 @@ void PbrRenderer::Startup()
 
 	CommandContext& gfxContext = CommandContext::Begin(L"Scene Startup");
 
+	// Baked IBL textures, model textures and mesh buffers are all uploaded in one command list, submitted
+	// before gfxContext.  The GPU fallback passes submit their own context, so the source HDR is submitted ahead
+	// of them.
+	UploadBatch uploads(L"Startup Uploads");
+	UploadBatch::Scope uploadScope(uploads);
+
 	m_Camera.SetEyeAtUp(Vector3(0.0f, 0.0f, -20.0f), Vector3(kZero), Vector3(kYUnitVector));
 	m_Camera.SetZRange(0.1f, 10000.0f);
 	//m_Camera.SetAspectRatio((float)g_DisplayWidth / g_DisplayHeight);
 	m_CameraController.reset(new FlyingFPSCamera(m_Camera, Vector3(kYUnitVector)));
 
-	g_IBLTexture = TextureManager::LoadHdrFromFile(FileSystem::GetFullPath(L"Assets/Textures/EnvirMap/sun.hdr"));
+	// The environment cube, GGX radiance mips, BRDF LUT and SH irradiance are baked on the CPU and cached on disk
+	// keyed by the HDR contents, so only the first launch for a given environment pays for the bake.
+	IBL::BakedEnvironment bakedEnvironment;
+	const std::string cacheDir = FileSystem::GetFullPath("Assets/Cache/IBL");
+	m_UseBakedIBL = IBL::LoadOrBakeEnvironment(FileSystem::GetFullPath("Assets/Textures/EnvirMap/sun.hdr"), cacheDir, bakedEnvironment);
+	if (m_UseBakedIBL)
+	{
+		UploadBakedTexture(g_EnvirMap, bakedEnvironment.EnvirMap);
+		UploadBakedTexture(g_RadianceMap, bakedEnvironment.RadianceMap);
+		m_IrradianceSH = SH::PackIrradianceConstants(bakedEnvironment.IrradianceSH);
+	}
+	else
+	{
+		// std::ifstream could not open the narrow path but the wide path loader still can, fall back to the GPU passes.
+		const std::wstring hdrPath = FileSystem::GetFullPath(L"Assets/Textures/EnvirMap/sun.hdr");
+		g_IBLTexture = TextureManager::LoadHdrFromFile(hdrPath);
+
+		// The bake projects the diffuse SH as well, so do it here from the same wide path.
+		MappedFile hdrFile;
+		int width = 0, height = 0, channels = 0;
+		float* pixels = hdrFile.Open(hdrPath) ?
+			stbi_loadf_from_memory(hdrFile.GetData(), (int)hdrFile.GetSize(), &width, &height, &channels, 4) : nullptr;
+		ASSERT(pixels != nullptr, "Failed to load environment map for SH projection");
+		if (pixels != nullptr)
+		{
+			const SH::SH9Color radiance = SH::ProjectEquirect(pixels, (uint32_t)width, (uint32_t)height);
+			m_IrradianceSH = SH::PackIrradianceConstants(SH::ConvolveIrradiance(radiance));
+			stbi_image_free(pixels);
+		}
+	}
+
+	IBL::LookupTables lookupTables;
+	IBL::LoadOrBakeLookupTables(cacheDir, lookupTables);
+	UploadBakedTexture(g_LUT, lookupTables.BRDFLut);
+	UploadBakedTexture(g_Emu, lookupTables.Emu);
+	UploadBakedTexture(g_Eavg, lookupTables.Eavg);
+	UploadBakedTexture(g_SSSDiffuseLut, lookupTables.SSSDiffuse);
+	UploadBakedTexture(g_SSSSpecularLut, lookupTables.SSSSpecular);
 
-	PrecomputeCubemaps(gfxContext);
+	if (!m_UseBakedIBL)
+	{
+		// PrecomputeCubemaps() finishes its own context on the same queue; the HDR copy has to be queued first.
+		uploads.Submit();
+		PrecomputeCubemaps(gfxContext);
+	}
 
 	// Setup Dear ImGui context
 	IMGUI_CHECKVERSION();
@@ -139,17 +198,27 @@ void PbrRenderer::Startup()
 
 	Model skyBox, pbrModel, pbrModel2;
 	skyBox = LoadGltfModel(FileSystem::GetFullPath("Assets/Models/cube.glb"));
-	pbrModel = LoadGltfModel(FileSystem::GetFullPath("Assets/Models/DamagedHelmet/DamagedHelmet.gltf"));
+	pbrModel = LoadGltfModel(FileSystem::GetFullPath("Assets/Models/DamagedHelmet/DamagedHelmet.gltf"), m_PackTextures);
 	//pbrModel.
 	m_SkyBox.model = std::move(skyBox);
 	m_Scene.Models.push_back(std::move(pbrModel));
 	m_Scene.Models.push_back(std::move(pbrModel2));
-	m_MaterialConstants.resize(m_Scene.Models.size());
 
 	s_IBL_PSOCache.clear();
 
+	uploads.Submit();
 	gfxContext.Finish(true);
 
+	GpuHeapAllocator::PrintStats();
+	GpuMemory::PrintStats();
+
+	// Give memory back through the texture streamer when the OS lowers the budget; runs on this thread, from
+	// Display::Present().
+	m_OverBudgetCallback = GpuMemory::AddOverBudgetCallback([this](const GpuMemoryTracker::BudgetInfo& budget)
+	{
+		const int excessMB = (int)((budget.CurrentUsage - budget.Budget) >> 20) + 1;
+		m_TextureBudgetMB = std::max(16, m_TextureBudgetMB - excessMB);
+	});
 }
 
 
@@ -165,6 +234,15 @@ void PbrRenderer::Update(float gt)
 	
 	m_CameraController->Update(gt);
 
+	for (Model& model : m_Scene.Models)
+		model.RequestTextureResolution(m_Camera, g_RendererSize.y);
+
+	TextureManager::SetStreamingBudget((uint64_t)m_TextureBudgetMB << 20);
+	if (TextureManager::UpdateStreaming())
+	{
+		for (Model& model : m_Scene.Models)
+			model.RefreshMaterialSRVs();
+	}
 }
 
 void PbrRenderer::RenderScene()
@@ -261,6 +339,11 @@ void PbrRenderer::RenderScene()
 	ImGui::Checkbox("UseEmu", &m_ShaderAttribs.UseEmu);
 	ImGui::Checkbox("UseSSS", &m_ShaderAttribs.UseSSS);
 
+	TextureResidencyManager::Stats streaming = TextureManager::GetStreamingStats();
+	ImGui::SliderInt("Texture budget (MB)", &m_TextureBudgetMB, 16, 2048);
+	ImGui::Text("Streamed textures: %u, %.1f MB resident, %.1f MB peak", streaming.NumTextures,
+		streaming.ResidentBytes / 1048576.0, streaming.PeakBytes / 1048576.0);
+
 	static struct
 	{
 		Vector3 Translate{ kIdentity };
@@ -305,6 +388,7 @@ void PbrRenderer::RenderScene()
 
 	// ------------------------------------------ Z PrePass -------------------------------------------------
 
+	BeginFramePass(GraphicsContext, kZPrePass);
 	GraphicsContext.TransitionResource(g_SceneNormalBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
 	GraphicsContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 
@@ -313,7 +397,7 @@ void PbrRenderer::RenderScene()
 
 	GraphicsContext.SetRenderTarget(g_SceneNormalBuffer.GetRTV(), g_SceneDepthBuffer.GetDSV());
 	GraphicsContext.SetRootSignature(s_RootSig);
-	GraphicsContext.SetPipelineState(s_PSOs["drawNormals"]);
+	GraphicsContext.SetPipelineState(GetPSO("drawNormals"));
 
 
 	{
@@ -341,7 +425,7 @@ void PbrRenderer::RenderScene()
 
 	// --------------------------------- Shadow Map ----------------------------------
 	
-
+	BeginFramePass(GraphicsContext, kShadowPass);
 	GraphicsContext.TransitionResource(g_ShadowBuffer,D3D12_RESOURCE_STATE_DEPTH_WRITE);
 
 	GraphicsContext.ClearDepthAndStencil(g_ShadowBuffer);
@@ -354,7 +438,7 @@ void PbrRenderer::RenderScene()
 	}
 
 	GraphicsContext.SetRootSignature(s_RootSig);
-	GraphicsContext.SetPipelineState(s_PSOs["shadow"]);
+	GraphicsContext.SetPipelineState(GetPSO("shadow"));
 
 	GraphicsContext.SetDynamicConstantBufferView(kCommonCBV, sizeof(GlobalConstants), &m_ShadowPassGlobalConstants);
 
@@ -374,14 +458,17 @@ void PbrRenderer::RenderScene()
 	
 	
 	// ----------------------------------- Render SSAO --------------------------------
+	BeginFramePass(GraphicsContext, kSsaoPass);
 	SSAO::Render(GraphicsContext, m_Camera);
 
 	// ----------------------------------- Render Color ------------------------------
 
+	BeginFramePass(GraphicsContext, kColorPass);
 	GraphicsContext.SetRootSignature(s_RootSig);
-	GraphicsContext.SetPipelineState(s_PSOs["opaque"]);
+	GraphicsContext.SetPipelineState(GetPSO("opaque"));
 
 	GraphicsContext.GetCommandList()->SetGraphicsRootDescriptorTable(Renderer::kCommonSRVs, Renderer::m_CommonTextures);
+	GraphicsContext.GetCommandList()->SetGraphicsRootDescriptorTable(Renderer::kMaterialSRVs, Renderer::s_TextureHeap[0]);
 	
 	GraphicsContext.GetCommandList()->RSSetViewports(1, &g_ViewPort);
 	GraphicsContext.GetCommandList()->RSSetScissorRects(1, &g_Rect);
@@ -396,12 +483,10 @@ void PbrRenderer::RenderScene()
 	GraphicsContext.SetDynamicConstantBufferView(kCommonCBV, sizeof(GlobalConstants), &m_LightPassGlobalConstants);
 
 	GraphicsContext.SetDynamicConstantBufferView(kShaderParams, sizeof(ShaderParams), &m_ShaderAttribs);
+	GraphicsContext.SetDynamicConstantBufferView(kIrradianceSH, sizeof(IrradianceSHConstants), &m_IrradianceSH);
 
 	for (int i = 0; i < m_Scene.Models.size(); i++)
 	{
-		{
-			m_MaterialConstants[i].gMatIndex = i;
-		}
 		{
 			m_Scene.Models[i].UpdateConstants();
 			Matrix4 T(
@@ -414,7 +499,6 @@ void PbrRenderer::RenderScene()
 
 		}
 		GraphicsContext.SetDynamicConstantBufferView(kMeshConstants, sizeof(MeshConstants), &m_Scene.Models[i].m_MeshConstants);
-		GraphicsContext.SetDynamicConstantBufferView(kMaterialConstants, sizeof(MaterialConstants), &m_MaterialConstants[i]);
 
 		m_Scene.Models[i].Draw(GraphicsContext.GetCommandList());
 	}   
@@ -448,6 +532,46 @@ void PbrRenderer::RenderScene()
 	ImGui::Text("GameCore average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
 
 	ImGui::End();
+
+	ImGui::Begin("GPU Memory");
+	const GpuMemoryTracker::Stats memory = GpuMemory::GetStats();
+	if (memory.Budget.Budget != 0)
+	{
+		char usage[64];
+		snprintf(usage, sizeof(usage), "%.0f / %.0f MB", memory.Budget.CurrentUsage / 1048576.0, memory.Budget.Budget / 1048576.0);
+		ImGui::ProgressBar((float)((double)memory.Budget.CurrentUsage / memory.Budget.Budget), ImVec2(-1.0f, 0.0f), usage);
+		if (memory.Budget.IsOverBudget())
+			ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Over budget");
+	}
+	if (ImGui::BeginTable("Categories", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+	{
+		ImGui::TableSetupColumn("Category");
+		ImGui::TableSetupColumn("MB");
+		ImGui::TableSetupColumn("Peak MB");
+		ImGui::TableSetupColumn("Objects");
+		ImGui::TableHeadersRow();
+		for (uint32_t i = 0; i < GpuMemoryTracker::kNumCategories; ++i)
+		{
+			const GpuMemoryTracker::CategoryStats& category = memory.Categories[i];
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::TextUnformatted(GpuMemoryTracker::GetCategoryName((GpuMemoryTracker::Category)i));
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", category.Bytes / 1048576.0);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", category.PeakBytes / 1048576.0);
+			ImGui::TableNextColumn(); ImGui::Text("%u", category.Count);
+		}
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn(); ImGui::TextUnformatted("Total");
+		ImGui::TableNextColumn(); ImGui::Text("%.1f", memory.TotalBytes / 1048576.0);
+		ImGui::TableNextColumn(); ImGui::Text("%.1f", memory.PeakTotalBytes / 1048576.0);
+		ImGui::EndTable();
+	}
+	// Placed resources are counted in their categories; what their heaps hold beyond that is not.
+	const GpuHeapAllocator::Stats heaps = GpuHeapAllocator::GetStats();
+	uint64_t heapSlack = 0;
+	for (const TlsfBlockPool::Stats& pool : heaps.Pools)
+		heapSlack += pool.ReservedBytes - pool.UsedBytes;
+	ImGui::Text("Unused in placed resource heaps: %.1f MB", heapSlack / 1048576.0);
+	ImGui::End();
 	
 	
 
@@ -517,35 +641,10 @@ void PbrRenderer::PrecomputeCubemaps(CommandContext& gfxContext)
 	s_IBL_PSOCache["PrefilterSpecularMap"].SetComputeShader(g_pSpecularMapCS, sizeof(g_pSpecularMapCS));
 	s_IBL_PSOCache["PrefilterSpecularMap"].Finalize();
 
-	s_IBL_PSOCache["PrecomputeIrradianceMap"].SetRootSignature(s_ComputeRootSig);
-	s_IBL_PSOCache["PrecomputeIrradianceMap"].SetComputeShader(g_pIrradianceMapCS, sizeof(g_pIrradianceMapCS));
-	s_IBL_PSOCache["PrecomputeIrradianceMap"].Finalize();
-
-	s_IBL_PSOCache["PrecomputeBRDF"].SetRootSignature(s_ComputeRootSig);
-	s_IBL_PSOCache["PrecomputeBRDF"].SetComputeShader(g_pSpecularBRDFCS, sizeof(g_pSpecularBRDFCS));
-	s_IBL_PSOCache["PrecomputeBRDF"].Finalize();
-
-	s_IBL_PSOCache["emu"].SetRootSignature(s_ComputeRootSig);
-	s_IBL_PSOCache["emu"].SetComputeShader(g_pEmu, sizeof(g_pEmu));
-	s_IBL_PSOCache["emu"].Finalize();
-
-	s_IBL_PSOCache["eavg"].SetRootSignature(s_ComputeRootSig);
-	s_IBL_PSOCache["eavg"].SetComputeShader(g_pEavg, sizeof(g_pEavg));
-	s_IBL_PSOCache["eavg"].Finalize();
-
-	s_IBL_PSOCache["PreintegralDiffuseSSS"].SetRootSignature(s_ComputeRootSig);
-	s_IBL_PSOCache["PreintegralDiffuseSSS"].SetComputeShader(g_pPreIntegralDiffuseSSSCS, sizeof(g_pPreIntegralDiffuseSSSCS));
-	s_IBL_PSOCache["PreintegralDiffuseSSS"].Finalize();
-
-	s_IBL_PSOCache["PreintegralSpecularSSS"].SetRootSignature(s_ComputeRootSig);
-	s_IBL_PSOCache["PreintegralSpecularSSS"].SetComputeShader(g_pPreIntegralSpecularSSSCS, sizeof(g_pPreIntegralSpecularSSSCS));
-	s_IBL_PSOCache["PreintegralSpecularSSS"].Finalize();
+	ComputeContext.SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, Renderer::s_TextureHeap.GetHeapPointer());
+	ComputeContext.SetRootSignature(s_ComputeRootSig);
 
 	{
-
-		ComputeContext.SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, Renderer::s_TextureHeap.GetHeapPointer());
-
-		ComputeContext.SetRootSignature(s_ComputeRootSig);
 		ComputeContext.SetPipelineState(s_IBL_PSOCache["EquirectToCube"]);
 
 		ComputeContext.TransitionResource(g_EnvirMap, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
@@ -601,67 +700,5 @@ void PbrRenderer::PrecomputeCubemaps(CommandContext& gfxContext)
 		
 		
 		
-	// create irradiance map compute pso
-	{	
-		
-		ComputeContext.SetPipelineState(s_IBL_PSOCache["PrecomputeIrradianceMap"]);
-
-
-		ComputeContext.SetDynamicDescriptor(0, 0, g_EnvirMap.GetSRV());
-		ComputeContext.SetDynamicDescriptor(1, 0, g_IrradianceMap.GetUAV());
-		ComputeContext.TransitionResource(g_IrradianceMap, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-
-		ComputeContext.Dispatch(2, 2, 6);
-		ComputeContext.TransitionResource(g_IrradianceMap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-	}
-		
-		
-	{	
-		
-		ComputeContext.SetPipelineState(s_IBL_PSOCache["PrecomputeBRDF"]);
-		
-		ComputeContext.SetDynamicDescriptor(1, 0, g_LUT.GetUAV());
-		ComputeContext.TransitionResource(g_LUT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-
-		ComputeContext.Dispatch(512/32, 512/32, 1);
-		ComputeContext.TransitionResource(g_LUT, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-
-	}	
-		
-	{	
-
-		ComputeContext.SetPipelineState(s_IBL_PSOCache["emu"]);
-		ComputeContext.SetDynamicDescriptor(1, 0, g_Emu.GetUAV());
-		ComputeContext.TransitionResource(g_Emu, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		ComputeContext.Dispatch(512 / 32, 512 / 32, 1);
-		ComputeContext.TransitionResource(g_Emu, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-	}	
-		
-	{
-		ComputeContext.SetPipelineState(s_IBL_PSOCache["eavg"]);
-
-		ComputeContext.SetDynamicDescriptor(1, 0, g_Eavg.GetUAV());
-		ComputeContext.TransitionResource(g_Eavg, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		ComputeContext.Dispatch(512 / 32, 512 / 32, 1);
-		ComputeContext.TransitionResource(g_Eavg, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-	}
-
-	{
-		ComputeContext.SetPipelineState(s_IBL_PSOCache["PreintegralDiffuseSSS"]);
-
-		ComputeContext.SetDynamicDescriptor(1, 0, g_SSSDiffuseLut.GetUAV());
-		ComputeContext.TransitionResource(g_SSSDiffuseLut, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		ComputeContext.Dispatch(512 / 32, 512 / 32, 1);
-		ComputeContext.TransitionResource(g_SSSDiffuseLut, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-	}
-
-	{
-		ComputeContext.SetPipelineState(s_IBL_PSOCache["PreintegralSpecularSSS"]);
-
-		ComputeContext.SetDynamicDescriptor(1, 0, g_SSSSpecularLut.GetUAV());
-		ComputeContext.TransitionResource(g_SSSSpecularLut, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		ComputeContext.Dispatch(512 / 32, 512 / 32, 1);
-		ComputeContext.TransitionResource(g_SSSSpecularLut, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-	}
 	ComputeContext.Finish();
 }
\ No newline at end of file
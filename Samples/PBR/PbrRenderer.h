@@ -73,8 +73,13 @@ private:
 
     GlobalConstants m_ShadowPassGlobalConstants = {};
     GlobalConstants m_LightPassGlobalConstants = {};
+    IrradianceSHConstants m_IrradianceSH;
+    bool m_UseBakedIBL = false;
+    int m_TextureBudgetMB = 256;
+    uint32_t m_OverBudgetCallback = ~0u;
+    // Packed model textures are not streamed; turn off to exercise the streamer with one texture per image.
+    bool m_PackTextures = true;
 
-    std::vector<MaterialConstants> m_MaterialConstants;
 
     Scene m_Scene;
     SkyBox m_SkyBox;